@@ -62,6 +62,7 @@
  #define configUSE_NEWLIB_REENTRANT              0 // Desabilita o suporte à reentrância da biblioteca Newlib.
  #define configENABLE_BACKWARD_COMPATIBILITY     0 // Desabilita a compatibilidade com versões antigas do FreeRTOS.
  #define configNUM_THREAD_LOCAL_STORAGE_POINTERS 5 // Define o número de ponteiros de armazenamento local para cada thread/tarefa.
+ #define configTASK_NOTIFICATION_ARRAY_ENTRIES   6 // Número de notificações indexadas por tarefa. O índice 0 fica livre, o 1 é do barramento de nível, o 2 do DMA do display, o 3 dos blocos do ADC, o 4 do eco do ultrassônico e o 5 da janela de gravação da flash.
  
  /* System */
  #define configSTACK_DEPTH_TYPE                  uint32_t //  Define o tipo de dados usado para especificar o tamanho da pilha de uma tarefa.
@@ -74,7 +75,7 @@
  #define configAPPLICATION_ALLOCATED_HEAP        0 //  Indica se o heap é alocado pela aplicação ou pelo FreeRTOS. Neste caso pelo FreeRTOS
  
  /* Hook function related definitions. */
- #define configCHECK_FOR_STACK_OVERFLOW          0 // Desabilita a verificação de estouro de pilha.
+ #define configCHECK_FOR_STACK_OVERFLOW          2 // Verifica o fim da pilha a cada troca de contexto; estouro chama vApplicationStackOverflowHook (main.c).
  #define configUSE_MALLOC_FAILED_HOOK            0 // Desabilita a função de hook para falhas de alocação de memória.
  #define configUSE_DAEMON_TASK_STARTUP_HOOK      0 // Desabilita o hook de inicialização da tarefa Daemon (ou Timer Service).
  
@@ -101,9 +102,17 @@
  */
  
  /* SMP port only */
- #define configNUM_CORES                         1 // Define o número de núcleos que o FreeRTOS pode usar.
- #define configTICK_CORE                         1 // Define qual núcleo gerencia o tick do FreeRTOS.
+ #ifndef APP_MULTICORE
+ #define APP_MULTICORE                           1 // 1 divide as tasks entre os dois núcleos, 0 roda tudo em um núcleo (para comparar a latência)
+ #endif
+ #if APP_MULTICORE
+ #define configNUM_CORES                         2 // Define o número de núcleos que o FreeRTOS pode usar.
+ #define configUSE_CORE_AFFINITY                 1 // Permite fixar cada task em um núcleo (xTaskCreateAffinitySet).
  #define configRUN_MULTIPLE_PRIORITIES           1 // Permite que o escalonador execute tarefas de diferentes prioridades em paralelo (em um sistema multi-core).
+ #else
+ #define configNUM_CORES                         1 // Sem afinidade: com um núcleo o kernel a rejeita, e CREATE_TASK usa xTaskCreate
+ #endif
+ #define configTICK_CORE                         0 // Define qual núcleo gerencia o tick do FreeRTOS.
  
  /* RP2040 specific */
  #define configSUPPORT_PICO_SYNC_INTEROP         1 // Habilita a interoperabilidade de sincronização com o SDK do Pico.
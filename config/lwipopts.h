@@ -4,7 +4,25 @@
 // Generally you would define your own explicit list of lwIP options
 // (see https://www.nongnu.org/lwip/2_1_x/group__lwip__opts.html)
 //
+// lwIP integrado ao FreeRTOS (pico_cyw43_arch_lwip_sys_freertos): a pilha roda na tcpip thread,
+// acordada pela chegada dos pacotes, e as outras tasks usam LOCK_TCPIP_CORE para acessá-la
+#define NO_SYS                      0
+
 // This example uses a common include to avoid repetition
 #include "lwipopts_examples_common.h"
 
+#if !NO_SYS
+#define TCPIP_THREAD_STACKSIZE      1024 // Pilha da tcpip thread, onde rodam os callbacks do servidor HTTP
+#define TCPIP_THREAD_PRIO           2    // Mesma prioridade da task do web server
+#define DEFAULT_THREAD_STACKSIZE    1024
+#define DEFAULT_RAW_RECVMBOX_SIZE   8
+#define TCPIP_MBOX_SIZE             8    // Mensagens pendentes para a tcpip thread
+#define LWIP_TIMEVAL_PRIVATE        0
+#define LWIP_TCPIP_CORE_LOCKING     1    // Permite chamar a API raw de outras tasks com LOCK_TCPIP_CORE
+#define LWIP_TCPIP_CORE_LOCKING_INPUT 1  // Pacotes recebidos são processados direto com a trava, sem passar pela mbox
+#endif
+
+// Cada cliente de /eventos mantém uma conexão aberta: espaço para os 8 slots do servidor e a escuta
+#define MEMP_NUM_TCP_PCB            10
+
 #endif
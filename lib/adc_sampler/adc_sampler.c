@@ -0,0 +1,99 @@
+#include "adc_sampler.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/clocks.h"
+
+static uint16_t blocks[ADC_SAMPLER_NUM_BLOCKS][ADC_SAMPLER_BLOCK_SIZE] __attribute__((aligned(4)));
+static int dma_chan[ADC_SAMPLER_NUM_BLOCKS];
+static volatile uint32_t block_seq = 0; // Quantidade de blocos completados desde o início
+static adc_sampler_callback_t block_callback = NULL;
+static void *block_ctx = NULL;
+
+static void adc_sampler_irq_handler(void)
+{
+    for (uint8_t i = 0; i < ADC_SAMPLER_NUM_BLOCKS; i++)
+    {
+        if (!dma_channel_get_irq0_status(dma_chan[i]))
+            continue;
+        dma_channel_acknowledge_irq0(dma_chan[i]);
+
+        // O outro canal já assumiu a captura pelo encadeamento, então este é só rearmado
+        // para quando o encadeamento voltar para ele
+        dma_channel_set_write_addr(dma_chan[i], blocks[i], false);
+
+        uint32_t seq = block_seq++;
+        if (block_callback)
+            block_callback(seq, block_ctx);
+    }
+}
+
+#define ADC_CYCLES_PER_SAMPLE 96 // Duração de uma conversão em ciclos do clock do ADC
+#define ADC_CLKDIV_MAX 65535.99609375f // Maior divisor de 16.8 bits: parte inteira 0xFFFF, fração 255/256
+
+bool adc_sampler_init(uint input, uint32_t sample_rate_hz, adc_sampler_callback_t callback, void *ctx)
+{
+    // Uma conversão a cada (div + 1) ciclos do clock do ADC. Fora do alcance o divisor estouraria
+    // ou ficaria negativo, e a taxa real seria outra sem aviso
+    uint32_t adc_hz = clock_get_hz(clk_adc);
+    if (sample_rate_hz == 0 || sample_rate_hz > adc_hz / ADC_CYCLES_PER_SAMPLE)
+        return false;
+    float clkdiv = (float)adc_hz / sample_rate_hz - 1.0f;
+    if (clkdiv > ADC_CLKDIV_MAX)
+        return false;
+
+    block_callback = callback;
+    block_ctx = ctx;
+
+    adc_gpio_init(26 + input);
+    adc_init();
+    adc_select_input(input);
+    adc_set_round_robin(0);
+    // FIFO habilitada com DREQ a cada amostra, sem flag de erro e sem reduzir para 8 bits
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_clkdiv(clkdiv);
+
+    for (uint8_t i = 0; i < ADC_SAMPLER_NUM_BLOCKS; i++)
+        dma_chan[i] = dma_claim_unused_channel(true);
+
+    for (uint8_t i = 0; i < ADC_SAMPLER_NUM_BLOCKS; i++)
+    {
+        dma_channel_config cfg = dma_channel_get_default_config(dma_chan[i]);
+        channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+        channel_config_set_read_increment(&cfg, false);
+        channel_config_set_write_increment(&cfg, true);
+        channel_config_set_dreq(&cfg, DREQ_ADC);
+        channel_config_set_chain_to(&cfg, dma_chan[(i + 1) % ADC_SAMPLER_NUM_BLOCKS]); // Ping-pong
+        dma_channel_configure(dma_chan[i], &cfg, blocks[i], &adc_hw->fifo, ADC_SAMPLER_BLOCK_SIZE, false);
+        dma_channel_set_irq0_enabled(dma_chan[i], true);
+    }
+
+    irq_add_shared_handler(DMA_IRQ_0, adc_sampler_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+
+    adc_fifo_drain();
+    dma_channel_start(dma_chan[0]);
+    adc_run(true);
+    return true;
+}
+
+const uint16_t *adc_sampler_block(uint32_t seq)
+{
+    return blocks[seq % ADC_SAMPLER_NUM_BLOCKS];
+}
+
+uint16_t adc_sampler_block_average(uint32_t seq)
+{
+    const uint16_t *samples = adc_sampler_block(seq);
+    uint32_t total = 0;
+    for (uint16_t i = 0; i < ADC_SAMPLER_BLOCK_SIZE; i++)
+        total += samples[i];
+    return (total + ADC_SAMPLER_BLOCK_SIZE / 2) >> ADC_SAMPLER_BLOCK_SHIFT;
+}
+
+uint32_t adc_sampler_blocks_lost(uint32_t *expected_seq, uint32_t seq)
+{
+    uint32_t lost = *expected_seq ? seq - *expected_seq : 0; // Aritmética modular cobre o estouro do contador
+    *expected_seq = seq + 1;
+    return lost;
+}
@@ -0,0 +1,32 @@
+#ifndef ADC_SAMPLER_H
+#define ADC_SAMPLER_H
+
+#include "pico/stdlib.h"
+
+// Amostragem contínua de uma entrada do ADC: o ADC roda livre em uma taxa fixa e dois canais DMA
+// encadeados preenchem alternadamente os blocos de um buffer ping-pong, sem uso da CPU.
+// A cada bloco completo o callback é chamado (em contexto de interrupção) com o número de sequência
+// do bloco, que pode ser lido com adc_sampler_block() até o bloco seguinte ser completado.
+
+#define ADC_SAMPLER_BLOCK_SIZE 256 // Amostras por bloco (potência de 2 para a média ser só um deslocamento)
+#define ADC_SAMPLER_BLOCK_SHIFT 8  // log2(ADC_SAMPLER_BLOCK_SIZE)
+#define ADC_SAMPLER_NUM_BLOCKS 2   // Blocos do ping-pong
+
+typedef void (*adc_sampler_callback_t)(uint32_t block_seq, void *ctx);
+
+// Configura o ADC na entrada 'input' (0..3) amostrando a 'sample_rate_hz' e inicia a captura.
+// Retorna false, sem tocar no hardware, se a taxa não cabe no divisor do ADC: acima de uma conversão
+// a cada 96 ciclos (500 kHz) ou abaixo do maior divisor de 16.8 bits (~733 Hz)
+bool adc_sampler_init(uint input, uint32_t sample_rate_hz, adc_sampler_callback_t callback, void *ctx);
+
+// Retorna as amostras do bloco de sequência 'block_seq'
+const uint16_t *adc_sampler_block(uint32_t block_seq);
+
+// Média arredondada das amostras de um bloco
+uint16_t adc_sampler_block_average(uint32_t block_seq);
+
+// Blocos completados que o consumidor não leu antes de receber 'block_seq'. 'expected_seq' guarda
+// entre as chamadas o próximo bloco esperado (comece com 0: a primeira leitura nunca conta perdas)
+uint32_t adc_sampler_blocks_lost(uint32_t *expected_seq, uint32_t block_seq);
+
+#endif // ADC_SAMPLER_H
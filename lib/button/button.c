@@ -1,7 +1,11 @@
 #include "button.h"
+#include "hardware/gpio.h"
+#include "hardware/irq.h"
 
-volatile uint32_t last_debounce_time = 0;
-const uint8_t debounce_delay = 250;
+static button_t buttons[BUTTON_MAX_BUTTONS];
+static alarm_id_t alarms[BUTTON_MAX_BUTTONS]; // Alarme do próximo prazo de cada botão, 0 = nenhum
+static uint8_t num_buttons = 0;
+static QueueHandle_t event_queue = NULL;
 
 void button_init(uint8_t pin){
     gpio_init(pin);
@@ -25,27 +29,151 @@ void button_init_predefined(bool A,bool B,bool SW){
 
 }
 
-void button_setup_irq(bool A,bool B,bool SW,gpio_irq_callback_t callback){
+bool button_is_pressed(uint8_t pin){
 
-    gpio_set_irq_callback(callback);
+    return !gpio_get(pin);  // true se pressionado (nível baixo)
 
-    if (A && gpio_get(BUTTON_A))
-    {
-        gpio_set_irq_enabled(BUTTON_A, GPIO_IRQ_EDGE_FALL, true);
+}
+
+void button_fsm_init(button_t *button, uint8_t pin){
+    button->pin = pin;
+    button->pressed = false;
+    button->long_sent = false;
+    button->clicks = 0;
+    button->change_us = 0;
+    button->settle_us = 0;
+    button->press_us = 0;
+    button->click_us = 0;
+    button->release_us = 0;
+}
+
+void button_fsm_edge(button_t *button, uint64_t now_us){
+    if (!button->settle_us){
+        button->change_us = now_us; // O instante da mudança é o da primeira borda, não o fim do debounce
     }
-    if (B && gpio_get(BUTTON_B))
-    {
-        gpio_set_irq_enabled(BUTTON_B, GPIO_IRQ_EDGE_FALL, true);
+    button->settle_us = now_us + BUTTON_DEBOUNCE_US; // Cada repique adia a confirmação
+}
+
+static void button_emit(const button_t *button, uint8_t type, uint64_t press_us, button_event_t *events, uint8_t *n){
+    events[*n].pin = button->pin;
+    events[*n].type = type;
+    events[*n].time_ms = (uint32_t)(press_us / 1000);
+    (*n)++;
+}
+
+uint8_t button_fsm_poll(button_t *button, bool pressed, uint64_t now_us, button_event_t events[2]){
+    uint8_t n = 0;
+
+    // Fim do debounce: o nível de agora vale. Se voltou ao anterior, o surto foi só ruído
+    if (button->settle_us && now_us >= button->settle_us){
+        button->settle_us = 0;
+        if (pressed != button->pressed){
+            button->pressed = pressed;
+            if (pressed){
+                button->press_us = button->change_us;
+                button->long_sent = false;
+            }
+            else{
+                button->release_us = button->change_us;
+                if (!button->long_sent && ++button->clicks == 2){
+                    button->clicks = 0;
+                    button_emit(button, BUTTON_EVENT_DOUBLE, button->click_us, events, &n);
+                }
+                else if (button->clicks == 1){
+                    button->click_us = button->press_us;
+                }
+            }
+        }
     }
-    if (SW && gpio_get(BUTTON_SW))
-    {
-        gpio_set_irq_enabled(BUTTON_SW, GPIO_IRQ_EDGE_FALL, true);
+
+    if (button->pressed && !button->long_sent && now_us - button->press_us >= BUTTON_LONG_PRESS_MS * 1000ull){
+        if (button->clicks){
+            button_emit(button, BUTTON_EVENT_SHORT, button->click_us, events, &n); // O toque anterior vale sozinho
+            button->clicks = 0;
+        }
+        button->long_sent = true;
+        button_emit(button, BUTTON_EVENT_LONG, button->press_us, events, &n);
     }
-    
+    else if (!button->pressed && button->clicks && now_us - button->release_us >= BUTTON_DOUBLE_PRESS_MS * 1000ull){
+        button->clicks = 0;
+        button_emit(button, BUTTON_EVENT_SHORT, button->click_us, events, &n);
+    }
+    return n;
 }
 
-bool button_is_pressed(uint8_t pin){
+uint64_t button_fsm_deadline(const button_t *button){
+    uint64_t deadline = button->settle_us;
+    uint64_t other = 0;
+    if (button->pressed && !button->long_sent){
+        other = button->press_us + BUTTON_LONG_PRESS_MS * 1000ull;
+    }
+    else if (!button->pressed && button->clicks){
+        other = button->release_us + BUTTON_DOUBLE_PRESS_MS * 1000ull;
+    }
+    if (other && (!deadline || other < deadline)){
+        deadline = other;
+    }
+    return deadline;
+}
 
-    return !gpio_get(pin);  // true se pressionado (nível baixo)
+static int64_t button_alarm(alarm_id_t id, void *user_data){
+    (void)id;
+    uint8_t i = (uint8_t)(uintptr_t)user_data;
+    button_t *button = &buttons[i];
+    button_event_t events[2];
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    uint64_t now = time_us_64();
+
+    uint8_t n = button_fsm_poll(button, !gpio_get(button->pin), now, events);
+    for (uint8_t e = 0; e < n; e++){
+        xQueueSendFromISR(event_queue, &events[e], &higher_priority_task_woken); // Fila cheia: o evento é perdido
+    }
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+
+    uint64_t deadline = button_fsm_deadline(button);
+    if (!deadline){
+        alarms[i] = 0; // A próxima borda agenda de novo
+        return 0;
+    }
+    return deadline > now ? (int64_t)(deadline - now) : 1; // Reagenda este alarme a partir de agora
+}
+
+static void button_irq_handler(void){
+    uint64_t now = time_us_64(); // Registrado aqui, antes de qualquer atraso até o alarme
+    for (uint8_t i = 0; i < num_buttons; i++){
+        uint32_t events = gpio_get_irq_event_mask(buttons[i].pin);
+        if (!events){
+            continue;
+        }
+        gpio_acknowledge_irq(buttons[i].pin, events);
+        button_fsm_edge(&buttons[i], now);
+        // O alarme pendente pode estar no prazo da pressão longa ou do duplo: volta para o fim do debounce
+        if (alarms[i]){
+            cancel_alarm(alarms[i]);
+        }
+        alarm_id_t alarm = add_alarm_in_us(BUTTON_DEBOUNCE_US, button_alarm, (void *)(uintptr_t)i, true);
+        alarms[i] = alarm > 0 ? alarm : 0;
+    }
+}
 
+bool button_events_init(const uint8_t *pins, uint8_t count, QueueHandle_t queue){
+    if (count > BUTTON_MAX_BUTTONS || !queue){
+        return false;
+    }
+    event_queue = queue;
+    uint32_t mask = 0;
+    for (uint8_t i = 0; i < count; i++){
+        button_init(pins[i]);
+        button_fsm_init(&buttons[i], pins[i]);
+        alarms[i] = 0;
+        mask |= 1u << pins[i];
+    }
+    num_buttons = count;
+    // Tratador próprio só para estes pinos, como o eco do ultrassônico: não ocupa o callback único do GPIO
+    gpio_add_raw_irq_handler_masked(mask, button_irq_handler);
+    for (uint8_t i = 0; i < count; i++){
+        gpio_set_irq_enabled(pins[i], GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE, true);
+    }
+    irq_set_enabled(IO_IRQ_BANK0, true);
+    return true;
 }
@@ -2,14 +2,43 @@
 #define BUTTON_H
 
 #include "pico/stdlib.h"
+#include "FreeRTOS.h"
+#include "queue.h"
 
 // Pinos padrão para os botões
 #define BUTTON_A 5
 #define BUTTON_B 6
 #define BUTTON_SW 22
 
-extern volatile uint32_t last_debounce_time;
-extern const uint8_t debounce_delay;
+#define BUTTON_MAX_BUTTONS 3
+#define BUTTON_DEBOUNCE_US 20000     // O nível só é aceito depois deste tempo sem novas bordas
+#define BUTTON_LONG_PRESS_MS 800     // Pressionado por este tempo: pressão longa (avisada ainda com o botão apertado)
+#define BUTTON_DOUBLE_PRESS_MS 300   // Segundo toque até este tempo depois de soltar: toque duplo
+
+typedef enum {
+    BUTTON_EVENT_SHORT = 0,  // Toque simples, avisado quando a janela do duplo termina
+    BUTTON_EVENT_DOUBLE,
+    BUTTON_EVENT_LONG
+} button_event_type_t;
+
+typedef struct {
+    uint8_t pin;
+    uint8_t type;      // button_event_type_t
+    uint32_t time_ms;  // Aperto que iniciou o gesto (no duplo, o primeiro), pela borda registrada na interrupção
+} button_event_t;
+
+// Estado de um botão. Cada botão tem o seu: bordas de um não interferem no debounce de outro
+typedef struct {
+    uint8_t pin;
+    bool pressed;          // Último nível aceito (estável)
+    bool long_sent;        // A pressão atual já gerou BUTTON_EVENT_LONG
+    uint8_t clicks;        // Toques completos aguardando a janela do duplo
+    uint64_t change_us;    // Primeira borda do surto de bordas em andamento
+    uint64_t settle_us;    // Fim do debounce em andamento, 0 = nenhum
+    uint64_t press_us;     // Instante do último aperto aceito
+    uint64_t click_us;     // Aperto do toque que aguarda a janela do duplo
+    uint64_t release_us;   // Instante da última soltura aceita
+} button_t;
 
 // Inicializa um botão em qualquer pino
 void button_init(uint8_t pin);
@@ -17,11 +46,20 @@ void button_init(uint8_t pin);
 // Inicializa os botões padrão A, B e SW com pull-up interno
 void button_init_predefined(bool A, bool B, bool SW);
 
-// Configura interrupções para os botões A, B e SW
-void button_setup_irq(bool A, bool B, bool SW, gpio_irq_callback_t callback);
-
 // Retorna true se o botão estiver pressionado (nível baixo)
 bool button_is_pressed(uint8_t pin);
 
+// Lógica de um botão, sem acesso ao hardware. 'edge' registra uma borda (na interrupção);
+// 'poll' recebe o nível atual e trata os prazos vencidos, escrevendo até 2 eventos em 'events'
+// e retornando quantos; 'deadline' é o próximo instante em que 'poll' deve ser chamada (0 = nenhum)
+void button_fsm_init(button_t *button, uint8_t pin);
+void button_fsm_edge(button_t *button, uint64_t now_us);
+uint8_t button_fsm_poll(button_t *button, bool pressed, uint64_t now_us, button_event_t events[2]);
+uint64_t button_fsm_deadline(const button_t *button);
+
+// Configura os pinos com pull-up e interrupção nas duas bordas. Os eventos são entregues em 'queue'
+// (itens button_event_t) direto das interrupções, sem nenhuma task consultando os botões.
+// Deve ser chamada no núcleo 0, o mesmo do pool de alarmes: as duas interrupções nunca se interrompem
+bool button_events_init(const uint8_t *pins, uint8_t count, QueueHandle_t queue);
 
 #endif // BUTTON_H
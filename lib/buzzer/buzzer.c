@@ -15,13 +15,29 @@ int init_buzzer(uint pin, float clk_div)
     return slice_num; // Retorna o número do slice PWM
 }
 
-// Toca uma nota com a frequência e duração especificadas
+// Toca uma nota com a frequência especificada
 void play_tone(uint pin, uint frequency)
 {
     uint slice_num = pwm_gpio_to_slice_num(pin);
     uint32_t clock_freq = clock_get_hz(clk_sys);
-    uint32_t top = clock_freq / frequency - 1;
+    if (frequency == 0)
+    {
+        stop_tone(pin);
+        return;
+    }
 
+    // O contador tem 16 bits: o menor divisor (em 1/16, formato 8.4 do PWM) que deixa wrap <= 65535.
+    // Sem ajustar o divisor, clock / frequência passa de 65535 abaixo de ~2 kHz e o tom sai errado
+    uint64_t div16 = ((uint64_t)clock_freq * 16 + (uint64_t)frequency * 65536 - 1) / ((uint64_t)frequency * 65536);
+    if (div16 < 16)
+        div16 = 16;                 // Divisor mínimo 1,0
+    if (div16 > 255 * 16 + 15)
+        div16 = 255 * 16 + 15;      // Máximo 255 + 15/16: abaixo de ~8 Hz a nota fica mais aguda
+    uint32_t top = (uint32_t)((uint64_t)clock_freq * 16 / (div16 * frequency)) - 1;
+    if (top > 65535)
+        top = 65535;
+
+    pwm_set_clkdiv_int_frac(slice_num, div16 >> 4, div16 & 0xF);
     pwm_set_wrap(slice_num, top);
     pwm_set_gpio_level(pin, top / 2); // 50% de duty cycle
 }
@@ -29,6 +45,87 @@ void play_tone(uint pin, uint frequency)
 // Desliga o tom no pino do buzzer
 void stop_tone(uint pin)
 {
-    uint slice_num = pwm_gpio_to_slice_num(pin);
     pwm_set_gpio_level(pin, 0); // Desliga o PWM
-}
\ No newline at end of file
+}
+
+static int64_t buzzer_alarm(alarm_id_t id, void *user_data)
+{
+    (void)id;
+    uint32_t ms = buzzer_step(user_data);
+    // Negativo: o próximo disparo conta do instante agendado deste, sem acumular o atraso da interrupção
+    return ms ? -(int64_t)ms * 1000 : 0;
+}
+
+void buzzer_init(buzzer_t *buzzer, uint pin)
+{
+    buzzer->pin = pin;
+    buzzer->head = 0;
+    buzzer->tail = 0;
+    buzzer->active = false;
+    buzzer->remaining = 0;
+    buzzer->sounding = false;
+    buzzer->dropped = 0;
+    critical_section_init(&buzzer->lock);
+    init_buzzer(pin, 1.0f);
+}
+
+bool buzzer_play(buzzer_t *buzzer, const buzzer_pattern_t *pattern)
+{
+    uint32_t head = buzzer->head;
+    if (head - buzzer->tail >= BUZZER_QUEUE_LENGTH)
+    {
+        buzzer->dropped++;
+        return false;
+    }
+    buzzer->queue[head % BUZZER_QUEUE_LENGTH] = *pattern;
+    __dmb(); // O padrão fica visível antes do novo head
+    buzzer->head = head + 1;
+
+    critical_section_enter_blocking(&buzzer->lock);
+    bool start = !buzzer->active;
+    buzzer->active = true;
+    critical_section_exit(&buzzer->lock);
+    if (start && add_alarm_in_ms(1, buzzer_alarm, buzzer, true) <= 0)
+    {
+        buzzer->active = false; // Sem alarme livre: o padrão fica na fila e o próximo buzzer_play tenta de novo
+    }
+    return true;
+}
+
+uint32_t buzzer_step(buzzer_t *buzzer)
+{
+    if (buzzer->sounding)
+    {
+        stop_tone(buzzer->pin);
+        buzzer->sounding = false;
+        if (buzzer->current.off_ms)
+        {
+            return buzzer->current.off_ms; // Silêncio depois do tom
+        }
+    }
+    if (buzzer->remaining == 0)
+    {
+        critical_section_enter_blocking(&buzzer->lock);
+        bool empty = buzzer->tail == buzzer->head;
+        if (empty)
+        {
+            buzzer->active = false; // Decidido junto com o produtor: o próximo buzzer_play agenda de novo
+        }
+        critical_section_exit(&buzzer->lock);
+        if (empty)
+        {
+            return 0;
+        }
+        __dmb(); // Lê o padrão só depois de ver o head que o publicou
+        buzzer->current = buzzer->queue[buzzer->tail % BUZZER_QUEUE_LENGTH];
+        buzzer->tail++;
+        buzzer->remaining = buzzer->current.repeat ? buzzer->current.repeat : 1;
+    }
+    buzzer->remaining--;
+    if (buzzer->current.frequency_hz)
+    {
+        play_tone(buzzer->pin, buzzer->current.frequency_hz);
+    }
+    buzzer->sounding = true;
+    return buzzer->current.on_ms ? buzzer->current.on_ms : 1;
+}
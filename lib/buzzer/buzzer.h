@@ -3,12 +3,53 @@
 
 #include <stdlib.h>
 #include "pico/stdlib.h"
+#include "pico/sync.h"
 
 #define BUZZER_A_PIN 21 // GPIO para buzzer A
 #define BUZZER_B_PIN 10 // GPIO para buzzer B
 
-int init_buzzer(uint pin, float clk_div); // Inicializa o PWM no pino do buzzer
-void play_tone(uint pin, uint frequency); // Toca uma nota com a frequência e duração especificadas
+#define BUZZER_QUEUE_LENGTH 8 // Padrões aguardando para tocar (potência de 2)
+
+// Um padrão: 'repeat' vezes um tom de 'on_ms' seguido de 'off_ms' de silêncio.
+// Frequência 0 é uma pausa de 'on_ms'
+typedef struct {
+    uint16_t frequency_hz;
+    uint16_t on_ms;
+    uint16_t off_ms;
+    uint8_t repeat;        // 0 conta como 1
+} buzzer_pattern_t;
+
+// Sequenciador: quem toca só enfileira e retorna. Os padrões são tocados por um alarme de hardware,
+// que liga e desliga o PWM nos instantes certos sem nenhuma task esperando.
+// A fila é de um produtor (uma task) e um consumidor (o alarme), sem lock. Só a passagem do alarme
+// para parado (fila vazia) usa uma seção crítica curta, para um padrão enfileirado nesse instante
+// não ficar esquecido
+typedef struct {
+    uint pin;
+    buzzer_pattern_t queue[BUZZER_QUEUE_LENGTH];
+    volatile uint32_t head;   // Só o produtor altera
+    volatile uint32_t tail;   // Só o alarme altera
+    critical_section_t lock;
+    volatile bool active;     // Há um alarme agendado
+    // Estado do alarme
+    buzzer_pattern_t current;
+    uint8_t remaining;        // Repetições do padrão atual ainda não iniciadas
+    bool sounding;            // Tom ligado neste momento
+    uint32_t dropped;         // Padrões descartados com a fila cheia
+} buzzer_t;
+
+int init_buzzer(uint pin, float clk_div); // Inicializa o PWM no pino do buzzer (o divisor é refeito por play_tone)
+void play_tone(uint pin, uint frequency); // Toca uma nota com a frequência especificada até stop_tone
 void stop_tone(uint pin);                 // Desliga o tom no pino do buzzer
 
+// Inicializa o PWM do pino e o sequenciador
+void buzzer_init(buzzer_t *buzzer, uint pin);
+
+// Enfileira um padrão e retorna na hora. Retorna false (padrão descartado) com a fila cheia
+bool buzzer_play(buzzer_t *buzzer, const buzzer_pattern_t *pattern);
+
+// Avança o sequenciador: encerra o passo atual e começa o próximo. Retorna quanto tempo, em ms,
+// o novo passo dura, ou 0 se a fila acabou. Chamada pelo alarme
+uint32_t buzzer_step(buzzer_t *buzzer);
+
 #endif // BUZZER_H
@@ -0,0 +1,194 @@
+#include "calibration.h"
+#include <string.h>
+#include <math.h>
+
+bool calibration_add_point(calibration_point_t *points, uint8_t *num_points, uint16_t raw, uint8_t percent)
+{
+    for (uint8_t i = 0; i < *num_points; i++)
+    {
+        if (points[i].percent == percent)
+        {
+            points[i].raw = raw;
+            return true;
+        }
+    }
+    if (*num_points >= CALIBRATION_MAX_POINTS)
+    {
+        return false;
+    }
+    points[*num_points].raw = raw;
+    points[*num_points].percent = percent;
+    (*num_points)++;
+    return true;
+}
+
+// Tangente em um extremo pela parábola dos três pontos mais próximos, limitada para não sair da monotonia
+static float pchip_end_slope(float h0, float h1, float d0, float d1)
+{
+    float m = ((2.0f * h0 + h1) * d0 - h0 * d1) / (h0 + h1);
+    if (m * d0 <= 0.0f)
+    {
+        return 0.0f;
+    }
+    if (d0 * d1 <= 0.0f && fabsf(m) > fabsf(3.0f * d0))
+    {
+        return 3.0f * d0;
+    }
+    return m;
+}
+
+// Tangentes da cúbica monotônica (Fritsch-Carlson) em cada ponto
+static void pchip_slopes(const float *x, const float *y, uint8_t n, float *m)
+{
+    float h[CALIBRATION_MAX_POINTS - 1];
+    float d[CALIBRATION_MAX_POINTS - 1];
+    for (uint8_t k = 0; k + 1 < n; k++)
+    {
+        h[k] = x[k + 1] - x[k];
+        d[k] = (y[k + 1] - y[k]) / h[k];
+    }
+    if (n < 3)
+    {
+        m[0] = m[n - 1] = d[0]; // Com só dois pontos, a curva é a reta entre eles
+        return;
+    }
+    m[0] = pchip_end_slope(h[0], h[1], d[0], d[1]);
+    m[n - 1] = pchip_end_slope(h[n - 2], h[n - 3], d[n - 2], d[n - 3]);
+    for (uint8_t k = 1; k + 1 < n; k++)
+    {
+        if (d[k - 1] * d[k] <= 0.0f)
+        {
+            m[k] = 0.0f; // Patamar ou extremo local: a curva não pode passar do ponto
+        }
+        else
+        {
+            // Média harmônica ponderada, mantém a curva monotônica em cada intervalo
+            float w1 = 2.0f * h[k] + h[k - 1];
+            float w2 = h[k] + 2.0f * h[k - 1];
+            m[k] = (w1 + w2) / (w1 / d[k - 1] + w2 / d[k]);
+        }
+    }
+}
+
+bool calibration_build(calibration_t *cal, const calibration_point_t *points, uint8_t num_points)
+{
+    calibration_point_t sorted[CALIBRATION_MAX_POINTS];
+    float x[CALIBRATION_MAX_POINTS], y[CALIBRATION_MAX_POINTS], m[CALIBRATION_MAX_POINTS];
+
+    if (num_points < 2 || num_points > CALIBRATION_MAX_POINTS)
+    {
+        return false;
+    }
+
+    // Ordena pela leitura (inserção, no máximo CALIBRATION_MAX_POINTS pontos)
+    for (uint8_t i = 0; i < num_points; i++)
+    {
+        uint8_t j = i;
+        while (j > 0 && sorted[j - 1].raw > points[i].raw)
+        {
+            sorted[j] = sorted[j - 1];
+            j--;
+        }
+        sorted[j] = points[i];
+    }
+
+    // A porcentagem deve seguir a leitura num só sentido: a boia sobe com o nível, o eco encurta
+    int direction = sorted[num_points - 1].percent > sorted[0].percent ? 1 : -1;
+    if (sorted[num_points - 1].raw - sorted[0].raw < CALIBRATION_MIN_SPAN || sorted[num_points - 1].percent == sorted[0].percent)
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < num_points; i++)
+    {
+        if (sorted[i].percent > 100)
+            return false;
+        if (i > 0 && (sorted[i].raw == sorted[i - 1].raw ||
+                      ((int)sorted[i].percent - sorted[i - 1].percent) * direction <= 0))
+            return false;
+        x[i] = sorted[i].raw;
+        y[i] = sorted[i].percent;
+    }
+    pchip_slopes(x, y, num_points, m);
+
+    for (uint8_t i = 0; i < num_points; i++)
+    {
+        cal->points[i] = sorted[i];
+    }
+    cal->num_points = num_points;
+    cal->raw_lo = sorted[0].raw;
+    cal->raw_hi = sorted[num_points - 1].raw;
+    uint32_t span = cal->raw_hi - cal->raw_lo;
+    // Arredonda para baixo: a maior leitura cai no último intervalo, nunca além da tabela
+    cal->scale = ((uint32_t)CALIBRATION_SEGMENTS << 16) / span;
+
+    // Amostra a curva nos nós da tabela
+    uint8_t k = 0;
+    for (uint8_t i = 0; i <= CALIBRATION_SEGMENTS; i++)
+    {
+        float raw = cal->raw_lo + (float)span * i / CALIBRATION_SEGMENTS;
+        while (k + 2 < num_points && raw > x[k + 1])
+        {
+            k++;
+        }
+        float h = x[k + 1] - x[k];
+        float t = (raw - x[k]) / h;
+        float t2 = t * t;
+        float t3 = t2 * t;
+        float value = (2 * t3 - 3 * t2 + 1) * y[k] + (t3 - 2 * t2 + t) * h * m[k] +
+                      (-2 * t3 + 3 * t2) * y[k + 1] + (t3 - t2) * h * m[k + 1];
+        if (value < 0.0f)
+            value = 0.0f;
+        if (value > 100.0f)
+            value = 100.0f;
+        cal->lut[i] = (int32_t)(value * (1 << CALIBRATION_Q) + 0.5f);
+    }
+    return true;
+}
+
+int32_t calibration_apply(const calibration_t *cal, int32_t raw)
+{
+    if (raw <= cal->raw_lo)
+    {
+        return cal->lut[0];
+    }
+    if (raw >= cal->raw_hi)
+    {
+        return cal->lut[CALIBRATION_SEGMENTS];
+    }
+    // Posição na tabela em Q16: parte inteira é o intervalo, a fração interpola entre os nós
+    uint32_t pos = (uint32_t)(raw - cal->raw_lo) * cal->scale;
+    uint32_t i = pos >> 16;
+    int32_t frac = pos & 0xFFFF;
+    if (i >= CALIBRATION_SEGMENTS)
+    {
+        return cal->lut[CALIBRATION_SEGMENTS];
+    }
+    return cal->lut[i] + (int32_t)(((int64_t)(cal->lut[i + 1] - cal->lut[i]) * frac) >> 16);
+}
+
+void calibration_pack(const calibration_t *cal, uint8_t *buf)
+{
+    memset(buf, 0, CALIBRATION_PACKED_SIZE);
+    buf[0] = cal->num_points;
+    for (uint8_t i = 0; i < cal->num_points; i++)
+    {
+        buf[1 + 3 * i] = cal->points[i].raw & 0xFF;
+        buf[2 + 3 * i] = cal->points[i].raw >> 8;
+        buf[3 + 3 * i] = cal->points[i].percent;
+    }
+}
+
+uint8_t calibration_unpack(const uint8_t *buf, calibration_point_t *points)
+{
+    uint8_t num_points = buf[0];
+    if (num_points < 2 || num_points > CALIBRATION_MAX_POINTS)
+    {
+        return 0;
+    }
+    for (uint8_t i = 0; i < num_points; i++)
+    {
+        points[i].raw = buf[1 + 3 * i] | (buf[2 + 3 * i] << 8);
+        points[i].percent = buf[3 + 3 * i];
+    }
+    return num_points;
+}
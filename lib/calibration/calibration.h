@@ -0,0 +1,51 @@
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include "pico/stdlib.h"
+
+// Conversão da leitura bruta de um sensor (contagem do ADC, duração do eco) em porcentagem do volume.
+// A calibração é um conjunto de pontos (leitura, porcentagem) gravados com o reservatório em níveis
+// conhecidos: no mínimo vazio e cheio. Com três ou mais pontos a curva entre eles é uma cúbica monotônica
+// (PCHIP), que acompanha reservatórios não cilíndricos sem oscilar entre os pontos.
+// A curva é amostrada uma vez em uma tabela de passo uniforme: a conversão é um índice calculado por
+// multiplicação e uma interpolação linear, em ponto fixo, qualquer que seja o número de pontos.
+
+#define CALIBRATION_MAX_POINTS 5  // Os pontos serializados cabem em um registro da flash
+#define CALIBRATION_SEGMENTS 32   // Intervalos da tabela entre a menor e a maior leitura calibrada
+#define CALIBRATION_Q 8           // Bits fracionários da porcentagem devolvida (Q8)
+#define CALIBRATION_MIN_SPAN 16   // Menor distância entre as leituras dos extremos
+#define CALIBRATION_PACKED_SIZE (1 + 3 * CALIBRATION_MAX_POINTS) // Número de pontos e 3 bytes por ponto
+
+typedef struct {
+    uint16_t raw;    // Leitura bruta do sensor
+    uint8_t percent; // Volume correspondente (0 a 100)
+} calibration_point_t;
+
+typedef struct {
+    calibration_point_t points[CALIBRATION_MAX_POINTS]; // Em ordem crescente de leitura
+    uint8_t num_points;
+    int32_t raw_lo;        // Faixa coberta pela tabela
+    int32_t raw_hi;
+    uint32_t scale;        // Intervalos por unidade de leitura, em Q16
+    int32_t lut[CALIBRATION_SEGMENTS + 1]; // Porcentagem em Q8 em cada nó da tabela
+} calibration_t;
+
+// Inclui um ponto na lista, substituindo o que tiver a mesma porcentagem.
+// Retorna false se a lista estiver cheia
+bool calibration_add_point(calibration_point_t *points, uint8_t *num_points, uint16_t raw, uint8_t percent);
+
+// Ajusta a curva aos pontos e preenche a tabela. Retorna false (sem alterar 'cal') se os pontos não
+// formam uma calibração válida: menos de dois, leituras repetidas, faixa estreita demais, ou porcentagem
+// que não cresce (ou não decresce) sempre junto com a leitura
+bool calibration_build(calibration_t *cal, const calibration_point_t *points, uint8_t num_points);
+
+// Porcentagem em Q8 para uma leitura bruta. Leituras fora da faixa calibrada ficam no extremo. O(1)
+int32_t calibration_apply(const calibration_t *cal, int32_t raw);
+
+// Serialização dos pontos para a flash, sempre CALIBRATION_PACKED_SIZE bytes: o número de pontos
+// e cada ponto (leitura little-endian, porcentagem), com o espaço não usado zerado
+void calibration_pack(const calibration_t *cal, uint8_t *buf);
+// Retorna o número de pontos lidos de 'buf', 0 se o conteúdo não for válido
+uint8_t calibration_unpack(const uint8_t *buf, calibration_point_t *points);
+
+#endif // CALIBRATION_H
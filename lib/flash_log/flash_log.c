@@ -0,0 +1,375 @@
+#include "flash_log.h"
+#include "pico/flash.h"
+#include "hardware/regs/addressmap.h"
+
+#include <string.h>
+
+#define SECTOR_MAGIC 0x474C564E // "NVLG"
+#define SECTOR_HEADER_SIZE 8    // Magic e sequência
+#define RECORD_HEADER_SIZE 4    // Tipo, tamanho e CRC-16
+#define RECORD_SIZE(len) ((RECORD_HEADER_SIZE + (len) + 3) & ~3) // Registros alinhados em 4 bytes
+#define ERASED 0xFF
+
+// A região reservada é lida direto pelo XIP
+#define SECTOR_DATA(sector) ((const uint8_t *)(XIP_BASE + FLASH_LOG_OFFSET + (sector) * FLASH_SECTOR_SIZE))
+
+typedef struct {
+    uint32_t offset;
+    const uint8_t *data;
+} flash_op_t;
+
+// CRC-16/CCITT do tipo, do tamanho e do conteúdo
+static uint16_t record_crc(uint8_t type, uint8_t len, const uint8_t *payload)
+{
+    uint8_t head[2] = {type, len};
+    uint16_t crc = 0xFFFF;
+    for (uint16_t i = 0; i < 2u + len; i++)
+    {
+        crc ^= (uint16_t)(i < 2 ? head[i] : payload[i - 2]) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+    }
+    return crc;
+}
+
+static uint32_t read_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool sector_valid(uint8_t sector, uint32_t *seq)
+{
+    const uint8_t *data = SECTOR_DATA(sector);
+    if (read_u32(data) != SECTOR_MAGIC)
+        return false;
+    *seq = read_u32(data + 4);
+    return true;
+}
+
+// Percorre os registros válidos de um setor. Retorna a posição logo após o último, e em 'torn'
+// se a leitura parou num registro corrompido em vez de na área apagada
+static uint16_t scan_sector(uint8_t sector, bool *torn, void (*visit)(const uint8_t *record, void *ctx), void *ctx)
+{
+    const uint8_t *data = SECTOR_DATA(sector);
+    uint16_t offset = SECTOR_HEADER_SIZE;
+    *torn = false;
+
+    while ((uint32_t)(offset + RECORD_HEADER_SIZE) <= FLASH_SECTOR_SIZE && data[offset] != ERASED)
+    {
+        const uint8_t *record = data + offset;
+        uint8_t len = record[1];
+        if (len > FLASH_LOG_MAX_PAYLOAD || (uint32_t)(offset + RECORD_SIZE(len)) > FLASH_SECTOR_SIZE ||
+            record_crc(record[0], len, record + RECORD_HEADER_SIZE) != (record[2] | (record[3] << 8)))
+        {
+            *torn = true;
+            return offset;
+        }
+        if (visit)
+            visit(record, ctx);
+        offset += RECORD_SIZE(len);
+    }
+
+    // Depois do fim tudo deve estar apagado. Bytes gravados ali (gravação interrompida que não
+    // chegou ao primeiro byte do registro) impedem acrescentar naquela área
+    for (uint16_t i = offset; i < FLASH_SECTOR_SIZE; i++)
+    {
+        if (data[i] != ERASED)
+        {
+            *torn = true;
+            break;
+        }
+    }
+    return offset;
+}
+
+// Setores válidos do mais antigo ao mais recente: o anel começa logo depois do ativo
+static uint8_t sector_order(uint8_t active, uint8_t i)
+{
+    return (active + 1 + i) % FLASH_LOG_SECTORS;
+}
+
+static void cache_config(const uint8_t *record, void *ctx)
+{
+    flash_log_t *log = ctx;
+    uint8_t type = record[0];
+    if (type > 0 && type < FLASH_LOG_MAX_KEYS)
+    {
+        log->config[type].len = record[1];
+        memcpy(log->config[type].data, record + RECORD_HEADER_SIZE, record[1]);
+    }
+}
+
+bool flash_log_init(flash_log_t *log, flash_log_window_t window, void *window_ctx)
+{
+    memset(log, 0, sizeof(*log));
+    log->queue = xQueueCreate(FLASH_LOG_QUEUE_LENGTH, sizeof(flash_log_record_t));
+    log->window = window;
+    log->window_ctx = window_ctx;
+
+    // O setor ativo é o de maior sequência
+    bool found = false;
+    for (uint8_t s = 0; s < FLASH_LOG_SECTORS; s++)
+    {
+        uint32_t seq;
+        if (sector_valid(s, &seq) && (!found || (int32_t)(seq - log->seq) > 0))
+        {
+            found = true;
+            log->sector = s;
+            log->seq = seq;
+        }
+    }
+    if (!found)
+    {
+        // Sem setor válido: o anel parte do último setor, então a primeira gravação prepara o setor 0
+        log->sector = FLASH_LOG_SECTORS - 1;
+        return false;
+    }
+
+    // Reaplica os registros em ordem: o valor mais recente de cada chave prevalece
+    for (uint8_t i = 0; i < FLASH_LOG_SECTORS; i++)
+    {
+        uint8_t s = sector_order(log->sector, i);
+        uint32_t seq;
+        bool torn;
+        if (!sector_valid(s, &seq))
+            continue;
+        uint16_t end = scan_sector(s, &torn, cache_config, log);
+        if (torn)
+            log->torn++;
+        if (s == log->sector)
+        {
+            // Continua a gravação no setor ativo, a partir de uma cópia da página parcial
+            log->open = !torn && end < FLASH_SECTOR_SIZE;
+            log->write_offset = end;
+            if (log->open)
+            {
+                memcpy(log->page, SECTOR_DATA(s) + (end & ~(FLASH_PAGE_SIZE - 1)), FLASH_PAGE_SIZE);
+            }
+        }
+    }
+    return true;
+}
+
+bool flash_log_get(const flash_log_t *log, uint8_t key, void *value, uint8_t len)
+{
+    if (key == 0 || key >= FLASH_LOG_MAX_KEYS || log->config[key].len != len)
+    {
+        return false;
+    }
+    memcpy(value, log->config[key].data, len);
+    return true;
+}
+
+static bool enqueue(flash_log_t *log, uint8_t type, const void *payload, uint8_t len)
+{
+    flash_log_record_t record;
+    if (len > FLASH_LOG_MAX_PAYLOAD)
+    {
+        return false;
+    }
+    record.type = type;
+    record.len = len;
+    memcpy(record.payload, payload, len);
+    if (xQueueSend(log->queue, &record, 0) != pdTRUE)
+    {
+        log->dropped++;
+        return false;
+    }
+    return true;
+}
+
+bool flash_log_set(flash_log_t *log, uint8_t key, const void *value, uint8_t len)
+{
+    if (key == 0 || key >= FLASH_LOG_MAX_KEYS)
+    {
+        return false;
+    }
+    return enqueue(log, key, value, len);
+}
+
+bool flash_log_append(flash_log_t *log, uint8_t type, const void *payload, uint8_t len)
+{
+    if (type < FLASH_LOG_EVENT || type == ERASED)
+    {
+        return false;
+    }
+    return enqueue(log, type, payload, len);
+}
+
+typedef struct {
+    flash_log_event_cb_t callback;
+    void *ctx;
+} foreach_ctx_t;
+
+static void visit_event(const uint8_t *record, void *ctx)
+{
+    foreach_ctx_t *foreach = ctx;
+    if (record[0] >= FLASH_LOG_EVENT)
+    {
+        foreach->callback(record[0], record + RECORD_HEADER_SIZE, record[1], foreach->ctx);
+    }
+}
+
+void flash_log_foreach(const flash_log_t *log, flash_log_event_cb_t callback, void *ctx)
+{
+    foreach_ctx_t foreach = {callback, ctx};
+    for (uint8_t i = 0; i < FLASH_LOG_SECTORS; i++)
+    {
+        uint8_t s = sector_order(log->sector, i);
+        uint32_t seq;
+        bool torn;
+        if (sector_valid(s, &seq))
+        {
+            scan_sector(s, &torn, visit_event, &foreach);
+        }
+    }
+}
+
+static void do_erase(void *param)
+{
+    const flash_op_t *op = param;
+    flash_range_erase(op->offset, FLASH_SECTOR_SIZE);
+}
+
+static void do_program(void *param)
+{
+    const flash_op_t *op = param;
+    flash_range_program(op->offset, op->data, FLASH_PAGE_SIZE);
+}
+
+// Executa um apagamento ou gravação com o outro núcleo fora da flash, na janela da aplicação
+static bool flash_op(flash_log_t *log, void (*func)(void *), uint32_t offset)
+{
+    flash_op_t op = {FLASH_LOG_OFFSET + offset, log->page};
+    if (log->window)
+    {
+        log->window(log->window_ctx);
+    }
+    uint64_t start = time_us_64();
+    int rc = flash_safe_execute(func, &op, FLASH_LOG_SAFE_TIMEOUT_MS);
+    uint32_t elapsed = (uint32_t)(time_us_64() - start);
+    if (elapsed > log->max_op_us)
+    {
+        log->max_op_us = elapsed;
+    }
+    if (rc != PICO_OK)
+    {
+        log->errors++;
+        return false;
+    }
+    return true;
+}
+
+// Grava a página em montagem, que começa em 'page_start' no setor ativo. Bytes já gravados
+// numa gravação anterior da mesma página são reenviados com o mesmo valor, o que a flash NOR aceita
+static void program_page(flash_log_t *log, uint16_t page_start)
+{
+    if (flash_op(log, do_program, log->sector * FLASH_SECTOR_SIZE + page_start))
+    {
+        log->pages_written++;
+    }
+    log->page_dirty = false;
+}
+
+static void flush_page(flash_log_t *log)
+{
+    if (log->page_dirty)
+    {
+        program_page(log, log->write_offset & ~(FLASH_PAGE_SIZE - 1));
+    }
+}
+
+static void put_bytes(flash_log_t *log, const uint8_t *data, uint16_t len)
+{
+    for (uint16_t i = 0; i < len; i++)
+    {
+        log->page[log->write_offset % FLASH_PAGE_SIZE] = data[i];
+        log->page_dirty = true;
+        if (++log->write_offset % FLASH_PAGE_SIZE == 0)
+        {
+            // Página completa: grava e começa a próxima, ainda apagada
+            program_page(log, log->write_offset - FLASH_PAGE_SIZE);
+            memset(log->page, ERASED, FLASH_PAGE_SIZE);
+        }
+    }
+}
+
+static void put_record(flash_log_t *log, uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    uint8_t record[RECORD_SIZE(FLASH_LOG_MAX_PAYLOAD)];
+    uint16_t crc = record_crc(type, len, payload);
+    uint16_t size = RECORD_SIZE(len);
+
+    memset(record, 0, size); // O preenchimento até o alinhamento não pode ficar 0xFF
+    record[0] = type;
+    record[1] = len;
+    record[2] = crc & 0xFF;
+    record[3] = crc >> 8;
+    memcpy(record + RECORD_HEADER_SIZE, payload, len);
+    put_bytes(log, record, size);
+}
+
+// Passa para o próximo setor do anel: apaga, grava o cabeçalho e copia a configuração atual.
+// O setor ativo só muda depois do apagamento: se ele falhar, o próximo registro tenta o mesmo setor
+// de novo, em vez de avançar o anel e apagar outro setor com histórico válido
+static void next_sector(flash_log_t *log)
+{
+    uint8_t next = (log->sector + 1) % FLASH_LOG_SECTORS;
+
+    flush_page(log);
+    log->open = false;
+    if (!flash_op(log, do_erase, next * FLASH_SECTOR_SIZE))
+    {
+        return; // Tenta de novo no próximo registro
+    }
+    log->erases++;
+    log->sector = next;
+    log->seq++;
+
+    uint8_t header[SECTOR_HEADER_SIZE] = {
+        SECTOR_MAGIC & 0xFF, (SECTOR_MAGIC >> 8) & 0xFF, (SECTOR_MAGIC >> 16) & 0xFF, SECTOR_MAGIC >> 24,
+        log->seq & 0xFF, (log->seq >> 8) & 0xFF, (log->seq >> 16) & 0xFF, log->seq >> 24,
+    };
+    memset(log->page, ERASED, FLASH_PAGE_SIZE);
+    log->write_offset = 0;
+    log->open = true;
+    put_bytes(log, header, sizeof(header));
+    for (uint8_t key = 1; key < FLASH_LOG_MAX_KEYS; key++)
+    {
+        if (log->config[key].len)
+        {
+            put_record(log, key, log->config[key].data, log->config[key].len);
+        }
+    }
+}
+
+static void write_record(flash_log_t *log, const flash_log_record_t *record)
+{
+    if (!log->open || (uint32_t)(log->write_offset + RECORD_SIZE(record->len)) > FLASH_SECTOR_SIZE)
+    {
+        next_sector(log);
+        if (!log->open)
+        {
+            return; // Falha ao apagar: o registro é perdido, a fila não deve travar
+        }
+    }
+    if (record->type < FLASH_LOG_MAX_KEYS)
+    {
+        log->config[record->type].len = record->len;
+        memcpy(log->config[record->type].data, record->payload, record->len);
+    }
+    put_record(log, record->type, record->payload, record->len);
+}
+
+void flash_log_service(flash_log_t *log)
+{
+    flash_log_record_t record;
+    TickType_t wait = log->page_dirty ? pdMS_TO_TICKS(FLASH_LOG_FLUSH_MS) : portMAX_DELAY;
+
+    if (xQueueReceive(log->queue, &record, wait) != pdTRUE)
+    {
+        flush_page(log); // Nenhum registro novo: grava a página incompleta
+        return;
+    }
+    write_record(log, &record);
+}
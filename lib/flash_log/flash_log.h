@@ -0,0 +1,86 @@
+#ifndef FLASH_LOG_H
+#define FLASH_LOG_H
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "FreeRTOS.h"
+#include "queue.h"
+
+// Armazenamento persistente em log nos últimos setores da flash, para configuração e um diário de eventos.
+// Cada registro é acrescentado no fim do setor ativo com um CRC. Quando o setor enche, o próximo do anel
+// (o mais antigo) é apagado e recebe uma cópia da configuração atual, então os setores se desgastam por igual
+// e a configuração nunca depende de um setor que será apagado.
+// Quem grava só enfileira o registro, sem bloquear. A flash é escrita por uma única task, em páginas inteiras
+// (vários registros por gravação), e cada apagamento ou gravação espera a janela indicada pela aplicação.
+// Na inicialização os setores são lidos em ordem de sequência: um registro com CRC inválido (gravação
+// interrompida por falta de energia) encerra aquele setor e a gravação continua no próximo.
+
+#define FLASH_LOG_SECTORS 8                 // Setores reservados no fim da flash (32 KB)
+#define FLASH_LOG_OFFSET (PICO_FLASH_SIZE_BYTES - FLASH_LOG_SECTORS * FLASH_SECTOR_SIZE)
+#define FLASH_LOG_MAX_PAYLOAD 16            // Maior conteúdo de um registro
+#define FLASH_LOG_MAX_KEYS 8                // Chaves de configuração válidas: 1 a FLASH_LOG_MAX_KEYS - 1
+#define FLASH_LOG_EVENT 0x40                // Tipos a partir deste (até 0xFE) são eventos do diário
+#define FLASH_LOG_QUEUE_LENGTH 16           // Registros aguardando a task de gravação
+#define FLASH_LOG_FLUSH_MS 2000             // Página incompleta vai para a flash após este tempo sem novos registros
+#define FLASH_LOG_SAFE_TIMEOUT_MS 100       // Espera máxima para o outro núcleo liberar a flash
+
+// Chamada antes de cada apagamento ou gravação, na task de gravação. Deve esperar o momento em que
+// parar a execução na flash atrapalha menos (o XIP fica indisponível para os dois núcleos)
+typedef void (*flash_log_window_t)(void *ctx);
+
+// Chamada por flash_log_foreach para cada evento do diário
+typedef void (*flash_log_event_cb_t)(uint8_t type, const uint8_t *payload, uint8_t len, void *ctx);
+
+typedef struct {
+    uint8_t type; // Chave de configuração ou tipo de evento
+    uint8_t len;
+    uint8_t payload[FLASH_LOG_MAX_PAYLOAD];
+} flash_log_record_t;
+
+typedef struct {
+    QueueHandle_t queue;
+    flash_log_window_t window;
+    void *window_ctx;
+    // Posição de gravação, só a task de gravação altera depois da inicialização
+    uint8_t sector;          // Setor ativo
+    uint32_t seq;            // Sequência do setor ativo (cresce a cada troca de setor)
+    bool open;               // false: a próxima gravação começa um novo setor
+    uint16_t write_offset;   // Posição do próximo registro no setor ativo
+    uint8_t page[FLASH_PAGE_SIZE]; // Página que contém write_offset, montada em RAM
+    bool page_dirty;         // A página tem bytes ainda não gravados
+    // Último valor de cada chave de configuração (len 0 = nunca gravada)
+    struct {
+        uint8_t len;
+        uint8_t data[FLASH_LOG_MAX_PAYLOAD];
+    } config[FLASH_LOG_MAX_KEYS];
+    // Estatísticas
+    uint32_t dropped;        // Registros descartados com a fila cheia
+    uint32_t torn;           // Registros corrompidos encontrados na inicialização
+    uint32_t pages_written;
+    uint32_t erases;
+    uint32_t errors;         // Operações de flash que não puderam ser executadas
+    uint32_t max_op_us;      // Maior tempo de um apagamento ou gravação
+} flash_log_t;
+
+// Lê a região reservada e reconstrói a configuração, sem gravar nada.
+// Retorna false se não havia nenhum setor válido (primeiro uso)
+bool flash_log_init(flash_log_t *log, flash_log_window_t window, void *window_ctx);
+
+// Último valor gravado de uma chave. Deve ser usada antes de a task de gravação começar,
+// que passa a ser a dona desta cópia
+bool flash_log_get(const flash_log_t *log, uint8_t key, void *value, uint8_t len);
+
+// Enfileira um novo valor para uma chave de configuração. Nunca bloqueia: retorna false com a fila cheia
+bool flash_log_set(flash_log_t *log, uint8_t key, const void *value, uint8_t len);
+
+// Enfileira um evento do diário ('type' >= FLASH_LOG_EVENT). Nunca bloqueia
+bool flash_log_append(flash_log_t *log, uint8_t type, const void *payload, uint8_t len);
+
+// Percorre os eventos guardados, do mais antigo ao mais recente
+void flash_log_foreach(const flash_log_t *log, flash_log_event_cb_t callback, void *ctx);
+
+// Corpo da task de gravação: espera registros, junta-os em páginas e grava quando a página enche
+// ou após FLASH_LOG_FLUSH_MS sem novos registros. Deve ser chamada em laço por uma única task
+void flash_log_service(flash_log_t *log);
+
+#endif // FLASH_LOG_H
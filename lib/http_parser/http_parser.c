@@ -0,0 +1,314 @@
+#include "http_parser.h"
+
+#include <string.h>
+#include <strings.h>
+
+enum {
+    STATE_METHOD = 0,
+    STATE_PATH,
+    STATE_QUERY,
+    STATE_VERSION,
+    STATE_HEADER_START,    // Início de linha: novo cabeçalho ou linha vazia
+    STATE_HEADER_NAME,
+    STATE_HEADER_SPACE,    // Espaços entre ':' e o valor
+    STATE_HEADER_VALUE,
+    STATE_BODY,
+    STATE_DONE,
+    STATE_ERROR
+};
+
+enum {
+    HEADER_OTHER = 0,
+    HEADER_CONTENT_LENGTH,
+    HEADER_CONNECTION,
+    HEADER_ACCEPT_ENCODING,
+    HEADER_IF_NONE_MATCH
+};
+
+void http_parser_init(http_parser_t *parser)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->state = STATE_METHOD;
+}
+
+static void fail(http_parser_t *parser, uint16_t status)
+{
+    parser->state = STATE_ERROR;
+    parser->error_status = status;
+}
+
+// Procura 'token' em 'value' sem diferenciar maiúsculas
+static bool contains(const char *value, const char *token)
+{
+    size_t token_len = strlen(token);
+    for (; *value; value++)
+    {
+        if (strncasecmp(value, token, token_len) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void end_method(http_parser_t *parser)
+{
+    parser->token[parser->token_len] = '\0';
+    if (strcmp(parser->token, "GET") == 0)
+        parser->method = HTTP_METHOD_GET;
+    else if (strcmp(parser->token, "POST") == 0)
+        parser->method = HTTP_METHOD_POST;
+    else if (strcmp(parser->token, "HEAD") == 0)
+        parser->method = HTTP_METHOD_HEAD;
+    else
+        parser->method = HTTP_METHOD_UNKNOWN; // Quem decide o que fazer é o roteamento
+    parser->token_len = 0;
+}
+
+static void end_version(http_parser_t *parser)
+{
+    parser->token[parser->token_len] = '\0';
+    if (strcmp(parser->token, "HTTP/1.1") == 0)
+        parser->http11 = true;
+    else if (strcmp(parser->token, "HTTP/1.0") != 0)
+        fail(parser, 400);
+    parser->token_len = 0;
+}
+
+static void end_header_name(http_parser_t *parser)
+{
+    parser->token[parser->token_len] = '\0';
+    if (strcasecmp(parser->token, "Content-Length") == 0)
+        parser->header = HEADER_CONTENT_LENGTH;
+    else if (strcasecmp(parser->token, "Connection") == 0)
+        parser->header = HEADER_CONNECTION;
+    else if (strcasecmp(parser->token, "Accept-Encoding") == 0)
+        parser->header = HEADER_ACCEPT_ENCODING;
+    else if (strcasecmp(parser->token, "If-None-Match") == 0)
+        parser->header = HEADER_IF_NONE_MATCH;
+    else
+        parser->header = HEADER_OTHER;
+    parser->token_len = 0;
+}
+
+static void end_header_value(http_parser_t *parser)
+{
+    // Espaços no fim do valor não fazem parte dele
+    while (parser->token_len && (parser->token[parser->token_len - 1] == ' ' || parser->token[parser->token_len - 1] == '\t'))
+        parser->token_len--;
+    parser->token[parser->token_len] = '\0';
+
+    switch (parser->header)
+    {
+    case HEADER_CONTENT_LENGTH:
+    {
+        uint32_t length = 0;
+        if (parser->token_len == 0)
+        {
+            fail(parser, 400);
+            break;
+        }
+        for (uint8_t i = 0; i < parser->token_len; i++)
+        {
+            char c = parser->token[i];
+            if (c < '0' || c > '9')
+            {
+                fail(parser, 400);
+                return;
+            }
+            length = length * 10 + (c - '0');
+            if (length > HTTP_PARSER_MAX_BODY)
+            {
+                fail(parser, 413);
+                return;
+            }
+        }
+        parser->content_length = length;
+        break;
+    }
+    case HEADER_CONNECTION:
+        parser->connection_close = contains(parser->token, "close");
+        parser->connection_keep_alive = contains(parser->token, "keep-alive");
+        break;
+    case HEADER_ACCEPT_ENCODING:
+        parser->accept_gzip = contains(parser->token, "gzip");
+        break;
+    case HEADER_IF_NONE_MATCH:
+        memcpy(parser->if_none_match, parser->token, parser->token_len + 1);
+        break;
+    default:
+        break;
+    }
+    parser->token_len = 0;
+}
+
+static void end_headers(http_parser_t *parser)
+{
+    if (parser->content_length)
+        parser->state = STATE_BODY;
+    else
+        parser->state = STATE_DONE;
+}
+
+size_t http_parser_feed(http_parser_t *parser, const char *data, size_t len, http_parser_status_t *status)
+{
+    size_t i = 0;
+
+    while (i < len && parser->state != STATE_DONE && parser->state != STATE_ERROR)
+    {
+        // O corpo é copiado em bloco, o resto é processado byte a byte
+        if (parser->state == STATE_BODY)
+        {
+            size_t want = parser->content_length - parser->body_len;
+            size_t chunk = len - i < want ? len - i : want;
+            memcpy(parser->body + parser->body_len, data + i, chunk);
+            parser->body_len += chunk;
+            parser->body[parser->body_len] = '\0';
+            i += chunk;
+            if (parser->body_len == parser->content_length)
+                parser->state = STATE_DONE;
+            continue;
+        }
+
+        char c = data[i++];
+        if (++parser->header_bytes > HTTP_PARSER_MAX_HEADER_BYTES)
+        {
+            fail(parser, 431);
+            break;
+        }
+        if (c == '\r')
+            continue; // Aceita linhas terminadas em "\r\n" ou só "\n"
+
+        switch (parser->state)
+        {
+        case STATE_METHOD:
+            if (c == ' ')
+            {
+                if (parser->token_len == 0)
+                    fail(parser, 400);
+                else
+                {
+                    end_method(parser);
+                    parser->state = STATE_PATH;
+                }
+            }
+            else if (c == '\n' || parser->token_len >= 7)
+                fail(parser, 400);
+            else
+                parser->token[parser->token_len++] = c;
+            break;
+
+        case STATE_PATH:
+            if (c == ' ')
+            {
+                if (parser->path_len == 0)
+                    fail(parser, 400);
+                else
+                    parser->state = STATE_VERSION;
+            }
+            else if (c == '?')
+                parser->state = STATE_QUERY;
+            else if (c == '\n')
+                fail(parser, 400);
+            else if (parser->path_len >= HTTP_PARSER_MAX_PATH)
+                fail(parser, 414);
+            else
+            {
+                parser->path[parser->path_len++] = c;
+                parser->path[parser->path_len] = '\0';
+            }
+            break;
+
+        case STATE_QUERY:
+            if (c == ' ')
+                parser->state = STATE_VERSION;
+            else if (c == '\n')
+                fail(parser, 400);
+            else if (parser->query_len >= HTTP_PARSER_MAX_QUERY)
+                fail(parser, 414);
+            else
+            {
+                parser->query[parser->query_len++] = c;
+                parser->query[parser->query_len] = '\0';
+            }
+            break;
+
+        case STATE_VERSION:
+            if (c == '\n')
+            {
+                end_version(parser);
+                if (parser->state != STATE_ERROR)
+                    parser->state = STATE_HEADER_START;
+            }
+            else if (parser->token_len >= 8)
+                fail(parser, 400);
+            else
+                parser->token[parser->token_len++] = c;
+            break;
+
+        case STATE_HEADER_START:
+            if (c == '\n')
+            {
+                end_headers(parser);
+                break;
+            }
+            parser->state = STATE_HEADER_NAME;
+            // O caractere já é o primeiro do nome
+            // fallthrough
+        case STATE_HEADER_NAME:
+            if (c == ':')
+            {
+                end_header_name(parser);
+                parser->state = STATE_HEADER_SPACE;
+            }
+            else if (c == '\n')
+                fail(parser, 400);
+            else if (parser->token_len < HTTP_PARSER_MAX_NAME)
+                parser->token[parser->token_len++] = c;
+            else
+                parser->token[0] = '\0'; // Nome longo demais: continua, mas não será reconhecido
+            break;
+
+        case STATE_HEADER_SPACE:
+            if (c == ' ' || c == '\t')
+                break;
+            parser->state = STATE_HEADER_VALUE;
+            // fallthrough
+        case STATE_HEADER_VALUE:
+            if (c == '\n')
+            {
+                end_header_value(parser);
+                if (parser->state != STATE_ERROR)
+                    parser->state = STATE_HEADER_START;
+            }
+            else if (parser->header != HEADER_OTHER && parser->token_len < HTTP_PARSER_MAX_VALUE)
+                parser->token[parser->token_len++] = c; // Valores longos são truncados
+            break;
+        }
+    }
+
+    if (parser->state == STATE_DONE)
+        *status = HTTP_PARSER_DONE;
+    else if (parser->state == STATE_ERROR)
+        *status = HTTP_PARSER_ERROR;
+    else
+        *status = HTTP_PARSER_INCOMPLETE;
+    return i;
+}
+
+const char *http_parser_query(const http_parser_t *parser, const char *name, size_t *len)
+{
+    size_t name_len = strlen(name);
+    const char *p = parser->query;
+    while (*p)
+    {
+        const char *end = strchr(p, '&');
+        if (!end)
+            end = p + strlen(p);
+        if ((size_t)(end - p) > name_len && p[name_len] == '=' && memcmp(p, name, name_len) == 0)
+        {
+            *len = end - p - name_len - 1;
+            return p + name_len + 1;
+        }
+        p = *end ? end + 1 : end;
+    }
+    return NULL;
+}
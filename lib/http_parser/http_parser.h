@@ -0,0 +1,71 @@
+#ifndef HTTP_PARSER_H
+#define HTTP_PARSER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Parser incremental de requisições HTTP/1.x.
+// Os bytes podem ser entregues em pedaços de qualquer tamanho (um por pbuf, por exemplo):
+// o estado fica na estrutura e nada depende de a requisição estar contígua na memória.
+// Só guarda o que o servidor usa: método, caminho, alguns cabeçalhos e um corpo pequeno,
+// tudo em buffers de tamanho fixo.
+
+#define HTTP_PARSER_MAX_PATH 32          // Maior caminho aceito (sem a query string)
+#define HTTP_PARSER_MAX_QUERY 48         // Maior query string aceita (sem o '?')
+#define HTTP_PARSER_MAX_BODY 128         // Maior corpo aceito
+#define HTTP_PARSER_MAX_HEADER_BYTES 2048 // Tamanho máximo da linha de requisição + cabeçalhos
+#define HTTP_PARSER_MAX_VALUE 48         // Valor guardado dos cabeçalhos reconhecidos
+#define HTTP_PARSER_MAX_NAME 20          // Nomes maiores nunca são de um cabeçalho reconhecido
+
+typedef enum {
+    HTTP_METHOD_UNKNOWN = 0,
+    HTTP_METHOD_GET,
+    HTTP_METHOD_HEAD,
+    HTTP_METHOD_POST
+} http_method_t;
+
+typedef enum {
+    HTTP_PARSER_INCOMPLETE = 0, // Precisa de mais bytes
+    HTTP_PARSER_DONE,           // Requisição completa
+    HTTP_PARSER_ERROR           // Requisição inválida, ver 'error_status'
+} http_parser_status_t;
+
+typedef struct {
+    // Resultado
+    http_method_t method;
+    char path[HTTP_PARSER_MAX_PATH + 1];
+    uint8_t path_len;
+    char query[HTTP_PARSER_MAX_QUERY + 1]; // Vazia se não houver
+    uint8_t query_len;
+    bool http11;               // Versão 1.1 (senão 1.0)
+    bool connection_close;     // Connection: close
+    bool connection_keep_alive; // Connection: keep-alive
+    bool accept_gzip;          // Accept-Encoding contém gzip
+    char if_none_match[HTTP_PARSER_MAX_VALUE + 1];
+    uint32_t content_length;
+    char body[HTTP_PARSER_MAX_BODY + 1]; // Sempre terminado em '\0'
+    uint16_t body_len;
+    uint16_t error_status;     // Status HTTP sugerido para a resposta de erro (400, 413, 414, 431)
+
+    // Estado interno
+    uint8_t state;
+    uint8_t header;            // Cabeçalho reconhecido da linha atual
+    char token[HTTP_PARSER_MAX_VALUE + 1]; // Método, versão, nome ou valor em montagem
+    uint8_t token_len;
+    uint16_t header_bytes;
+} http_parser_t;
+
+// Prepara o parser para uma nova requisição
+void http_parser_init(http_parser_t *parser);
+
+// Entrega 'len' bytes ao parser. Retorna quantos bytes foram consumidos: o parser para no fim
+// da requisição, e o restante (uma requisição seguinte, em pipelining) deve ser entregue depois
+// de um novo http_parser_init. Em 'status' retorna o estado após os bytes consumidos
+size_t http_parser_feed(http_parser_t *parser, const char *data, size_t len, http_parser_status_t *status);
+
+// Procura o parâmetro 'name' na query string. Retorna o início do valor (terminado em '&' ou '\0')
+// e o tamanho em 'len', ou NULL se o parâmetro não existir
+const char *http_parser_query(const http_parser_t *parser, const char *name, size_t *len);
+
+#endif // HTTP_PARSER_H
@@ -0,0 +1,582 @@
+#include "http_server.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Cabeçalho da resposta de eventos: sem Content-Length, a conexão continua aberta
+static const char http_sse_header[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+// Slots fixos no lugar de um malloc de 10 KB por requisição
+static struct http_state http_states[HTTP_MAX_CONNECTIONS];
+static http_handler_t http_handler;
+
+http_server_stats_t http_server_stats;
+
+static err_t http_process(struct http_state *hs, struct tcp_pcb *tpcb);
+
+static uint32_t http_now_ms(void)
+{
+    return to_ms_since_boot(get_absolute_time());
+}
+
+// Libera o slot da conexão para ser reutilizado
+static void http_release(struct http_state *hs)
+{
+    if (hs->sse)
+    {
+        http_server_stats.sse_clients--;
+    }
+    if (hs->pending)
+    {
+        pbuf_free(hs->pending);
+        hs->pending = NULL;
+    }
+    hs->in_use = false;
+    hs->sse = false;
+    hs->pcb = NULL;
+    http_server_stats.active_connections--;
+}
+
+// Encerra a conexão e devolve o slot. Retorna ERR_ABRT se o PCB teve de ser abortado,
+// valor que os callbacks do lwIP devem repassar
+static err_t http_close(struct http_state *hs, struct tcp_pcb *tpcb)
+{
+    tcp_arg(tpcb, NULL);
+    tcp_recv(tpcb, NULL);
+    tcp_sent(tpcb, NULL);
+    tcp_err(tpcb, NULL);
+    tcp_poll(tpcb, NULL, 0);
+    if (hs)
+    {
+        http_release(hs);
+    }
+    if (tcp_close(tpcb) != ERR_OK)
+    {
+        tcp_abort(tpcb); // Sem memória para o FIN: derruba a conexão para não vazar o PCB
+        return ERR_ABRT;
+    }
+    return ERR_OK;
+}
+
+// Envia uma resposta gerada aos pedaços. Cada pedaço tem o tamanho do espaço livre no buffer de envio
+// (no máximo 'small') e é copiado para o lwIP, então 'small' é reaproveitado no pedaço seguinte.
+// Retorna false se o histórico foi sobrescrito antes de ser enviado e a resposta não pode ser concluída
+static bool http_stream_more(struct http_state *hs, struct tcp_pcb *tpcb)
+{
+    u32_t total = hs->header_len + hs->body_len;
+    if (hs->queued == 0)
+    {
+        // O cabeçalho está em 'small' e precisa sair inteiro antes do primeiro pedaço do corpo
+        if (tcp_sndbuf(tpcb) < hs->header_len ||
+            tcp_write(tpcb, hs->small, hs->header_len, TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE) != ERR_OK)
+        {
+            return true; // Continua em http_sent, ou em http_poll se nada estiver em voo
+        }
+        hs->queued = hs->header_len;
+    }
+    while (hs->queued < total)
+    {
+        u16_t space = tcp_sndbuf(tpcb);
+        if (space == 0)
+        {
+            break;
+        }
+        size_t want = space < sizeof(hs->small) ? space : sizeof(hs->small);
+        if (want > total - hs->queued)
+        {
+            want = total - hs->queued; // Nunca além do Content-Length anunciado
+        }
+        timeseries_reader_t saved = hs->history; // Para desfazer o pedaço se o lwIP não o aceitar
+        int chunk = timeseries_read(&hs->history, (uint8_t *)hs->small, want);
+        if (chunk <= 0)
+        {
+            return false; // Amostras sobrescritas, ou o tamanho anunciado não bate com o gerado
+        }
+        u8_t flags = TCP_WRITE_FLAG_COPY | (hs->queued + chunk < total ? TCP_WRITE_FLAG_MORE : 0);
+        if (tcp_write(tpcb, hs->small, chunk, flags) != ERR_OK)
+        {
+            hs->history = saved;
+            break;
+        }
+        hs->queued += chunk;
+    }
+    if (hs->queued == total && hs->keep_alive)
+    {
+        // O Content-Length foi medido antes da geração. Se o corpo gerado não termina junto com ele,
+        // a próxima resposta começaria no meio do que sobrou: esta conexão fecha depois da resposta
+        timeseries_reader_t rest = hs->history;
+        uint8_t extra;
+        if (timeseries_read(&rest, &extra, 1) != 0)
+        {
+            hs->keep_alive = false;
+        }
+    }
+    tcp_output(tpcb);
+    return true;
+}
+
+// Entrega ao lwIP o quanto couber do cabeçalho e do corpo.
+// Cabeçalhos estáticos e a página na flash vão sem TCP_WRITE_FLAG_COPY: o lwIP só guarda referências
+// (pbufs ROM), válidas para sempre. O que está no slot da conexão (respostas dinâmicas) é copiado, porque
+// o slot é liberado assim que o cliente fecha, com segmentos ainda sem confirmação na fila do lwIP.
+// Retorna false se a resposta não pode ser concluída e a conexão deve ser encerrada
+static bool http_send_more(struct http_state *hs, struct tcp_pcb *tpcb)
+{
+    if (hs->stream)
+    {
+        return http_stream_more(hs, tpcb);
+    }
+    u32_t total = hs->header_len + hs->body_len;
+    while (hs->queued < total)
+    {
+        const char *data;
+        u32_t left;
+        if (hs->queued < hs->header_len)
+        {
+            data = hs->header + hs->queued;
+            left = hs->header_len - hs->queued;
+        }
+        else
+        {
+            data = hs->body + (hs->queued - hs->header_len);
+            left = total - hs->queued;
+        }
+
+        u16_t space = tcp_sndbuf(tpcb);
+        if (space == 0)
+        {
+            break; // Continua quando o cliente confirmar, em http_sent
+        }
+        u16_t chunk = left < space ? left : space;
+        u8_t flags = hs->queued + chunk < total ? TCP_WRITE_FLAG_MORE : 0;
+        if (data >= hs->small && data < hs->small + sizeof(hs->small))
+        {
+            flags |= TCP_WRITE_FLAG_COPY;
+        }
+        if (tcp_write(tpcb, data, chunk, flags) != ERR_OK)
+        {
+            break; // Fila de segmentos cheia: continua em http_sent, ou em http_poll se nada estiver em voo
+        }
+        hs->queued += chunk;
+    }
+    tcp_output(tpcb);
+    return true;
+}
+
+// Linha Connection de uma resposta. Sempre enviada: um cliente HTTP/1.0 só mantém a conexão se o servidor
+// confirmar o keep-alive, e qualquer cliente precisa saber que o servidor vai fechar depois da resposta
+const char *http_connection_header(bool keep_alive)
+{
+    return keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+}
+
+void http_reply_small(struct http_state *hs, const char *status, const char *content_type, const char *body, int body_len)
+{
+    int len = snprintf(hs->small, sizeof(hs->small),
+                       "HTTP/1.1 %s\r\n"
+                       "Content-Type: %s\r\n"
+                       "Content-Length: %d\r\n"
+                       "%s"
+                       "\r\n"
+                       "%.*s",
+                       status, content_type, body_len, http_connection_header(hs->keep_alive),
+                       hs->head ? 0 : body_len, body);
+    hs->header = hs->small;
+    hs->header_len = len < (int)sizeof(hs->small) ? len : (int)sizeof(hs->small) - 1;
+    hs->body = NULL;
+    hs->body_len = 0;
+}
+
+void http_reply_history(struct http_state *hs, const timeseries_t *ts, timeseries_format_t format, const timeseries_range_t *range)
+{
+    timeseries_reader_init(&hs->history, ts, format, range);
+    hs->stream = true;
+    hs->body = NULL;
+    hs->body_len = timeseries_reader_size(&hs->history);
+    hs->header = hs->small;
+    hs->header_len = snprintf(hs->small, sizeof(hs->small),
+                              "HTTP/1.1 200 OK\r\n"
+                              "Content-Type: %s\r\n"
+                              "Content-Length: %lu\r\n"
+                              "Cache-Control: no-store\r\n"
+                              "%s"
+                              "\r\n",
+                              format == TIMESERIES_FORMAT_JSON ? "application/json" : "application/octet-stream",
+                              (unsigned long)hs->body_len, http_connection_header(hs->keep_alive));
+}
+
+void http_reply_events(struct http_state *hs)
+{
+    if (http_server_stats.sse_clients >= HTTP_MAX_SSE_CLIENTS)
+    {
+        const char *txt = "Muitos clientes";
+        http_reply_small(hs, "503 Service Unavailable", "text/plain", txt, strlen(txt));
+        return;
+    }
+    if (!hs->head)
+    {
+        // HEAD recebe só o cabeçalho do canal, sem abrir o fluxo de eventos
+        hs->sse = true;
+        hs->sse_sent = (http_sse_state_t){-1, -1, -1, -1}; // O primeiro evento leva o estado completo
+        hs->sse_last_ms = http_now_ms();
+        http_server_stats.sse_clients++;
+    }
+    hs->header = http_sse_header;
+    hs->header_len = sizeof(http_sse_header) - 1;
+    hs->body = NULL;
+    hs->body_len = 0;
+}
+
+int http_build_header(char *buf, const char *status, const char *encoding, const char *etag, int length, bool keep_alive)
+{
+    int len = snprintf(buf, HTTP_HEADER_SIZE,
+                       "HTTP/1.1 %s\r\n"
+                       "Cache-Control: no-cache\r\n" // O navegador guarda a página mas sempre revalida pelo ETag
+                       "ETag: %s\r\n"
+                       "Vary: Accept-Encoding\r\n"
+                       "%s",
+                       status, etag, http_connection_header(keep_alive));
+    if (length >= 0)
+    {
+        len += snprintf(buf + len, HTTP_HEADER_SIZE - len,
+                        "Content-Type: text/html; charset=utf-8\r\n"
+                        "Content-Length: %d\r\n",
+                        length);
+    }
+    if (encoding)
+    {
+        len += snprintf(buf + len, HTTP_HEADER_SIZE - len, "Content-Encoding: %s\r\n", encoding);
+    }
+    len += snprintf(buf + len, HTTP_HEADER_SIZE - len, "\r\n");
+    return len;
+}
+
+// Resposta para uma requisição que o parser rejeitou
+static void http_reply_error(struct http_state *hs, uint16_t status)
+{
+    const char *text;
+    switch (status)
+    {
+    case 413: text = "413 Payload Too Large"; break;
+    case 414: text = "414 URI Too Long"; break;
+    case 431: text = "431 Request Header Fields Too Large"; break;
+    default: text = "400 Bad Request"; break;
+    }
+    http_reply_small(hs, text, "text/plain", text, strlen(text));
+}
+
+// Chamada periodicamente pelo lwIP: retoma respostas paradas e encerra conexões persistentes ociosas
+static err_t http_poll(void *arg, struct tcp_pcb *tpcb)
+{
+    struct http_state *hs = (struct http_state *)arg;
+    if (!hs)
+    {
+        return ERR_OK;
+    }
+    if (hs->responding && hs->queued < hs->header_len + hs->body_len)
+    {
+        // Se o tcp_write falhou (ERR_MEM) sem nada em voo, nenhum tcp_sent virá: a resposta (ou o cabeçalho
+        // de um canal de eventos) continua daqui, como no httpd do lwIP. Sem nada escrito nem confirmado por
+        // HTTP_SEND_RETRIES polls seguidos, a conexão é dada como perdida
+        u32_t queued = hs->queued;
+        if (!http_send_more(hs, tpcb))
+        {
+            return http_close(hs, tpcb);
+        }
+        if (hs->queued != queued)
+        {
+            hs->retries = 0;
+        }
+        else if (++hs->retries >= HTTP_SEND_RETRIES)
+        {
+            return http_close(hs, tpcb);
+        }
+        return ERR_OK;
+    }
+    if (!hs->sse && !hs->responding && http_now_ms() - hs->last_activity_ms >= HTTP_IDLE_TIMEOUT_MS)
+    {
+        return http_close(hs, tpcb);
+    }
+    return ERR_OK;
+}
+
+// Chamada pelo lwIP quando o cliente confirma bytes: continua a resposta ou passa à próxima requisição
+static err_t http_sent(void *arg, struct tcp_pcb *tpcb, u16_t len)
+{
+    struct http_state *hs = (struct http_state *)arg;
+    if (!hs)
+    {
+        return ERR_OK;
+    }
+    hs->acked += len;
+    hs->retries = 0; // O cliente está recebendo
+    if (hs->sse)
+    {
+        return ERR_OK; // Os eventos são enviados por http_sse_push, a conexão continua aberta
+    }
+    if (hs->acked < hs->header_len + hs->body_len)
+    {
+        if (!http_send_more(hs, tpcb))
+        {
+            return http_close(hs, tpcb);
+        }
+        return ERR_OK;
+    }
+    if (!hs->keep_alive)
+    {
+        return http_close(hs, tpcb);
+    }
+
+    // Resposta concluída: a conexão fica aberta e atende o que o cliente já tiver enviado
+    hs->responding = false;
+    hs->last_activity_ms = http_now_ms();
+    return http_process(hs, tpcb);
+}
+
+// Chamada pelo lwIP quando a conexão é abortada, o PCB já foi liberado
+static void http_err(void *arg, err_t err)
+{
+    struct http_state *hs = (struct http_state *)arg;
+    if (hs)
+    {
+        http_release(hs);
+    }
+}
+
+// Atende as requisições acumuladas na conexão, uma de cada vez e na ordem de chegada.
+// Os bytes vão para o parser pbuf a pbuf, sem montar a requisição em um buffer contíguo.
+// A próxima requisição só é processada depois que a resposta anterior foi toda confirmada,
+// porque ela pode estar no buffer 'small' do slot
+static err_t http_process(struct http_state *hs, struct tcp_pcb *tpcb)
+{
+    while (hs->pending && !hs->responding && !hs->sse)
+    {
+        if (hs->pending->len == 0)
+        {
+            // pbuf vazio na cadeia: pbuf_free_header não o remove com tamanho zero, e o laço pararia nele
+            struct pbuf *empty = hs->pending;
+            hs->pending = empty->next;
+            empty->next = NULL;
+            pbuf_free(empty);
+            continue;
+        }
+        http_parser_status_t status;
+        size_t used = http_parser_feed(&hs->parser, hs->pending->payload, hs->pending->len, &status);
+        hs->pending = pbuf_free_header(hs->pending, used);
+        tcp_recved(tpcb, used); // Só agora abre a janela: um cliente não acumula mais do que o servidor atende
+        if (status == HTTP_PARSER_INCOMPLETE)
+        {
+            if (used == 0)
+            {
+                break; // O parser recusou bytes sem terminar a requisição: não há como avançar
+            }
+            continue; // Aguarda o resto da requisição
+        }
+
+        hs->responding = true;
+        hs->stream = false;
+        hs->queued = 0;
+        hs->acked = 0;
+        hs->retries = 0;
+        http_server_stats.requests++;
+        hs->head = status == HTTP_PARSER_DONE && hs->parser.method == HTTP_METHOD_HEAD;
+        if (status == HTTP_PARSER_ERROR)
+        {
+            // Depois de uma requisição inválida não dá para saber onde começa a próxima
+            hs->keep_alive = false;
+            http_reply_error(hs, hs->parser.error_status);
+        }
+        else
+        {
+            // HTTP/1.1 é persistente por padrão, HTTP/1.0 só se o cliente pedir
+            hs->keep_alive = hs->parser.http11 ? !hs->parser.connection_close : hs->parser.connection_keep_alive;
+            http_handler(hs, &hs->parser);
+            if (hs->head)
+            {
+                // Cabeçalhos do GET, inclusive o Content-Length, sem o corpo (o de 'small' já foi omitido)
+                hs->body = NULL;
+                hs->body_len = 0;
+                hs->stream = false;
+            }
+        }
+        http_parser_init(&hs->parser);
+        if (!http_send_more(hs, tpcb))
+        {
+            return http_close(hs, tpcb);
+        }
+    }
+    return ERR_OK;
+}
+
+// Chamada pelo lwIP quando chegam bytes, ou com 'p' NULL quando o cliente fecha
+static err_t http_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err)
+{
+    struct http_state *hs = (struct http_state *)arg;
+
+    if (!p)
+    {
+        return http_close(hs, tpcb);
+    }
+    if (!hs || hs->sse)
+    {
+        tcp_recved(tpcb, p->tot_len);
+        pbuf_free(p); // Um cliente de eventos não envia mais requisições
+        return ERR_OK;
+    }
+
+    // Acumula sem copiar: pode ser o pedaço de uma requisição ou várias de uma vez
+    if (hs->pending)
+    {
+        pbuf_cat(hs->pending, p);
+    }
+    else
+    {
+        hs->pending = p;
+    }
+    hs->last_activity_ms = http_now_ms();
+    return http_process(hs, tpcb);
+}
+
+// Acrescenta ao evento um campo que mudou desde o último envio
+static int http_sse_field(char *buf, int len, int size, const char *name, int value, int *sent)
+{
+    if (value == *sent || len >= size)
+    {
+        return len;
+    }
+    *sent = value;
+    return len + snprintf(buf + len, size - len, "%s\"%s\":%d", buf[len - 1] == '{' ? "" : ",", name, value);
+}
+
+void http_sse_push(const http_sse_state_t *current, uint32_t now_ms)
+{
+    for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        struct http_state *hs = &http_states[i];
+        if (!hs->in_use || !hs->sse || hs->queued < hs->header_len)
+        {
+            continue;
+        }
+
+        // O estado enviado só é atualizado se o evento couber no buffer de envio.
+        // Um cliente lento recebe depois um único delta com tudo que mudou
+        http_sse_state_t sent = hs->sse_sent;
+        char event[96];
+        int len = snprintf(event, sizeof(event), "data: {");
+        int start = len;
+        len = http_sse_field(event, len, sizeof(event), "nivel_agua", current->nivel, &sent.nivel);
+        len = http_sse_field(event, len, sizeof(event), "bomba_agua", current->bomba, &sent.bomba);
+        len = http_sse_field(event, len, sizeof(event), "limite_minimo", current->min, &sent.min);
+        len = http_sse_field(event, len, sizeof(event), "limite_maximo", current->max, &sent.max);
+
+        if (len > start)
+        {
+            len += snprintf(event + len, sizeof(event) - len, "}\n\n");
+        }
+        else if (now_ms - hs->sse_last_ms >= HTTP_SSE_KEEPALIVE_MS)
+        {
+            len = snprintf(event, sizeof(event), ": keep-alive\n\n");
+        }
+        else
+        {
+            continue;
+        }
+
+        // Eventos são pequenos e montados na pilha, então aqui a cópia para o lwIP é necessária
+        if (len < (int)sizeof(event) && tcp_sndbuf(hs->pcb) >= len &&
+            tcp_write(hs->pcb, event, len, TCP_WRITE_FLAG_COPY) == ERR_OK)
+        {
+            tcp_output(hs->pcb);
+            hs->sse_sent = sent;
+            hs->sse_last_ms = now_ms;
+            http_server_stats.sse_events++;
+        }
+    }
+}
+
+// Chamada pelo lwIP a cada conexão nova: ocupa um slot livre, ou despeja a conexão ociosa mais antiga
+static err_t http_accept(void *arg, struct tcp_pcb *newpcb, err_t err)
+{
+    struct http_state *hs = NULL;
+    struct http_state *idle = NULL; // Conexão persistente ociosa há mais tempo
+    for (uint8_t i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        struct http_state *candidate = &http_states[i];
+        if (!candidate->in_use)
+        {
+            hs = candidate;
+            break;
+        }
+        if (!candidate->sse && !candidate->responding && !candidate->pending &&
+            (!idle || (int32_t)(candidate->last_activity_ms - idle->last_activity_ms) < 0))
+        {
+            idle = candidate;
+        }
+    }
+    if (!hs && idle)
+    {
+        // Tabela cheia: despeja a conexão ociosa mais antiga, o navegador reconecta se precisar
+        http_close(idle, idle->pcb);
+        http_server_stats.evictions++;
+        hs = idle;
+    }
+    if (!hs)
+    {
+        tcp_abort(newpcb); // Todas as conexões estão ocupadas: recusa em vez de alocar
+        return ERR_ABRT;
+    }
+
+    hs->in_use = true;
+    hs->queued = 0;
+    hs->acked = 0;
+    hs->retries = 0;
+    hs->header_len = 0;
+    hs->body_len = 0;
+    hs->sse = false;
+    hs->stream = false;
+    hs->keep_alive = false;
+    hs->head = false;
+    hs->responding = false;
+    hs->pending = NULL;
+    http_parser_init(&hs->parser);
+    hs->last_activity_ms = http_now_ms();
+    hs->pcb = newpcb;
+    http_server_stats.active_connections++;
+    http_server_stats.connections_accepted++;
+    if (http_server_stats.active_connections > http_server_stats.connections_peak)
+    {
+        http_server_stats.connections_peak = http_server_stats.active_connections;
+    }
+
+    tcp_arg(newpcb, hs);
+    tcp_recv(newpcb, http_recv);
+    tcp_sent(newpcb, http_sent);
+    tcp_err(newpcb, http_err);
+    tcp_poll(newpcb, http_poll, HTTP_POLL_INTERVAL);
+    return ERR_OK;
+}
+
+bool http_server_start(uint16_t port, http_handler_t handler)
+{
+    http_handler = handler;
+    struct tcp_pcb *pcb = tcp_new();
+    if (!pcb)
+    {
+        printf("Erro ao criar PCB TCP\n");
+        return false;
+    }
+    if (tcp_bind(pcb, IP_ADDR_ANY, port) != ERR_OK)
+    {
+        printf("Erro ao ligar o servidor na porta %u\n", port);
+        return false;
+    }
+    pcb = tcp_listen(pcb);
+    tcp_accept(pcb, http_accept);
+    printf("Servidor HTTP rodando na porta %u...\n", port);
+    return true;
+}
@@ -0,0 +1,102 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include "pico/stdlib.h"
+#include "lwip/tcp.h"
+#include "http_parser/http_parser.h"
+#include "timeseries/timeseries.h"
+
+// Servidor HTTP sobre a API raw do lwIP, sem heap: um slot fixo por conexão, com o parser, a resposta
+// em andamento e os bytes recebidos ainda não atendidos. Cuida das conexões persistentes (pipelining,
+// tempo limite de ociosidade e despejo da mais antiga quando a tabela enche), do ritmo de envio pelo
+// buffer do lwIP e dos canais de eventos (SSE). O que responder a cada requisição fica com a aplicação,
+// no handler passado a http_server_start, que prepara a resposta no slot com as funções http_reply_*.
+// Tudo roda na tcpip thread ou com o núcleo do lwIP travado (LOCK_TCPIP_CORE)
+
+#define HTTP_MAX_CONNECTIONS 8         // Conexões atendidas ao mesmo tempo, sem usar o heap
+#define HTTP_MAX_SSE_CLIENTS 4         // Conexões de eventos abertas ao mesmo tempo, o resto dos slots fica para requisições
+#define HTTP_SSE_KEEPALIVE_MS 15000    // Comentário enviado a um cliente de eventos sem eventos há este tempo
+#define HTTP_SMALL_RESPONSE_SIZE 384   // Maior resposta dinâmica (cabeçalho + corpo)
+#define HTTP_HEADER_SIZE 224           // Cabeçalhos pré-calculados montados por http_build_header
+#define HTTP_IDLE_TIMEOUT_MS 5000      // Conexão persistente sem requisições por este tempo é encerrada
+#define HTTP_POLL_INTERVAL 2           // Intervalo do tcp_poll, em unidades de 500 ms
+#define HTTP_SEND_RETRIES 8            // Polls seguidos sem escrever nem ter bytes confirmados antes de encerrar a conexão
+
+// Estado exibido no painel, enviado pelos canais de eventos. -1 indica campo ainda não enviado
+typedef struct {
+    int nivel;
+    int bomba;
+    int min;
+    int max;
+} http_sse_state_t;
+
+// Estado de uma conexão HTTP. Não guarda cópia do conteúdo estático, apenas onde ele está
+struct http_state
+{
+    bool in_use;
+    const char *header; // Cabeçalho da resposta (pré-calculado ou em 'small')
+    u32_t header_len;
+    const char *body;   // Corpo da resposta na flash, NULL se tudo está em 'small'
+    u32_t body_len;
+    u32_t queued;       // Bytes já entregues ao lwIP
+    u32_t acked;        // Bytes confirmados pelo cliente
+    uint8_t retries;    // Polls seguidos sem progresso no envio
+    char small[HTTP_SMALL_RESPONSE_SIZE]; // Respostas dinâmicas (JSON e texto)
+    // Conexão persistente: várias requisições em sequência, inclusive enviadas sem esperar a resposta
+    bool keep_alive;            // Mantém a conexão após a resposta atual
+    bool head;                  // Requisição HEAD: a resposta leva os cabeçalhos do GET, sem o corpo
+    bool responding;            // Há uma resposta sendo enviada, as próximas requisições esperam em 'pending'
+    struct pbuf *pending;       // Bytes recebidos e ainda não entregues ao parser
+    http_parser_t parser;       // Requisição em montagem
+    uint32_t last_activity_ms;  // Para o tempo limite de ociosidade e a escolha de quem despejar
+    // Conexão de eventos: fica aberta e recebe só o que mudou
+    bool sse;
+    struct tcp_pcb *pcb;
+    http_sse_state_t sse_sent;  // Último estado enviado a este cliente
+    uint32_t sse_last_ms;       // Instante do último envio, para o keep-alive
+    // Resposta gerada aos pedaços (histórico): cada pedaço é codificado em 'small' no momento do envio
+    bool stream;
+    timeseries_reader_t history;
+};
+
+// Prepara a resposta a uma requisição completa. 'hs->keep_alive' e 'hs->head' já valem para ela
+typedef void (*http_handler_t)(struct http_state *hs, const http_parser_t *req);
+
+// Estatísticas do servidor, lidas sem lock por quem as exibe
+typedef struct {
+    volatile uint32_t requests;
+    volatile uint32_t connections_accepted;
+    volatile uint32_t evictions;
+    volatile uint8_t active_connections;
+    volatile uint8_t connections_peak;
+    volatile uint8_t sse_clients;
+    volatile uint32_t sse_events;
+} http_server_stats_t;
+
+extern http_server_stats_t http_server_stats;
+
+// Começa a aceitar conexões na porta. Retorna false se o PCB não pôde ser criado ou ligado
+bool http_server_start(uint16_t port, http_handler_t handler);
+
+// Resposta dinâmica pequena (cabeçalho e corpo), montada no buffer do próprio slot
+void http_reply_small(struct http_state *hs, const char *status, const char *content_type, const char *body, int body_len);
+
+// Resposta com o corpo gerado do histórico enquanto é enviado: só a posição do codificador fica no slot
+void http_reply_history(struct http_state *hs, const timeseries_t *ts, timeseries_format_t format, const timeseries_range_t *range);
+
+// Abre um canal de eventos, ou responde 503 se já houver HTTP_MAX_SSE_CLIENTS.
+// O primeiro evento leva o estado completo, os seguintes só o que mudou (http_sse_push)
+void http_reply_events(struct http_state *hs);
+
+// Linha Connection de uma resposta
+const char *http_connection_header(bool keep_alive);
+
+// Monta em 'buf' (HTTP_HEADER_SIZE bytes) um cabeçalho de página HTML com ETag. 'length' negativo omite
+// o corpo (304). Retorna o tamanho
+int http_build_header(char *buf, const char *status, const char *encoding, const char *etag, int length, bool keep_alive);
+
+// Envia a cada canal de eventos um delta em JSON com os campos que mudaram.
+// Sem mudanças por HTTP_SSE_KEEPALIVE_MS, envia um comentário para a conexão não ser dada como ociosa
+void http_sse_push(const http_sse_state_t *current, uint32_t now_ms);
+
+#endif // HTTP_SERVER_H
@@ -0,0 +1,101 @@
+#include "level_bus.h"
+#include "hardware/sync.h"
+
+void level_bus_init(level_bus_t *bus)
+{
+    bus->slots[0].value = 0;
+    bus->slots[0].timestamp_us = 0;
+    bus->seq = 0;
+    bus->num_subscribers = 0;
+}
+
+bool level_bus_subscribe(level_bus_t *bus, level_bus_sub_t *sub)
+{
+    bool ok = false;
+
+    taskENTER_CRITICAL();
+    if (bus->num_subscribers < LEVEL_BUS_MAX_SUBSCRIBERS)
+    {
+        bus->subscribers[bus->num_subscribers] = xTaskGetCurrentTaskHandle();
+        bus->num_subscribers++;
+        sub->bus = bus;
+        sub->last_seq = bus->seq; // Só interessa o que for publicado a partir de agora
+        sub->received = 0;
+        sub->skipped = 0;
+        sub->latency_max_us = 0;
+        sub->latency_total_us = 0;
+        ok = true;
+    }
+    taskEXIT_CRITICAL();
+
+    return ok;
+}
+
+void level_bus_publish(level_bus_t *bus, int value)
+{
+    // Escreve no slot inativo e só então o torna atual avançando a sequência.
+    // Um leitor no outro núcleo nunca vê um slot pela metade sem perceber a mudança de 'seq'
+    uint32_t next = bus->seq + 1;
+    level_bus_slot_t *slot = &bus->slots[next & 1];
+    slot->value = value;
+    slot->timestamp_us = time_us_64();
+    __dmb();
+    bus->seq = next;
+    __dmb();
+
+    uint8_t n = bus->num_subscribers;
+
+    // Notificação por contagem: não bloqueia e não depende de espaço em fila
+    for (uint8_t i = 0; i < n; i++)
+    {
+        xTaskNotifyGiveIndexed(bus->subscribers[i], LEVEL_BUS_NOTIFY_INDEX);
+    }
+}
+
+void level_bus_peek(level_bus_t *bus, level_sample_t *sample)
+{
+    uint32_t seq;
+    do
+    {
+        seq = bus->seq;
+        __dmb();
+        const level_bus_slot_t *slot = &bus->slots[seq & 1];
+        sample->value = slot->value;
+        sample->timestamp_us = slot->timestamp_us;
+        __dmb();
+    } while (seq != bus->seq); // O produtor publicou durante a cópia: o slot pode ter sido reescrito
+    sample->seq = seq;
+}
+
+bool level_bus_receive(level_bus_sub_t *sub, level_sample_t *sample, uint32_t *skipped, TickType_t timeout)
+{
+    // Várias publicações podem gerar uma única entrega, então uma notificação pendente
+    // pode não corresponder a dado novo. Nesse caso volta a esperar.
+    while (sub->bus->seq == sub->last_seq)
+    {
+        if (ulTaskNotifyTakeIndexed(LEVEL_BUS_NOTIFY_INDEX, pdTRUE, timeout) == 0)
+        {
+            return false; // Timeout
+        }
+    }
+
+    level_bus_peek(sub->bus, sample);
+
+    uint32_t lost = sample->seq - sub->last_seq - 1; // Aritmética modular cobre o estouro do contador
+    uint32_t latency = (uint32_t)(time_us_64() - sample->timestamp_us);
+
+    sub->last_seq = sample->seq;
+    sub->received++;
+    sub->skipped += lost;
+    sub->latency_total_us += latency;
+    if (latency > sub->latency_max_us)
+    {
+        sub->latency_max_us = latency;
+    }
+
+    if (skipped)
+    {
+        *skipped = lost;
+    }
+    return true;
+}
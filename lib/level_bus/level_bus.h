@@ -0,0 +1,61 @@
+#ifndef LEVEL_BUS_H
+#define LEVEL_BUS_H
+
+#include "pico/stdlib.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+// Barramento de difusão do último valor de nível de água.
+// O produtor apenas sobrescreve o valor e incrementa o número de sequência, nunca bloqueia.
+// Cada assinante guarda a última sequência que viu, assim sabe exatamente quantas leituras perdeu.
+// Publicar e ler não usam lock: o valor fica em dois slots alternados e o leitor repete a leitura
+// se o número de sequência mudou durante a cópia. Exige um único produtor por barramento.
+
+#define LEVEL_BUS_MAX_SUBSCRIBERS 4 // Número máximo de tasks assinantes por barramento
+#define LEVEL_BUS_NOTIFY_INDEX 1    // Índice de notificação de task usado para acordar os assinantes
+
+// Amostra publicada no barramento
+typedef struct {
+    int value;             // Nível de água em porcentagem
+    uint32_t seq;          // Número de sequência da publicação (começa em 1)
+    uint64_t timestamp_us; // Instante da publicação, para medir latência até o assinante
+} level_sample_t;
+
+typedef struct {
+    int value;
+    uint64_t timestamp_us;
+} level_bus_slot_t;
+
+typedef struct {
+    level_bus_slot_t slots[2];   // O slot (seq & 1) contém a publicação atual
+    volatile uint32_t seq;
+    TaskHandle_t subscribers[LEVEL_BUS_MAX_SUBSCRIBERS];
+    volatile uint8_t num_subscribers;
+} level_bus_t;
+
+// Estado de um assinante, pertence à task que o registrou
+typedef struct {
+    level_bus_t *bus;
+    uint32_t last_seq;       // Última sequência entregue a esta task
+    uint32_t received;       // Total de amostras entregues
+    uint32_t skipped;        // Total de amostras sobrescritas antes de serem lidas
+    uint32_t latency_max_us; // Pior latência publicação -> entrega observada
+    uint64_t latency_total_us; // Soma das latências, para a média
+} level_bus_sub_t;
+
+void level_bus_init(level_bus_t *bus);
+
+// Registra a task chamadora como assinante. Retorna false se não houver espaço
+bool level_bus_subscribe(level_bus_t *bus, level_bus_sub_t *sub);
+
+// Publica um novo valor e acorda todos os assinantes, nunca bloqueia
+void level_bus_publish(level_bus_t *bus, int value);
+
+// Aguarda uma amostra mais nova que a última entregue a este assinante.
+// Retorna false em caso de timeout. Em 'skipped' (opcional) retorna quantas publicações foram perdidas
+bool level_bus_receive(level_bus_sub_t *sub, level_sample_t *sample, uint32_t *skipped, TickType_t timeout);
+
+// Lê o último valor publicado sem consumir nem bloquear
+void level_bus_peek(level_bus_t *bus, level_sample_t *sample);
+
+#endif // LEVEL_BUS_H
@@ -0,0 +1,86 @@
+#include "level_filter.h"
+
+void level_filter_init(level_filter_t *filter, const level_filter_config_t *config)
+{
+    filter->config = *config;
+    if (filter->config.median_window < 1)
+        filter->config.median_window = 1;
+    if (filter->config.median_window > LEVEL_FILTER_MAX_WINDOW)
+        filter->config.median_window = LEVEL_FILTER_MAX_WINDOW;
+    filter->primed = false;
+    filter->rejected_total = 0;
+}
+
+void level_filter_reset(level_filter_t *filter, int32_t sample)
+{
+    for (uint8_t i = 0; i < filter->config.median_window; i++)
+    {
+        filter->window[i] = sample;
+        filter->sorted[i] = sample;
+    }
+    filter->head = 0;
+    filter->output = sample;
+    filter->rejects = 0;
+    filter->primed = true;
+}
+
+// Troca a amostra mais antiga da janela pela nova mantendo 'sorted' ordenado.
+// Remove a antiga e desliza a nova até a posição certa: no máximo 'median_window' passos
+static int32_t median_push(level_filter_t *filter, int32_t sample)
+{
+    uint8_t n = filter->config.median_window;
+    int32_t oldest = filter->window[filter->head];
+    filter->window[filter->head] = sample;
+    filter->head = (filter->head + 1) % n;
+
+    uint8_t i = 0;
+    while (filter->sorted[i] != oldest)
+        i++;
+
+    // Desloca em direção à posição correta da nova amostra, ocupando o lugar da antiga
+    while (i > 0 && filter->sorted[i - 1] > sample)
+    {
+        filter->sorted[i] = filter->sorted[i - 1];
+        i--;
+    }
+    while (i < n - 1 && filter->sorted[i + 1] < sample)
+    {
+        filter->sorted[i] = filter->sorted[i + 1];
+        i++;
+    }
+    filter->sorted[i] = sample;
+
+    return filter->sorted[n / 2];
+}
+
+int32_t level_filter_update(level_filter_t *filter, int32_t sample)
+{
+    if (!filter->primed)
+    {
+        level_filter_reset(filter, sample);
+        return sample;
+    }
+
+    // Rejeição de espúrios: um salto maior que max_step é ignorado, a não ser que se repita
+    // por max_rejects amostras seguidas, quando passa a ser tratado como o novo nível real
+    if (filter->config.max_step > 0)
+    {
+        int32_t step = sample - filter->output;
+        if (step > filter->config.max_step || step < -filter->config.max_step)
+        {
+            filter->rejected_total++;
+            if (++filter->rejects <= filter->config.max_rejects)
+                return filter->output;
+            level_filter_reset(filter, sample);
+            return sample;
+        }
+        filter->rejects = 0;
+    }
+
+    int32_t median = median_push(filter, sample);
+
+    // EMA em Q15: saída += alpha * (mediana - saída), com arredondamento
+    int32_t delta = median - filter->output;
+    filter->output += (delta * (int32_t)filter->config.ema_alpha_q15 + (1 << 14)) >> 15;
+    return filter->output;
+}
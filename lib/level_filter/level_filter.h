@@ -0,0 +1,41 @@
+#ifndef LEVEL_FILTER_H
+#define LEVEL_FILTER_H
+
+#include "pico/stdlib.h"
+
+// Filtro de leituras de nível em ponto fixo, aplicado em três estágios:
+// rejeição de variações bruscas -> mediana deslizante -> média móvel exponencial (EMA).
+// Não usa heap nem ponto flutuante; o custo por amostra é limitado por LEVEL_FILTER_MAX_WINDOW.
+
+#define LEVEL_FILTER_MAX_WINDOW 9 // Maior janela de mediana suportada
+#define LEVEL_FILTER_Q 8          // Bits fracionários usados para representar a porcentagem (Q8)
+#define LEVEL_FILTER_ONE (1 << LEVEL_FILTER_Q)
+
+// Configuração por sensor. As amostras devem estar na faixa de +-32767 para a EMA não estourar
+typedef struct {
+    uint8_t median_window;  // Amostras da mediana (ímpar, 1 desabilita)
+    uint16_t ema_alpha_q15; // Peso da amostra nova na EMA em Q15 (32768 desabilita a suavização)
+    int32_t max_step;       // Maior variação aceita em relação à saída anterior (0 desabilita a rejeição)
+    uint8_t max_rejects;    // Rejeições seguidas após as quais o novo patamar é aceito como real
+} level_filter_config_t;
+
+typedef struct {
+    level_filter_config_t config;
+    int32_t window[LEVEL_FILTER_MAX_WINDOW]; // Amostras em ordem de chegada (buffer circular)
+    int32_t sorted[LEVEL_FILTER_MAX_WINDOW]; // As mesmas amostras ordenadas, para a mediana
+    uint8_t head;
+    int32_t output;          // Última saída (estado da EMA), na unidade de entrada
+    bool primed;             // false até a primeira amostra
+    uint8_t rejects;         // Rejeições seguidas
+    uint32_t rejected_total; // Total de amostras descartadas como espúrias
+} level_filter_t;
+
+void level_filter_init(level_filter_t *filter, const level_filter_config_t *config);
+
+// Reinicia o filtro com todos os estágios já no valor 'sample'
+void level_filter_reset(level_filter_t *filter, int32_t sample);
+
+// Processa uma amostra e retorna a saída filtrada, na mesma unidade da entrada
+int32_t level_filter_update(level_filter_t *filter, int32_t sample);
+
+#endif // LEVEL_FILTER_H
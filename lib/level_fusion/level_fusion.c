@@ -0,0 +1,127 @@
+#include "level_fusion.h"
+
+#define VARIANCE_SHIFT 3 // Constante de tempo das médias móveis: 1/8 por leitura
+
+void level_fusion_init(level_fusion_t *fusion, const level_fusion_config_t *config)
+{
+    fusion->config = *config;
+    for (uint8_t i = 0; i < LEVEL_FUSION_NUM_SENSORS; i++)
+    {
+        fusion->sensors[i].has_data = false;
+        fusion->sensors[i].faults = LEVEL_FUSION_FAULT_STALE;
+        fusion->sensors[i].variance = config->min_variance;
+    }
+    fusion->disagree_since_us = 0;
+    fusion->output = 0;
+    fusion->active_mask = 0;
+}
+
+void level_fusion_update(level_fusion_t *fusion, level_fusion_sensor_id_t id, int32_t value_q8, uint64_t now_us)
+{
+    level_fusion_sensor_t *sensor = &fusion->sensors[id];
+
+    if (!sensor->has_data)
+    {
+        sensor->mean = value_q8;
+        sensor->variance = fusion->config.min_variance;
+        sensor->has_data = true;
+    }
+    else
+    {
+        // Variância como média móvel do quadrado do desvio em relação à média móvel
+        int32_t deviation = value_q8 - sensor->mean;
+        sensor->mean += deviation >> VARIANCE_SHIFT;
+        uint32_t squared = (uint32_t)(deviation * deviation); // |desvio| <= 100% em Q8, cabe em 32 bits
+        if (squared >= sensor->variance)
+            sensor->variance += (squared - sensor->variance) >> VARIANCE_SHIFT;
+        else
+            sensor->variance -= (sensor->variance - squared) >> VARIANCE_SHIFT;
+    }
+
+    sensor->value = value_q8;
+    sensor->last_update_us = now_us;
+}
+
+static uint32_t effective_variance(const level_fusion_t *fusion, const level_fusion_sensor_t *sensor)
+{
+    return sensor->variance > fusion->config.min_variance ? sensor->variance : fusion->config.min_variance;
+}
+
+bool level_fusion_compute(level_fusion_t *fusion, uint64_t now_us, int32_t *value_q8)
+{
+    level_fusion_sensor_t *pot = &fusion->sensors[LEVEL_FUSION_POTENTIOMETER];
+    level_fusion_sensor_t *ultra = &fusion->sensors[LEVEL_FUSION_ULTRASONIC];
+
+    // Falhas individuais: sensor parado ou ruidoso
+    for (uint8_t i = 0; i < LEVEL_FUSION_NUM_SENSORS; i++)
+    {
+        level_fusion_sensor_t *sensor = &fusion->sensors[i];
+        sensor->faults &= LEVEL_FUSION_FAULT_DRIFT;
+        if (!sensor->has_data || now_us - sensor->last_update_us > fusion->config.stale_timeout_us)
+            sensor->faults |= LEVEL_FUSION_FAULT_STALE;
+        if (sensor->variance > fusion->config.max_variance)
+            sensor->faults |= LEVEL_FUSION_FAULT_NOISY;
+    }
+
+    // Divergência entre os dois, só avaliada quando ambos estão funcionando.
+    // Com apenas dois sensores não dá para saber qual está certo: descarta o mais ruidoso,
+    // ou o secundário se a variância for igual
+    bool both_alive = !(pot->faults & ~LEVEL_FUSION_FAULT_DRIFT) && !(ultra->faults & ~LEVEL_FUSION_FAULT_DRIFT);
+    int32_t difference = pot->value - ultra->value;
+    if (both_alive && (difference > fusion->config.max_disagreement || difference < -fusion->config.max_disagreement))
+    {
+        if (!fusion->disagree_since_us)
+            fusion->disagree_since_us = now_us;
+        if (now_us - fusion->disagree_since_us > fusion->config.drift_timeout_us &&
+            !((pot->faults | ultra->faults) & LEVEL_FUSION_FAULT_DRIFT))
+        {
+            level_fusion_sensor_t *suspect;
+            if (pot->variance != ultra->variance)
+                suspect = pot->variance > ultra->variance ? pot : ultra;
+            else
+                suspect = fusion->config.primary == LEVEL_FUSION_POTENTIOMETER ? ultra : pot;
+            suspect->faults |= LEVEL_FUSION_FAULT_DRIFT;
+        }
+    }
+    else
+    {
+        fusion->disagree_since_us = 0;
+        pot->faults &= ~LEVEL_FUSION_FAULT_DRIFT;
+        ultra->faults &= ~LEVEL_FUSION_FAULT_DRIFT;
+    }
+
+    // Média ponderada pelo inverso da variância: x = (a*vb + b*va) / (va + vb)
+    int64_t numerator = 0;
+    uint64_t denominator = 0;
+    uint64_t total_variance = 0;
+    fusion->active_mask = 0;
+    for (uint8_t i = 0; i < LEVEL_FUSION_NUM_SENSORS; i++)
+    {
+        if (!fusion->sensors[i].faults)
+        {
+            fusion->active_mask |= 1u << i;
+            total_variance += effective_variance(fusion, &fusion->sensors[i]);
+        }
+    }
+    if (!fusion->active_mask)
+    {
+        *value_q8 = fusion->output;
+        return false;
+    }
+    for (uint8_t i = 0; i < LEVEL_FUSION_NUM_SENSORS; i++)
+    {
+        if (fusion->active_mask & (1u << i))
+        {
+            // Peso de cada sensor = soma das variâncias dos outros (para dois sensores, a do outro)
+            uint64_t weight = total_variance - effective_variance(fusion, &fusion->sensors[i]);
+            if (fusion->active_mask == (1u << i))
+                weight = 1;
+            numerator += (int64_t)fusion->sensors[i].value * (int64_t)weight;
+            denominator += weight;
+        }
+    }
+
+    fusion->output = (int32_t)(numerator / (int64_t)denominator);
+    *value_q8 = fusion->output;
+    return true;
+}
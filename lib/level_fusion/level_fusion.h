@@ -0,0 +1,58 @@
+#ifndef LEVEL_FUSION_H
+#define LEVEL_FUSION_H
+
+#include "pico/stdlib.h"
+
+// Combina as leituras de nível da boia e do ultrassônico (porcentagem em Q8).
+// Cada sensor tem sua variância estimada continuamente; os sensores saudáveis são combinados
+// com peso inversamente proporcional à variância. Um sensor parado (sem leituras), ruidoso
+// demais ou que diverge do outro por muito tempo é excluído até a condição desaparecer.
+
+#define LEVEL_FUSION_NUM_SENSORS 2
+
+typedef enum {
+    LEVEL_FUSION_POTENTIOMETER = 0,
+    LEVEL_FUSION_ULTRASONIC = 1
+} level_fusion_sensor_id_t;
+
+// Motivos de exclusão de um sensor (máscara de bits)
+#define LEVEL_FUSION_FAULT_STALE 0x01 // Sem leituras novas dentro de stale_timeout_us
+#define LEVEL_FUSION_FAULT_NOISY 0x02 // Variância acima de max_variance
+#define LEVEL_FUSION_FAULT_DRIFT 0x04 // Divergiu do outro sensor por mais de drift_timeout_us
+
+typedef struct {
+    uint32_t stale_timeout_us;  // Tempo sem leituras para considerar o sensor parado
+    uint32_t min_variance;      // Piso da variância (Q16), evita peso infinito em um sensor parado
+    uint32_t max_variance;      // Variância (Q16) acima da qual o sensor é descartado
+    int32_t max_disagreement;   // Diferença máxima (Q8) aceita entre os sensores
+    uint32_t drift_timeout_us;  // Tempo de divergência até excluir o sensor suspeito
+    level_fusion_sensor_id_t primary; // Sensor mantido em caso de empate na divergência
+} level_fusion_config_t;
+
+typedef struct {
+    int32_t value;           // Última leitura (Q8)
+    int32_t mean;            // Média móvel da leitura (Q8)
+    uint32_t variance;       // Variância móvel em torno da média (Q16)
+    uint64_t last_update_us; // Instante da última leitura nova
+    bool has_data;
+    uint8_t faults;          // LEVEL_FUSION_FAULT_*
+} level_fusion_sensor_t;
+
+typedef struct {
+    level_fusion_config_t config;
+    level_fusion_sensor_t sensors[LEVEL_FUSION_NUM_SENSORS];
+    uint64_t disagree_since_us; // Início da divergência atual, 0 se os sensores concordam
+    int32_t output;             // Último valor combinado (Q8)
+    uint8_t active_mask;        // Sensores usados no último valor combinado
+} level_fusion_t;
+
+void level_fusion_init(level_fusion_t *fusion, const level_fusion_config_t *config);
+
+// Entrega uma leitura nova de um sensor
+void level_fusion_update(level_fusion_t *fusion, level_fusion_sensor_id_t id, int32_t value_q8, uint64_t now_us);
+
+// Reavalia as falhas e calcula o valor combinado. Com os dois sensores em falha mantém o último valor.
+// Retorna false se nenhum sensor estava disponível
+bool level_fusion_compute(level_fusion_t *fusion, uint64_t now_us, int32_t *value_q8);
+
+#endif // LEVEL_FUSION_H
@@ -3,20 +3,18 @@
 
 #include <stdio.h>
 #include "pico/stdlib.h"
-#include "hardware/pio.h"
-#include "hardware/clocks.h"
-#include "pio_matrix.pio.h"
-
-extern uint sm;
+#include "ws2812/ws2812.h"
 
+#define NUM_PIXELS 25
 
 uint8_t obter_index(uint8_t i); //Função auxiliar para preencher a matriz de LEDS
 
-void desenha_frame(const uint32_t matriz[][25],uint8_t frame); //Desenha frame especifico do vetor de frames
+// Envia um quadro já em ordem de fio pelo DMA, sem esperar a transmissão. Quadro igual ao último enviado
+// não é reenviado. Retorna true se o quadro foi enviado
+bool envia_frame(const uint32_t fio[NUM_PIXELS]);
 
 void init_led_matrix(); //Configurações para uso da matriz de LEDs
 
 void apaga_matriz(); //Apaga os LEDs ligados da matriz de LEDs
 
-extern const uint32_t levels[5][25]; //Vetor  de frames, com os números de 0 a 9
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,101 @@
+#include "matrix_render.h"
+#include <math.h>
+
+typedef struct {
+    uint8_t r, g, b;
+} matrix_render_color_t;
+
+// Cor da água pela profundidade: a linha da superfície é mais clara, as de baixo mais azuis
+static const matrix_render_color_t water_palette[MATRIX_RENDER_ROWS] = {
+    {70, 120, 255},
+    {0, 0, 255},
+    {0, 0, 200},
+    {0, 0, 160},
+    {0, 0, 150},
+};
+
+// Onda triangular de 8 bits: 0 -> 255 -> 0 ao longo de uma volta de 'phase'
+static inline uint32_t triangle(uint32_t phase)
+{
+    phase &= 0xFF;
+    return phase < 128 ? phase * 2 : (255 - phase) * 2;
+}
+
+void matrix_render_init(matrix_render_t *render, uint8_t brightness, uint8_t (*wire_index)(uint8_t i))
+{
+    render->shown_q8 = 0;
+    render->brightness = brightness;
+    render->frame = 0;
+    for (uint8_t i = 0; i < MATRIX_RENDER_PIXELS; i++)
+    {
+        render->wire_pixel[i] = wire_index(i);
+    }
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        render->gamma[i] = (uint8_t)(powf(i / 255.0f, MATRIX_RENDER_GAMMA) * 255.0f + 0.5f);
+    }
+}
+
+// Canal final: cor (0-255) * intensidade (0-256) * brilho (0-255), corrigido pela tabela gamma
+static inline uint32_t shade(const matrix_render_t *render, uint32_t color, uint32_t intensity)
+{
+    return render->gamma[(color * intensity * render->brightness) >> 16];
+}
+
+void matrix_render_frame(matrix_render_t *render, int32_t level_q8, uint8_t flags, uint32_t *fio)
+{
+    // O nível exibido persegue o medido; perto do alvo encaixa, senão o deslocamento nunca chegaria a zero
+    int32_t diff = level_q8 - render->shown_q8;
+    if (diff > -(1 << MATRIX_RENDER_EASE_SHIFT) && diff < (1 << MATRIX_RENDER_EASE_SHIFT))
+    {
+        render->shown_q8 = level_q8;
+    }
+    else
+    {
+        render->shown_q8 += diff >> MATRIX_RENDER_EASE_SHIFT;
+    }
+
+    // Altura da água em linhas, Q8: a parte inteira são linhas cheias, a fração acende a linha da superfície
+    int32_t fill = render->shown_q8 * MATRIX_RENDER_ROWS / 100;
+    if (fill < 0)
+        fill = 0;
+    if (fill > MATRIX_RENDER_ROWS << 8)
+        fill = MATRIX_RENDER_ROWS << 8;
+    int32_t surface = (fill - 1) >> 8; // Linha (contada de baixo) mais alta com água, -1 sem água
+
+    uint32_t pulse = triangle(render->frame * 256 / MATRIX_RENDER_FPS); // Uma volta por segundo
+
+    for (uint8_t i = 0; i < MATRIX_RENDER_PIXELS; i++)
+    {
+        uint8_t pixel = render->wire_pixel[i];
+        int32_t row = MATRIX_RENDER_ROWS - 1 - pixel / MATRIX_RENDER_WIDTH; // Contada de baixo
+        uint32_t column = pixel % MATRIX_RENDER_WIDTH;
+        int32_t amount = fill - (row << 8); // Quanto desta linha está cheio, em Q8
+        uint32_t r = 0, g = 0, b = 0;
+
+        if (amount > 0)
+        {
+            uint32_t intensity = amount > 256 ? 256 : amount;
+            if (row == surface && (flags & MATRIX_RENDER_FLAG_PUMP))
+            {
+                // Onda correndo pela superfície: a intensidade varia entre 1/2 e 1 de coluna a coluna
+                uint32_t wave = 128 + triangle(column * 51 + render->frame * 16) / 2;
+                intensity = intensity * wave >> 8;
+            }
+            if (flags & MATRIX_RENDER_FLAG_ALARM)
+            {
+                intensity = intensity * (128 + pulse / 2) >> 8;
+            }
+            const matrix_render_color_t *color = &water_palette[surface - row];
+            r = shade(render, color->r, intensity);
+            g = shade(render, color->g, intensity);
+            b = shade(render, color->b, intensity);
+        }
+        else if (flags & MATRIX_RENDER_FLAG_ALARM)
+        {
+            r = shade(render, 255, pulse);
+        }
+        fio[i] = (g << 24) | (r << 16) | (b << 8);
+    }
+    render->frame++;
+}
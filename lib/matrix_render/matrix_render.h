@@ -0,0 +1,41 @@
+#ifndef MATRIX_RENDER_H
+#define MATRIX_RENDER_H
+
+#include "pico/stdlib.h"
+
+// Desenho do nível de água na matriz 5x5, quadro a quadro, em vez de cinco quadros fixos de 20%.
+// A linha da superfície acende proporcionalmente à fração do nível que cai nela, e o nível exibido
+// persegue o medido aos poucos, então a água sobe e desce suavemente. Bomba ligada faz uma onda correr
+// pela superfície; alarme pulsa em vermelho a parte vazia.
+// Todo o cálculo é inteiro e o trabalho por quadro é fixo (os mesmos 25 pixels, sem laços dependentes
+// do nível): o tempo de um quadro é sempre o mesmo e fica muito abaixo do período.
+// Cor final de cada canal: gamma[cor * intensidade * brilho], com a correção gamma em tabela.
+
+#define MATRIX_RENDER_WIDTH 5
+#define MATRIX_RENDER_ROWS 5
+#define MATRIX_RENDER_PIXELS (MATRIX_RENDER_WIDTH * MATRIX_RENDER_ROWS)
+#define MATRIX_RENDER_FPS 30
+#define MATRIX_RENDER_PERIOD_MS (1000 / MATRIX_RENDER_FPS)
+#define MATRIX_RENDER_EASE_SHIFT 3     // A cada quadro o nível exibido anda 1/8 do que falta
+#define MATRIX_RENDER_GAMMA 2.2f
+#define MATRIX_RENDER_BUDGET_US 2000   // Tempo máximo de desenho de um quadro (o envio ao PIO leva ~750 us)
+
+#define MATRIX_RENDER_FLAG_PUMP (1 << 0)  // Onda na superfície
+#define MATRIX_RENDER_FLAG_ALARM (1 << 1) // Parte vazia pulsando em vermelho
+
+typedef struct {
+    int32_t shown_q8;      // Nível exibido, em porcentagem Q8
+    uint8_t brightness;    // Brilho global, 0 a 255
+    uint32_t frame;        // Quadros desenhados, dá a fase das animações
+    uint8_t wire_pixel[MATRIX_RENDER_PIXELS]; // Pixel (linha * largura + coluna, linha 0 em cima) de cada posição do fio
+    uint8_t gamma[256];
+} matrix_render_t;
+
+// 'wire_index' devolve o pixel ligado em cada posição do fio (obter_index, na matriz da placa)
+void matrix_render_init(matrix_render_t *render, uint8_t brightness, uint8_t (*wire_index)(uint8_t i));
+
+// Desenha o próximo quadro em 'fio', já na ordem de envio e no formato do PIO (GRB nos 24 bits altos).
+// 'level_q8' é o nível medido em porcentagem Q8, 'flags' são MATRIX_RENDER_FLAG_*
+void matrix_render_frame(matrix_render_t *render, int32_t level_q8, uint8_t flags, uint32_t *fio);
+
+#endif // MATRIX_RENDER_H
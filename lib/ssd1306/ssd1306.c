@@ -1,5 +1,8 @@
+#include <string.h>
 #include "ssd1306.h"
 #include "font.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
 
 void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_vcc, uint8_t address, i2c_inst_t *i2c) {
   ssd->width = width;
@@ -11,6 +14,15 @@ void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_v
   ssd->ram_buffer = calloc(ssd->bufsize, sizeof(uint8_t));
   ssd->ram_buffer[0] = 0x40;
   ssd->port_buffer[0] = 0x80;
+  ssd->shadow_buffer = calloc(ssd->bufsize, sizeof(uint8_t));
+  ssd->shadow_valid = false;
+  // Quadro inteiro mais os 8 bytes de controle/comandos de até SSD1306_MAX_WINDOWS janelas
+  ssd->tx_capacity = (ssd->bufsize - 1) + 8 * SSD1306_MAX_WINDOWS;
+  ssd->tx_words = calloc(ssd->tx_capacity, sizeof(uint16_t));
+  ssd->last_flush_bytes = 0;
+  ssd->dma_chan = -1;
+  ssd->flush_callback = NULL;
+  ssd->flush_ctx = NULL;
 }
 
 void ssd1306_config(ssd1306_t *ssd) {
@@ -42,6 +54,7 @@ void ssd1306_config(ssd1306_t *ssd) {
 }
 
 void ssd1306_command(ssd1306_t *ssd, uint8_t command) {
+  ssd1306_wait_idle(ssd); // Não intercala um comando avulso com um envio assíncrono em andamento
   ssd->port_buffer[1] = command;
   i2c_write_blocking(
     ssd->i2c_port,
@@ -52,20 +65,203 @@ void ssd1306_command(ssd1306_t *ssd, uint8_t command) {
   );
 }
 
+// Display dono do canal DMA, usado pelo tratador de interrupção
+static ssd1306_t *dma_owner = NULL;
+
+static void ssd1306_dma_irq_handler(void) {
+  if (!dma_owner || !dma_channel_get_irq1_status(dma_owner->dma_chan))
+    return;
+  dma_channel_acknowledge_irq1(dma_owner->dma_chan);
+  if (dma_owner->flush_callback)
+    dma_owner->flush_callback(dma_owner->flush_ctx);
+}
+
+// Configura um canal DMA que alimenta a FIFO de transmissão do I2C a partir do tx_words.
+// O callback é chamado em contexto de interrupção quando o DMA termina de ler o buffer
+void ssd1306_dma_init(ssd1306_t *ssd, ssd1306_flush_callback_t callback, void *ctx) {
+  ssd1306_wait_idle(ssd);
+  ssd->flush_callback = callback;
+  ssd->flush_ctx = ctx;
+  if (ssd->dma_chan >= 0)
+    return;
+
+  ssd->dma_chan = dma_claim_unused_channel(true);
+  dma_channel_config cfg = dma_channel_get_default_config(ssd->dma_chan);
+  // Palavras de 16 bits: byte de dados + bit de STOP no fim de cada transação
+  channel_config_set_transfer_data_size(&cfg, DMA_SIZE_16);
+  channel_config_set_read_increment(&cfg, true);
+  channel_config_set_write_increment(&cfg, false);
+  channel_config_set_dreq(&cfg, i2c_get_dreq(ssd->i2c_port, true));
+  dma_channel_configure(ssd->dma_chan, &cfg, &i2c_get_hw(ssd->i2c_port)->data_cmd, ssd->tx_words, 0, false);
+
+  dma_owner = ssd;
+  dma_channel_set_irq1_enabled(ssd->dma_chan, true);
+  irq_add_shared_handler(DMA_IRQ_1, ssd1306_dma_irq_handler, PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY);
+  irq_set_enabled(DMA_IRQ_1, true);
+}
+
+bool ssd1306_is_busy(ssd1306_t *ssd) {
+  i2c_hw_t *hw = i2c_get_hw(ssd->i2c_port);
+  if (ssd->dma_chan >= 0 && dma_channel_is_busy(ssd->dma_chan))
+    return true;
+  return !(hw->status & I2C_IC_STATUS_TFE_BITS) || (hw->status & I2C_IC_STATUS_ACTIVITY_BITS);
+}
+
+// Se o display não respondeu (NACK) em algum envio, limpa o abort do I2C. Enquanto o abort não é
+// lido em clr_tx_abrt o controlador mantém a FIFO esvaziada e descarta todo quadro seguinte
+static void ssd1306_clear_abort(ssd1306_t *ssd) {
+  i2c_hw_t *hw = i2c_get_hw(ssd->i2c_port);
+  if (hw->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) {
+    (void)hw->clr_tx_abrt;
+    // A cópia já registrava o quadro perdido como exibido: o próximo envio volta a ser completo
+    ssd1306_invalidate(ssd);
+  }
+}
+
+// Espera o DMA terminar e o último byte sair da FIFO do I2C
+void ssd1306_wait_idle(ssd1306_t *ssd) {
+  if (ssd->dma_chan >= 0)
+    dma_channel_wait_for_finish_blocking(ssd->dma_chan);
+  while (ssd1306_is_busy(ssd))
+    tight_loop_contents();
+  ssd1306_clear_abort(ssd);
+}
+
+// Empacota uma janela retangular de colunas [c0, c1] e páginas [p0, p1] no tx_words: uma
+// transação de comandos de janela e uma de dados, cada uma terminada com STOP.
+// Com o endereçamento vertical (SET_MEM_ADDR 0x01) o display percorre as páginas de cada coluna
+// antes de avançar a coluna, que é a mesma ordem do ram_buffer.
+static size_t ssd1306_pack_window(ssd1306_t *ssd, size_t n, uint8_t c0, uint8_t c1, uint8_t p0, uint8_t p1) {
+  uint16_t *out = ssd->tx_words;
+
+  out[n++] = 0x00; // Byte de controle: sequência de comandos
+  out[n++] = SET_COL_ADDR;
+  out[n++] = c0;
+  out[n++] = c1;
+  out[n++] = SET_PAGE_ADDR;
+  out[n++] = p0;
+  out[n++] = p1 | I2C_IC_DATA_CMD_STOP_BITS;
+
+  out[n++] = 0x40; // Byte de controle: dados da GDDRAM
+  for (uint8_t x = c0; x <= c1; ++x) {
+    const uint8_t *column = &ssd->ram_buffer[1 + x * ssd->pages];
+    uint8_t *shadow = &ssd->shadow_buffer[1 + x * ssd->pages];
+    for (uint8_t p = p0; p <= p1; ++p) {
+      out[n++] = column[p];
+      shadow[p] = column[p];
+    }
+  }
+  out[n - 1] |= I2C_IC_DATA_CMD_STOP_BITS;
+
+  ssd->last_flush_bytes += 2; // Byte de endereço I2C de cada uma das duas transações
+  return n;
+}
+
+// Retorna uma máscara com um bit por página que difere do último quadro enviado
+static uint8_t ssd1306_dirty_pages(ssd1306_t *ssd, uint8_t x) {
+  if (!ssd->shadow_valid)
+    return (uint8_t)((1u << ssd->pages) - 1);
+
+  const uint8_t *now = &ssd->ram_buffer[1 + x * ssd->pages];
+  const uint8_t *before = &ssd->shadow_buffer[1 + x * ssd->pages];
+  uint8_t mask = 0;
+  for (uint8_t p = 0; p < ssd->pages; ++p) {
+    if (now[p] != before[p])
+      mask |= 1u << p;
+  }
+  return mask;
+}
+
+// Monta no tx_words as janelas de colunas/páginas que mudaram desde o último envio.
+// Retorna o número de palavras a transmitir
+static size_t ssd1306_pack_dirty(ssd1306_t *ssd) {
+  size_t n = 0;
+  ssd->last_flush_bytes = 0;
+
+  uint8_t x = 0;
+  while (x < ssd->width) {
+    uint8_t mask = ssd1306_dirty_pages(ssd, x);
+    if (!mask) {
+      ++x;
+      continue;
+    }
+
+    // Estende a janela enquanto houver outra coluna alterada perto o bastante
+    uint8_t c0 = x, c1 = x;
+    uint8_t window_mask = mask;
+    for (uint8_t next = x + 1; next < ssd->width && next - c1 <= SSD1306_WINDOW_MERGE_GAP + 1; ++next) {
+      mask = ssd1306_dirty_pages(ssd, next);
+      if (mask) {
+        window_mask |= mask;
+        c1 = next;
+      }
+    }
+
+    uint8_t p0 = 0, p1 = ssd->pages - 1;
+    while (!(window_mask & (1u << p0)))
+      ++p0;
+    while (!(window_mask & (1u << p1)))
+      --p1;
+
+    // Alterações muito espalhadas não cabem no buffer: envia o quadro inteiro
+    if (n + 8 + (size_t)(c1 - c0 + 1) * (p1 - p0 + 1) > ssd->tx_capacity) {
+      ssd->last_flush_bytes = 0;
+      n = ssd1306_pack_window(ssd, 0, 0, ssd->width - 1, 0, ssd->pages - 1);
+      break;
+    }
+
+    n = ssd1306_pack_window(ssd, n, c0, c1, p0, p1);
+    x = c1 + 1;
+  }
+
+  ssd->shadow_valid = true;
+  ssd->last_flush_bytes += n;
+  return n;
+}
+
+// Inicia o envio das alterações e retorna sem esperar o barramento.
+// O ram_buffer pode ser redesenhado logo em seguida: o que vai para o fio já está no tx_words.
+// Retorna false se não havia nada para enviar (nesse caso o callback não será chamado)
+bool ssd1306_send_data_async(ssd1306_t *ssd) {
+  if (ssd->dma_chan >= 0)
+    dma_channel_wait_for_finish_blocking(ssd->dma_chan); // O tx_words ainda pertence ao envio anterior
+  ssd1306_clear_abort(ssd); // Antes de empacotar, para um quadro perdido ser enviado de novo por inteiro
+
+  size_t n = ssd1306_pack_dirty(ssd);
+  if (!n)
+    return false;
+
+  i2c_hw_t *hw = i2c_get_hw(ssd->i2c_port);
+  if ((hw->tar & 0x3FF) != ssd->address) {
+    // Trocar o endereço exige desabilitar o I2C, só pode ser feito com o barramento parado
+    ssd1306_wait_idle(ssd);
+    hw->enable = 0;
+    hw->tar = ssd->address;
+    hw->enable = 1;
+  }
+
+  if (ssd->dma_chan >= 0) {
+    dma_channel_transfer_from_buffer_now(ssd->dma_chan, ssd->tx_words, n);
+  } else {
+    // Sem DMA configurado (ex.: antes do escalonador): a CPU alimenta a FIFO
+    for (size_t i = 0; i < n; ++i) {
+      while (!(hw->status & I2C_IC_STATUS_TFNF_BITS))
+        tight_loop_contents();
+      hw->data_cmd = ssd->tx_words[i];
+    }
+  }
+  return true;
+}
+
+// Envia as alterações e espera o último byte sair no barramento
 void ssd1306_send_data(ssd1306_t *ssd) {
-  ssd1306_command(ssd, SET_COL_ADDR);
-  ssd1306_command(ssd, 0);
-  ssd1306_command(ssd, ssd->width - 1);
-  ssd1306_command(ssd, SET_PAGE_ADDR);
-  ssd1306_command(ssd, 0);
-  ssd1306_command(ssd, ssd->pages - 1);
-  i2c_write_blocking(
-    ssd->i2c_port,
-    ssd->address,
-    ssd->ram_buffer,
-    ssd->bufsize,
-    false
-  );
+  ssd1306_send_data_async(ssd);
+  ssd1306_wait_idle(ssd);
+}
+
+// Descarta a cópia do último quadro, o próximo envio será completo (ex.: após reiniciar o display)
+void ssd1306_invalidate(ssd1306_t *ssd) {
+  ssd->shadow_valid = false;
 }
 
 void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value) {
@@ -77,41 +273,53 @@ void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value) {
     ssd->ram_buffer[index] &= ~(1 << pixel);
 }
 
-/*
-void ssd1306_fill(ssd1306_t *ssd, bool value) {
-  uint8_t byte = value ? 0xFF : 0x00;
-  for (uint8_t i = 1; i < ssd->bufsize; ++i)
-    ssd->ram_buffer[i] = byte;
-}*/
-
+// Como o ram_buffer é organizado por coluna (8 páginas de 8 pixels cada), preencher a tela
+// inteira é só escrever bytes inteiros
 void ssd1306_fill(ssd1306_t *ssd, bool value) {
-    // Itera por todas as posições do display
-    for (uint8_t y = 0; y < ssd->height; ++y) {
-        for (uint8_t x = 0; x < ssd->width; ++x) {
-            ssd1306_pixel(ssd, x, y, value);
-        }
-    }
+  memset(&ssd->ram_buffer[1], value ? 0xFF : 0x00, ssd->bufsize - 1);
 }
 
+// Preenche as linhas [y0, y1] de uma coluna. As páginas inteiras são escritas de uma vez,
+// só as páginas das pontas precisam de máscara
+static void ssd1306_column_span(ssd1306_t *ssd, uint8_t x, uint8_t y0, uint8_t y1, bool value) {
+  uint8_t *column = &ssd->ram_buffer[1 + x * ssd->pages];
+  uint8_t first = y0 >> 3, last = y1 >> 3;
+  uint8_t first_mask = 0xFF << (y0 & 7);
+  uint8_t last_mask = 0xFF >> (7 - (y1 & 7));
 
+  if (first == last) {
+    first_mask &= last_mask;
+  } else {
+    if (last > first + 1)
+      memset(&column[first + 1], value ? 0xFF : 0x00, last - first - 1);
+    if (value)
+      column[last] |= last_mask;
+    else
+      column[last] &= ~last_mask;
+  }
+  if (value)
+    column[first] |= first_mask;
+  else
+    column[first] &= ~first_mask;
+}
 
 void ssd1306_rect(ssd1306_t *ssd, uint8_t top, uint8_t left, uint8_t width, uint8_t height, bool value, bool fill) {
-  for (uint8_t x = left; x < left + width; ++x) {
-    ssd1306_pixel(ssd, x, top, value);
-    ssd1306_pixel(ssd, x, top + height - 1, value);
-  }
-  for (uint8_t y = top; y < top + height; ++y) {
-    ssd1306_pixel(ssd, left, y, value);
-    ssd1306_pixel(ssd, left + width - 1, y, value);
-  }
+  if (!width || !height || left >= ssd->width || top >= ssd->height)
+    return;
+  uint8_t right = (left + width - 1 < ssd->width) ? left + width - 1 : ssd->width - 1;
+  uint8_t bottom = (top + height - 1 < ssd->height) ? top + height - 1 : ssd->height - 1;
 
   if (fill) {
-    for (uint8_t x = left + 1; x < left + width - 1; ++x) {
-      for (uint8_t y = top + 1; y < top + height - 1; ++y) {
-        ssd1306_pixel(ssd, x, y, value);
-      }
-    }
+    // Borda e interior têm a mesma cor, então é um único span por coluna
+    for (uint8_t x = left; x <= right; ++x)
+      ssd1306_column_span(ssd, x, top, bottom, value);
+    return;
   }
+
+  ssd1306_hline(ssd, left, right, top, value);
+  ssd1306_hline(ssd, left, right, bottom, value);
+  ssd1306_vline(ssd, left, top, bottom, value);
+  ssd1306_vline(ssd, right, top, bottom, value);
 }
 
 void ssd1306_line(ssd1306_t *ssd, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1, bool value) {
@@ -144,13 +352,28 @@ void ssd1306_line(ssd1306_t *ssd, uint8_t x0, uint8_t y0, uint8_t x1, uint8_t y1
 
 
 void ssd1306_hline(ssd1306_t *ssd, uint8_t x0, uint8_t x1, uint8_t y, bool value) {
-  for (uint8_t x = x0; x <= x1; ++x)
-    ssd1306_pixel(ssd, x, y, value);
+  if (y >= ssd->height || x0 >= ssd->width)
+    return;
+  if (x1 >= ssd->width)
+    x1 = ssd->width - 1;
+
+  // Uma linha horizontal é o mesmo bit em colunas consecutivas, separadas por 'pages' bytes
+  uint8_t *byte = &ssd->ram_buffer[1 + x0 * ssd->pages + (y >> 3)];
+  uint8_t mask = 1 << (y & 7);
+  for (uint8_t x = x0; x <= x1; ++x, byte += ssd->pages) {
+    if (value)
+      *byte |= mask;
+    else
+      *byte &= ~mask;
+  }
 }
 
 void ssd1306_vline(ssd1306_t *ssd, uint8_t x, uint8_t y0, uint8_t y1, bool value) {
-  for (uint8_t y = y0; y <= y1; ++y)
-    ssd1306_pixel(ssd, x, y, value);
+  if (x >= ssd->width || y0 > y1 || y0 >= ssd->height)
+    return;
+  if (y1 >= ssd->height)
+    y1 = ssd->height - 1;
+  ssd1306_column_span(ssd, x, y0, y1, value);
 }
 
 // Função para desenhar um caractere
@@ -169,14 +392,24 @@ void ssd1306_draw_char(ssd1306_t *ssd, char c, uint8_t x, uint8_t y)
     index = 0; // Índice 0 corresponde ao caractere "nada" (espaço)
   }
 
-  // Desenha o caractere na tela
-  for (uint8_t i = 0; i < 8; ++i)
+  if (y >= ssd->height)
+    return;
+
+  // Cada byte da fonte já é uma coluna de 8 pixels, no mesmo formato das páginas do display.
+  // Com y múltiplo de 8 o glifo cai inteiro em uma página; senão é dividido entre duas
+  uint8_t page = y >> 3;
+  uint8_t shift = y & 7;
+  bool has_next_page = shift && page + 1 < ssd->pages;
+  uint8_t low_mask = 0xFF << shift;
+  uint8_t high_mask = 0xFF >> (8 - shift);
+
+  for (uint8_t i = 0; i < 8 && x + i < ssd->width; ++i)
   {
-    uint8_t line = font[index + i]; // Acessa a linha correspondente do caractere na fonte
-    for (uint8_t j = 0; j < 8; ++j)
-    {
-      ssd1306_pixel(ssd, x + i, y + j, line & (1 << j)); // Desenha cada pixel do caractere
-    }
+    uint8_t line = font[index + i]; // Acessa a coluna correspondente do caractere na fonte
+    uint8_t *column = &ssd->ram_buffer[1 + (x + i) * ssd->pages];
+    column[page] = (column[page] & ~low_mask) | (uint8_t)(line << shift);
+    if (has_next_page)
+      column[page + 1] = (column[page + 1] & ~high_mask) | (line >> (8 - shift));
   }
 }
 
@@ -8,6 +8,12 @@
 #define WIDTH 128
 #define HEIGHT 64
 
+// Colunas limpas entre duas regiões alteradas que ainda compensam ser enviadas junto,
+// em vez de pagar de novo os comandos de janela e o endereço I2C
+#define SSD1306_WINDOW_MERGE_GAP 4
+// Janelas por envio antes de cair para o envio do quadro completo
+#define SSD1306_MAX_WINDOWS 16
+
 typedef enum {
   SET_CONTRAST = 0x81,
   SET_ENTIRE_ON = 0xA4,
@@ -28,6 +34,9 @@ typedef enum {
   SET_CHARGE_PUMP = 0x8D
 } ssd1306_command_t;
 
+// Chamado em contexto de interrupção quando o DMA termina de ler o quadro em envio
+typedef void (*ssd1306_flush_callback_t)(void *ctx);
+
 typedef struct {
   uint8_t width, height, pages, address;
   i2c_inst_t *i2c_port;
@@ -35,12 +44,25 @@ typedef struct {
   uint8_t *ram_buffer;
   size_t bufsize;
   uint8_t port_buffer[2];
+  uint8_t *shadow_buffer;  // Cópia do último quadro enviado, usada para enviar só o que mudou
+  bool shadow_valid;       // false força o envio do quadro completo no próximo ssd1306_send_data
+  uint16_t *tx_words;      // Quadro em envio: um byte por palavra, com o bit de STOP do I2C no fim de cada transação
+  size_t tx_capacity;      // Tamanho do tx_words em palavras
+  size_t last_flush_bytes; // Bytes colocados no barramento pelo último ssd1306_send_data
+  int dma_chan;            // Canal DMA do envio assíncrono, -1 enquanto ssd1306_dma_init não for chamado
+  ssd1306_flush_callback_t flush_callback;
+  void *flush_ctx;
 } ssd1306_t;
 
 void ssd1306_init(ssd1306_t *ssd, uint8_t width, uint8_t height, bool external_vcc, uint8_t address, i2c_inst_t *i2c);
 void ssd1306_config(ssd1306_t *ssd);
 void ssd1306_command(ssd1306_t *ssd, uint8_t command);
 void ssd1306_send_data(ssd1306_t *ssd);
+void ssd1306_invalidate(ssd1306_t *ssd);
+void ssd1306_dma_init(ssd1306_t *ssd, ssd1306_flush_callback_t callback, void *ctx);
+bool ssd1306_send_data_async(ssd1306_t *ssd);
+bool ssd1306_is_busy(ssd1306_t *ssd);
+void ssd1306_wait_idle(ssd1306_t *ssd);
 
 void ssd1306_pixel(ssd1306_t *ssd, uint8_t x, uint8_t y, bool value);
 void ssd1306_fill(ssd1306_t *ssd, bool value);
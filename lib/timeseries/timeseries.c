@@ -0,0 +1,418 @@
+#include "timeseries.h"
+#include "hardware/sync.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ITEM_MAX 96 // Maior item da saída (o cabeçalho JSON)
+
+// Nada vem do heap: o orçamento de memória é conferido aqui, não em tempo de execução
+_Static_assert(sizeof(timeseries_t) <= TIMESERIES_MEMORY_BUDGET, "timeseries_t excede TIMESERIES_MEMORY_BUDGET");
+_Static_assert(sizeof(timeseries_record_t) == 6, "timeseries_record_t deve ser empacotado como no formato binário");
+
+static const uint8_t tier_ratio[TIMESERIES_TIERS] = {1, TIMESERIES_TIER1_RATIO, TIMESERIES_TIER2_RATIO};
+
+enum {
+    COLUMN_NONE = -1,
+    // Colunas enviadas como diferença para o registro anterior
+    COLUMN_LEVEL = 0,
+    COLUMN_LEVEL_MIN,
+    COLUMN_LEVEL_MAX,
+    // Colunas enviadas só nas mudanças
+    COLUMN_PUMP,
+    COLUMN_STALE,
+    COLUMN_LIMIT_MIN,
+    COLUMN_LIMIT_MAX
+};
+
+// Partes da saída JSON, na ordem. O cabeçalho (primeira parte) é montado com os parâmetros da leitura.
+// As partes 'aggregate' só aparecem nos níveis agregados: no nível 0 repetiriam o nível
+static const struct {
+    const char *literal;
+    int8_t column;
+    bool aggregate;
+} json_sections[] = {
+    {NULL, COLUMN_NONE, false},
+    {NULL, COLUMN_LEVEL, false},
+    {"],\"nivel_min\":[", COLUMN_NONE, true},
+    {NULL, COLUMN_LEVEL_MIN, true},
+    {"],\"nivel_max\":[", COLUMN_NONE, true},
+    {NULL, COLUMN_LEVEL_MAX, true},
+    {"],\"bomba\":[", COLUMN_NONE, false},
+    {NULL, COLUMN_PUMP, false},
+    {"],\"sem_leitura\":[", COLUMN_NONE, false},
+    {NULL, COLUMN_STALE, false},
+    {"],\"min\":[", COLUMN_NONE, false},
+    {NULL, COLUMN_LIMIT_MIN, false},
+    {"],\"max\":[", COLUMN_NONE, false},
+    {NULL, COLUMN_LIMIT_MAX, false},
+    {"]}", COLUMN_NONE, false},
+};
+#define JSON_SECTIONS (sizeof(json_sections) / sizeof(json_sections[0]))
+#define BINARY_SECTIONS 2 // Cabeçalho e registros
+
+void timeseries_init(timeseries_t *ts, uint32_t period_ms)
+{
+    timeseries_record_t *storage[TIMESERIES_TIERS] = {ts->tier0, ts->tier1, ts->tier2};
+    const uint32_t capacity[TIMESERIES_TIERS] = {TIMESERIES_TIER0_CAPACITY, TIMESERIES_TIER1_CAPACITY, TIMESERIES_TIER2_CAPACITY};
+
+    ts->origin_ms = 0;
+    for (uint8_t t = 0; t < TIMESERIES_TIERS; t++)
+    {
+        timeseries_tier_t *tier = &ts->tiers[t];
+        period_ms *= tier_ratio[t];
+        tier->records = storage[t];
+        tier->capacity = capacity[t];
+        tier->period_ms = period_ms;
+        tier->count = 0;
+        tier->acc_n = 0;
+    }
+}
+
+static void tier_push(timeseries_tier_t *tier, const timeseries_record_t *record)
+{
+    // Grava o registro e só então o publica avançando o contador
+    tier->records[tier->count % tier->capacity] = *record;
+    __dmb();
+    tier->count = tier->count + 1;
+}
+
+void timeseries_insert(timeseries_t *ts, uint8_t level, uint8_t flags, uint8_t limit_min, uint8_t limit_max, uint32_t now_ms)
+{
+    timeseries_record_t record = {level, level, level, flags, limit_min, limit_max};
+
+    if (ts->tiers[0].count == 0)
+    {
+        ts->origin_ms = now_ms; // Publicado junto com o primeiro registro, pela barreira de tier_push
+    }
+
+    // Cada registro completa no máximo um agregado por nível: custo limitado por TIMESERIES_TIERS
+    for (uint8_t t = 0; t < TIMESERIES_TIERS; t++)
+    {
+        tier_push(&ts->tiers[t], &record);
+        if (t + 1 == TIMESERIES_TIERS)
+        {
+            break;
+        }
+
+        timeseries_tier_t *next = &ts->tiers[t + 1];
+        if (next->acc_n == 0)
+        {
+            next->acc_sum = 0;
+            next->acc_min = UINT8_MAX;
+            next->acc_max = 0;
+            next->acc_flags = 0;
+        }
+        next->acc_sum += record.level;
+        if (record.level_min < next->acc_min)
+            next->acc_min = record.level_min;
+        if (record.level_max > next->acc_max)
+            next->acc_max = record.level_max;
+        next->acc_flags |= record.flags;
+        if (++next->acc_n < tier_ratio[t + 1])
+        {
+            break;
+        }
+
+        // Agregado completo: sobe para o próximo nível com os limites do último registro
+        record.level = (next->acc_sum + next->acc_n / 2) / next->acc_n;
+        record.level_min = next->acc_min;
+        record.level_max = next->acc_max;
+        record.flags = next->acc_flags;
+        next->acc_n = 0;
+    }
+}
+
+bool timeseries_get(const timeseries_t *ts, uint8_t tier, uint32_t index, timeseries_record_t *record)
+{
+    const timeseries_tier_t *t = &ts->tiers[tier];
+    uint32_t count = t->count;
+    // O registro mais antigo do buffer é o próximo a ser sobrescrito, então não é entregue
+    if (index >= count || count - index >= t->capacity)
+    {
+        return false;
+    }
+    __dmb();
+    *record = t->records[index % t->capacity];
+    __dmb();
+    // Se o produtor começou a gravar por cima durante a cópia, o contador já mostra
+    return t->count - index < t->capacity;
+}
+
+uint32_t timeseries_record_ms(const timeseries_t *ts, uint8_t tier, uint32_t index)
+{
+    return ts->origin_ms + index * ts->tiers[tier].period_ms;
+}
+
+// Índice do registro mais antigo que uma consulta pode entregar
+static uint32_t oldest_readable(uint32_t count, uint32_t capacity)
+{
+    return count > capacity - TIMESERIES_READ_SLACK ? count - (capacity - TIMESERIES_READ_SLACK) : 0;
+}
+
+static void tier_range(const timeseries_t *ts, uint8_t tier, uint32_t from_ms, uint32_t to_ms, timeseries_range_t *range)
+{
+    const timeseries_tier_t *t = &ts->tiers[tier];
+    uint32_t count = t->count;
+    uint32_t oldest = oldest_readable(count, t->capacity);
+    uint32_t first = (from_ms - ts->origin_ms) / t->period_ms;
+    uint32_t span = to_ms - ts->origin_ms; // Arredondado para cima sem somar, para não estourar perto de UINT32_MAX
+    uint32_t end = span / t->period_ms + (span % t->period_ms != 0);
+
+    if (first < oldest)
+        first = oldest;
+    if (end > count)
+        end = count;
+    if (first > end)
+        first = end;
+    range->tier = tier;
+    range->first = first;
+    range->end = end;
+}
+
+void timeseries_query(const timeseries_t *ts, uint32_t from_ms, uint32_t to_ms, uint32_t max_points, timeseries_range_t *range)
+{
+    // Nada é mais antigo que o primeiro registro
+    if (from_ms < ts->origin_ms)
+        from_ms = ts->origin_ms;
+    if (to_ms < from_ms)
+        to_ms = from_ms;
+
+    uint8_t tier = TIMESERIES_TIERS - 1; // Se nenhum nível alcança o início, o mais longo é o que mais se aproxima
+    for (uint8_t t = 0; t < TIMESERIES_TIERS; t++)
+    {
+        const timeseries_tier_t *candidate = &ts->tiers[t];
+        if (timeseries_record_ms(ts, t, oldest_readable(candidate->count, candidate->capacity)) <= from_ms)
+        {
+            tier = t;
+            break;
+        }
+    }
+
+    // Os níveis mais grossos guardam mais tempo, então continuam cobrindo o intervalo
+    tier_range(ts, tier, from_ms, to_ms, range);
+    while (max_points && range->end - range->first > max_points && tier + 1 < TIMESERIES_TIERS)
+    {
+        tier_range(ts, ++tier, from_ms, to_ms, range);
+    }
+}
+
+void timeseries_reader_init(timeseries_reader_t *reader, const timeseries_t *ts, timeseries_format_t format, const timeseries_range_t *range)
+{
+    reader->ts = ts;
+    reader->range = *range;
+    reader->format = format;
+    reader->section = 0;
+    reader->index = range->first;
+    reader->offset = 0;
+    reader->prev = -1;
+    reader->comma = false;
+}
+
+static uint8_t section_count(const timeseries_reader_t *reader)
+{
+    return reader->format == TIMESERIES_FORMAT_JSON ? JSON_SECTIONS : BINARY_SECTIONS;
+}
+
+// Coluna percorrida pela seção atual, ou COLUMN_NONE se a seção é um item único
+static int8_t section_column(const timeseries_reader_t *reader)
+{
+    if (reader->format == TIMESERIES_FORMAT_JSON)
+        return json_sections[reader->section].column;
+    return reader->section == 1 ? COLUMN_LEVEL : COLUMN_NONE;
+}
+
+static int column_value(const timeseries_record_t *record, int8_t column)
+{
+    switch (column)
+    {
+    case COLUMN_LEVEL: return record->level;
+    case COLUMN_LEVEL_MIN: return record->level_min;
+    case COLUMN_LEVEL_MAX: return record->level_max;
+    case COLUMN_PUMP: return record->flags & TIMESERIES_FLAG_PUMP ? 1 : 0;
+    case COLUMN_STALE: return record->flags & TIMESERIES_FLAG_STALE ? 1 : 0;
+    case COLUMN_LIMIT_MIN: return record->limit_min;
+    default: return record->limit_max;
+    }
+}
+
+static void put_u32(uint8_t *buf, uint32_t value)
+{
+    buf[0] = value;
+    buf[1] = value >> 8;
+    buf[2] = value >> 16;
+    buf[3] = value >> 24;
+}
+
+// Inteiro em decimal, sem snprintf: é chamado uma vez por registro e coluna
+static int format_int(char *buf, int value)
+{
+    char digits[12];
+    int n = 0;
+    int len = 0;
+    unsigned magnitude = value < 0 ? -(unsigned)value : (unsigned)value;
+    if (value < 0)
+        buf[len++] = '-';
+    do
+    {
+        digits[n++] = '0' + magnitude % 10;
+        magnitude /= 10;
+    } while (magnitude);
+    while (n)
+        buf[len++] = digits[--n];
+    return len;
+}
+
+// Monta o item atual da saída. Não altera o leitor: pode ser chamada de novo para o mesmo item
+// quando ele ficou dividido entre dois pedaços. 'record' só é usado nas seções de coluna
+static int render(const timeseries_reader_t *reader, const timeseries_record_t *record, uint8_t *item)
+{
+    const timeseries_t *ts = reader->ts;
+    const timeseries_range_t *range = &reader->range;
+    int8_t column = section_column(reader);
+
+    if (column == COLUMN_NONE)
+    {
+        uint32_t period_ms = ts->tiers[range->tier].period_ms;
+        uint32_t first_ms = timeseries_record_ms(ts, range->tier, range->first);
+        if (reader->format == TIMESERIES_FORMAT_BINARY)
+        {
+            item[0] = 'N';
+            item[1] = 'V';
+            item[2] = TIMESERIES_BINARY_VERSION;
+            item[3] = sizeof(timeseries_record_t);
+            put_u32(item + 4, period_ms);
+            put_u32(item + 8, first_ms);
+            put_u32(item + 12, range->end - range->first);
+            return TIMESERIES_BINARY_HEADER_SIZE;
+        }
+        const char *literal = json_sections[reader->section].literal;
+        if (literal)
+        {
+            int len = strlen(literal);
+            memcpy(item, literal, len);
+            return len;
+        }
+        return snprintf((char *)item, ITEM_MAX, "{\"periodo_ms\":%lu,\"inicio_ms\":%lu,\"n\":%lu,\"nivel\":[",
+                        (unsigned long)period_ms, (unsigned long)first_ms,
+                        (unsigned long)(range->end - range->first));
+    }
+
+    if (reader->format == TIMESERIES_FORMAT_BINARY)
+    {
+        memcpy(item, record, sizeof(*record));
+        return sizeof(*record);
+    }
+
+    char *text = (char *)item;
+    int value = column_value(record, column);
+    int len = 0;
+    if (column < COLUMN_PUMP)
+    {
+        // Primeiro valor absoluto, os demais como diferença
+        if (reader->comma)
+            text[len++] = ',';
+        return len + format_int(text + len, reader->comma ? value - reader->prev : value);
+    }
+    if (value == reader->prev)
+        return 0; // Sem mudança, nada a escrever
+    if (reader->comma)
+        text[len++] = ',';
+    len += format_int(text + len, reader->index - range->first);
+    text[len++] = ',';
+    return len + format_int(text + len, value);
+}
+
+static void next_section(timeseries_reader_t *reader)
+{
+    reader->section++;
+    // As colunas de mínimo e máximo não existem no nível 0
+    while (reader->format == TIMESERIES_FORMAT_JSON && reader->section < JSON_SECTIONS &&
+           json_sections[reader->section].aggregate && reader->range.tier == 0)
+    {
+        reader->section++;
+    }
+    reader->index = reader->range.first;
+    reader->prev = -1;
+    reader->comma = false;
+}
+
+// Passa para o item seguinte depois que o atual foi todo escrito
+static void advance(timeseries_reader_t *reader, const timeseries_record_t *record)
+{
+    int8_t column = section_column(reader);
+    if (column == COLUMN_NONE)
+    {
+        next_section(reader);
+        return;
+    }
+
+    int value = column_value(record, column);
+    if (value != reader->prev)
+    {
+        reader->prev = value;
+        reader->comma = true;
+    }
+    reader->index++;
+}
+
+// Prepara o próximo item: troca de seção no fim de uma coluna e copia o registro atual.
+// Retorna 0 no fim da saída, -1 se o registro foi sobrescrito
+static int next_item(timeseries_reader_t *reader, timeseries_record_t *record)
+{
+    while (reader->section < section_count(reader))
+    {
+        if (section_column(reader) == COLUMN_NONE)
+            return 1;
+        if (reader->index < reader->range.end)
+            return timeseries_get(reader->ts, reader->range.tier, reader->index, record) ? 1 : -1;
+        next_section(reader);
+    }
+    return 0;
+}
+
+int timeseries_read(timeseries_reader_t *reader, uint8_t *buf, size_t size)
+{
+    uint8_t item[ITEM_MAX];
+    timeseries_record_t record;
+    size_t written = 0;
+
+    while (written < size)
+    {
+        int status = next_item(reader, &record);
+        if (status < 0)
+            return -1; // A gravação passou por cima de registros ainda não lidos
+        if (status == 0)
+            break;
+
+        int len = render(reader, &record, item);
+        size_t chunk = len - reader->offset;
+        if (chunk > size - written)
+            chunk = size - written;
+        memcpy(buf + written, item + reader->offset, chunk);
+        written += chunk;
+        reader->offset += chunk;
+        if (reader->offset == len)
+        {
+            reader->offset = 0;
+            advance(reader, &record);
+        }
+    }
+    return written;
+}
+
+uint32_t timeseries_reader_size(const timeseries_reader_t *reader)
+{
+    // Percorre os itens como a leitura faria, só somando os tamanhos
+    timeseries_reader_t copy = *reader;
+    uint8_t item[ITEM_MAX];
+    timeseries_record_t record;
+    uint32_t total = 0;
+
+    while (next_item(&copy, &record) > 0)
+    {
+        total += render(&copy, &record, item);
+        advance(&copy, &record);
+    }
+    return total - reader->offset;
+}
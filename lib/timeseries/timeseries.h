@@ -0,0 +1,120 @@
+#ifndef TIMESERIES_H
+#define TIMESERIES_H
+
+#include "pico/stdlib.h"
+
+// Histórico em RAM do nível, da bomba e dos limites, em três resoluções (níveis):
+// cada leitura entra no nível 0 e, a cada TIMESERIES_TIERn_RATIO registros, um agregado
+// (média, mínimo e máximo) sobe para o nível seguinte. Cada nível é um buffer circular de tamanho fixo,
+// então a memória total é conhecida em tempo de compilação e nada é alocado.
+// Com uma leitura a cada 100 ms:
+//   nível 0: leituras a cada 100 ms, último minuto
+//   nível 1: agregados de 1 s, última hora
+//   nível 2: agregados de 1 min, último dia
+// O instante de cada registro não é guardado: sai do índice e do período do nível.
+// Exige um único produtor. Os leitores não usam lock: copiam o registro e conferem depois
+// se a gravação não o alcançou durante a cópia, como no level_bus.
+
+#define TIMESERIES_TIERS 3
+#define TIMESERIES_READ_SLACK 60   // Registros mais antigos de cada nível deixados fora das consultas,
+                                   // para a gravação não alcançar uma resposta em andamento
+#define TIMESERIES_TIER0_CAPACITY (600 + TIMESERIES_READ_SLACK)
+#define TIMESERIES_TIER1_CAPACITY (3600 + TIMESERIES_READ_SLACK)
+#define TIMESERIES_TIER2_CAPACITY (1440 + TIMESERIES_READ_SLACK)
+#define TIMESERIES_TIER1_RATIO 10  // Registros do nível 0 por agregado do nível 1
+#define TIMESERIES_TIER2_RATIO 60  // Registros do nível 1 por agregado do nível 2
+#define TIMESERIES_MEMORY_BUDGET (36 * 1024) // Verificado em tempo de compilação contra sizeof(timeseries_t)
+
+#define TIMESERIES_FLAG_PUMP (1 << 0)  // Bomba ligada (em algum momento do intervalo, nos agregados)
+#define TIMESERIES_FLAG_STALE (1 << 1) // Nenhum sensor disponível: o nível repete o último conhecido
+
+#define TIMESERIES_BINARY_HEADER_SIZE 16
+#define TIMESERIES_BINARY_VERSION 2
+
+// Formato binário (little-endian):
+//   cabeçalho: "NV", versão, tamanho do registro, período em ms (u32),
+//              instante do primeiro registro em ms desde o boot (u32), número de registros (u32)
+//   registros: os campos de timeseries_record_t, um byte cada e na mesma ordem
+// Formato JSON: o nível (e, nos agregados, o mínimo e o máximo) vai como diferença para o registro
+// anterior. A bomba e os limites, que quase não mudam, só como pares [índice, valor] nas mudanças
+typedef enum {
+    TIMESERIES_FORMAT_BINARY = 0,
+    TIMESERIES_FORMAT_JSON
+} timeseries_format_t;
+
+typedef struct {
+    uint8_t level;     // Porcentagem (média do intervalo nos agregados)
+    uint8_t level_min; // Menor e maior leitura do intervalo (iguais a 'level' no nível 0)
+    uint8_t level_max;
+    uint8_t flags;     // TIMESERIES_FLAG_*
+    uint8_t limit_min; // Limites em vigor no fim do intervalo
+    uint8_t limit_max;
+} timeseries_record_t;
+
+typedef struct {
+    timeseries_record_t *records;
+    uint32_t capacity;
+    uint32_t period_ms;
+    volatile uint32_t count; // Registros já gravados, o próximo vai para records[count % capacity]
+    // Agregado em montagem a partir do nível anterior, só o produtor usa
+    uint32_t acc_sum;
+    uint8_t acc_min;
+    uint8_t acc_max;
+    uint8_t acc_flags;
+    uint8_t acc_n;
+} timeseries_tier_t;
+
+typedef struct {
+    timeseries_tier_t tiers[TIMESERIES_TIERS];
+    uint32_t origin_ms; // Instante do primeiro registro de todos os níveis
+    timeseries_record_t tier0[TIMESERIES_TIER0_CAPACITY];
+    timeseries_record_t tier1[TIMESERIES_TIER1_CAPACITY];
+    timeseries_record_t tier2[TIMESERIES_TIER2_CAPACITY];
+} timeseries_t;
+
+// Resultado de uma consulta: um nível e os índices absolutos [first, end) dos seus registros
+typedef struct {
+    uint8_t tier;
+    uint32_t first;
+    uint32_t end;
+} timeseries_range_t;
+
+// Posição do codificador. Cópia simples: salvar e restaurar permite desfazer um pedaço não enviado
+typedef struct {
+    const timeseries_t *ts;
+    timeseries_range_t range;
+    uint8_t format;
+    uint8_t section;    // Parte da saída em andamento (cabeçalho, colunas, separadores)
+    uint32_t index;     // Registro atual dentro da seção
+    uint8_t offset;     // Bytes do item atual já escritos, quando ele ficou dividido entre dois pedaços
+    int16_t prev;       // Valor anterior da coluna (diferença ou detecção de mudança)
+    bool comma;         // A coluna já tem algum valor
+} timeseries_reader_t;
+
+// 'period_ms' é o intervalo entre as chamadas a timeseries_insert
+void timeseries_init(timeseries_t *ts, uint32_t period_ms);
+
+// Grava uma leitura no nível 0 e propaga os agregados completos. O(1), sem bloquear
+void timeseries_insert(timeseries_t *ts, uint8_t level, uint8_t flags, uint8_t limit_min, uint8_t limit_max, uint32_t now_ms);
+
+// Copia um registro. Retorna false se ele ainda não existe ou já foi (ou está sendo) sobrescrito
+bool timeseries_get(const timeseries_t *ts, uint8_t tier, uint32_t index, timeseries_record_t *record);
+
+// Instante de início do registro 'index' do nível 'tier', em ms desde o boot
+uint32_t timeseries_record_ms(const timeseries_t *ts, uint8_t tier, uint32_t index);
+
+// Escolhe o nível mais fino que ainda guarda o intervalo [from_ms, to_ms) e, se ele tiver mais
+// de 'max_points' registros no intervalo (0 = sem limite), o primeiro nível mais grosso que caiba. O(1)
+void timeseries_query(const timeseries_t *ts, uint32_t from_ms, uint32_t to_ms, uint32_t max_points, timeseries_range_t *range);
+
+// Prepara a codificação dos registros de uma consulta
+void timeseries_reader_init(timeseries_reader_t *reader, const timeseries_t *ts, timeseries_format_t format, const timeseries_range_t *range);
+
+// Bytes que faltam na saída do leitor: logo após timeseries_reader_init, o total para o Content-Length
+uint32_t timeseries_reader_size(const timeseries_reader_t *reader);
+
+// Escreve até 'size' bytes da saída em 'buf'. Retorna quantos bytes foram escritos (0 no fim),
+// ou -1 se registros ainda não lidos já foram sobrescritos pela gravação
+int timeseries_read(timeseries_reader_t *reader, uint8_t *buf, size_t size);
+
+#endif // TIMESERIES_H
@@ -2,6 +2,8 @@
 #include <stdio.h>
 #include "hardware/gpio.h"
 #include "hardware/timer.h"
+#include "hardware/irq.h"
+#include "ultrasonic.h"
 
 // Velocidade do som em cm/µs. (343 m/s = 34300 cm/s = 0.0343 cm/µs)
 const float SOUND_SPEED_CM_PER_US = 0.0343;
@@ -17,40 +19,95 @@ void setup_ultrasonic_pins(uint trigPin, uint echoPin) {
     gpio_set_dir(echoPin, GPIO_IN);
 }
 
-// Função para medir a duração do pulso em microssegundos
-// Retorna 0 em caso de timeout/erro
-uint64_t get_pulse_duration_us(uint trigPin, uint echoPin) {
-    // Garante que o gatilho esteja baixo e estabilizado
-    gpio_put(trigPin, 0);
-    sleep_us(2);
+// --- Medição por interrupção ---
+// As duas bordas do eco são marcadas com o timer de 64 bits dentro da interrupção do GPIO,
+// a CPU fica livre enquanto o som vai e volta
 
-    // Envia o pulso de gatilho de 10µs
-    gpio_put(trigPin, 1);
-    sleep_us(10);
-    gpio_put(trigPin, 0);
+void ultrasonic_fsm_init(ultrasonic_echo_t *echo) {
+    echo->state = ULTRASONIC_IDLE;
+    echo->pulse_start_us = 0;
+}
 
-    absolute_time_t start_wait, end_wait;
+void ultrasonic_fsm_arm(ultrasonic_echo_t *echo) {
+    echo->state = ULTRASONIC_WAIT_RISE;
+}
 
-    // Aguarda o início do pulso de eco (com timeout)
-    start_wait = get_absolute_time();
-    while (gpio_get(echoPin) == 0) {
-        if (absolute_time_diff_us(start_wait, get_absolute_time()) > TIMEOUT_US) {
-            return 0; // Retorna 0 para indicar timeout
+void ultrasonic_fsm_cancel(ultrasonic_echo_t *echo) {
+    echo->state = ULTRASONIC_IDLE;
+}
+
+bool ultrasonic_fsm_edge(ultrasonic_echo_t *echo, uint32_t events, uint64_t now_us, uint64_t *pulse_duration_us) {
+    if (echo->state == ULTRASONIC_WAIT_RISE && (events & GPIO_IRQ_EDGE_RISE)) {
+        echo->pulse_start_us = now_us;
+        echo->state = ULTRASONIC_WAIT_FALL;
+        if (!(events & GPIO_IRQ_EDGE_FALL)) {
+            return false;
         }
+        *pulse_duration_us = 0; // As duas bordas chegaram juntas, não dá para saber a duração
+    } else if (echo->state == ULTRASONIC_WAIT_FALL && (events & GPIO_IRQ_EDGE_FALL)) {
+        uint64_t duration = now_us - echo->pulse_start_us;
+        *pulse_duration_us = duration > TIMEOUT_US ? 0 : duration;
+    } else {
+        return false; // Borda fora de uma medição (ex.: depois de cancelada) ou repetida
     }
-    absolute_time_t pulse_start = get_absolute_time();
+    echo->state = ULTRASONIC_IDLE;
+    return true;
+}
 
-    // Aguarda o fim do pulso de eco (com timeout)
-    end_wait = get_absolute_time();
-    while (gpio_get(echoPin) == 1) {
-        if (absolute_time_diff_us(end_wait, get_absolute_time()) > TIMEOUT_US) {
-            return 0; // Retorna 0 para indicar timeout
-        }
+static ultrasonic_echo_t echo;
+static uint trig_pin, echo_pin;
+static ultrasonic_callback_t echo_callback = NULL;
+static void *echo_ctx = NULL;
+
+static void echo_irq_handler(void) {
+    uint32_t events = gpio_get_irq_event_mask(echo_pin);
+    if (!(events & (GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL))) {
+        return; // Interrupção de outro pino
+    }
+    uint64_t now = time_us_64();
+    gpio_acknowledge_irq(echo_pin, events);
+
+    uint64_t duration;
+    if (ultrasonic_fsm_edge(&echo, events, now, &duration) && echo_callback) {
+        echo_callback(duration, echo_ctx);
     }
-    absolute_time_t pulse_end = get_absolute_time();
+}
+
+// Configura a captura do eco por interrupção. O callback é chamado em contexto de interrupção
+// com a duração do pulso em µs, ou 0 se a medição for inválida
+void ultrasonic_init_async(uint trigPin, uint echoPin, ultrasonic_callback_t callback, void *ctx) {
+    setup_ultrasonic_pins(trigPin, echoPin);
+    gpio_put(trigPin, 0);
+    ultrasonic_fsm_init(&echo);
+    trig_pin = trigPin;
+    echo_pin = echoPin;
+    echo_callback = callback;
+    echo_ctx = ctx;
+
+    // Tratador exclusivo do pino de eco, no núcleo que chama esta função. Os botões registram o seu
+    // para os próprios pinos do mesmo jeito: cada tratador só vê e reconhece as bordas dos seus pinos
+    gpio_add_raw_irq_handler(echoPin, echo_irq_handler);
+    gpio_set_irq_enabled(echoPin, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, true);
+    irq_set_enabled(IO_IRQ_BANK0, true);
+}
+
+// Envia o pulso de gatilho e arma a captura. Retorna false se ainda há um eco em andamento
+bool ultrasonic_trigger(void) {
+    if (echo.state != ULTRASONIC_IDLE || gpio_get(echo_pin)) {
+        return false;
+    }
+    ultrasonic_fsm_arm(&echo);
+
+    // Envia o pulso de gatilho de 10µs
+    gpio_put(trig_pin, 1);
+    busy_wait_us_32(10);
+    gpio_put(trig_pin, 0);
+    return true;
+}
 
-    // Retorna a duração do pulso em microssegundos
-    return absolute_time_diff_us(pulse_start, pulse_end);
+// Abandona a medição em andamento (ex.: timeout sem eco). Bordas que chegarem depois são ignoradas
+void ultrasonic_cancel(void) {
+    ultrasonic_fsm_cancel(&echo);
 }
 
 // --- Funções de Conversão ---
@@ -1,8 +1,36 @@
 #ifndef ultrasonic_h
 #define ultrasonic_h
 
+#include "pico/stdlib.h"
+
+// Chamado em contexto de interrupção ao fim de cada medição, com a duração do eco em µs (0 = inválida)
+typedef void (*ultrasonic_callback_t)(uint64_t pulse_duration_us, void *ctx);
+
+typedef enum {
+    ULTRASONIC_IDLE,      // Nenhuma medição em andamento
+    ULTRASONIC_WAIT_RISE, // Gatilho enviado, esperando o início do eco
+    ULTRASONIC_WAIT_FALL  // Eco em andamento, esperando o fim
+} ultrasonic_state_t;
+
+// Estado de uma medição do eco
+typedef struct {
+    volatile ultrasonic_state_t state;
+    uint64_t pulse_start_us; // Borda de subida do eco
+} ultrasonic_echo_t;
+
+// Lógica da captura do eco, sem acesso ao hardware. 'arm' passa a esperar o eco (gatilho enviado);
+// 'edge' recebe as bordas (GPIO_IRQ_EDGE_RISE/FALL) vistas numa interrupção, marcadas em 'now_us', e
+// retorna true quando a medição termina, com a duração em 'pulse_duration_us' (0 = inválida);
+// 'cancel' abandona a medição, e bordas que chegarem depois são ignoradas
+void ultrasonic_fsm_init(ultrasonic_echo_t *echo);
+void ultrasonic_fsm_arm(ultrasonic_echo_t *echo);
+bool ultrasonic_fsm_edge(ultrasonic_echo_t *echo, uint32_t events, uint64_t now_us, uint64_t *pulse_duration_us);
+void ultrasonic_fsm_cancel(ultrasonic_echo_t *echo);
+
 void setup_ultrasonic_pins(uint trigPin, uint echoPin);
-uint64_t get_pulse_duration_us(uint trigPin, uint echoPin);
+void ultrasonic_init_async(uint trigPin, uint echoPin, ultrasonic_callback_t callback, void *ctx);
+bool ultrasonic_trigger(void);
+void ultrasonic_cancel(void);
 float microseconds_to_cm(uint64_t pulse_duration_us);
 float microseconds_to_inches(uint64_t pulse_duration_us);
 #endif
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "ws2812.h"
+#include <string.h>
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+#include "ws2812.pio.h"
+
+static bool program_loaded[NUM_PIOS];  // O programa já está em cada bloco PIO
+static uint program_offset[NUM_PIOS];  // E em que posição
+
+static float ws2812_clkdiv(void)
+{
+    return (float)clock_get_hz(clk_sys) / (WS2812_BIT_RATE_HZ * WS2812_CYCLES_PER_BIT);
+}
+
+bool ws2812_init(ws2812_t *strip, PIO pio, uint pin, uint32_t *tx_buffer, uint16_t num_pixels)
+{
+    uint index = pio_get_index(pio);
+    if (!program_loaded[index])
+    {
+        if (!pio_can_add_program(pio, &ws2812_program))
+            return false;
+        program_offset[index] = pio_add_program(pio, &ws2812_program);
+        program_loaded[index] = true;
+    }
+    int sm = pio_claim_unused_sm(pio, false);
+    if (sm < 0)
+        return false;
+    int dma_chan = dma_claim_unused_channel(false);
+    if (dma_chan < 0)
+    {
+        pio_sm_unclaim(pio, sm);
+        return false;
+    }
+
+    strip->pio = pio;
+    strip->sm = sm;
+    strip->pin = pin;
+    strip->num_pixels = num_pixels;
+    strip->dma_chan = dma_chan;
+    strip->tx = tx_buffer;
+    strip->tx_valid = false;
+    strip->ready_us = 0;
+    ws2812_program_init(pio, sm, program_offset[index], pin, ws2812_clkdiv());
+
+    // O DMA alimenta a FIFO desta state machine no ritmo do DREQ, a CPU fica livre durante a transmissão
+    dma_channel_config cfg = dma_channel_get_default_config(dma_chan);
+    channel_config_set_transfer_data_size(&cfg, DMA_SIZE_32);
+    channel_config_set_read_increment(&cfg, true);
+    channel_config_set_write_increment(&cfg, false);
+    channel_config_set_dreq(&cfg, pio_get_dreq(pio, sm, true));
+    dma_channel_configure(dma_chan, &cfg, &pio->txf[sm], tx_buffer, num_pixels, false);
+
+    memset(tx_buffer, 0, num_pixels * sizeof(uint32_t));
+    ws2812_show(strip, tx_buffer);
+    return true;
+}
+
+bool ws2812_show(ws2812_t *strip, const uint32_t *pixels)
+{
+    if (strip->tx_valid && memcmp(pixels, strip->tx, strip->num_pixels * sizeof(uint32_t)) == 0)
+    {
+        return false; // Os LEDs já mostram este quadro
+    }
+    // O DMA termina quando a última palavra entra na FIFO; o prazo cobre também o que falta sair e o reset
+    dma_channel_wait_for_finish_blocking(strip->dma_chan);
+    uint64_t now = time_us_64();
+    if (now < strip->ready_us)
+    {
+        busy_wait_us(strip->ready_us - now);
+    }
+    if (pixels != strip->tx)
+    {
+        memcpy(strip->tx, pixels, strip->num_pixels * sizeof(uint32_t));
+    }
+    strip->tx_valid = true;
+    strip->ready_us = time_us_64() + (uint64_t)strip->num_pixels * WS2812_PIXEL_US + WS2812_RESET_US;
+    dma_channel_transfer_from_buffer_now(strip->dma_chan, strip->tx, strip->num_pixels);
+    return true;
+}
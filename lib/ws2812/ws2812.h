@@ -0,0 +1,39 @@
+#ifndef WS2812_H
+#define WS2812_H
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+// Driver de fileiras de LEDs WS2812 (fitas ou matrizes) pelo PIO.
+// Cada fileira tem o próprio handle, state machine e canal de DMA, então várias são atualizadas em
+// paralelo, em pinos diferentes, sem que uma espere a outra. O programa PIO é carregado uma vez por bloco.
+// O divisor do PIO sai do clock do sistema na inicialização, então o tempo de cada bit não depende da
+// frequência escolhida pela aplicação (que deve ser configurada antes).
+// Os pixels vão no formato do PIO: GRB nos 24 bits altos de cada palavra, na ordem em que estão ligados.
+
+#define WS2812_BIT_RATE_HZ 800000
+#define WS2812_CYCLES_PER_BIT 10  // Instruções do programa PIO por bit
+#define WS2812_PIXEL_US 30        // 24 bits a 800 kHz
+#define WS2812_RESET_US 300       // Linha em nível baixo que encerra o quadro (>= 280 us nos modelos novos)
+
+typedef struct {
+    PIO pio;
+    uint sm;
+    uint pin;
+    uint16_t num_pixels;
+    int dma_chan;
+    uint32_t *tx;         // Quadro lido pelo DMA (num_pixels palavras), fornecido por quem inicializa.
+                          // Também é a referência para descartar quadros repetidos
+    bool tx_valid;        // tx já foi enviado ao menos uma vez
+    uint64_t ready_us;    // Fim do quadro anterior mais o reset: antes disso um novo quadro emendaria nele
+} ws2812_t;
+
+// Reserva uma state machine livre de 'pio' e um canal de DMA e apaga os LEDs.
+// Retorna false se não houver state machine, espaço para o programa ou canal de DMA
+bool ws2812_init(ws2812_t *strip, PIO pio, uint pin, uint32_t *tx_buffer, uint16_t num_pixels);
+
+// Envia um quadro pelo DMA, sem esperar a transmissão. Quadro igual ao último enviado não é reenviado.
+// Só espera se o quadro anterior ainda não terminou (incluindo o reset). Retorna true se enviou
+bool ws2812_show(ws2812_t *strip, const uint32_t *pixels);
+
+#endif // WS2812_H
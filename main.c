@@ -1,19 +1,33 @@
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "pico/stdlib.h"
 #include "pico/cyw43_arch.h" // Biblioteca para arquitetura Wi-Fi da Pico com CYW43
+#include "pico/async_context_freertos.h"
 #include "hardware/adc.h"
+#include "hardware/clocks.h"
 #include "lwip/tcp.h"
+#include "lwip/tcpip.h"
 
 #include "lib/ssd1306/ssd1306.h"
 #include "lib/ssd1306/display.h"
 #include "lib/led/led.h"
 #include "lib/button/button.h"
 #include "lib/matrix_leds/matrix_leds.h"
+#include "lib/matrix_render/matrix_render.h"
 #include "lib/buzzer/buzzer.h"
 #include "lib/ultrasonic/ultrasonic.h"
+#include "lib/level_bus/level_bus.h"
+#include "lib/adc_sampler/adc_sampler.h"
+#include "lib/level_filter/level_filter.h"
+#include "lib/level_fusion/level_fusion.h"
+#include "lib/http_parser/http_parser.h"
+#include "lib/http_server/http_server.h"
+#include "lib/timeseries/timeseries.h"
+#include "lib/flash_log/flash_log.h"
+#include "lib/calibration/calibration.h"
 #include "config/wifi_config_example.h"
-#include "public/html_data.h"
+#include "html_data.h" // Gerado a partir de public/index.html por tools/embed_html.py
 
 #include "FreeRTOS.h"
 #include "FreeRTOSConfig.h"
@@ -22,67 +36,203 @@
 #include "semphr.h"
 
 
+#define SYS_CLOCK_KHZ 133000 // Clock do sistema
 #define RELE_PIN 16 // Gpio que ativará(low) e desativará(high) o relé para acionar a bomba
 #define ADC_PIN_POTENTIOMETER_READ 28 // Pino do ADC para ler os valores alterados no potencimetro pela boia
+#define ADC_INPUT_POTENTIOMETER 2     // GPIO 28 = ADC2
+#define ADC_SAMPLE_RATE_HZ 2560       // Taxa de amostragem contínua, um bloco de 256 amostras a cada 100 ms (10 Hz)
 #define ULTRASONIC_TRIG_PIN 18 // Pino do Trig do sensor ultrassônico
 #define ULTRASONIC_ECHO_PIN 19 // Pino do Echo do sensor ultrassônico
 
-// Definições para o sensor ultrassônico
+// Calibração padrão, usada até a primeira calibração pelos botões ou por POST /calibrar
 #define ULTRASONIC_DIST_MAX_VAZIO 28.0f // Distância máxima lida (reservatório vazio)
 #define ULTRASONIC_DIST_MIN_CHEIO 15.0f // Distância mínima lida (reservatório cheio)
-
-// Valores ajustados para o reservatório usado
+#define ULTRASONIC_CM_TO_ECHO_US(cm) ((uint16_t)((cm) * 2.0f / 0.0343f + 0.5f)) // Ida e volta a 343 m/s
 #define ADC_MIN_POTENTIOMETER_READING 1990   // Valor mínimo lido do potenciômetro (quando o reservatório está vazio)
 #define ADC_MAX_POTENTIOMETER_READING  2240   // Valor máximo lido do potenciômetro (quando o reservatório está cheio)
+#define CALIBRATION_RESTORE -1               // Pedido de calibração que volta aos valores padrão
+#define CALIBRATION_NONE -2                  // Nenhum pedido de calibração pendente
+
+#define DISPLAY_FLUSH_NOTIFY_INDEX 2 // Índice de notificação usado para avisar o fim do envio do quadro ao display
+#define ADC_BLOCK_NOTIFY_INDEX 3     // Índice de notificação que entrega o número do bloco pronto do ADC
+#define ULTRASONIC_NOTIFY_INDEX 4    // Índice de notificação que entrega a duração do eco do ultrassônico
+#define FLASH_WINDOW_NOTIFY_INDEX 5  // Índice de notificação que avisa a task da flash do fim de um ciclo de controle
+#define ULTRASONIC_TIMEOUT_MS 50     // Espera máxima pelo eco (o HC-SR04 desiste em ~38 ms)
+#define FUSION_PERIOD_MS 100         // Período de publicação do nível combinado
+#define LATENCY_REPORT_MS 10000      // Intervalo do relatório de tempo do laço de controle da bomba
+#define PUMP_CONTROL_PERIOD_MS 50    // Período fixo do laço de controle da bomba
+#define PUMP_RELAY_PULSE_MS 200      // Duração do pulso no relé que liga ou desliga a bomba
+#define PUMP_RETRIGGER_MS 20000      // Intervalo mínimo entre dois pulsos de ligar
+
+#define DEFAULT_MIN_WATER_LEVEL_LIMIT 20 // Limite mínimo padrão (restaurado pela pressão longa do botão A)
+#define DEFAULT_MAX_WATER_LEVEL_LIMIT 50 // Limite máximo padrão
+#define PACK_LIMITS(min, max) ((uint32_t)(min) | ((uint32_t)(max) << 8))
+#define BUTTON_LIMIT_STEP 5           // Passo do ajuste dos limites pelos botões, em porcentagem
+#define BUTTON_QUEUE_LENGTH 8         // Eventos de botão aguardando a vButtonTask
+#define PUMP_AUTOMATIC -1             // manual_pump: a bomba segue os limites
+
+// Registros guardados na flash
+#define FLASH_KEY_LIMITS 1            // Configuração: limite mínimo e máximo
+#define FLASH_KEY_CAL_POTENTIOMETER 2 // Configuração: pontos de calibração da boia
+#define FLASH_KEY_CAL_ULTRASONIC 3    // Configuração: pontos de calibração do ultrassônico
+#define FLASH_EVENT_BOOT 0x40         // Diário: inicialização
+#define FLASH_EVENT_PUMP 0x41         // Diário: mudança de estado da bomba (instante em ms, estado, nível)
+
+#define HTTP_SSE_CHECK_MS 100          // Intervalo de verificação da bomba e dos limites (o nível acorda a task na hora)
+#define HTTP_STATS_PERIOD_MS 10000     // Intervalo do relatório do servidor
+#define HISTORY_DEFAULT_MINUTES 60     // Intervalo de /historico quando 'minutos' não é informado
+#define DISPLAY_GRAPH_MINUTES 30       // Intervalo do gráfico do display, uma coluna por minuto: colunas 90 a 119,
+                                       // à direita dos valores de 4 caracteres ("100%" vai de x=58 a x=89)
+#define DISPLAY_GRAPH_RIGHT 119        // Coluna mais à direita do gráfico (o registro mais recente)
+#define DISPLAY_GRAPH_TOP 8            // Linha do nível 100%
+#define DISPLAY_GRAPH_HEIGHT 48        // Altura do gráfico em pixels
+#define MATRIX_BRIGHTNESS 84           // Brilho global da matriz de LEDs (0 a 255)
+#define TASK_REPORT_MAX 24             // Tasks no relatório de pilhas: as da aplicação, do lwIP, do Wi-Fi e do kernel
+
+// Divisão das tasks entre os núcleos: o núcleo 1 fica com a aquisição, a fusão e o controle da bomba,
+// o núcleo 0 com o Wi-Fi, o web server e as interfaces. Com APP_MULTICORE 0 tudo roda em um núcleo só
+#if configNUM_CORES > 1
+#define CORE_INTERFACE (1 << 0)
+#define CORE_CONTROL (1 << 1)
+#define CREATE_TASK(fn, name, stack, priority, cores) \
+    xTaskCreateAffinitySet(fn, name, stack, NULL, priority, cores, NULL)
+#else
+#define CREATE_TASK(fn, name, stack, priority, cores) \
+    xTaskCreate(fn, name, stack, NULL, priority, NULL)
+#endif
+
+// Pilha de cada task, em palavras. configMINIMAL_STACK_SIZE (1 KB) serve às tasks com quadros pequenos e só
+// printf de inteiros. As demais somam os quadros da cadeia mais funda (-fstack-usage) ao printf, com folga;
+// a folga real de todas aparece no relatório do web server, e um estouro para o sistema (configCHECK_FOR_STACK_OVERFLOW)
+#define STACK_FUSION_TASK 512      // sensor_calibration_record: ajuste da curva em float, tabelas e printf
+#define STACK_WEB_SERVER_TASK 512  // Inicialização do Wi-Fi, snprintf e relatório das tasks
+#define STACK_DISPLAY_TASK 384     // sprintf e desenho do display
+#define STACK_CONTROL_TASK 384     // Relatório do laço com printf de vários campos
+#define STACK_ULTRASONIC_TASK 384  // calibration_apply, filtro e printf
+
+// Filtros de cada sensor, valores em porcentagem Q8.
+// Boia: amostras a 10 Hz já com média de bloco, a mediana remove batidas da boia e a EMA a ondulação
+static const level_filter_config_t potentiometer_filter_config = {
+    .median_window = 5,
+    .ema_alpha_q15 = 9830,                 // alpha = 0.3
+    .max_step = 15 * LEVEL_FILTER_ONE,     // Mais de 15% em 100 ms não é fisicamente possível
+    .max_rejects = 3,
+};
+// Ultrassônico: ecos espúrios são comuns, janela maior e rejeição mais agressiva
+static const level_filter_config_t ultrasonic_filter_config = {
+    .median_window = 7,
+    .ema_alpha_q15 = 8192,                 // alpha = 0.25
+    .max_step = 10 * LEVEL_FILTER_ONE,
+    .max_rejects = 4,
+};
 
-// Fila para armazenar os valores de nivel de agua lidos
-QueueHandle_t xQueueWaterLevelReadings;
-//Mutexes para proteger o acesso ao display e as váriaveis de limites
-SemaphoreHandle_t xMutexDisplay;
-SemaphoreHandle_t xMutexLimites;
-SemaphoreHandle_t xWifiReadySemaphore; // Novo semáforo para sinalizar que o Wi-Fi está pronto
-SemaphoreHandle_t xMutexWaterLevelJson; // Mutex para gerir a porcentagem da bomba para a interface web
-// Estrutura de dados
-struct http_state
-{
-    char response[10000];
-    size_t len;
-    size_t sent;
+// Parâmetros da fusão dos dois sensores (porcentagens em Q8, variâncias em Q16)
+static const level_fusion_config_t fusion_config = {
+    .stale_timeout_us = 1000000,                      // 1 s sem leitura válida
+    .min_variance = (LEVEL_FILTER_ONE / 2) * (LEVEL_FILTER_ONE / 2),          // Desvio mínimo de 0,5%
+    .max_variance = (15 * LEVEL_FILTER_ONE) * (15 * LEVEL_FILTER_ONE),        // Desvio acima de 15% = sensor com defeito
+    .max_disagreement = 15 * LEVEL_FILTER_ONE,        // Diferença tolerada entre os sensores
+    .drift_timeout_us = 5000000,                      // 5 s divergindo até excluir o suspeito
+    .primary = LEVEL_FUSION_POTENTIOMETER,
 };
 
+// Barramento que difunde o nível de água combinado para todas as tasks consumidoras
+level_bus_t water_level_bus;
+// Leituras filtradas de cada sensor (porcentagem em Q8), consumidas apenas pela fusão
+level_bus_t potentiometer_bus;
+level_bus_t ultrasonic_bus;
+//Mutex para proteger o acesso ao display (só usado por tasks do núcleo 0)
+SemaphoreHandle_t xMutexDisplay;
+SemaphoreHandle_t xWifiReadySemaphore; // Novo semáforo para sinalizar que o Wi-Fi está pronto
+QueueHandle_t xPumpEffectsQueue; // Último estado da bomba, para o LED e o buzzer
+QueueHandle_t xButtonQueue; // Eventos dos botões (button_event_t), enviados pelas interrupções
+// Rotas do servidor
+typedef enum {
+    HTTP_ROUTE_NOT_FOUND = 0,
+    HTTP_ROUTE_PAGE,
+    HTTP_ROUTE_ESTADO,
+    HTTP_ROUTE_EVENTOS,
+    HTTP_ROUTE_HISTORICO,
+    HTTP_ROUTE_LIMITES,
+    HTTP_ROUTE_BOMBA_ON,
+    HTTP_ROUTE_BOMBA_OFF,
+    HTTP_ROUTE_CALIBRAR,
+    HTTP_ROUTE_CALIBRAR_ESTADO
+} http_route_t;
+
+// Histórico do nível, da bomba e dos limites em três resoluções. Gravado pela vLevelFusionTask
+// a cada publicação e lido sem lock pelas conexões de /historico e pelo gráfico do display
+static timeseries_t history;
+// Cabeçalhos da página, montados uma vez em start_http_server: com e sem gzip, e as respostas 304.
+// Cada um em duas versões, indexadas por keep_alive: [0] com Connection: close, [1] com keep-alive
+static char html_header[2][HTTP_HEADER_SIZE], html_header_gz[2][HTTP_HEADER_SIZE];
+static char html_not_modified[2][HTTP_HEADER_SIZE], html_not_modified_gz[2][HTTP_HEADER_SIZE];
+static int html_header_len[2], html_header_gz_len[2], html_not_modified_len[2], html_not_modified_gz_len[2];
 // Prototipos das funções
+// Calibração de um sensor. A task do sensor só lê 'active'; uma nova calibração é montada na outra tabela
+// e publicada trocando o ponteiro (escrita de uma palavra, atômica), sem lock no caminho da leitura
+typedef struct {
+    calibration_t tables[2];
+    const calibration_t *volatile active;
+    volatile uint16_t raw;     // Última leitura bruta do sensor, gravada como ponto na próxima calibração
+    calibration_point_t defaults[2]; // Vazio e cheio padrão, restaurados por CALIBRATION_RESTORE
+    uint8_t flash_key;
+    const char *name;
+} sensor_calibration_t;
+
 void vWebServerTask(void *pvParameters);
 void vDisplayTask(void *pvParameters);
 void vControlWaterPumpTask(void * pvParameters);
 void vReadPotentiometerTask(void *pvParameters);
 void vUltrasonicSensorTask(void *pvParameters);
+void vLevelFusionTask(void *pvParameters);
 void vMatrixLedsTask(void *pvParameters);
-static err_t http_sent(void *arg, struct tcp_pcb *tpcb, u16_t len);
-static err_t http_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
-static err_t connection_callback(void *arg, struct tcp_pcb *newpcb, err_t err);
+void vEffectsTask(void *pvParameters);
+void vFlashLogTask(void *pvParameters);
+void vButtonTask(void *pvParameters);
+static void display_flush_done(void *ctx);
+static void report_task_stacks(void);
+static void report_bus_subscriber(const char *name, level_bus_sub_t *sub);
+static void flash_log_window(void *ctx);
+static void flash_journal_count(uint8_t type, const uint8_t *payload, uint8_t len, void *ctx);
+static void sensor_calibration_init(sensor_calibration_t *sc, uint16_t raw_empty, uint16_t raw_full);
+static void sensor_calibration_record(sensor_calibration_t *sc, int8_t percent);
 static void start_http_server(void);
-void button_callback(uint gpio, uint32_t events);
+static void http_handle_request(struct http_state *hs, const http_parser_t *req);
 
 // Variáveis globais
 ssd1306_t ssd; // Declaração do display OLED
-volatile static int min_water_level_limit = 20; // Limite mínimo do nível de água (em porcentagem)
-volatile static int max_water_level_limit = 50; // Limite máximo do nível de água (em porcentagem)
-volatile static bool reset_limits=false; // Alterada pelo botão A
+// Limites mínimo e máximo do nível de água (em porcentagem) empacotados em uma palavra: min | max << 8.
+// Leitura e escrita de uma palavra alinhada são atômicas no RP2040, então as tasks dos dois núcleos
+// sempre veem um par coerente sem mutex
+volatile static uint32_t water_level_limits = PACK_LIMITS(DEFAULT_MIN_WATER_LEVEL_LIMIT, DEFAULT_MAX_WATER_LEVEL_LIMIT);
+volatile static int8_t manual_pump = PUMP_AUTOMATIC; // Comando local da bomba pelo joystick: 1 ligada, 0 desligada
+volatile static bool limit_selected_max = false; // Limite ajustado pelos toques curtos de A e B
 float ultrasonic_distance = 0.0f; // Variável para armazenar a distância medida pelo sensor ultrassônico
-int water_level_percentege_json; // Variavel global para armazenar a porcentagem de água para interface web
+static sensor_calibration_t potentiometer_cal = {.flash_key = FLASH_KEY_CAL_POTENTIOMETER, .name = "boia"};
+static sensor_calibration_t ultrasonic_cal = {.flash_key = FLASH_KEY_CAL_ULTRASONIC, .name = "ultrassonico"};
+volatile static int8_t calibration_request = CALIBRATION_NONE; // Nível (0 a 100) a gravar nos dois sensores, tratado pela vLevelFusionTask
 bool estado_bomba = false; // Variável para armazenar o estado da bomba (ligada/desligada)
 bool envia_sinal = false; // Variável para controlar o envio do sinal de acionamento da bomba
+static flash_log_t flash_store; // Limites e diário de eventos persistidos na flash
+static buzzer_t buzzer; // Sequenciador do buzzer A, alimentado só pela vEffectsTask
+static TaskHandle_t xFlashLogTask = NULL; // Avisada pelo controle da bomba a cada ciclo
 
 int main()
 {
+    // Antes de qualquer periférico: os divisores (UART, PWM do buzzer, ADC, PIO dos LEDs) são calculados
+    // a partir do clock em vigor na inicialização de cada um
+    bool clock_ok = set_sys_clock_khz(SYS_CLOCK_KHZ, false);
     stdio_init_all();
     sleep_ms(2000); // Aguarda a serial se conectar
+    if (clock_ok) printf("Clock configurado para %lu Hz\n", (unsigned long)clock_get_hz(clk_sys));
 
-    button_init_predefined(true, true, true); // INicializa os botões com Pull-up
-
-    init_buzzer(BUZZER_A_PIN,4.0f); 
+    buzzer_init(&buzzer, BUZZER_A_PIN);
 
-    button_setup_irq(true,true,true,button_callback);// Inicializa interrupções no 3 botões, setando a função de callback
+    // Botões com pull-up, debounce próprio de cada um e eventos entregues direto na fila
+    static const uint8_t button_pins[] = {BUTTON_A, BUTTON_B, BUTTON_SW};
+    xButtonQueue = xQueueCreate(BUTTON_QUEUE_LENGTH, sizeof(button_event_t));
+    button_events_init(button_pins, sizeof(button_pins), xButtonQueue);
 
     // Inicializa o display OLED
     init_display(&ssd);
@@ -92,219 +242,532 @@ int main()
     ssd1306_fill(&ssd, false); // Limpa a tela
     ssd1306_send_data(&ssd);   // Envia os dados para o display
 
-    //Criação de fila e mutex
-    xQueueWaterLevelReadings = xQueueCreate(5, sizeof(int));
+    //Criação do barramento de leituras e mutex
+    level_bus_init(&water_level_bus);
+    level_bus_init(&potentiometer_bus);
+    level_bus_init(&ultrasonic_bus);
+    timeseries_init(&history, FUSION_PERIOD_MS);
+
+    // Recupera os limites da última execução, só leitura: a flash é gravada depois, pela vFlashLogTask
+    if (flash_log_init(&flash_store, flash_log_window, NULL)){
+        uint8_t limits[2];
+        if (flash_log_get(&flash_store, FLASH_KEY_LIMITS, limits, sizeof(limits)) && limits[0] <= 100 && limits[1] <= 100){
+            water_level_limits = PACK_LIMITS(limits[0], limits[1]);
+            printf("Limites restaurados da flash: Min=%d, Max=%d\n", limits[0], limits[1]);
+        }
+        uint32_t journal[2] = {0, 0}; // Inicializações e mudanças da bomba guardadas no diário
+        flash_log_foreach(&flash_store, flash_journal_count, journal);
+        printf("Diário da flash: %lu inicializações, %lu mudanças da bomba\n", (unsigned long)journal[0], (unsigned long)journal[1]);
+        if (flash_store.torn){
+            printf("Flash: %lu registro(s) interrompido(s) por falta de energia descartado(s)\n", (unsigned long)flash_store.torn);
+        }
+    }
+    sensor_calibration_init(&potentiometer_cal, ADC_MIN_POTENTIOMETER_READING, ADC_MAX_POTENTIOMETER_READING);
+    sensor_calibration_init(&ultrasonic_cal, ULTRASONIC_CM_TO_ECHO_US(ULTRASONIC_DIST_MAX_VAZIO), ULTRASONIC_CM_TO_ECHO_US(ULTRASONIC_DIST_MIN_CHEIO));
+    flash_log_append(&flash_store, FLASH_EVENT_BOOT, NULL, 0);
     xMutexDisplay = xSemaphoreCreateMutex();
-    xMutexLimites = xSemaphoreCreateMutex();
 
     xWifiReadySemaphore = xSemaphoreCreateBinary(); // Cria um semáforo binário, inicialmente "não tomado"
-
-    xMutexWaterLevelJson = xSemaphoreCreateMutex();
-
-    xTaskCreate(vWebServerTask, "WebServerTask", configMINIMAL_STACK_SIZE,
-                NULL, tskIDLE_PRIORITY + 2, NULL); // Prioridade maior para o webserver ser iniciado primeiramente
-    xTaskCreate(vControlWaterPumpTask, "AcionaBombaComBaseNoNivelTask", configMINIMAL_STACK_SIZE,
-                NULL, tskIDLE_PRIORITY, NULL);
-    xTaskCreate(vDisplayTask, "vMostraDadosNoDisplayTask", configMINIMAL_STACK_SIZE,
-                NULL, tskIDLE_PRIORITY, NULL);
-    xTaskCreate(vReadPotentiometerTask, "LeituraPotenciometroTask", configMINIMAL_STACK_SIZE,
-                NULL, tskIDLE_PRIORITY, NULL);
-    //xTaskCreate(vUltrasonicSensorTask, "vUltrasonicSensorTask", configMINIMAL_STACK_SIZE,
-    //            NULL, tskIDLE_PRIORITY, NULL);
-    xTaskCreate(vMatrixLedsTask, "vMatrixLedsTask", configMINIMAL_STACK_SIZE,
-                NULL, tskIDLE_PRIORITY, NULL);
+    xPumpEffectsQueue = xQueueCreate(1, sizeof(bool)); // Tamanho 1 com xQueueOverwrite: só o estado mais recente importa
+
+    CREATE_TASK(vWebServerTask, "WebServerTask", STACK_WEB_SERVER_TASK, tskIDLE_PRIORITY + 2, CORE_INTERFACE); // Prioridade maior para o webserver ser iniciado primeiramente
+    CREATE_TASK(vDisplayTask, "vMostraDadosNoDisplayTask", STACK_DISPLAY_TASK, tskIDLE_PRIORITY, CORE_INTERFACE);
+    CREATE_TASK(vMatrixLedsTask, "vMatrixLedsTask", configMINIMAL_STACK_SIZE, tskIDLE_PRIORITY, CORE_INTERFACE);
+    CREATE_TASK(vEffectsTask, "vEffectsTask", configMINIMAL_STACK_SIZE, tskIDLE_PRIORITY, CORE_INTERFACE);
+    CREATE_TASK(vButtonTask, "vButtonTask", configMINIMAL_STACK_SIZE, tskIDLE_PRIORITY + 1, CORE_INTERFACE);
+    CREATE_TASK(vFlashLogTask, "vFlashLogTask", configMINIMAL_STACK_SIZE, tskIDLE_PRIORITY + 3, CORE_INTERFACE); // Bloqueada quase sempre, a prioridade só garante que ela use a janela logo que abre
+    CREATE_TASK(vControlWaterPumpTask, "AcionaBombaComBaseNoNivelTask", STACK_CONTROL_TASK, tskIDLE_PRIORITY + 2, CORE_CONTROL); // Maior prioridade do núcleo: o período não pode atrasar
+    CREATE_TASK(vReadPotentiometerTask, "LeituraPotenciometroTask", configMINIMAL_STACK_SIZE, tskIDLE_PRIORITY, CORE_CONTROL);
+    CREATE_TASK(vUltrasonicSensorTask, "vUltrasonicSensorTask", STACK_ULTRASONIC_TASK, tskIDLE_PRIORITY, CORE_CONTROL);
+    CREATE_TASK(vLevelFusionTask, "vLevelFusionTask", STACK_FUSION_TASK, tskIDLE_PRIORITY + 1, CORE_CONTROL);
 
     vTaskStartScheduler();
     panic_unsupported();
 }
 
-// Função de callback para interrupção dos botões
-void button_callback(uint gpio, uint32_t events){
-    uint32_t current_time = to_ms_since_boot(get_absolute_time());
-
-    if(current_time - last_debounce_time > debounce_delay){
-
-        if(gpio == BUTTON_A){
-            reset_limits=true;
-        }
-        else if(gpio == BUTTON_B){
-
-        }
-        else if(gpio == BUTTON_SW){
-
-        }
-
-        last_debounce_time = current_time;
-    }
+// Chamada pela interrupção do pino de eco ao fim de cada medição
+static void ultrasonic_echo_done(uint64_t pulse_duration_us, void *ctx){
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    xTaskNotifyIndexedFromISR((TaskHandle_t)ctx, ULTRASONIC_NOTIFY_INDEX, (uint32_t)pulse_duration_us, eSetValueWithOverwrite, &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
 }
 
 // Task que controla o sensor ultrassônico
 void vUltrasonicSensorTask(void *pvParameters){
     (void)pvParameters; // Evita aviso de parâmetro não utilizado
 
-    // Inicializa os pinos do sensor ultrassônico
-    setup_ultrasonic_pins(ULTRASONIC_TRIG_PIN, ULTRASONIC_ECHO_PIN);
+    // Inicializa os pinos do sensor ultrassônico e a captura do eco por interrupção
+    ultrasonic_init_async(ULTRASONIC_TRIG_PIN, ULTRASONIC_ECHO_PIN, ultrasonic_echo_done, xTaskGetCurrentTaskHandle());
+    level_filter_t filter;
+    level_filter_init(&filter, &ultrasonic_filter_config);
     xSemaphoreTake(xWifiReadySemaphore, portMAX_DELAY);
     xSemaphoreGive(xWifiReadySemaphore); // Dá o semáforo de volta para que outras tasks também possam usá-lo
     while (true){
-        uint64_t pulse_duration = get_pulse_duration_us(ULTRASONIC_TRIG_PIN, ULTRASONIC_ECHO_PIN); // Mede a duração do pulso do ultrassônico
+        uint32_t pulse_duration = 0;
+        xTaskNotifyStateClearIndexed(NULL, ULTRASONIC_NOTIFY_INDEX); // Descarta resultado de uma medição anterior
+        if (ultrasonic_trigger()){
+            // A task fica bloqueada até a interrupção do eco entregar a duração do pulso
+            if (xTaskNotifyWaitIndexed(ULTRASONIC_NOTIFY_INDEX, 0, 0, &pulse_duration, pdMS_TO_TICKS(ULTRASONIC_TIMEOUT_MS)) != pdTRUE){
+                ultrasonic_cancel();
+                pulse_duration = 0;
+            }
+        }
 
-        // Converte a duração do pulso em cm e inches
+        // Converte a duração do pulso em cm. Sem printf de float a 4 Hz: a distância fica em ultrasonic_distance
         if (pulse_duration > 0) {
-            float distance_cm = microseconds_to_cm(pulse_duration);
-            float distance_inches = microseconds_to_inches(pulse_duration);
-
-            printf("Distância: %.2f cm (%.2f inches)\n", distance_cm, distance_inches);
-            ultrasonic_distance = distance_cm; // Armazena a distância medida
+            ultrasonic_distance = microseconds_to_cm(pulse_duration); // Armazena a distância medida
         } else {
             printf("Erro: Timeout. Nenhum objeto detectado no alcance.\n");
         }
 
-         // Converte a distância para porcentagem do nível de água
-        // A lógica é inversa: quanto MAIOR a distância, mais VAZIO o tanque (0%).
-        // Quanto MENOR a distância, mais CHEIO o tanque (100%).
-        float float_ultrassonic_distance = (float) ultrasonic_distance;
-        float range = ULTRASONIC_DIST_MAX_VAZIO - ULTRASONIC_DIST_MIN_CHEIO;
-        float adjusted_distance = float_ultrassonic_distance - ULTRASONIC_DIST_MIN_CHEIO; // Ajusta a distância para o novo zero (tanque cheio)
-
-        // Calcula a porcentagem.
-        // Se a distância for ULTRASONIC_DIST_MIN_CHEIO (cheio), adjusted_distance será 0, e a porcentagem será 100.
-        // Se a distância for ULTRASONIC_DIST_MAX_VAZIO (vazio), adjusted_distance será 'range', e a porcentagem será 0.
-        int water_level_percentage = (int)(((range - adjusted_distance) / range) * 100.0f);
-
-        // Garante que a porcentagem esteja entre 0 e 100
-        if (water_level_percentage < 0.) {
-            water_level_percentage = 0;
-        } else if (water_level_percentage > 100) {
-            water_level_percentage = 100;
-        }
-
-        if(xSemaphoreTake(xMutexWaterLevelJson, portMAX_DELAY)) {
-            water_level_percentege_json= water_level_percentage;
-            xSemaphoreGive(xMutexWaterLevelJson);
+        // Ecos espúrios do HC-SR04 são descartados pelo filtro. Sem eco válido nada é publicado,
+        // e a fusão percebe o sensor parado
+        if (pulse_duration > 0) {
+            // A duração do eco vai direto para a porcentagem em Q8 pela tabela da calibração, sem passar por cm.
+            // Quanto maior o eco, mais vazio o reservatório: a tabela já tem o sentido certo
+            uint16_t raw = pulse_duration > UINT16_MAX ? UINT16_MAX : pulse_duration;
+            // Média móvel curta para o ponto de calibração não depender de um único eco
+            ultrasonic_cal.raw = ultrasonic_cal.raw ? ultrasonic_cal.raw + ((int32_t)raw - ultrasonic_cal.raw) / 4 : raw;
+            int32_t level_q8 = calibration_apply(ultrasonic_cal.active, raw);
+            level_q8 = level_filter_update(&filter, level_q8);
+            level_bus_publish(&ultrasonic_bus, level_q8); // Publica a porcentagem em Q8 para a fusão
         }
-
-        xQueueSend(xQueueWaterLevelReadings, &water_level_percentage, 0); // Envia o valor da porcentagem para a fila
         vTaskDelay(pdMS_TO_TICKS(250)); // Aguarda 500ms para a próxima leitura (ajustável)
     }
 }
 
-// Task que controla a leitura do joystick
+// Chamada pela interrupção do DMA do ADC a cada bloco de amostras completo
+static void adc_block_ready(uint32_t block_seq, void *ctx){
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    xTaskNotifyIndexedFromISR((TaskHandle_t)ctx, ADC_BLOCK_NOTIFY_INDEX, block_seq, eSetValueWithOverwrite, &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
+// Task que controla a leitura do potenciômetro da boia
 void vReadPotentiometerTask(void *pvParameters){
     (void)pvParameters; // Evita aviso de parâmetro não utilizado
-    // Inicializa o adc e os pinos responsáveis pelo eixo x e y do joystick
-    adc_gpio_init(ADC_PIN_POTENTIOMETER_READ);
-    adc_init();
+    // O ADC amostra continuamente via DMA, a task só é acordada com um bloco inteiro pronto
+    if (!adc_sampler_init(ADC_INPUT_POTENTIOMETER, ADC_SAMPLE_RATE_HZ, adc_block_ready, xTaskGetCurrentTaskHandle())){
+        printf("ADC: taxa de %d Hz fora do alcance do divisor\n", ADC_SAMPLE_RATE_HZ);
+        vTaskDelete(NULL); // Sem a boia a fusão segue só com o ultrassônico
+    }
     int water_level_percentage = 0;
-    uint32_t total, average_adc; // Para tirar a média da leitura do adc no potênciometro
+    uint32_t average_adc; // Média do bloco de amostras do potênciometro
+    uint32_t block_seq, expected_seq = 0, lost;
+    level_filter_t filter;
+    level_filter_init(&filter, &potentiometer_filter_config);
     xSemaphoreTake(xWifiReadySemaphore, portMAX_DELAY);
     xSemaphoreGive(xWifiReadySemaphore); // Dá o semáforo de volta para que outras tasks também possam usá-lo
     while (true){
-        adc_select_input(2); // GPIO 28 = ADC2
-        total=0;
-        // Faz 20 leituras
-        for (uint8_t i = 0; i < 20; i++)
-        {
-            uint16_t leitura = adc_read();
-            total += leitura;
+        if (xTaskNotifyWaitIndexed(ADC_BLOCK_NOTIFY_INDEX, 0, 0, &block_seq, portMAX_DELAY) != pdTRUE){
+            continue;
+        }
+        lost = adc_sampler_blocks_lost(&expected_seq, block_seq);
+        if (lost){
+            printf("Potenciômetro perdeu %lu blocos do ADC\n", (unsigned long)lost);
         }
 
-        average_adc=total/20; // Tira a média
-        printf("\nLeitura média do potenciômetro: %d\n", average_adc);
+        // Média dos ADC_SAMPLER_BLOCK_SIZE pontos espalhados por todo o intervalo, filtra a oscilação da água
+        average_adc = adc_sampler_block_average(block_seq);
+        printf("\nLeitura média do potenciômetro: %lu\n", (unsigned long)average_adc);
 
-        // Converte em porcentagem baseado nos valores máximos e mínimos lidos pelo potênciometro no reservatório
-        water_level_percentage = (((float)(average_adc - ADC_MIN_POTENTIOMETER_READING) / (ADC_MAX_POTENTIOMETER_READING - ADC_MIN_POTENTIOMETER_READING)) * 100.0f);
+        // Converte em porcentagem pela calibração em vigor, já limitada entre 0 e 100.
+        // A porcentagem é calculada em Q8 para o filtro não perder a parte fracionária
+        potentiometer_cal.raw = average_adc;
+        int32_t level_q8 = calibration_apply(potentiometer_cal.active, average_adc);
 
-        // Limita entre 0 e 100
-        if (water_level_percentage < 0) water_level_percentage = 0;
-        if (water_level_percentage > 100) water_level_percentage = 100;
+        // Remove os saltos da boia antes de publicar, para a histerese do relé não oscilar
+        level_q8 = level_filter_update(&filter, level_q8);
+        water_level_percentage = (level_q8 + LEVEL_FILTER_ONE / 2) >> LEVEL_FILTER_Q;
 
          printf("Leitura nível de água: %d%%\n", water_level_percentage);
 
-        if(xSemaphoreTake(xMutexWaterLevelJson, portMAX_DELAY)) {
-            water_level_percentege_json= water_level_percentage;
-            xSemaphoreGive(xMutexWaterLevelJson);
+        level_bus_publish(&potentiometer_bus, level_q8); // Publica a porcentagem em Q8 para a fusão
+    }
+}
+
+// Task que combina a boia e o ultrassônico e publica o nível em uma taxa fixa
+void vLevelFusionTask(void *pvParameters){
+    (void)pvParameters; // Evita aviso de parâmetro não utilizado
+    level_fusion_t fusion;
+    level_fusion_init(&fusion, &fusion_config);
+    level_bus_t *inputs[LEVEL_FUSION_NUM_SENSORS] = {
+        [LEVEL_FUSION_POTENTIOMETER] = &potentiometer_bus,
+        [LEVEL_FUSION_ULTRASONIC] = &ultrasonic_bus,
+    };
+    uint32_t last_seq[LEVEL_FUSION_NUM_SENSORS] = {0};
+    uint8_t last_faults[LEVEL_FUSION_NUM_SENSORS] = {0};
+    level_sample_t sample;
+    int32_t level_q8;
+    int water_level_percentage = 0;
+
+    xSemaphoreTake(xWifiReadySemaphore, portMAX_DELAY);
+    xSemaphoreGive(xWifiReadySemaphore); // Dá o semáforo de volta para que outras tasks também possam usá-lo
+    TickType_t last_wake = xTaskGetTickCount();
+    while (true){
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(FUSION_PERIOD_MS)); // Publicação em taxa fixa, independente dos sensores
+
+        // Pedido dos botões ou de /calibrar: o ajuste da curva usa ponto flutuante e fica fora das tasks dos sensores
+        int8_t request = calibration_request;
+        if (request != CALIBRATION_NONE){
+            calibration_request = CALIBRATION_NONE;
+            sensor_calibration_record(&potentiometer_cal, request);
+            sensor_calibration_record(&ultrasonic_cal, request);
         }
-        
-        xQueueSend(xQueueWaterLevelReadings, &water_level_percentage, 0); // Envia o valor da leitura do potenciometro em porcentagem para fila
-        vTaskDelay(pdMS_TO_TICKS(100));              // 10 Hz de leitura
+
+        uint64_t now = time_us_64();
+        for (uint8_t i = 0; i < LEVEL_FUSION_NUM_SENSORS; i++){
+            level_bus_peek(inputs[i], &sample);
+            if (sample.seq != last_seq[i]){ // Só leituras novas entram na estimativa de variância
+                last_seq[i] = sample.seq;
+                level_fusion_update(&fusion, i, sample.value, sample.timestamp_us);
+            }
+        }
+
+        uint32_t limits = water_level_limits;
+        uint8_t flags = estado_bomba ? TIMESERIES_FLAG_PUMP : 0;
+        if (!level_fusion_compute(&fusion, now, &level_q8)){
+            // Nenhum sensor disponível: não publica, os consumidores mantêm o último nível.
+            // O histórico recebe o registro mesmo assim, marcado, para o eixo do tempo não ter buracos
+            timeseries_insert(&history, water_level_percentage, flags | TIMESERIES_FLAG_STALE, limits & 0xFF, limits >> 8, (uint32_t)(now / 1000));
+            continue;
+        }
+
+        for (uint8_t i = 0; i < LEVEL_FUSION_NUM_SENSORS; i++){
+            if (fusion.sensors[i].faults != last_faults[i]){
+                printf("Sensor %s: falhas 0x%02x\n", i == LEVEL_FUSION_POTENTIOMETER ? "boia" : "ultrassonico", fusion.sensors[i].faults);
+                last_faults[i] = fusion.sensors[i].faults;
+            }
+        }
+
+        water_level_percentage = (level_q8 + LEVEL_FILTER_ONE / 2) >> LEVEL_FILTER_Q;
+        level_bus_publish(&water_level_bus, water_level_percentage); // Publica o nível combinado para todos os assinantes
+        timeseries_insert(&history, water_level_percentage, flags, limits & 0xFF, limits >> 8, (uint32_t)(now / 1000)); // O(1), não atrasa o período
     }
 }
 
 
-// Task que controla o relé da bomba de água
+// Task que controla o relé da bomba de água.
+// Roda em período fixo sobre o último nível publicado, sem depender de quando a leitura chega.
+// Nenhuma espera acontece dentro do laço: o pulso do relé é encerrado por prazo e os efeitos
+// (LED e buzzer) ficam com a vEffectsTask
 void vControlWaterPumpTask(void * pvParameters){
     (void)pvParameters; // Evita aviso de parâmetro não utilizado
     gpio_init(RELE_PIN);
     gpio_set_dir(RELE_PIN,GPIO_OUT);
     gpio_put(RELE_PIN,1);// Começa com o Relé desligado, pois ele no nivel alto da gpio é desligado ja que é um rele com optoacoplador
-    int water_level_percentage = 0;
+    level_sample_t sample;
+    uint32_t last_seq = 0;
+    bool last_estado = !estado_bomba; // Força o envio do estado inicial para os efeitos
     xSemaphoreTake(xWifiReadySemaphore, portMAX_DELAY);
     xSemaphoreGive(xWifiReadySemaphore); // Dá o semáforo de volta para que outras tasks também possam usá-lo
 
-    uint64_t last_time_bomba = -20000; // Variável para armazenar o último tempo que a bomba foi ligada
+    uint32_t last_time_bomba = -PUMP_RETRIGGER_MS; // Variável para armazenar o último tempo que a bomba foi ligada
+    uint64_t pulse_end_us = 0; // Fim do pulso atual do relé, 0 se não houver pulso
+    uint32_t last_report = 0; // Último relatório de tempo do laço
+
+    // Medidas de tempo do laço, zeradas a cada relatório
+    uint32_t cycles = 0;
+    uint32_t jitter_max_us = 0;
+    uint32_t loop_max_us = 0;
+    uint32_t sample_age_max_us = 0;
+    uint64_t jitter_total_us = 0;
+
+    TickType_t last_wake = xTaskGetTickCount();
+    uint64_t expected_us = time_us_64();
     while (true){
-        if (xQueueReceive(xQueueWaterLevelReadings, &water_level_percentage, portMAX_DELAY) == pdTRUE){
-            if(xSemaphoreTake(xMutexLimites, portMAX_DELAY) == pdTRUE){
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(PUMP_CONTROL_PERIOD_MS));
+        uint64_t start_us = time_us_64();
+        expected_us += PUMP_CONTROL_PERIOD_MS * 1000;
+        uint32_t jitter = start_us > expected_us ? (uint32_t)(start_us - expected_us) : (uint32_t)(expected_us - start_us);
+        uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+
+        // Encerra o pulso do relé quando o prazo vence
+        if (pulse_end_us && start_us >= pulse_end_us){
+            gpio_put(RELE_PIN, 1); // Desliga a bomba (desativa o relé)
+            pulse_end_us = 0;
+        }
 
-                if (reset_limits){// Caso o botão A seja pressionado, reseta os limites
-                    min_water_level_limit = 20; 
-                    max_water_level_limit = 50;
-                    reset_limits=false;
-                }
+        level_bus_peek(&water_level_bus, &sample); // Último nível combinado, sem bloquear
+        if (sample.seq != last_seq){
+            if (sample.seq - last_seq > 1 && last_seq != 0){
+                printf("Controle da bomba perdeu %lu leituras\n", (unsigned long)(sample.seq - last_seq - 1));
+            }
+            last_seq = sample.seq;
+            uint32_t age = (uint32_t)(start_us - sample.timestamp_us);
+            if (age > sample_age_max_us){
+                sample_age_max_us = age;
+            }
 
-                if (water_level_percentage <= min_water_level_limit){
-                    estado_bomba = true; // Estado da bomba ligado
-                }
-                else if (water_level_percentage >= max_water_level_limit){
-                    estado_bomba = false; // Estado da bomba desligado
+            uint32_t limits = water_level_limits; // Uma única leitura: min e max sempre do mesmo par
+            if (manual_pump != PUMP_AUTOMATIC){
+                if (manual_pump == 1 && sample.value >= (int)(limits >> 8)){
+                    manual_pump = 0; // Mesmo no modo manual a bomba não enche acima do limite máximo
+                    printf("Modo manual: limite máximo atingido, bomba desligada\n");
                 }
-                xSemaphoreGive(xMutexLimites);
+            }
+            else if (sample.value <= (int)(limits & 0xFF)){
+                estado_bomba = true; // Estado da bomba ligado
+            }
+            else if (sample.value >= (int)(limits >> 8)){
+                estado_bomba = false; // Estado da bomba desligado
             }
         }
 
-        if (estado_bomba && to_ms_since_boot(get_absolute_time()) - last_time_bomba > 20000) {// Liga a bomba se o estado esta true e passou 20s
-            gpio_put(RELE_PIN, 0); // Liga a bomba (ativa o relé)
-            vTaskDelay(pdMS_TO_TICKS(200));
-            gpio_put(RELE_PIN, 1); // Desliga a bomba (desativa o relé)
-            last_time_bomba = to_ms_since_boot(get_absolute_time()); // Atualiza o último
-            envia_sinal = true;
-            printf("Bomba ligada!\n");
-        } else if (!estado_bomba && envia_sinal) {// Senão desliga a bomba
-            gpio_put(RELE_PIN, 0); // Liga a bomba (ativa o relé)
-            vTaskDelay(pdMS_TO_TICKS(200));
-            gpio_put(RELE_PIN, 1); // Desliga a bomba (desativa o relé)
-            envia_sinal = false; // Não envia sinal, pois a bomba não está ligada
-            last_time_bomba = -20000;
-            printf("Bomba desligada!\n");
+        // O comando manual vale a cada ciclo, mesmo sem leituras novas: é quando os sensores falham que ele mais importa
+        int8_t manual = manual_pump;
+        if (manual != PUMP_AUTOMATIC){
+            estado_bomba = manual;
         }
 
-        printf("Last time bomba: %llu\n", last_time_bomba);
-        printf("Estado da bomba: %s\n", estado_bomba ? "ON" : "OFF");
-        printf("Envia sinal: %s\n", envia_sinal ? "SIM" : "NAO");
+        // Um novo pulso só começa depois que o anterior terminou
+        if (!pulse_end_us){
+            if (estado_bomba && now_ms - last_time_bomba > PUMP_RETRIGGER_MS) {// Liga a bomba se o estado esta true e passou 20s
+                gpio_put(RELE_PIN, 0); // Liga a bomba (ativa o relé)
+                pulse_end_us = start_us + PUMP_RELAY_PULSE_MS * 1000;
+                last_time_bomba = now_ms; // Atualiza o último
+                envia_sinal = true;
+                printf("Bomba ligada!\n");
+            } else if (!estado_bomba && envia_sinal) {// Senão desliga a bomba
+                gpio_put(RELE_PIN, 0); // Liga a bomba (ativa o relé)
+                pulse_end_us = start_us + PUMP_RELAY_PULSE_MS * 1000;
+                envia_sinal = false; // Não envia sinal, pois a bomba não está ligada
+                last_time_bomba = -PUMP_RETRIGGER_MS;
+                printf("Bomba desligada!\n");
+            }
+        }
 
+        // Avisa os efeitos só na mudança de estado. A fila guarda apenas o estado mais recente
+        if (estado_bomba != last_estado){
+            last_estado = estado_bomba;
+            xQueueOverwrite(xPumpEffectsQueue, &last_estado);
+
+            // Registra a mudança no diário da flash. Só enfileira: a gravação acontece fora deste laço
+            uint8_t event[6];
+            memcpy(event, &now_ms, sizeof(now_ms));
+            event[4] = estado_bomba;
+            event[5] = sample.value;
+            flash_log_append(&flash_store, FLASH_EVENT_PUMP, event, sizeof(event));
+        }
 
+        // Ciclo encerrado: até o próximo período, parar a flash não atrasa o controle
+        if (xFlashLogTask){
+            xTaskNotifyGiveIndexed(xFlashLogTask, FLASH_WINDOW_NOTIFY_INDEX);
+        }
 
-        if (estado_bomba && gpio_get(RED_LED_PIN)){// Som emitido quando a bomba esta ligada
-            set_led_green(); // Liga o led verde indicando acionamento da bomba
+        uint32_t loop_us = (uint32_t)(time_us_64() - start_us);
+        cycles++;
+        jitter_total_us += jitter;
+        if (jitter > jitter_max_us){
+            jitter_max_us = jitter;
+        }
+        if (loop_us > loop_max_us){
+            loop_max_us = loop_us;
+        }
 
-            play_tone(BUZZER_A_PIN, 300);
-            vTaskDelay(pdMS_TO_TICKS(250)); // Toca o buzzer por 250ms
-            stop_tone(BUZZER_A_PIN);
+        if (now_ms - last_report > LATENCY_REPORT_MS){
+            printf("Controle (%s): %lu ciclos de %d ms, jitter médio %lu us, pior %lu us, laço pior %lu us, idade da leitura pior %lu us\n",
+                   configNUM_CORES > 1 ? "dois nucleos" : "um nucleo",
+                   (unsigned long)cycles, PUMP_CONTROL_PERIOD_MS,
+                   (unsigned long)(jitter_total_us / cycles),
+                   (unsigned long)jitter_max_us,
+                   (unsigned long)loop_max_us,
+                   (unsigned long)sample_age_max_us);
+            cycles = 0;
+            jitter_total_us = 0;
+            jitter_max_us = 0;
+            loop_max_us = 0;
+            sample_age_max_us = 0;
+            last_report = now_ms;
+        }
+    }
+}
 
-        }else if(!estado_bomba && !gpio_get(RED_LED_PIN)){ // Som emitido quando a bomba esta desligada
-            set_led_yellow(); // Liga
-            for (uint8_t i = 0; i < 2; i++)
-            {
-                play_tone(BUZZER_A_PIN, 900);
-                vTaskDelay(pdMS_TO_TICKS(150)); // Toca o buzzer por 250ms
-                stop_tone(BUZZER_A_PIN);
-                vTaskDelay(pdMS_TO_TICKS(150)); // Toca o buzzer por 250ms
+// Task que grava a flash. Junta os registros em páginas e faz cada apagamento ou gravação
+// logo depois de um ciclo do controle da bomba (ver flash_log_window)
+void vFlashLogTask(void *pvParameters){
+    (void)pvParameters; // Evita aviso de parâmetro não utilizado
+    xFlashLogTask = xTaskGetCurrentTaskHandle();
+    uint32_t last_erases = 0;
+    while (true){
+        flash_log_service(&flash_store);
+        if (flash_store.erases != last_erases){
+            last_erases = flash_store.erases;
+            printf("Flash: setor %u em uso, %lu apagamentos, %lu páginas gravadas, pior operação %lu us, %lu registros descartados\n",
+                   flash_store.sector, (unsigned long)flash_store.erases, (unsigned long)flash_store.pages_written,
+                   (unsigned long)flash_store.max_op_us, (unsigned long)flash_store.dropped);
+        }
+    }
+}
+
+// Enquanto a flash é apagada ou gravada, nenhum núcleo executa código dela, e o controle da bomba para.
+// Espera o aviso de fim de ciclo: a operação ocupa o intervalo até o próximo período em vez de cair no meio dele
+static void flash_log_window(void *ctx){
+    (void)ctx;
+    ulTaskNotifyTakeIndexed(FLASH_WINDOW_NOTIFY_INDEX, pdTRUE, 0); // Descarta um aviso antigo
+    ulTaskNotifyTakeIndexed(FLASH_WINDOW_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(2 * PUMP_CONTROL_PERIOD_MS));
+}
+
+// Conta os eventos do diário por tipo, para o resumo da inicialização
+static void flash_journal_count(uint8_t type, const uint8_t *payload, uint8_t len, void *ctx){
+    uint32_t *journal = ctx;
+    if (type == FLASH_EVENT_BOOT){
+        journal[0]++;
+    }
+    else if (type == FLASH_EVENT_PUMP){
+        journal[1]++;
+    }
+}
+
+// Carrega a calibração salva na flash ou, sem ela, a reta entre as leituras padrão de vazio e cheio.
+// Chamada antes do escalonador, depois de flash_log_init
+static void sensor_calibration_init(sensor_calibration_t *sc, uint16_t raw_empty, uint16_t raw_full){
+    sc->defaults[0] = (calibration_point_t){raw_empty, 0};
+    sc->defaults[1] = (calibration_point_t){raw_full, 100};
+    calibration_point_t points[CALIBRATION_MAX_POINTS];
+    uint8_t packed[CALIBRATION_PACKED_SIZE];
+    uint8_t num_points = 0;
+    if (flash_log_get(&flash_store, sc->flash_key, packed, sizeof(packed))){
+        num_points = calibration_unpack(packed, points);
+    }
+    if (num_points && calibration_build(&sc->tables[0], points, num_points)){
+        printf("Calibração %s restaurada da flash: %d pontos\n", sc->name, num_points);
+    }
+    else{
+        calibration_build(&sc->tables[0], sc->defaults, 2);
+    }
+    sc->active = &sc->tables[0];
+}
+
+// Grava a última leitura do sensor como o ponto 'percent' da curva (ou volta à calibração padrão),
+// publica a nova tabela e a persiste. Só a vLevelFusionTask chama: uma calibração por período, então a
+// tabela reaproveitada não está mais em uso pela task do sensor
+static void sensor_calibration_record(sensor_calibration_t *sc, int8_t percent){
+    const calibration_t *current = sc->active;
+    calibration_t *next = current == &sc->tables[0] ? &sc->tables[1] : &sc->tables[0];
+    calibration_point_t points[CALIBRATION_MAX_POINTS];
+    uint8_t num_points;
+
+    if (percent == CALIBRATION_RESTORE){
+        memcpy(points, sc->defaults, sizeof(sc->defaults));
+        num_points = 2;
+    }
+    else{
+        uint16_t raw = sc->raw;
+        if (raw == 0){
+            printf("Calibração %s: sensor ainda sem leitura\n", sc->name);
+            return;
+        }
+        num_points = current->num_points;
+        memcpy(points, current->points, num_points * sizeof(points[0]));
+        if (!calibration_add_point(points, &num_points, raw, percent)){
+            printf("Calibração %s: já tem %d pontos, restaure a padrão para recomeçar\n", sc->name, CALIBRATION_MAX_POINTS);
+            return;
+        }
+    }
+    if (!calibration_build(next, points, num_points)){
+        // Ex.: um ponto intermediário com leitura fora da ordem dos outros. A calibração em vigor continua
+        printf("Calibração %s: ponto %d%% rejeitado, curva não monotônica\n", sc->name, percent);
+        return;
+    }
+    sc->active = next; // A task do sensor passa a usar a nova tabela na próxima leitura
+
+    uint8_t packed[CALIBRATION_PACKED_SIZE];
+    calibration_pack(next, packed);
+    flash_log_set(&flash_store, sc->flash_key, packed, sizeof(packed)); // Só enfileira
+    printf("Calibração %s: %d pontos, leituras %ld a %ld\n", sc->name, next->num_points, (long)next->raw_lo, (long)next->raw_hi);
+}
+
+// Task que traduz os eventos dos botões em comandos locais:
+//   A: curto baixa o limite selecionado, duplo alterna entre mínimo e máximo, longo restaura os padrões
+//   B: curto sobe o limite selecionado, duplo alterna entre mínimo e máximo, longo calibra o vazio (0%)
+//   SW: curto liga/desliga a bomba em modo manual, duplo volta ao automático, longo calibra o cheio (100%)
+void vButtonTask(void *pvParameters){
+    (void)pvParameters; // Evita aviso de parâmetro não utilizado
+    button_event_t event;
+    while (true){
+        if (xQueueReceive(xButtonQueue, &event, portMAX_DELAY) != pdTRUE){
+            continue;
+        }
+        uint32_t limits = water_level_limits;
+        int min_val = limits & 0xFF;
+        int max_val = limits >> 8;
+
+        if (event.pin == BUTTON_SW){
+            if (event.type == BUTTON_EVENT_SHORT){
+                manual_pump = !estado_bomba; // O controle da bomba aplica na próxima leitura de nível
+                printf("Modo manual: bomba %s\n", manual_pump ? "ligada" : "desligada");
+            }
+            else if (event.type == BUTTON_EVENT_DOUBLE){
+                manual_pump = PUMP_AUTOMATIC;
+                printf("Modo automático\n");
+            }
+            else{
+                calibration_request = 100; // Grava a leitura atual dos sensores como reservatório cheio
+            }
+            continue;
+        }
+        if (event.type == BUTTON_EVENT_DOUBLE){
+            limit_selected_max = !limit_selected_max;
+            printf("Ajuste do limite %s\n", limit_selected_max ? "máximo" : "mínimo");
+            continue;
+        }
+        if (event.type == BUTTON_EVENT_LONG){
+            if (event.pin == BUTTON_B){
+                calibration_request = 0; // Grava a leitura atual dos sensores como reservatório vazio
+                continue;
+            }
+            min_val = DEFAULT_MIN_WATER_LEVEL_LIMIT;
+            max_val = DEFAULT_MAX_WATER_LEVEL_LIMIT;
+        }
+        else{
+            int step = event.pin == BUTTON_A ? -BUTTON_LIMIT_STEP : BUTTON_LIMIT_STEP;
+            if (limit_selected_max){ // Os dois limites nunca se cruzam
+                max_val += step;
+                if (max_val > 100) max_val = 100;
+                if (max_val < min_val + BUTTON_LIMIT_STEP) max_val = min_val + BUTTON_LIMIT_STEP;
             }
+            else{
+                min_val += step;
+                if (min_val > max_val - BUTTON_LIMIT_STEP) min_val = max_val - BUTTON_LIMIT_STEP;
+                if (min_val < 0) min_val = 0;
+            }
+        }
+        if (PACK_LIMITS(min_val, max_val) != limits){
+            water_level_limits = PACK_LIMITS(min_val, max_val); // Troca o par inteiro de uma vez
+            uint8_t new_limits[2] = {min_val, max_val};
+            flash_log_set(&flash_store, FLASH_KEY_LIMITS, new_limits, sizeof(new_limits)); // Persistido pela vFlashLogTask
+            printf("Novos limites: Max=%d, Min=%d\n", max_val, min_val);
+        }
+    }
+}
 
+// Task que sinaliza o estado da bomba com o LED RGB e o buzzer, fora do laço de controle
+void vEffectsTask(void *pvParameters){
+    (void)pvParameters; // Evita aviso de parâmetro não utilizado
+    static const buzzer_pattern_t pump_on_pattern = {.frequency_hz = 300, .on_ms = 250, .off_ms = 0, .repeat = 1};
+    static const buzzer_pattern_t pump_off_pattern = {.frequency_hz = 900, .on_ms = 150, .off_ms = 150, .repeat = 2}; // Dois bipes
+    bool estado;
+    while (true){
+        if (xQueueReceive(xPumpEffectsQueue, &estado, portMAX_DELAY) != pdTRUE){
+            continue;
         }
+        if (estado){// Som emitido quando a bomba esta ligada
+            set_led_green(); // Liga o led verde indicando acionamento da bomba
+            buzzer_play(&buzzer, &pump_on_pattern); // Só enfileira, o alarme do buzzer toca
+        }else{ // Som emitido quando a bomba esta desligada
+            set_led_yellow(); // Liga
+            buzzer_play(&buzzer, &pump_off_pattern);
+        }
+    }
+}
 
+// Linha do display correspondente a um nível, no gráfico do histórico
+static uint8_t display_graph_y(uint8_t level){
+    if (level > 100){
+        level = 100;
     }
+    return DISPLAY_GRAPH_TOP + DISPLAY_GRAPH_HEIGHT - level * DISPLAY_GRAPH_HEIGHT / 100;
 }
 
 // Task que exibe os dados no display OLED
@@ -317,13 +780,33 @@ void vDisplayTask(void *pvParameters){
     char min_water_level_str[5];
     char max_water_level_str[5];
     char distance_str[10]; // Buffer para armazenar a string da distância
+    bool flush_pending = false; // Há um quadro sendo enviado por DMA
+    level_bus_sub_t level_sub;
+    level_sample_t sample;
+    uint32_t last_report = to_ms_since_boot(get_absolute_time());
+    level_bus_subscribe(&water_level_bus, &level_sub);
+    if (xSemaphoreTake(xMutexDisplay, portMAX_DELAY) == pdTRUE){ // O web server pode estar usando o display
+        ssd1306_dma_init(&ssd, display_flush_done, xTaskGetCurrentTaskHandle());
+        xSemaphoreGive(xMutexDisplay);
+    }
     while (true){
-        // Aguarde recebimento de novo valor de porcentagem
-        if (xQueueReceive(xQueueWaterLevelReadings, &water_level_percentage, portMAX_DELAY) == pdTRUE){
-            if(xSemaphoreTake(xMutexLimites, portMAX_DELAY) == pdTRUE){ // Pega os limite com segurança através do mutex
-                min=min_water_level_limit;
-                max=max_water_level_limit;
-                xSemaphoreGive(xMutexLimites);
+        // Aguarde recebimento de novo valor de porcentagem. Se o I2C atrasar, as leituras intermediárias são descartadas
+        if (level_bus_receive(&level_sub, &sample, NULL, portMAX_DELAY)){
+            water_level_percentage = sample.value;
+            uint32_t limits = water_level_limits; // Pega os dois limites de uma vez, sem mutex
+            min = limits & 0xFF;
+            max = limits >> 8;
+            uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+            if (now_ms - last_report > LATENCY_REPORT_MS){
+                report_bus_subscriber("display", &level_sub);
+                last_report = now_ms;
+            }
+
+            // Espera o quadro anterior sair antes de tomar o mutex, sem ocupar a CPU: o web server não
+            // fica parado no display enquanto o DMA envia. Normalmente o envio já terminou há muito tempo
+            if (flush_pending){
+                ulTaskNotifyTakeIndexed(DISPLAY_FLUSH_NOTIFY_INDEX, pdTRUE, pdMS_TO_TICKS(100));
+                flush_pending = false;
             }
 
             if (xSemaphoreTake(xMutexDisplay,portMAX_DELAY) == pdTRUE){// Acessa o display tomando o mutex
@@ -340,13 +823,34 @@ void vDisplayTask(void *pvParameters){
 
                 ssd1306_draw_string(&ssd, "Nivel: ", 10, 30);           // Desenha uma string
                 ssd1306_draw_string(&ssd, water_level_str, 58, 30);         // Desenha uma string
-                ssd1306_draw_string(&ssd, !estado_bomba ? "Bomba:OFF" : "Bomba:ON", 10,40);
+                ssd1306_draw_string(&ssd, ">", 48, limit_selected_max ? 20 : 10); // Limite ajustado pelos botões A e B, entre o rótulo e o valor
+                if (manual_pump != PUMP_AUTOMATIC){ // Modo manual: rótulo próprio, ainda à esquerda do gráfico (x=90)
+                    ssd1306_draw_string(&ssd, !estado_bomba ? "Man:OFF" : "Man:ON", 10,40);
+                }
+                else{
+                    ssd1306_draw_string(&ssd, !estado_bomba ? "Bomba:OFF" : "Bomba:ON", 10,40);
+                }
 
                 ssd1306_draw_string(&ssd, (cyw43_tcpip_link_status(&cyw43_state, CYW43_ITF_STA) <= 0) ? "Wi-Fi:OFF" : "Wi-Fi:ON", 10,50);
 
                 //sprintf(distance_str, "%.2f cm", ultrasonic_distance); // Formata a distância medida
                 //ssd1306_draw_string(&ssd, distance_str, 20, 53); // Desenha a distância medida*/
-                ssd1306_send_data(&ssd);                             // Atualiza o display
+
+                // Gráfico dos últimos DISPLAY_GRAPH_MINUTES minutos à direita do texto: uma barra do mínimo
+                // ao máximo por registro, alinhadas à direita. A consulta escolhe a resolução que cabe na largura
+                uint32_t now = to_ms_since_boot(get_absolute_time());
+                uint32_t span = DISPLAY_GRAPH_MINUTES * 60000;
+                timeseries_range_t range;
+                timeseries_record_t record;
+                timeseries_query(&history, now > span ? now - span : 0, now, DISPLAY_GRAPH_MINUTES, &range);
+                for (uint32_t i = range.first; i < range.end; i++){
+                    if (timeseries_get(&history, range.tier, i, &record)){
+                        uint8_t x = DISPLAY_GRAPH_RIGHT - (range.end - 1 - i);
+                        ssd1306_vline(&ssd, x, display_graph_y(record.level_max), display_graph_y(record.level_min), true);
+                    }
+                }
+
+                flush_pending = ssd1306_send_data_async(&ssd); // Atualiza o display sem bloquear
                 xSemaphoreGive(xMutexDisplay);
             }
 
@@ -354,34 +858,76 @@ void vDisplayTask(void *pvParameters){
     }
 }
 
+// Chamada pela interrupção do DMA do display ao terminar de ler o quadro
+static void display_flush_done(void *ctx){
+    BaseType_t higher_priority_task_woken = pdFALSE;
+    vTaskNotifyGiveIndexedFromISR((TaskHandle_t)ctx, DISPLAY_FLUSH_NOTIFY_INDEX, &higher_priority_task_woken);
+    portYIELD_FROM_ISR(higher_priority_task_woken);
+}
+
 // Task que controla a matriz de LEDs
 void vMatrixLedsTask(void *pvParameters){
     (void)pvParameters; // Evita aviso de parâmetro não utilizado
     init_led_matrix();
     apaga_matriz();
-    int water_level_percentage = 0;
+    static matrix_render_t render; // Tabelas do desenho, fora da pilha da task
+    matrix_render_init(&render, MATRIX_BRIGHTNESS, obter_index);
+    uint32_t frame[NUM_PIXELS]; // Desenhado aqui e copiado pelo envia_frame, nunca é o buffer lido pelo DMA
+    level_sample_t sample;
+    uint32_t render_max_us = 0, over_budget = 0;
+    uint32_t last_seq = 0, shown = 0, latency_max_us = 0; // Latência publicação -> primeiro quadro com a amostra
+    uint64_t latency_total_us = 0;
+    uint32_t last_report = to_ms_since_boot(get_absolute_time());
     xSemaphoreTake(xWifiReadySemaphore, portMAX_DELAY);
     xSemaphoreGive(xWifiReadySemaphore); // Dá o semáforo de volta para que outras tasks também possam usá-lo
+    TickType_t last_wake = xTaskGetTickCount();
     while (true){
-        if(xQueueReceive(xQueueWaterLevelReadings, &water_level_percentage, portMAX_DELAY) == pdTRUE){// Aguarda um novo valor de porcentagem
-            // Exibe na matriz a porcentagem correponde, sendo que cada linha representa 20%
-            if (water_level_percentage >= 80){
-                desenha_frame(levels,4);
-            }else if(water_level_percentage >= 60){
-                desenha_frame(levels,3);
-            }else if(water_level_percentage >= 40){
-                desenha_frame(levels,2);
-            }else if(water_level_percentage >= 20){
-                desenha_frame(levels,1);
-            }else{
-                desenha_frame(levels,0);
+        // Taxa de quadros fixa: as animações não dependem de quando o nível chega
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(MATRIX_RENDER_PERIOD_MS));
+        uint32_t start_us = time_us_32();
+
+        level_bus_peek(&water_level_bus, &sample); // Último nível combinado, sem bloquear
+        if (sample.seq != last_seq && sample.seq != 0){
+            uint32_t latency = (uint32_t)(time_us_64() - sample.timestamp_us);
+            latency_total_us += latency;
+            if (latency > latency_max_us){
+                latency_max_us = latency;
             }
+            shown++;
+            last_seq = sample.seq;
+        }
+        uint8_t flags = estado_bomba ? MATRIX_RENDER_FLAG_PUMP : 0;
+        if (sample.seq == 0 || time_us_64() - sample.timestamp_us > fusion_config.stale_timeout_us){
+            flags |= MATRIX_RENDER_FLAG_ALARM; // Nenhum sensor disponível: o nível mostrado é o último conhecido
+        }
+        matrix_render_frame(&render, sample.value * LEVEL_FILTER_ONE, flags, frame);
+        envia_frame(frame); // Parado e sem animação o quadro se repete e não é reenviado
 
+        uint32_t render_us = time_us_32() - start_us;
+        if (render_us > render_max_us){
+            render_max_us = render_us;
+        }
+        if (render_us > MATRIX_RENDER_BUDGET_US){
+            over_budget++;
+        }
+        uint32_t now_ms = to_ms_since_boot(get_absolute_time());
+        if (now_ms - last_report > LATENCY_REPORT_MS){
+            if (over_budget){
+                printf("Matriz: %lu quadro(s) acima de %d us, pior %lu us\n",
+                       (unsigned long)over_budget, MATRIX_RENDER_BUDGET_US, (unsigned long)render_max_us);
+            }
+            if (shown){
+                printf("Nível -> matriz: %lu amostras exibidas, latência média %lu us, pior %lu us\n",
+                       (unsigned long)shown, (unsigned long)(latency_total_us / shown), (unsigned long)latency_max_us);
+            }
+            last_report = now_ms;
+            render_max_us = 0;
+            over_budget = 0;
+            shown = 0;
+            latency_max_us = 0;
+            latency_total_us = 0;
         }
-        vTaskDelay(pdMS_TO_TICKS(50));
     }
-
-
 }
 
 // Task que inicia o servidor web
@@ -397,6 +943,15 @@ void vWebServerTask(void *pvParameters){
 
             vTaskDelete(NULL);  // Encerrar esta task
         }
+#if configNUM_CORES > 1
+        // A tcpip thread do lwIP e a task do driver do Wi-Fi são criadas em cyw43_arch_init sem afinidade.
+        // Presas ao núcleo das interfaces, o núcleo do controle fica só com a aquisição, a fusão e a bomba
+        vTaskCoreAffinitySet(((async_context_freertos_t *)cyw43_arch_async_context())->task_handle, CORE_INTERFACE);
+        TaskHandle_t tcpip_thread = xTaskGetHandle(TCPIP_THREAD_NAME);
+        if (tcpip_thread){
+            vTaskCoreAffinitySet(tcpip_thread, CORE_INTERFACE);
+        }
+#endif
 
         cyw43_arch_enable_sta_mode();// Coloca em modo cliente
         if (cyw43_arch_wifi_connect_timeout_ms(WIFI_SSID, WIFI_PASSWORD, CYW43_AUTH_WPA2_AES_PSK, 30000)){ // Tenta se conectar durante 30s
@@ -415,186 +970,309 @@ void vWebServerTask(void *pvParameters){
         ssd1306_draw_string(&ssd, "WiFi => OK", 0, 0);
         ssd1306_draw_string(&ssd, ip_str, 0, 10);// Mostra o ip na tela para acessar o webserver
         ssd1306_send_data(&ssd);
+        LOCK_TCPIP_CORE(); // Fora da tcpip thread, toda chamada ao lwIP precisa da trava do núcleo
         start_http_server();
+        UNLOCK_TCPIP_CORE();
         vTaskDelay(pdMS_TO_TICKS(2000)); // pra dar tempo de ver o ip
         xSemaphoreGive(xMutexDisplay); // Libera o display 
         xSemaphoreGive(xWifiReadySemaphore); // Sinaliza que o Wi-Fi está pronto!
     }
 
 
+    level_bus_sub_t level_sub;
+    level_sample_t sample;
+    level_bus_subscribe(&water_level_bus, &level_sub);
+    uint32_t last_requests = 0;
+    uint32_t last_connections = 0;
+    uint32_t last_stats = to_ms_since_boot(get_absolute_time());
     while (1){
-        // Mantém o servidor HTTP ativo
-        cyw43_arch_poll();
-        vTaskDelay(pdMS_TO_TICKS(1000)); // Aguarda 1 segundo
+        // Acorda assim que um novo nível é publicado, ou a cada HTTP_SSE_CHECK_MS para ver a bomba e os limites
+        level_bus_receive(&level_sub, &sample, NULL, pdMS_TO_TICKS(HTTP_SSE_CHECK_MS));
+
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        uint32_t limits = water_level_limits;
+        level_bus_peek(&water_level_bus, &sample);
+        http_sse_state_t current = {
+            .nivel = sample.value,
+            .bomba = estado_bomba,
+            .min = limits & 0xFF,
+            .max = limits >> 8,
+        };
+        // Requisições são atendidas pela tcpip thread assim que os pacotes chegam,
+        // esta task só empurra os eventos. As conexões pertencem ao lwIP: trava o núcleo antes de tocá-las
+        LOCK_TCPIP_CORE();
+        http_sse_push(&current, now);
+        UNLOCK_TCPIP_CORE();
+
+        if (now - last_stats >= HTTP_STATS_PERIOD_MS){
+            uint32_t requests = http_server_stats.requests;
+            uint32_t connections = http_server_stats.connections_accepted;
+            if (requests != last_requests || http_server_stats.sse_clients){
+                printf("HTTP: %lu req/s em %lu conexões novas, pico de %u conexões, %lu despejadas, %u clientes de eventos, %lu eventos, heap livre mínimo %u bytes\n",
+                       (unsigned long)((requests - last_requests) * 1000 / (now - last_stats)),
+                       (unsigned long)(connections - last_connections),
+                       http_server_stats.connections_peak, (unsigned long)http_server_stats.evictions,
+                       http_server_stats.sse_clients, (unsigned long)http_server_stats.sse_events,
+                       (unsigned)xPortGetMinimumEverFreeHeapSize());
+            }
+            last_requests = requests;
+            last_connections = connections;
+            last_stats = now;
+            report_bus_subscriber("web server", &level_sub);
+            report_task_stacks();
+        }
     }
      cyw43_arch_deinit();// Esperamos que nunca chegue aqui
 }
 
-// Função de callback para enviar dados HTTP
-static err_t http_sent(void *arg, struct tcp_pcb *tpcb, u16_t len)
+// Entregas do barramento a um assinante desde o último relatório, com a latência publicação -> entrega.
+// As estatísticas pertencem à task assinante, que é quem chama: zeradas aqui sem lock
+static void report_bus_subscriber(const char *name, level_bus_sub_t *sub)
 {
-    struct http_state *hs = (struct http_state *)arg;
-    hs->sent += len;
-    if (hs->sent >= hs->len)
+    if (sub->received)
     {
-        tcp_close(tpcb);
-        free(hs);
+        printf("Nível -> %s: %lu entregas, %lu perdidas, latência média %lu us, pior %lu us\n", name,
+               (unsigned long)sub->received, (unsigned long)sub->skipped,
+               (unsigned long)(sub->latency_total_us / sub->received), (unsigned long)sub->latency_max_us);
     }
-    return ERR_OK;
+    sub->received = 0;
+    sub->skipped = 0;
+    sub->latency_total_us = 0;
+    sub->latency_max_us = 0;
 }
 
-// Função de recebimento HTTP
-static err_t http_recv(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err){   
-
-    if (!p)
+// Mostra a menor folga de pilha já vista em cada task, só quando alguma diminuiu desde o último relatório.
+// A folga nunca cresce, então a soma muda exatamente quando há um novo mínimo
+static void report_task_stacks(void)
+{
+    static TaskStatus_t tasks[TASK_REPORT_MAX]; // Fora da pilha desta task
+    static uint32_t last_total = 0;
+    UBaseType_t count = uxTaskGetSystemState(tasks, TASK_REPORT_MAX, NULL);
+    uint32_t total = 0;
+    for (UBaseType_t i = 0; i < count; i++)
     {
-        tcp_close(tpcb);
-        return ERR_OK;
+        total += tasks[i].usStackHighWaterMark;
     }
+    if (total == last_total)
+    {
+        return;
+    }
+    last_total = total;
+    printf("Pilha livre mínima (palavras):");
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+        printf(" %s=%u", tasks[i].pcTaskName, (unsigned)tasks[i].usStackHighWaterMark);
+    }
+    printf("\n");
+}
 
-    char *req = (char *)p->payload;
-    struct http_state *hs = malloc(sizeof(struct http_state));
-    if (!hs)
+// Chamada pelo kernel quando uma task passa do fim da pilha: a memória vizinha já pode estar corrompida,
+// então o sistema para mostrando qual task estourou
+void vApplicationStackOverflowHook(TaskHandle_t task, char *name)
+{
+    (void)task;
+    panic("Estouro de pilha na task %s", name);
+}
+
+// Identifica a rota pelo tamanho do caminho: no máximo duas comparações, qualquer que seja o número de rotas
+static http_route_t http_route(const http_parser_t *req)
+{
+    const char *path = req->path;
+    bool get = req->method == HTTP_METHOD_GET || req->method == HTTP_METHOD_HEAD; // HEAD tem as rotas do GET
+    switch (req->path_len)
     {
-        pbuf_free(p);
-        tcp_close(tpcb);
-        return ERR_MEM;
+    case 1:
+        return get && path[0] == '/' ? HTTP_ROUTE_PAGE : HTTP_ROUTE_NOT_FOUND;
+    case 7:
+        return get && memcmp(path, "/estado", 7) == 0 ? HTTP_ROUTE_ESTADO : HTTP_ROUTE_NOT_FOUND;
+    case 8:
+        if (get && memcmp(path, "/eventos", 8) == 0)
+            return HTTP_ROUTE_EVENTOS;
+        if (req->method == HTTP_METHOD_POST && memcmp(path, "/limites", 8) == 0)
+            return HTTP_ROUTE_LIMITES;
+        return HTTP_ROUTE_NOT_FOUND;
+    case 9:
+        if (get && memcmp(path, "/bomba/on", 9) == 0)
+            return HTTP_ROUTE_BOMBA_ON;
+        if (memcmp(path, "/calibrar", 9) == 0)
+            return get ? HTTP_ROUTE_CALIBRAR_ESTADO : req->method == HTTP_METHOD_POST ? HTTP_ROUTE_CALIBRAR : HTTP_ROUTE_NOT_FOUND;
+        return HTTP_ROUTE_NOT_FOUND;
+    case 10:
+        if (get && memcmp(path, "/bomba/off", 10) == 0)
+            return HTTP_ROUTE_BOMBA_OFF;
+        if (get && memcmp(path, "/historico", 10) == 0)
+            return HTTP_ROUTE_HISTORICO;
+        return HTTP_ROUTE_NOT_FOUND;
+    default:
+        return HTTP_ROUTE_NOT_FOUND;
     }
-    hs->sent = 0;
+}
 
-    if (strstr(req, "GET /bomba/on")){
-        estado_bomba = true;// Coloca o estado da bomba como verdadeira(Ligada)
+// Roteia uma requisição completa e prepara a resposta no slot
+static void http_handle_request(struct http_state *hs, const http_parser_t *req)
+{
+    switch (http_route(req))
+    {
+    case HTTP_ROUTE_BOMBA_ON:
+    {
+        if (!hs->head){ // HEAD só consulta, não aciona a bomba
+            estado_bomba = true;// Coloca o estado da bomba como verdadeira(Ligada)
+        }
 
         const char *txt = "Bomba Ligada";
-        hs->len = snprintf(hs->response, sizeof(hs->response),
-                        "HTTP/1.1 200 OK\r\n"
-                        "Content-Type: text/plain\r\n"
-                        "Content-Length: %d\r\n"
-                        "Connection: close\r\n"
-                        "\r\n"
-                        "%s",
-                        (int)strlen(txt), txt);
-    }
-    else if (strstr(req, "GET /bomba/off")){
-        estado_bomba = false; // Coloca o estado da bomba como false(Desligada)
+        http_reply_small(hs, "200 OK", "text/plain", txt, strlen(txt));
+        break;
+    }
+    case HTTP_ROUTE_BOMBA_OFF:
+    {
+        if (!hs->head){
+            estado_bomba = false; // Coloca o estado da bomba como false(Desligada)
+        }
 
         const char *txt = "Bomba Desligada";
-        hs->len = snprintf(hs->response, sizeof(hs->response),
-                        "HTTP/1.1 200 OK\r\n"
-                        "Content-Type: text/plain\r\n"
-                        "Content-Length: %d\r\n"
-                        "Connection: close\r\n"
-                        "\r\n"
-                        "%s",
-                        (int)strlen(txt), txt);
+        http_reply_small(hs, "200 OK", "text/plain", txt, strlen(txt));
+        break;
     }
-    else if (strstr(req, "GET /estado")){  // Se a requisição for para obter o estado dos sensores(potenciometro com boia)
-
-        int nivel_agua;
-        if(xSemaphoreTake(xMutexWaterLevelJson, portMAX_DELAY)) {
-            nivel_agua =  water_level_percentege_json;
-            xSemaphoreGive(xMutexWaterLevelJson);
-        }
+    case HTTP_ROUTE_ESTADO: // Estado dos sensores(potenciometro com boia)
+    {
+        level_sample_t nivel;
+        level_bus_peek(&water_level_bus, &nivel); // Último nível combinado, lido sem lock do outro núcleo
+        int nivel_agua = nivel.value;
 
-        int min_limit, max_limit;
-        if(xSemaphoreTake(xMutexLimites, portMAX_DELAY)){  
-            min_limit = min_water_level_limit;
-            max_limit = max_water_level_limit;
-            xSemaphoreGive(xMutexLimites);
-        }
+        uint32_t limits = water_level_limits;
+        int min_limit = limits & 0xFF;
+        int max_limit = limits >> 8;
 
         int estado_bomba_para_json = estado_bomba;
         char json_payload[96]; // Buffer para a string JSON
         int json_len = snprintf(json_payload, sizeof(json_payload),
                                  "{\"bomba_agua\":%d,\"nivel_agua\":%d, \"limite_maximo\":%d,\"limite_minimo\":%d}\r\n",
                                  estado_bomba_para_json, nivel_agua, 
-                                 max_water_level_limit, min_limit); // Enviando como 'nivel_agua', estado'bomba_agua', limite 'max' e 'min'
-         hs->len = snprintf(hs->response, sizeof(hs->response),
-                           "HTTP/1.1 200 OK\r\n"
-                           "Content-Type: application/json\r\n"
-                           "Content-Length: %d\r\n"
-                           "Connection: close\r\n"
-                           "\r\n"
-                           "%s",
-                           json_len, json_payload);
-
-    }
-    else if (strstr(req, "POST /limites")) { // Para mudar os valores do limite no codigo atraves do webserver
-        char *body = strstr(req, "\r\n\r\n");
-        if(body) {
-            body += 4;
-            
-            // Extrai os valores diretamente usando sscanf
-            int max_val, min_val;
-            if(sscanf(body, "{\"max\":%d,\"min\":%d", &max_val, &min_val) == 2) {
-                // Valida os valores recebidos
-                if(max_val >= 0 && max_val <= 100 && min_val >= 0 && min_val <= 100) {
-                    if(xSemaphoreTake(xMutexLimites, portMAX_DELAY) == pdTRUE){
-                        max_water_level_limit = max_val;
-                        min_water_level_limit = min_val;
-                        printf("Novos limites: Max=%d, Min=%d\n", 
-                                max_water_level_limit, 
-                                min_water_level_limit); 
-                        xSemaphoreGive(xMutexLimites);
-                    }
-                }
+                                 max_limit, min_limit); // Enviando como 'nivel_agua', estado'bomba_agua', limite 'max' e 'min'
+        http_reply_small(hs, "200 OK", "application/json", json_payload, json_len);
+        break;
+    }
+    case HTTP_ROUTE_EVENTOS: // Canal de eventos: substitui a consulta periódica a /estado
+        http_reply_events(hs);
+        break;
+    case HTTP_ROUTE_HISTORICO: // Histórico: ?minutos=N&ate=M&pontos=P&formato=json (padrão: última hora, em binário)
+    {
+        // Intervalo de N minutos terminando M minutos atrás. A resolução é a mais fina que ainda guarda
+        // o intervalo, reduzida até caber em P registros se 'pontos' for informado
+        size_t len;
+        const char *value = http_parser_query(req, "formato", &len);
+        bool json = value && len == 4 && memcmp(value, "json", 4) == 0;
+        value = http_parser_query(req, "minutos", &len);
+        uint32_t minutes = value ? strtoul(value, NULL, 10) : HISTORY_DEFAULT_MINUTES;
+        value = http_parser_query(req, "ate", &len);
+        uint32_t ago = value ? strtoul(value, NULL, 10) : 0;
+        value = http_parser_query(req, "pontos", &len);
+        uint32_t points = value ? strtoul(value, NULL, 10) : 0;
+
+        uint32_t now = to_ms_since_boot(get_absolute_time());
+        uint32_t to_ms = ago <= now / 60000 ? now - ago * 60000 : 0; // Minutos antes do boot: intervalo vazio
+        uint32_t from_ms = minutes <= to_ms / 60000 ? to_ms - minutes * 60000 : 0;
+        timeseries_range_t range;
+        timeseries_query(&history, from_ms, to_ms, points, &range);
+
+        // Só a posição do codificador fica no slot, o corpo é gerado enquanto é enviado
+        http_reply_history(hs, &history, json ? TIMESERIES_FORMAT_JSON : TIMESERIES_FORMAT_BINARY, &range);
+        break;
+    }
+    case HTTP_ROUTE_LIMITES: // Para mudar os valores do limite no codigo atraves do webserver
+    {
+        // O parser só entrega a requisição com o corpo inteiro, mesmo que ele chegue em outro segmento
+        int max_val, min_val;
+        if(sscanf(req->body, "{\"max\":%d,\"min\":%d", &max_val, &min_val) == 2) {
+            // Valida os valores recebidos
+            if(max_val >= 0 && max_val <= 100 && min_val >= 0 && min_val <= 100) {
+                water_level_limits = PACK_LIMITS(min_val, max_val); // Troca o par inteiro de uma vez
+                uint8_t limits[2] = {min_val, max_val};
+                flash_log_set(&flash_store, FLASH_KEY_LIMITS, limits, sizeof(limits)); // Persistido pela vFlashLogTask
+                printf("Novos limites: Max=%d, Min=%d\n", max_val, min_val);
             }
         }
         
         // Confirma atualização
         const char *txt = "Limites atualizados";
-        hs->len = snprintf(hs->response, sizeof(hs->response),
-                        "HTTP/1.1 200 OK\r\n"
-                        "Content-Type: text/plain\r\n"
-                        "Content-Length: %d\r\n"
-                        "\r\n"
-                        "%s",
-                        (int)strlen(txt), txt);
-    }
-    else{// So atualiza a página caso nada tenha ocorrido
-        hs->len = snprintf(hs->response, sizeof(hs->response),
-                           "HTTP/1.1 200 OK\r\n"
-                           "Content-Type: text/html\r\n"
-                           "Content-Length: %d\r\n"
-                           "Connection: close\r\n"
-                           "\r\n"
-                           "%s",
-                           (int)strlen(html_data), html_data);
-    }
-
-    tcp_arg(tpcb, hs);
-    tcp_sent(tpcb, http_sent);
-
-    tcp_write(tpcb, hs->response, hs->len, TCP_WRITE_FLAG_COPY);
-    tcp_output(tpcb);
-
-    pbuf_free(p);
-    return ERR_OK;
-}
-
-// Função de callback para aceitar conexões TCP
-static err_t connection_callback(void *arg, struct tcp_pcb *newpcb, err_t err)
-{
-    tcp_recv(newpcb, http_recv);
-    return ERR_OK;
+        http_reply_small(hs, "200 OK", "text/plain", txt, strlen(txt));
+        break;
+    }
+    case HTTP_ROUTE_CALIBRAR: // Grava a leitura atual dos sensores como o nível informado: {"nivel":N}, -1 volta ao padrão
+    {
+        int nivel;
+        if (sscanf(req->body, "{\"nivel\":%d", &nivel) != 1 || nivel < CALIBRATION_RESTORE || nivel > 100){
+            const char *txt = "Nivel invalido";
+            http_reply_small(hs, "400 Bad Request", "text/plain", txt, strlen(txt));
+            break;
+        }
+        // A curva é ajustada pela vLevelFusionTask no próximo período, fora da thread do lwIP
+        calibration_request = nivel;
+        const char *txt = "Calibracao agendada";
+        http_reply_small(hs, "202 Accepted", "text/plain", txt, strlen(txt));
+        break;
+    }
+    case HTTP_ROUTE_CALIBRAR_ESTADO: // Pontos em vigor e leitura atual de cada sensor, para conferir antes de gravar
+    {
+        const sensor_calibration_t *sensors[] = {&potentiometer_cal, &ultrasonic_cal};
+        char json_payload[240]; // Dois sensores com CALIBRATION_MAX_POINTS pontos cabem
+        int json_len = 0;
+        for (int s = 0; s < 2; s++){
+            const calibration_t *cal = sensors[s]->active;
+            json_len += snprintf(json_payload + json_len, sizeof(json_payload) - json_len, "%s\"%s\":{\"leitura\":%u,\"pontos\":[",
+                                 s ? "," : "{", sensors[s]->name, sensors[s]->raw);
+            for (int i = 0; i < cal->num_points; i++){
+                json_len += snprintf(json_payload + json_len, sizeof(json_payload) - json_len, "%s[%u,%u]",
+                                     i ? "," : "", cal->points[i].raw, cal->points[i].percent);
+            }
+            json_len += snprintf(json_payload + json_len, sizeof(json_payload) - json_len, "]}");
+        }
+        json_len += snprintf(json_payload + json_len, sizeof(json_payload) - json_len, "}\r\n");
+        http_reply_small(hs, "200 OK", "application/json", json_payload, json_len);
+        break;
+    }
+    case HTTP_ROUTE_PAGE:
+        // Cabeçalho pré-calculado e página referenciada direto da flash, nada é copiado.
+        // Se o navegador já tem esta versão, responde só 304
+        if (strstr(req->if_none_match, HTML_DATA_ETAG_ID)){
+            hs->header = req->accept_gzip ? html_not_modified_gz[hs->keep_alive] : html_not_modified[hs->keep_alive];
+            hs->header_len = req->accept_gzip ? html_not_modified_gz_len[hs->keep_alive] : html_not_modified_len[hs->keep_alive];
+            hs->body = NULL;
+            hs->body_len = 0;
+        }
+        else if (req->accept_gzip){
+            hs->header = html_header_gz[hs->keep_alive];
+            hs->header_len = html_header_gz_len[hs->keep_alive];
+            hs->body = (const char *)html_data_gz;
+            hs->body_len = sizeof(html_data_gz);
+        }
+        else{
+            hs->header = html_header[hs->keep_alive];
+            hs->header_len = html_header_len[hs->keep_alive];
+            hs->body = html_data;
+            hs->body_len = sizeof(html_data) - 1;
+        }
+        break;
+    default:
+    {
+        const char *txt = "Nao encontrado";
+        http_reply_small(hs, "404 Not Found", "text/plain", txt, strlen(txt));
+        break;
+    }
+    }
 }
 
 // Função para iniciar o servidor HTTP
 static void start_http_server(void)
 {
-    struct tcp_pcb *pcb = tcp_new();
-    if (!pcb)
+    // Os cabeçalhos da página não mudam, são montados uma única vez
+    for (int keep_alive = 0; keep_alive < 2; keep_alive++)
     {
-        printf("Erro ao criar PCB TCP\n");
-        return;
-    }
-    if (tcp_bind(pcb, IP_ADDR_ANY, 80) != ERR_OK)
-    {
-        printf("Erro ao ligar o servidor na porta 80\n");
-        return;
+        html_header_len[keep_alive] = http_build_header(html_header[keep_alive], "200 OK", NULL, HTML_DATA_ETAG, sizeof(html_data) - 1, keep_alive);
+        html_header_gz_len[keep_alive] = http_build_header(html_header_gz[keep_alive], "200 OK", "gzip", HTML_DATA_GZ_ETAG, sizeof(html_data_gz), keep_alive);
+        html_not_modified_len[keep_alive] = http_build_header(html_not_modified[keep_alive], "304 Not Modified", NULL, HTML_DATA_ETAG, -1, keep_alive);
+        html_not_modified_gz_len[keep_alive] = http_build_header(html_not_modified_gz[keep_alive], "304 Not Modified", NULL, HTML_DATA_GZ_ETAG, -1, keep_alive);
     }
-    pcb = tcp_listen(pcb);
-    tcp_accept(pcb, connection_callback);
-    printf("Servidor HTTP rodando na porta 80...\n");
-}
 
+    http_server_start(80, http_handle_request);
+}
@@ -0,0 +1,104 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "pico/flash.h"
+
+// Flash emulada em arquivo, para o conteúdo sobreviver a um "reinício" como na placa
+
+uint8_t *host_flash;
+int64_t host_flash_budget = -1;
+bool host_flash_dead;
+uint32_t host_flash_fail_ops;
+uint32_t host_flash_erases[PICO_FLASH_SIZE_BYTES / FLASH_SECTOR_SIZE];
+
+static int flash_fd = -1;
+
+static void flash_map(void)
+{
+    host_flash = mmap(NULL, PICO_FLASH_SIZE_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, flash_fd, 0);
+    if (host_flash == MAP_FAILED)
+    {
+        perror("mmap");
+        exit(1);
+    }
+}
+
+void host_flash_open(const char *path)
+{
+    if (host_flash)
+    {
+        munmap(host_flash, PICO_FLASH_SIZE_BYTES);
+        close(flash_fd);
+    }
+    flash_fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (flash_fd < 0 || ftruncate(flash_fd, PICO_FLASH_SIZE_BYTES))
+    {
+        perror(path);
+        exit(1);
+    }
+    flash_map();
+    memset(host_flash, 0xFF, PICO_FLASH_SIZE_BYTES);
+    memset(host_flash_erases, 0, sizeof(host_flash_erases));
+    host_flash_budget = -1;
+    host_flash_dead = false;
+    host_flash_fail_ops = 0;
+}
+
+void host_flash_reboot(void)
+{
+    msync(host_flash, PICO_FLASH_SIZE_BYTES, MS_SYNC);
+    munmap(host_flash, PICO_FLASH_SIZE_BYTES);
+    flash_map();
+    host_flash_budget = -1;
+    host_flash_dead = false;
+    host_flash_fail_ops = 0;
+}
+
+// Consome um byte do que resta de energia. Retorna false se ela acabou
+static bool flash_power(void)
+{
+    if (host_flash_dead)
+        return false;
+    if (host_flash_budget == 0)
+    {
+        host_flash_dead = true;
+        return false;
+    }
+    if (host_flash_budget > 0)
+        host_flash_budget--;
+    return true;
+}
+
+void flash_range_erase(uint32_t flash_offs, size_t count)
+{
+    if (!flash_power())
+        return;
+    memset(host_flash + flash_offs, 0xFF, count);
+    for (size_t s = flash_offs / FLASH_SECTOR_SIZE; s < (flash_offs + count) / FLASH_SECTOR_SIZE; s++)
+        host_flash_erases[s]++;
+}
+
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!flash_power())
+            return;
+        host_flash[flash_offs + i] &= data[i];
+    }
+}
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms)
+{
+    (void)enter_exit_timeout_ms;
+    if (host_flash_fail_ops)
+    {
+        host_flash_fail_ops--;
+        return PICO_ERROR_TIMEOUT;
+    }
+    func(param);
+    return PICO_OK;
+}
@@ -0,0 +1,369 @@
+#include "hardware/pwm.h"
+#include "hardware/clocks.h"
+#include "hardware/i2c.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/gpio.h"
+#include "hardware/adc.h"
+#include "hardware/pio.h"
+
+// Periféricos emulados para os testes que usam PWM, alarmes, GPIO, I2C, DMA, ADC e PIO
+
+host_pwm_slice_t host_pwm[HOST_PWM_SLICES];
+uint32_t host_clk_sys_hz = 125000000;
+
+// Último alarme agendado, disparado pelo teste com host_alarm_fire
+alarm_callback_t host_alarm_callback;
+void *host_alarm_user_data;
+uint32_t host_alarm_count;
+
+pwm_config pwm_get_default_config(void)
+{
+    pwm_config config = {1.0f};
+    return config;
+}
+
+void pwm_config_set_clkdiv(pwm_config *config, float div)
+{
+    config->clkdiv = div;
+}
+
+void pwm_init(uint slice_num, pwm_config *config, bool start)
+{
+    (void)start;
+    host_pwm[slice_num].div_int = (uint8_t)config->clkdiv;
+    host_pwm[slice_num].div_frac = 0;
+    host_pwm[slice_num].wrap = 0xFFFF;
+}
+
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract)
+{
+    host_pwm[slice_num].div_int = integer;
+    host_pwm[slice_num].div_frac = fract;
+}
+
+void pwm_set_wrap(uint slice_num, uint16_t wrap)
+{
+    host_pwm[slice_num].wrap = wrap;
+}
+
+void pwm_set_gpio_level(uint gpio, uint16_t level)
+{
+    host_pwm[pwm_gpio_to_slice_num(gpio)].level = level;
+}
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    return add_alarm_in_us((uint64_t)ms * 1000, callback, user_data, fire_if_past);
+}
+
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past)
+{
+    (void)us;
+    (void)fire_if_past;
+    host_alarm_callback = callback;
+    host_alarm_user_data = user_data;
+    host_alarm_count++;
+    return 1;
+}
+
+bool cancel_alarm(alarm_id_t alarm_id)
+{
+    (void)alarm_id;
+    host_alarm_callback = NULL;
+    return true;
+}
+
+// GPIO
+bool host_gpio_level[HOST_GPIO_PINS];
+uint32_t host_gpio_irq_events[HOST_GPIO_PINS];
+static host_gpio_irq_handler_t gpio_handlers[HOST_GPIO_IRQ_HANDLERS];
+static uint8_t gpio_handler_count;
+
+void gpio_add_raw_irq_handler_masked(uint32_t gpio_mask, host_gpio_irq_handler_t handler)
+{
+    (void)gpio_mask;
+    if (gpio_handler_count < HOST_GPIO_IRQ_HANDLERS)
+        gpio_handlers[gpio_handler_count++] = handler;
+}
+
+void host_gpio_irq(void)
+{
+    for (uint8_t i = 0; i < gpio_handler_count; i++)
+        gpio_handlers[i]();
+}
+
+// I2C: FIFO de transmissão sempre vazia e barramento parado
+static uint32_t host_i2c_clr_tx_abrt(void);
+
+static i2c_hw_t host_i2c0_hw = {
+    .status = I2C_IC_STATUS_TFE_BITS | I2C_IC_STATUS_TFNF_BITS,
+    .clr_tx_abrt_read = host_i2c_clr_tx_abrt,
+};
+i2c_inst_t host_i2c0 = {&host_i2c0_hw};
+uint32_t host_i2c_abort_clears;
+uint32_t host_i2c_blocking_bytes;
+
+static uint32_t host_i2c_clr_tx_abrt(void)
+{
+    host_i2c0_hw.raw_intr_stat &= ~I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS;
+    host_i2c_abort_clears++;
+    return 0;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop)
+{
+    (void)i2c;
+    (void)addr;
+    (void)src;
+    (void)nostop;
+    host_i2c_blocking_bytes += len;
+    return (int)len;
+}
+
+// DMA
+host_dma_channel_t host_dma[HOST_DMA_CHANNELS];
+uint16_t host_wire[HOST_WIRE_WORDS];
+size_t host_wire_len;
+irq_handler_t host_dma_irq0_handler;
+irq_handler_t host_dma_irq1_handler;
+
+void host_dma_complete(uint channel)
+{
+    host_dma_channel_t *ch = &host_dma[channel];
+    if (!ch->busy)
+        return;
+
+    // Com o abort pendente o I2C mantém a FIFO esvaziada: o DMA termina, mas nada vai para o fio
+    i2c_hw_t *i2c = host_i2c0.hw;
+    const uint16_t *words = (const uint16_t *)ch->read_addr;
+    for (uint32_t i = ch->transferred; i < ch->count; i++)
+    {
+        // Para a FIFO de uma state machine vão palavras de 32 bits
+        if (host_pio_fifo_write(ch->write_addr, ((const uint32_t *)ch->read_addr)[i]))
+            continue;
+        if (ch->write_addr == &i2c->data_cmd && !(i2c->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS) &&
+            host_wire_len < HOST_WIRE_WORDS)
+            host_wire[host_wire_len++] = words[i];
+    }
+    ch->transferred = ch->count;
+    ch->busy = false;
+
+    // O encadeamento dispara o próximo canal no mesmo instante em que este termina
+    if (ch->chain_to >= 0 && ch->chain_to != (int)channel)
+        dma_channel_start(ch->chain_to);
+
+    if (ch->irq0_enabled)
+    {
+        ch->irq0_status = true;
+        if (host_dma_irq0_handler)
+            host_dma_irq0_handler();
+    }
+    if (ch->irq1_enabled)
+    {
+        ch->irq1_status = true;
+        if (host_dma_irq1_handler)
+            host_dma_irq1_handler();
+    }
+}
+
+int dma_claim_unused_channel(bool required)
+{
+    (void)required;
+    for (int i = 0; i < HOST_DMA_CHANNELS; i++)
+    {
+        if (!host_dma[i].claimed)
+        {
+            host_dma[i].claimed = true;
+            return i;
+        }
+    }
+    return -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    dma_channel_config c = {0, (int)channel}; // Como no pico-sdk: encadeado a si mesmo, ou seja, sem encadeamento
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size)
+{
+    c->ctrl = (c->ctrl & ~3u) | size;
+}
+
+void channel_config_set_read_increment(dma_channel_config *c, bool incr)
+{
+    (void)c;
+    (void)incr;
+}
+
+void channel_config_set_write_increment(dma_channel_config *c, bool incr)
+{
+    (void)c;
+    (void)incr;
+}
+
+void channel_config_set_dreq(dma_channel_config *c, uint dreq)
+{
+    (void)c;
+    (void)dreq;
+}
+
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to)
+{
+    c->chain_to = (int)chain_to;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+    host_dma[channel].chain_to = config->chain_to;
+    host_dma[channel].write_addr = write_addr;
+    host_dma[channel].read_addr = read_addr;
+    host_dma[channel].count = transfer_count;
+    if (trigger)
+        dma_channel_transfer_from_buffer_now(channel, read_addr, transfer_count);
+}
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count)
+{
+    host_dma[channel].read_addr = read_addr;
+    host_dma[channel].count = transfer_count;
+    dma_channel_start(channel);
+}
+
+void dma_channel_start(uint channel)
+{
+    host_dma[channel].transferred = 0;
+    host_dma[channel].busy = true;
+    host_dma[channel].transfers++;
+}
+
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger)
+{
+    host_dma[channel].write_addr = write_addr;
+    if (trigger)
+        dma_channel_start(channel);
+}
+
+void dma_channel_set_irq0_enabled(uint channel, bool enabled)
+{
+    host_dma[channel].irq0_enabled = enabled;
+}
+
+// Esperar o fim de uma transferência é deixá-la terminar
+void dma_channel_wait_for_finish_blocking(uint channel)
+{
+    host_dma_complete(channel);
+}
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled)
+{
+    host_dma[channel].irq1_enabled = enabled;
+}
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority)
+{
+    (void)order_priority;
+    if (num == DMA_IRQ_0)
+        host_dma_irq0_handler = handler;
+    else if (num == DMA_IRQ_1)
+        host_dma_irq1_handler = handler;
+}
+
+// ADC
+adc_hw_t host_adc_hw;
+float host_adc_clkdiv;
+bool host_adc_running;
+uint host_adc_input;
+
+void host_adc_push(uint16_t sample)
+{
+    if (!host_adc_running)
+        return;
+    for (uint c = 0; c < HOST_DMA_CHANNELS; c++)
+    {
+        host_dma_channel_t *ch = &host_dma[c];
+        if (ch->busy && ch->read_addr == &host_adc_hw.fifo)
+        {
+            ((volatile uint16_t *)ch->write_addr)[ch->transferred++] = sample;
+            if (ch->transferred == ch->count)
+                host_dma_complete(c);
+            return;
+        }
+    }
+    // Nenhum canal lendo a FIFO: a amostra fica na FIFO e é perdida
+}
+
+// PIO
+pio_hw_t host_pio_hw[NUM_PIOS];
+host_pio_sm_t host_pio_sm[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+uint host_pio_used[NUM_PIOS];
+
+bool host_pio_fifo_write(volatile void *addr, uint32_t word)
+{
+    for (uint p = 0; p < NUM_PIOS; p++)
+    {
+        for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+        {
+            if (addr != &host_pio_hw[p].txf[sm])
+                continue;
+            host_pio_sm_t *state = &host_pio_sm[p][sm];
+            if (state->fifo_len < HOST_PIO_FIFO_WORDS)
+                state->fifo[state->fifo_len++] = word;
+            return true;
+        }
+    }
+    return false;
+}
+
+void host_pio_fifo_clear(PIO pio, uint sm)
+{
+    host_pio_sm[pio_get_index(pio)][sm].fifo_len = 0;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program)
+{
+    return host_pio_used[pio_get_index(pio)] + program->length <= PIO_INSTRUCTION_COUNT;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program)
+{
+    uint offset = host_pio_used[pio_get_index(pio)];
+    host_pio_used[pio_get_index(pio)] += program->length;
+    return offset;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required)
+{
+    (void)required;
+    for (uint sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++)
+    {
+        if (!host_pio_sm[pio_get_index(pio)][sm].claimed)
+        {
+            host_pio_sm[pio_get_index(pio)][sm].claimed = true;
+            return (int)sm;
+        }
+    }
+    return -1;
+}
+
+void pio_sm_unclaim(PIO pio, uint sm)
+{
+    host_pio_sm[pio_get_index(pio)][sm].claimed = false;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config)
+{
+    host_pio_sm_t *state = &host_pio_sm[pio_get_index(pio)][sm];
+    state->offset = initial_pc;
+    state->config = *config;
+    state->enabled = false;
+    state->fifo_len = 0;
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled)
+{
+    host_pio_sm[pio_get_index(pio)][sm].enabled = enabled;
+}
@@ -0,0 +1,65 @@
+#ifndef HOST_HARDWARE_ADC_H
+#define HOST_HARDWARE_ADC_H
+
+// ADC emulado: guarda a configuração para o teste conferir. As amostras são entregues pelo teste
+// com host_adc_push, que as passa ao canal DMA que estiver lendo a FIFO
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    uint32_t fifo;
+} adc_hw_t;
+
+extern adc_hw_t host_adc_hw;
+#define adc_hw (&host_adc_hw)
+
+extern float host_adc_clkdiv;
+extern bool host_adc_running;
+extern uint host_adc_input;
+
+// Uma conversão concluída: vai para o canal DMA ativo, como o DREQ_ADC faria
+void host_adc_push(uint16_t sample);
+
+static inline void adc_init(void)
+{
+}
+
+static inline void adc_gpio_init(uint gpio)
+{
+    (void)gpio;
+}
+
+static inline void adc_select_input(uint input)
+{
+    host_adc_input = input;
+}
+
+static inline void adc_set_round_robin(uint input_mask)
+{
+    (void)input_mask;
+}
+
+static inline void adc_fifo_setup(bool en, bool dreq_en, uint16_t dreq_thresh, bool err_in_fifo, bool byte_shift)
+{
+    (void)en;
+    (void)dreq_en;
+    (void)dreq_thresh;
+    (void)err_in_fifo;
+    (void)byte_shift;
+}
+
+static inline void adc_set_clkdiv(float clkdiv)
+{
+    host_adc_clkdiv = clkdiv;
+}
+
+static inline void adc_fifo_drain(void)
+{
+}
+
+static inline void adc_run(bool run)
+{
+    host_adc_running = run;
+}
+
+#endif // HOST_HARDWARE_ADC_H
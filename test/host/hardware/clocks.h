@@ -0,0 +1,20 @@
+#ifndef HOST_HARDWARE_CLOCKS_H
+#define HOST_HARDWARE_CLOCKS_H
+
+// Clock do sistema ajustável pelo teste em host_clk_sys_hz. O do ADC é sempre 48 MHz, vindo da USB PLL
+
+#include "pico/stdlib.h"
+
+enum clock_index {
+    clk_sys = 5,
+    clk_adc = 7
+};
+
+extern uint32_t host_clk_sys_hz;
+
+static inline uint32_t clock_get_hz(enum clock_index clk_index)
+{
+    return clk_index == clk_adc ? 48000000 : host_clk_sys_hz;
+}
+
+#endif // HOST_HARDWARE_CLOCKS_H
@@ -0,0 +1,92 @@
+#ifndef HOST_HARDWARE_DMA_H
+#define HOST_HARDWARE_DMA_H
+
+// DMA emulado. Para o I2C: uma transferência iniciada fica pendente até o teste chamar
+// host_dma_complete, ou até o código esperar por ela. Ao terminar, as palavras lidas vão para o fio
+// do I2C emulado (host_wire) e a interrupção IRQ1 é sinalizada ao tratador registrado.
+// Para o ADC: cada host_adc_push escreve uma amostra no canal ativo; ao completar, ele dispara o
+// canal encadeado e sinaliza a IRQ0
+
+#include "pico/stdlib.h"
+
+#define HOST_DMA_CHANNELS 12
+#define HOST_WIRE_WORDS 4096
+
+enum dma_channel_transfer_size {
+    DMA_SIZE_8 = 0,
+    DMA_SIZE_16 = 1,
+    DMA_SIZE_32 = 2
+};
+
+#define DREQ_ADC 36
+
+typedef struct {
+    uint32_t ctrl;
+    int chain_to; // -1: sem encadeamento
+} dma_channel_config;
+
+typedef struct {
+    bool claimed;
+    bool busy;
+    bool irq0_enabled;
+    bool irq0_status;
+    bool irq1_enabled;
+    bool irq1_status;
+    volatile void *write_addr;
+    const volatile void *read_addr;
+    uint32_t count;
+    uint32_t transferred; // Itens já transferidos na transferência atual
+    int chain_to;
+    uint32_t transfers;   // Transferências iniciadas
+} host_dma_channel_t;
+
+extern host_dma_channel_t host_dma[HOST_DMA_CHANNELS];
+
+// Palavras que chegaram ao data_cmd do I2C: as descartadas pelo abort não entram
+extern uint16_t host_wire[HOST_WIRE_WORDS];
+extern size_t host_wire_len;
+
+void host_dma_complete(uint channel);
+
+int dma_claim_unused_channel(bool required);
+dma_channel_config dma_channel_get_default_config(uint channel);
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size);
+void channel_config_set_read_increment(dma_channel_config *c, bool incr);
+void channel_config_set_write_increment(dma_channel_config *c, bool incr);
+void channel_config_set_dreq(dma_channel_config *c, uint dreq);
+void channel_config_set_chain_to(dma_channel_config *c, uint chain_to);
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger);
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count);
+void dma_channel_wait_for_finish_blocking(uint channel);
+void dma_channel_start(uint channel);
+void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger);
+void dma_channel_set_irq0_enabled(uint channel, bool enabled);
+void dma_channel_set_irq1_enabled(uint channel, bool enabled);
+
+static inline bool dma_channel_is_busy(uint channel)
+{
+    return host_dma[channel].busy;
+}
+
+static inline bool dma_channel_get_irq0_status(uint channel)
+{
+    return host_dma[channel].irq0_status;
+}
+
+static inline void dma_channel_acknowledge_irq0(uint channel)
+{
+    host_dma[channel].irq0_status = false;
+}
+
+static inline bool dma_channel_get_irq1_status(uint channel)
+{
+    return host_dma[channel].irq1_status;
+}
+
+static inline void dma_channel_acknowledge_irq1(uint channel)
+{
+    host_dma[channel].irq1_status = false;
+}
+
+#endif // HOST_HARDWARE_DMA_H
@@ -0,0 +1,34 @@
+#ifndef HOST_HARDWARE_FLASH_H
+#define HOST_HARDWARE_FLASH_H
+
+// Flash emulada sobre um arquivo mapeado em memória (host/flash.c), lida pelo "XIP" em host_flash.
+// Como na NOR, gravar só baixa bits e apagar volta o setor inteiro a 0xFF. O teste pode cortar a
+// energia depois de um número de bytes gravados e fazer operações falharem, como num tempo limite
+// de flash_safe_execute
+
+#include "pico/stdlib.h"
+
+#define FLASH_PAGE_SIZE 256u
+#define FLASH_SECTOR_SIZE 4096u
+#define PICO_FLASH_SIZE_BYTES (16 * FLASH_SECTOR_SIZE)
+
+extern uint8_t *host_flash;
+
+// Bytes que ainda podem ser gravados antes da falta de energia (cada apagamento conta um).
+// Negativo: sem limite. Ao chegar a zero a flash para de mudar e host_flash_dead fica true
+extern int64_t host_flash_budget;
+extern bool host_flash_dead;
+// Próximas chamadas a flash_safe_execute que falham sem executar nada
+extern uint32_t host_flash_fail_ops;
+// Apagamentos feitos em cada setor da flash
+extern uint32_t host_flash_erases[PICO_FLASH_SIZE_BYTES / FLASH_SECTOR_SIZE];
+
+// Abre (criando e apagando) o arquivo que guarda a flash
+void host_flash_open(const char *path);
+// Reinicia a placa: mapeia o arquivo de novo e religa a energia
+void host_flash_reboot(void);
+
+void flash_range_erase(uint32_t flash_offs, size_t count);
+void flash_range_program(uint32_t flash_offs, const uint8_t *data, size_t count);
+
+#endif // HOST_HARDWARE_FLASH_H
@@ -0,0 +1,80 @@
+#ifndef HOST_HARDWARE_GPIO_H
+#define HOST_HARDWARE_GPIO_H
+
+// GPIO emulado: o teste ajusta o nível de cada pino em host_gpio_level e as bordas pendentes em
+// host_gpio_irq_events, e chama host_gpio_irq para rodar os tratadores registrados
+
+#include "pico/stdlib.h"
+
+#define HOST_GPIO_PINS 30
+#define HOST_GPIO_IRQ_HANDLERS 4
+
+#define GPIO_IN false
+#define GPIO_OUT true
+
+enum gpio_irq_level {
+    GPIO_IRQ_LEVEL_LOW = 0x1u,
+    GPIO_IRQ_LEVEL_HIGH = 0x2u,
+    GPIO_IRQ_EDGE_FALL = 0x4u,
+    GPIO_IRQ_EDGE_RISE = 0x8u,
+};
+
+typedef void (*host_gpio_irq_handler_t)(void);
+
+extern bool host_gpio_level[HOST_GPIO_PINS];
+extern uint32_t host_gpio_irq_events[HOST_GPIO_PINS];
+
+// Roda os tratadores registrados, como a interrupção IO_IRQ_BANK0
+void host_gpio_irq(void);
+
+static inline void gpio_init(uint gpio)
+{
+    host_gpio_level[gpio] = false;
+}
+
+static inline void gpio_set_dir(uint gpio, bool out)
+{
+    (void)gpio;
+    (void)out;
+}
+
+static inline void gpio_pull_up(uint gpio)
+{
+    host_gpio_level[gpio] = true;
+}
+
+static inline bool gpio_get(uint gpio)
+{
+    return host_gpio_level[gpio];
+}
+
+static inline void gpio_put(uint gpio, bool value)
+{
+    host_gpio_level[gpio] = value;
+}
+
+static inline uint32_t gpio_get_irq_event_mask(uint gpio)
+{
+    return host_gpio_irq_events[gpio];
+}
+
+static inline void gpio_acknowledge_irq(uint gpio, uint32_t events)
+{
+    host_gpio_irq_events[gpio] &= ~events;
+}
+
+static inline void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled)
+{
+    (void)gpio;
+    (void)events;
+    (void)enabled;
+}
+
+void gpio_add_raw_irq_handler_masked(uint32_t gpio_mask, host_gpio_irq_handler_t handler);
+
+static inline void gpio_add_raw_irq_handler(uint gpio, host_gpio_irq_handler_t handler)
+{
+    gpio_add_raw_irq_handler_masked(1u << gpio, handler);
+}
+
+#endif // HOST_HARDWARE_GPIO_H
@@ -0,0 +1,51 @@
+#ifndef HOST_HARDWARE_I2C_H
+#define HOST_HARDWARE_I2C_H
+
+// I2C emulado para o driver do display: os registradores são campos comuns, o teste lê o que foi
+// escrito e injeta o abort em raw_intr_stat. A FIFO nunca enche e o barramento nunca fica ocupado
+
+#include "pico/stdlib.h"
+
+#define I2C_IC_DATA_CMD_STOP_BITS 0x00000200u
+#define I2C_IC_STATUS_ACTIVITY_BITS 0x00000001u
+#define I2C_IC_STATUS_TFNF_BITS 0x00000002u
+#define I2C_IC_STATUS_TFE_BITS 0x00000004u
+#define I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS 0x00000040u
+
+// No RP2040 ler IC_CLR_TX_ABRT limpa o abort. Aqui a leitura vira a chamada de host_i2c_clr_tx_abrt
+#define clr_tx_abrt clr_tx_abrt_read()
+
+typedef struct {
+    uint32_t tar;
+    uint32_t enable;
+    uint32_t status;
+    uint32_t raw_intr_stat;
+    uint32_t data_cmd;
+    uint32_t (*clr_tx_abrt_read)(void);
+} i2c_hw_t;
+
+typedef struct {
+    i2c_hw_t *hw;
+} i2c_inst_t;
+
+extern i2c_inst_t host_i2c0;
+#define i2c0 (&host_i2c0)
+
+// Vezes que o abort foi limpo e bytes enviados por i2c_write_blocking
+extern uint32_t host_i2c_abort_clears;
+extern uint32_t host_i2c_blocking_bytes;
+
+static inline i2c_hw_t *i2c_get_hw(i2c_inst_t *i2c)
+{
+    return i2c->hw;
+}
+
+static inline uint i2c_get_dreq(i2c_inst_t *i2c, bool is_tx)
+{
+    (void)i2c;
+    return is_tx ? 32 : 33;
+}
+
+int i2c_write_blocking(i2c_inst_t *i2c, uint8_t addr, const uint8_t *src, size_t len, bool nostop);
+
+#endif // HOST_HARDWARE_I2C_H
@@ -0,0 +1,27 @@
+#ifndef HOST_HARDWARE_IRQ_H
+#define HOST_HARDWARE_IRQ_H
+
+// Interrupções emuladas: só os tratadores compartilhados do DMA são guardados, chamados pelo DMA emulado.
+// Os tratadores do GPIO ficam em hardware/gpio.h
+
+#include "pico/stdlib.h"
+
+#define DMA_IRQ_0 11
+#define DMA_IRQ_1 12
+#define IO_IRQ_BANK0 13
+#define PICO_SHARED_IRQ_HANDLER_DEFAULT_ORDER_PRIORITY 0x80
+
+typedef void (*irq_handler_t)(void);
+
+extern irq_handler_t host_dma_irq0_handler;
+extern irq_handler_t host_dma_irq1_handler;
+
+void irq_add_shared_handler(uint num, irq_handler_t handler, uint8_t order_priority);
+
+static inline void irq_set_enabled(uint num, bool enabled)
+{
+    (void)num;
+    (void)enabled;
+}
+
+#endif // HOST_HARDWARE_IRQ_H
@@ -0,0 +1,141 @@
+#ifndef HOST_HARDWARE_PIO_H
+#define HOST_HARDWARE_PIO_H
+
+// PIO emulado: só a reserva de state machines e de espaço para programas e a configuração gravada.
+// As palavras que o DMA escreve em pio->txf[sm] vão para a FIFO de transmissão da state machine
+// (host_pio_sm[].fifo), que o teste lê como a state machine leria
+
+#include "pico/stdlib.h"
+
+#define NUM_PIOS 2
+#define NUM_PIO_STATE_MACHINES 4
+#define PIO_INSTRUCTION_COUNT 32
+#define HOST_PIO_FIFO_WORDS 1024
+
+enum pio_fifo_join {
+    PIO_FIFO_JOIN_NONE = 0,
+    PIO_FIFO_JOIN_TX = 1,
+    PIO_FIFO_JOIN_RX = 2
+};
+
+typedef struct {
+    volatile uint32_t txf[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+typedef pio_hw_t *PIO;
+
+extern pio_hw_t host_pio_hw[NUM_PIOS];
+
+#define pio0 (&host_pio_hw[0])
+#define pio1 (&host_pio_hw[1])
+
+typedef struct {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+typedef struct {
+    uint wrap_target;
+    uint wrap;
+    uint set_base;
+    uint set_count;
+    float clkdiv;
+    enum pio_fifo_join join;
+    bool out_shift_right;
+    bool autopull;
+    uint pull_threshold;
+    bool out_sticky;
+} pio_sm_config;
+
+typedef struct {
+    bool claimed;
+    bool enabled;
+    uint offset;             // Onde o programa começa
+    pio_sm_config config;    // Última configuração carregada por pio_sm_init
+    uint32_t fifo[HOST_PIO_FIFO_WORDS];
+    size_t fifo_len;         // Palavras recebidas desde o último host_pio_fifo_clear
+} host_pio_sm_t;
+
+extern host_pio_sm_t host_pio_sm[NUM_PIOS][NUM_PIO_STATE_MACHINES];
+extern uint host_pio_used[NUM_PIOS]; // Instruções ocupadas em cada bloco
+
+// Escreve uma palavra se 'addr' for a FIFO de transmissão de alguma state machine. Retorna false se não for
+bool host_pio_fifo_write(volatile void *addr, uint32_t word);
+void host_pio_fifo_clear(PIO pio, uint sm);
+
+static inline uint pio_get_index(PIO pio)
+{
+    return (uint)(pio - host_pio_hw);
+}
+
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx)
+{
+    return pio_get_index(pio) * 8 + (is_tx ? 0 : 4) + sm;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program);
+uint pio_add_program(PIO pio, const pio_program_t *program);
+int pio_claim_unused_sm(PIO pio, bool required);
+void pio_sm_unclaim(PIO pio, uint sm);
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+
+static inline void pio_gpio_init(PIO pio, uint pin)
+{
+    (void)pio;
+    (void)pin;
+}
+
+static inline void pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out)
+{
+    (void)pio;
+    (void)sm;
+    (void)pin_base;
+    (void)pin_count;
+    (void)is_out;
+}
+
+static inline pio_sm_config pio_get_default_sm_config(void)
+{
+    pio_sm_config c = {0, PIO_INSTRUCTION_COUNT - 1, 0, 0, 1.0f, PIO_FIFO_JOIN_NONE, true, false, 32, false};
+    return c;
+}
+
+static inline void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap)
+{
+    c->wrap_target = wrap_target;
+    c->wrap = wrap;
+}
+
+static inline void sm_config_set_set_pins(pio_sm_config *c, uint set_base, uint set_count)
+{
+    c->set_base = set_base;
+    c->set_count = set_count;
+}
+
+static inline void sm_config_set_clkdiv(pio_sm_config *c, float div)
+{
+    c->clkdiv = div;
+}
+
+static inline void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join)
+{
+    c->join = join;
+}
+
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold)
+{
+    c->out_shift_right = shift_right;
+    c->autopull = autopull;
+    c->pull_threshold = pull_threshold;
+}
+
+static inline void sm_config_set_out_special(pio_sm_config *c, bool sticky, bool has_enable_pin, uint enable_pin_index)
+{
+    (void)has_enable_pin;
+    (void)enable_pin_index;
+    c->out_sticky = sticky;
+}
+
+#endif // HOST_HARDWARE_PIO_H
@@ -0,0 +1,35 @@
+#ifndef HOST_HARDWARE_PWM_H
+#define HOST_HARDWARE_PWM_H
+
+// PWM emulado: cada slice só guarda os últimos valores escritos, para os testes conferirem
+
+#include "pico/stdlib.h"
+
+#define HOST_PWM_SLICES 8
+
+typedef struct {
+    float clkdiv;
+} pwm_config;
+
+typedef struct {
+    uint8_t div_int;
+    uint8_t div_frac;
+    uint16_t wrap;
+    uint16_t level;
+} host_pwm_slice_t;
+
+extern host_pwm_slice_t host_pwm[HOST_PWM_SLICES];
+
+static inline uint pwm_gpio_to_slice_num(uint gpio)
+{
+    return (gpio >> 1) & 7;
+}
+
+pwm_config pwm_get_default_config(void);
+void pwm_config_set_clkdiv(pwm_config *config, float div);
+void pwm_init(uint slice_num, pwm_config *config, bool start);
+void pwm_set_clkdiv_int_frac(uint slice_num, uint8_t integer, uint8_t fract);
+void pwm_set_wrap(uint slice_num, uint16_t wrap);
+void pwm_set_gpio_level(uint gpio, uint16_t level);
+
+#endif // HOST_HARDWARE_PWM_H
@@ -0,0 +1,11 @@
+#ifndef HOST_HARDWARE_REGS_ADDRESSMAP_H
+#define HOST_HARDWARE_REGS_ADDRESSMAP_H
+
+// O XIP aponta para a flash emulada
+
+#include <stdint.h>
+#include "hardware/flash.h"
+
+#define XIP_BASE ((uintptr_t)host_flash)
+
+#endif // HOST_HARDWARE_REGS_ADDRESSMAP_H
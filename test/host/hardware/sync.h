@@ -0,0 +1,7 @@
+#ifndef HOST_HARDWARE_SYNC_H
+#define HOST_HARDWARE_SYNC_H
+
+// Barreira de memória do RP2040 trocada pela do compilador
+#define __dmb() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#endif // HOST_HARDWARE_SYNC_H
@@ -0,0 +1,13 @@
+#ifndef HOST_HARDWARE_TIMER_H
+#define HOST_HARDWARE_TIMER_H
+
+// Espera ativa emulada: só avança o relógio do host
+
+#include "pico/stdlib.h"
+
+static inline void busy_wait_us_32(uint32_t delay_us)
+{
+    host_time_us += delay_us;
+}
+
+#endif // HOST_HARDWARE_TIMER_H
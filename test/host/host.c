@@ -0,0 +1,89 @@
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "task.h"
+#include "queue.h"
+
+// Estado global do suporte ao host, compartilhado por todos os testes
+
+int test_failures = 0;
+uint64_t host_time_us = 0;
+
+static host_task_t main_task;
+host_task_t *host_current_task = &main_task;
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return host_current_task;
+}
+
+BaseType_t xTaskNotifyGiveIndexed(TaskHandle_t task, UBaseType_t index)
+{
+    task->notify[index]++;
+    return pdTRUE;
+}
+
+uint32_t ulTaskNotifyTakeIndexed(UBaseType_t index, BaseType_t clear_on_exit, TickType_t timeout)
+{
+    (void)timeout;
+    uint32_t value = host_current_task->notify[index];
+    if (value)
+    {
+        host_current_task->notify[index] = clear_on_exit ? 0 : value - 1;
+    }
+    return value;
+}
+
+struct host_queue {
+    UBaseType_t length, item_size;
+    UBaseType_t head, count;
+    uint8_t *items;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    QueueHandle_t queue = calloc(1, sizeof(*queue));
+    queue->length = length;
+    queue->item_size = item_size;
+    queue->items = calloc(length, item_size);
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t timeout)
+{
+    (void)timeout;
+    if (queue->count == queue->length)
+    {
+        return pdFALSE;
+    }
+    memcpy(queue->items + ((queue->head + queue->count) % queue->length) * queue->item_size, item, queue->item_size);
+    queue->count++;
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higher_priority_task_woken)
+{
+    if (higher_priority_task_woken)
+    {
+        *higher_priority_task_woken = pdFALSE;
+    }
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t timeout)
+{
+    (void)timeout;
+    if (!queue->count)
+    {
+        return pdFALSE;
+    }
+    memcpy(item, queue->items + queue->head * queue->item_size, queue->item_size);
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return queue->count;
+}
@@ -0,0 +1,339 @@
+#include <stdlib.h>
+#include <string.h>
+#include "lwip/tcp.h"
+
+// API raw do lwIP emulada sobre PCBs estáticos e pbufs do heap (ver lwip/tcp.h)
+
+u16_t host_tcp_snd_buf = 2920; // TCP_SND_BUF com dois segmentos de 1460 bytes
+struct tcp_pcb *host_tcp_listener;
+u32_t host_tcp_ref_changed;
+u32_t host_pbuf_live;
+u32_t host_pbuf_bytes;
+u32_t host_pbuf_peak_bytes;
+
+static struct tcp_pcb pcbs[HOST_TCP_PCBS];
+static unsigned next_pcb; // PCBs encerrados são reaproveitados na ordem, o mais tarde possível
+
+static u32_t hash(const void *data, u16_t len)
+{
+    const u8_t *p = data;
+    u32_t h = 2166136261u;
+    for (u16_t i = 0; i < len; i++)
+        h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+void host_tcp_reset(void)
+{
+    memset(pcbs, 0, sizeof(pcbs));
+    next_pcb = 0;
+    host_tcp_listener = NULL;
+    host_tcp_ref_changed = 0;
+}
+
+struct tcp_pcb *tcp_new(void)
+{
+    for (unsigned n = 0; n < HOST_TCP_PCBS; n++)
+    {
+        struct tcp_pcb *pcb = &pcbs[(next_pcb + n) % HOST_TCP_PCBS];
+        if (!pcb->used || pcb->closed || pcb->aborted)
+        {
+            next_pcb = (next_pcb + n + 1) % HOST_TCP_PCBS;
+            memset(pcb, 0, sizeof(*pcb));
+            pcb->used = true;
+            pcb->snd_buf = host_tcp_snd_buf;
+            return pcb;
+        }
+    }
+    return NULL;
+}
+
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port)
+{
+    return ERR_OK;
+}
+
+struct tcp_pcb *tcp_listen(struct tcp_pcb *pcb)
+{
+    pcb->listening = true;
+    return pcb;
+}
+
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept)
+{
+    pcb->accept = accept;
+    host_tcp_listener = pcb;
+}
+
+void tcp_arg(struct tcp_pcb *pcb, void *arg)
+{
+    pcb->arg = arg;
+}
+
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv)
+{
+    pcb->recv = recv;
+}
+
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent)
+{
+    pcb->sent = sent;
+}
+
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err)
+{
+    pcb->errf = err;
+}
+
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval)
+{
+    pcb->poll = poll;
+    pcb->poll_interval = interval;
+}
+
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags)
+{
+    if (pcb->fail_writes > 0)
+    {
+        pcb->fail_writes--;
+        return ERR_MEM;
+    }
+    if (len > pcb->snd_buf)
+    {
+        return ERR_MEM;
+    }
+    u32_t room = HOST_TCP_OUT_SIZE - pcb->out_len;
+    memcpy(pcb->out + pcb->out_len, dataptr, len < room ? len : room);
+    pcb->out_len += len < room ? len : room;
+    pcb->out[pcb->out_len] = '\0';
+    pcb->out_total += len;
+    pcb->snd_buf -= len;
+    pcb->unacked += len;
+    pcb->writes++;
+    if (!(apiflags & TCP_WRITE_FLAG_COPY) && pcb->num_refs < HOST_TCP_REFS)
+    {
+        pcb->refs[pcb->num_refs++] = (host_tcp_ref_t){dataptr, pcb->out_total, len, hash(dataptr, len)};
+    }
+    return ERR_OK;
+}
+
+err_t tcp_output(struct tcp_pcb *pcb)
+{
+    pcb->outputs++;
+    return ERR_OK;
+}
+
+void tcp_recved(struct tcp_pcb *pcb, u16_t len)
+{
+    pcb->recved += len;
+}
+
+err_t tcp_close(struct tcp_pcb *pcb)
+{
+    if (pcb->fail_close)
+    {
+        return ERR_MEM;
+    }
+    pcb->closed = true;
+    return ERR_OK;
+}
+
+void tcp_abort(struct tcp_pcb *pcb)
+{
+    pcb->aborted = true;
+    if (pcb->errf)
+    {
+        pcb->errf(pcb->arg, ERR_ABRT);
+    }
+}
+
+struct pbuf *host_pbuf(const void *data, u16_t len)
+{
+    struct pbuf *p = malloc(sizeof(struct pbuf) + len);
+    p->next = NULL;
+    p->payload = p + 1;
+    p->tot_len = len;
+    p->len = len;
+    if (len)
+    {
+        memcpy(p->payload, data, len);
+    }
+    host_pbuf_live++;
+    host_pbuf_bytes += len;
+    if (host_pbuf_bytes > host_pbuf_peak_bytes)
+    {
+        host_pbuf_peak_bytes = host_pbuf_bytes;
+    }
+    return p;
+}
+
+// O tamanho alocado fica no pbuf original: 'payload' anda com pbuf_free_header, o bloco não
+static u16_t pbuf_capacity(const struct pbuf *p)
+{
+    return (u16_t)((const u8_t *)p->payload - (const u8_t *)(p + 1)) + p->len;
+}
+
+u8_t pbuf_free(struct pbuf *p)
+{
+    u8_t count = 0;
+    while (p)
+    {
+        struct pbuf *next = p->next;
+        host_pbuf_live--;
+        host_pbuf_bytes -= pbuf_capacity(p);
+        free(p);
+        p = next;
+        count++;
+    }
+    return count;
+}
+
+void pbuf_cat(struct pbuf *head, struct pbuf *tail)
+{
+    struct pbuf *p = head;
+    for (; p->next; p = p->next)
+        p->tot_len += tail->tot_len;
+    p->tot_len += tail->tot_len;
+    p->next = tail;
+}
+
+// Como no lwIP: libera os pbufs inteiros do começo e avança o payload do primeiro que sobrar.
+// Com 'size' zero a cadeia volta como está, mesmo que o primeiro pbuf esteja vazio
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size)
+{
+    struct pbuf *p = q;
+    u16_t free_left = size;
+    while (free_left && p)
+    {
+        if (free_left >= p->len)
+        {
+            struct pbuf *f = p;
+            free_left -= p->len;
+            p = p->next;
+            f->next = NULL;
+            pbuf_free(f);
+        }
+        else
+        {
+            p->payload = (u8_t *)p->payload + free_left;
+            p->len -= free_left;
+            p->tot_len -= free_left;
+            free_left = 0;
+        }
+    }
+    return p;
+}
+
+struct tcp_pcb *host_tcp_connect(void)
+{
+    struct tcp_pcb *pcb = tcp_new();
+    if (pcb && host_tcp_listener && host_tcp_listener->accept)
+    {
+        host_tcp_listener->accept(host_tcp_listener->arg, pcb, ERR_OK);
+    }
+    return pcb;
+}
+
+err_t host_tcp_recv(struct tcp_pcb *pcb, struct pbuf *p)
+{
+    if (!pcb->recv)
+    {
+        pbuf_free(p);
+        return ERR_OK;
+    }
+    return pcb->recv(pcb->arg, pcb, p, ERR_OK);
+}
+
+err_t host_tcp_send(struct tcp_pcb *pcb, const char *data, size_t len, size_t split)
+{
+    struct pbuf *head = NULL;
+    for (size_t pos = 0; pos < len; pos += split)
+    {
+        struct pbuf *p = host_pbuf(data + pos, len - pos < split ? len - pos : split);
+        if (head)
+            pbuf_cat(head, p);
+        else
+            head = p;
+    }
+    return head ? host_tcp_recv(pcb, head) : ERR_OK;
+}
+
+err_t host_tcp_remote_close(struct tcp_pcb *pcb)
+{
+    return pcb->recv ? pcb->recv(pcb->arg, pcb, NULL, ERR_OK) : ERR_OK;
+}
+
+err_t host_tcp_ack(struct tcp_pcb *pcb, u32_t len)
+{
+    if (len > pcb->unacked)
+    {
+        len = pcb->unacked;
+    }
+    if (len == 0)
+    {
+        return ERR_OK;
+    }
+    pcb->unacked -= len;
+    pcb->snd_buf += len;
+
+    // As escritas sem cópia confirmadas agora ainda precisavam estar intactas até aqui
+    u32_t acked = pcb->out_total - pcb->unacked;
+    uint8_t keep = 0;
+    for (uint8_t i = 0; i < pcb->num_refs; i++)
+    {
+        host_tcp_ref_t *ref = &pcb->refs[i];
+        if (ref->end <= acked)
+        {
+            if (hash(ref->data, ref->len) != ref->hash)
+                host_tcp_ref_changed++;
+        }
+        else
+        {
+            pcb->refs[keep++] = *ref;
+        }
+    }
+    pcb->num_refs = keep;
+
+    return pcb->sent ? pcb->sent(pcb->arg, pcb, (u16_t)len) : ERR_OK;
+}
+
+u32_t host_tcp_ack_all(struct tcp_pcb *pcb)
+{
+    u32_t total = 0;
+    while (pcb->unacked && !pcb->aborted)
+    {
+        u32_t len = pcb->unacked < 0xFFFF ? pcb->unacked : 0xFFFF;
+        total += len;
+        host_tcp_ack(pcb, len);
+    }
+    return total;
+}
+
+err_t host_tcp_poll(struct tcp_pcb *pcb)
+{
+    return pcb->poll ? pcb->poll(pcb->arg, pcb) : ERR_OK;
+}
+
+void host_tcp_error(struct tcp_pcb *pcb, err_t err)
+{
+    tcp_err_fn errf = pcb->errf;
+    void *arg = pcb->arg;
+    memset(pcb, 0, sizeof(*pcb));
+    if (errf)
+    {
+        errf(arg, err);
+    }
+}
+
+const char *host_tcp_take(struct tcp_pcb *pcb, u32_t *len)
+{
+    static char taken[HOST_TCP_OUT_SIZE + 1];
+    memcpy(taken, pcb->out, pcb->out_len + 1);
+    if (len)
+    {
+        *len = pcb->out_len;
+    }
+    pcb->out_len = 0;
+    pcb->out[0] = '\0';
+    return taken;
+}
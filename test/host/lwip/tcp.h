@@ -0,0 +1,137 @@
+#ifndef HOST_LWIP_TCP_H
+#define HOST_LWIP_TCP_H
+
+// API raw do lwIP emulada, só o que o servidor HTTP usa. Não há rede: o teste faz o papel do cliente,
+// abrindo conexões (host_tcp_connect), entregando pbufs (host_tcp_recv) e confirmando bytes (host_tcp_ack).
+// Cada PCB guarda tudo o que o servidor escreveu e tem um buffer de envio que só se esvazia nas confirmações.
+// Os pbufs vêm do heap e são contados, para o teste conferir vazamentos e o pico de memória retida
+
+#include "pico/stdlib.h"
+
+typedef uint8_t u8_t;
+typedef uint16_t u16_t;
+typedef uint32_t u32_t;
+typedef int8_t err_t;
+
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_ABRT -13
+
+#define TCP_WRITE_FLAG_COPY 0x01
+#define TCP_WRITE_FLAG_MORE 0x02
+
+typedef struct {
+    u32_t addr;
+} ip_addr_t;
+
+#define IP_ADDR_ANY ((const ip_addr_t *)NULL)
+
+struct pbuf {
+    struct pbuf *next;
+    void *payload;
+    u16_t tot_len;
+    u16_t len;
+};
+
+struct tcp_pcb;
+
+typedef err_t (*tcp_accept_fn)(void *arg, struct tcp_pcb *newpcb, err_t err);
+typedef err_t (*tcp_recv_fn)(void *arg, struct tcp_pcb *tpcb, struct pbuf *p, err_t err);
+typedef err_t (*tcp_sent_fn)(void *arg, struct tcp_pcb *tpcb, u16_t len);
+typedef err_t (*tcp_poll_fn)(void *arg, struct tcp_pcb *tpcb);
+typedef void (*tcp_err_fn)(void *arg, err_t err);
+
+#define HOST_TCP_PCBS 64
+#define HOST_TCP_OUT_SIZE 32768 // Bytes guardados do que o servidor escreveu em cada conexão
+#define HOST_TCP_REFS 64        // Escritas sem cópia ainda sem confirmação, em cada conexão
+
+// Escrita sem TCP_WRITE_FLAG_COPY: o lwIP guarda só o ponteiro até a confirmação
+typedef struct {
+    const void *data;
+    u32_t end;                  // Posição do fim da escrita no total enviado
+    u16_t len;
+    u32_t hash;                 // Dos bytes no momento da escrita
+} host_tcp_ref_t;
+
+struct tcp_pcb {
+    bool used;
+    bool listening;
+    bool closed;                // tcp_close aceito
+    bool aborted;               // tcp_abort chamado
+    void *arg;
+    tcp_accept_fn accept;
+    tcp_recv_fn recv;
+    tcp_sent_fn sent;
+    tcp_poll_fn poll;
+    tcp_err_fn errf;
+    u8_t poll_interval;
+    u16_t snd_buf;              // Espaço livre no buffer de envio (tcp_sndbuf)
+    u32_t unacked;              // Bytes escritos e ainda não confirmados
+    u32_t recved;               // Soma dos tcp_recved
+    u32_t writes;               // Chamadas de tcp_write aceitas
+    u32_t outputs;              // Chamadas de tcp_output
+    int fail_writes;            // As próximas chamadas de tcp_write falham com ERR_MEM
+    bool fail_close;            // tcp_close falha com ERR_MEM
+    u8_t out[HOST_TCP_OUT_SIZE + 1];
+    u32_t out_len;              // Bytes escritos desde o último host_tcp_take (até HOST_TCP_OUT_SIZE ficam em 'out')
+    u32_t out_total;            // Total escrito na conexão
+    host_tcp_ref_t refs[HOST_TCP_REFS];
+    uint8_t num_refs;
+};
+
+// Espaço do buffer de envio de cada conexão nova
+extern u16_t host_tcp_snd_buf;
+// PCB em escuta registrado por tcp_accept
+extern struct tcp_pcb *host_tcp_listener;
+// Escritas sem cópia cuja memória mudou antes da confirmação: o lwIP teria enviado outros bytes
+extern u32_t host_tcp_ref_changed;
+// Pbufs alocados e ainda não liberados, e o pico de bytes retidos
+extern u32_t host_pbuf_live;
+extern u32_t host_pbuf_bytes;
+extern u32_t host_pbuf_peak_bytes;
+
+// Volta ao estado inicial: libera os PCBs, sem chamar callbacks
+void host_tcp_reset(void);
+// Abre uma conexão no PCB em escuta. Retorna o PCB novo, já abortado se o servidor recusou
+struct tcp_pcb *host_tcp_connect(void);
+// Cria um pbuf com uma cópia de 'data' (len pode ser 0)
+struct pbuf *host_pbuf(const void *data, u16_t len);
+// Entrega uma cadeia de pbufs ao servidor, como a chegada de um segmento
+err_t host_tcp_recv(struct tcp_pcb *pcb, struct pbuf *p);
+// Entrega 'len' bytes em pbufs de 'split' bytes encadeados
+err_t host_tcp_send(struct tcp_pcb *pcb, const char *data, size_t len, size_t split);
+// O cliente fechou a conexão
+err_t host_tcp_remote_close(struct tcp_pcb *pcb);
+// O cliente confirmou 'len' bytes (no máximo os não confirmados): libera o buffer e chama o tcp_sent
+err_t host_tcp_ack(struct tcp_pcb *pcb, u32_t len);
+// Confirma tudo o que foi escrito, repetindo enquanto o servidor escrever mais. Retorna o total confirmado
+u32_t host_tcp_ack_all(struct tcp_pcb *pcb);
+// Chama o tcp_poll da conexão
+err_t host_tcp_poll(struct tcp_pcb *pcb);
+// Erro na conexão (ex.: reset do cliente): o lwIP chama o tcp_err e libera o PCB
+void host_tcp_error(struct tcp_pcb *pcb, err_t err);
+// O que o servidor escreveu desde a última leitura, terminado em '\0'. Válido até a próxima chamada
+const char *host_tcp_take(struct tcp_pcb *pcb, u32_t *len);
+
+struct tcp_pcb *tcp_new(void);
+err_t tcp_bind(struct tcp_pcb *pcb, const ip_addr_t *ipaddr, u16_t port);
+struct tcp_pcb *tcp_listen(struct tcp_pcb *pcb);
+void tcp_accept(struct tcp_pcb *pcb, tcp_accept_fn accept);
+void tcp_arg(struct tcp_pcb *pcb, void *arg);
+void tcp_recv(struct tcp_pcb *pcb, tcp_recv_fn recv);
+void tcp_sent(struct tcp_pcb *pcb, tcp_sent_fn sent);
+void tcp_err(struct tcp_pcb *pcb, tcp_err_fn err);
+void tcp_poll(struct tcp_pcb *pcb, tcp_poll_fn poll, u8_t interval);
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len, u8_t apiflags);
+err_t tcp_output(struct tcp_pcb *pcb);
+void tcp_recved(struct tcp_pcb *pcb, u16_t len);
+err_t tcp_close(struct tcp_pcb *pcb);
+void tcp_abort(struct tcp_pcb *pcb);
+
+#define tcp_sndbuf(pcb) ((pcb)->snd_buf)
+
+u8_t pbuf_free(struct pbuf *p);
+void pbuf_cat(struct pbuf *head, struct pbuf *tail);
+struct pbuf *pbuf_free_header(struct pbuf *q, u16_t size);
+
+#endif // HOST_LWIP_TCP_H
@@ -0,0 +1,14 @@
+#ifndef HOST_PICO_FLASH_H
+#define HOST_PICO_FLASH_H
+
+// flash_safe_execute emulado: executa a função na hora, ou falha se o teste pediu em host_flash_fail_ops
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+
+#define PICO_OK 0
+#define PICO_ERROR_TIMEOUT -1
+
+int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms);
+
+#endif // HOST_PICO_FLASH_H
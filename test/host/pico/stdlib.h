@@ -0,0 +1,68 @@
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+// Substitui o pico/stdlib.h nos testes no host: só os tipos e o relógio usados pelas bibliotecas.
+// O relógio não anda sozinho, o teste o ajusta em host_time_us
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef unsigned int uint;
+
+extern uint64_t host_time_us;
+
+static inline uint64_t time_us_64(void)
+{
+    return host_time_us;
+}
+
+static inline uint32_t time_us_32(void)
+{
+    return (uint32_t)host_time_us;
+}
+
+typedef uint64_t absolute_time_t;
+
+static inline absolute_time_t get_absolute_time(void)
+{
+    return host_time_us;
+}
+
+static inline uint32_t to_ms_since_boot(absolute_time_t t)
+{
+    return (uint32_t)(t / 1000);
+}
+
+// Espera ativa: só avança o relógio
+static inline void busy_wait_us(uint64_t delay_us)
+{
+    host_time_us += delay_us;
+}
+
+static inline void tight_loop_contents(void)
+{
+}
+
+// GPIO e alarmes, usados pelo buzzer e pelos botões. Os alarmes são emulados em host/hardware.c
+#define GPIO_FUNC_PWM 4
+
+static inline void gpio_set_function(uint gpio, int fn)
+{
+    (void)gpio;
+    (void)fn;
+}
+
+typedef int32_t alarm_id_t;
+typedef int64_t (*alarm_callback_t)(alarm_id_t id, void *user_data);
+
+alarm_id_t add_alarm_in_ms(uint32_t ms, alarm_callback_t callback, void *user_data, bool fire_if_past);
+alarm_id_t add_alarm_in_us(uint64_t us, alarm_callback_t callback, void *user_data, bool fire_if_past);
+bool cancel_alarm(alarm_id_t alarm_id);
+
+// Último alarme agendado e quantos foram agendados, para o teste disparar e conferir
+extern alarm_callback_t host_alarm_callback;
+extern void *host_alarm_user_data;
+extern uint32_t host_alarm_count;
+
+#endif // HOST_PICO_STDLIB_H
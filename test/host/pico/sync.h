@@ -0,0 +1,28 @@
+#ifndef HOST_PICO_SYNC_H
+#define HOST_PICO_SYNC_H
+
+// Seção crítica do pico-sdk: sem interrupções nem segundo núcleo no host, não faz nada
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+typedef struct {
+    int unused;
+} critical_section_t;
+
+static inline void critical_section_init(critical_section_t *cs)
+{
+    (void)cs;
+}
+
+static inline void critical_section_enter_blocking(critical_section_t *cs)
+{
+    (void)cs;
+}
+
+static inline void critical_section_exit(critical_section_t *cs)
+{
+    (void)cs;
+}
+
+#endif // HOST_PICO_SYNC_H
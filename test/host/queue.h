@@ -0,0 +1,17 @@
+#ifndef HOST_QUEUE_H
+#define HOST_QUEUE_H
+
+// Filas do FreeRTOS emuladas no host. Sem escalonador, esperar nunca bloqueia: com a fila vazia
+// xQueueReceive retorna pdFALSE como se o tempo limite tivesse vencido, e com a fila cheia o envio falha
+
+#include "FreeRTOS.h"
+
+typedef struct host_queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t timeout);
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void *item, BaseType_t *higher_priority_task_woken);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t timeout);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#endif // HOST_QUEUE_H
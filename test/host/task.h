@@ -0,0 +1,24 @@
+#ifndef HOST_TASK_H
+#define HOST_TASK_H
+
+// Notificações de task emuladas no host. Cada "task" é um host_task_t; a atual é host_current_task.
+// Sem escalonador, esperar nunca bloqueia: sem notificação pendente, ulTaskNotifyTakeIndexed
+// retorna 0 como se o tempo limite tivesse vencido
+
+#include "FreeRTOS.h"
+
+#define HOST_TASK_NOTIFY_INDEXES 8
+
+typedef struct {
+    uint32_t notify[HOST_TASK_NOTIFY_INDEXES];
+} host_task_t;
+
+typedef host_task_t *TaskHandle_t;
+
+extern host_task_t *host_current_task;
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGiveIndexed(TaskHandle_t task, UBaseType_t index);
+uint32_t ulTaskNotifyTakeIndexed(UBaseType_t index, BaseType_t clear_on_exit, TickType_t timeout);
+
+#endif // HOST_TASK_H
@@ -0,0 +1,51 @@
+#ifndef HOST_WS2812_PIO_H
+#define HOST_WS2812_PIO_H
+
+// Substitui o cabeçalho que o pioasm gera de lib/ws2812/ws2812.pio no firmware: o mesmo programa,
+// montado à mão, e a mesma inicialização da seção c-sdk
+
+#include "hardware/pio.h"
+
+#define ws2812_wrap_target 0
+#define ws2812_wrap 6
+
+static const uint16_t ws2812_program_instructions[] = {
+    //     .wrap_target
+    0x6021, //  0: out    x, 1
+    0x0024, //  1: jmp    !x, 4
+    0xe401, //  2: set    pins, 1                [4]
+    0x0006, //  3: jmp    6
+    0xe201, //  4: set    pins, 1                [2]
+    0xe200, //  5: set    pins, 0                [2]
+    0xe100, //  6: set    pins, 0                [1]
+    //     .wrap
+};
+
+static const pio_program_t ws2812_program = {
+    .instructions = ws2812_program_instructions,
+    .length = 7,
+    .origin = -1,
+};
+
+static inline pio_sm_config ws2812_program_get_default_config(uint offset)
+{
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, offset + ws2812_wrap_target, offset + ws2812_wrap);
+    return c;
+}
+
+static inline void ws2812_program_init(PIO pio, uint sm, uint offset, uint pin, float div)
+{
+    pio_sm_config c = ws2812_program_get_default_config(offset);
+    sm_config_set_set_pins(&c, pin, 1);
+    pio_gpio_init(pio, pin);
+    pio_sm_set_consecutive_pindirs(pio, sm, pin, 1, true);
+    sm_config_set_clkdiv(&c, div);
+    sm_config_set_fifo_join(&c, PIO_FIFO_JOIN_TX);
+    sm_config_set_out_shift(&c, false, true, 24);
+    sm_config_set_out_special(&c, true, false, false);
+    pio_sm_init(pio, sm, offset, &c);
+    pio_sm_set_enabled(pio, sm, true);
+}
+
+#endif // HOST_WS2812_PIO_H
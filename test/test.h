@@ -0,0 +1,33 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdio.h>
+
+// Verificações dos testes no host: uma falha é mostrada com arquivo e linha e o teste continua.
+// O main de cada teste retorna TEST_RESULT, diferente de zero se algo falhou
+extern int test_failures;
+
+#define CHECK(cond)                                                          \
+    do                                                                       \
+    {                                                                        \
+        if (!(cond))                                                         \
+        {                                                                    \
+            printf("%s:%d: falhou: %s\n", __FILE__, __LINE__, #cond);       \
+            test_failures++;                                                 \
+        }                                                                    \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                                  \
+    do                                                                                              \
+    {                                                                                               \
+        long long actual_ = (actual), expected_ = (expected);                                       \
+        if (actual_ != expected_)                                                                   \
+        {                                                                                           \
+            printf("%s:%d: %s = %lld, esperado %lld\n", __FILE__, __LINE__, #actual, actual_, expected_); \
+            test_failures++;                                                                        \
+        }                                                                                           \
+    } while (0)
+
+#define TEST_RESULT (test_failures ? 1 : 0)
+
+#endif // TEST_H
@@ -0,0 +1,143 @@
+#include <string.h>
+#include "test.h"
+#include "adc_sampler/adc_sampler.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+
+// Amostragem do ADC por DMA em ping-pong: limites da taxa, e um traço de amostras reproduzido pelo
+// ADC e DMA emulados com um consumidor que às vezes se atrasa, como a task do potenciômetro
+
+#define INPUT 2
+#define BLOCKS 12
+
+static uint32_t callbacks;
+static uint32_t latest_seq; // Sobrescrito a cada bloco, como a notificação eSetValueWithOverwrite
+static bool in_order;
+
+static void block_ready(uint32_t block_seq, void *ctx)
+{
+    (void)ctx;
+    if (block_seq != callbacks)
+        in_order = false;
+    latest_seq = block_seq;
+    callbacks++;
+}
+
+static void reset_hardware(void)
+{
+    memset(host_dma, 0, sizeof(host_dma));
+    host_adc_running = false;
+    host_adc_clkdiv = 0;
+}
+
+static int claimed_channels(void)
+{
+    int n = 0;
+    for (int c = 0; c < HOST_DMA_CHANNELS; c++)
+        n += host_dma[c].claimed;
+    return n;
+}
+
+static void test_rate_limits(void)
+{
+    const uint32_t rejected[] = {0, 1, 732, 500001, 48000000, 100000000};
+    for (unsigned i = 0; i < sizeof(rejected) / sizeof(rejected[0]); i++)
+    {
+        reset_hardware();
+        CHECK(!adc_sampler_init(INPUT, rejected[i], block_ready, NULL));
+        // Recusada antes de qualquer configuração
+        CHECK(!host_adc_running);
+        CHECK_EQ(claimed_channels(), 0);
+        CHECK(host_adc_clkdiv == 0);
+    }
+
+    // Nos dois extremos o divisor cabe e dá a taxa pedida
+    const uint32_t accepted[] = {733, 2560, 500000};
+    for (unsigned i = 0; i < sizeof(accepted) / sizeof(accepted[0]); i++)
+    {
+        reset_hardware();
+        CHECK(adc_sampler_init(INPUT, accepted[i], block_ready, NULL));
+        CHECK(host_adc_running);
+        CHECK_EQ(host_adc_input, INPUT);
+        CHECK(host_adc_clkdiv >= 95.0f && host_adc_clkdiv < 65536.0f);
+        double rate = 48e6 / (host_adc_clkdiv + 1.0);
+        CHECK(rate > accepted[i] * 0.9999 && rate < accepted[i] * 1.0001);
+    }
+}
+
+// Traço de uma boia oscilando devagar, com ruído, em 12 bits
+static uint16_t trace_sample(uint32_t n)
+{
+    static uint32_t lcg = 1;
+    lcg = lcg * 1103515245u + 12345u;
+    int32_t value = 1500 + (int32_t)(n / 8) - 40 + (int32_t)((lcg >> 16) % 81);
+    return value < 0 ? 0 : value > 4095 ? 4095 : value;
+}
+
+static void test_replay(void)
+{
+    static uint16_t trace[BLOCKS][ADC_SAMPLER_BLOCK_SIZE];
+    // Blocos depois dos quais o consumidor roda: atrasa três blocos depois do bloco 2 e um depois do 8
+    static const bool consumer_runs[BLOCKS] = {1, 1, 1, 0, 0, 1, 1, 1, 0, 1, 1, 1};
+    static const uint32_t expected_lost[BLOCKS] = {0, 0, 0, 0, 0, 2, 0, 0, 0, 1, 0, 0};
+
+    reset_hardware();
+    callbacks = 0;
+    in_order = true;
+    CHECK(adc_sampler_init(INPUT, 2560, block_ready, NULL));
+
+    uint32_t expected_seq = 0, total_lost = 0, reads = 0;
+    for (uint32_t b = 0; b < BLOCKS; b++)
+    {
+        uint32_t sum = 0;
+        for (uint32_t i = 0; i < ADC_SAMPLER_BLOCK_SIZE; i++)
+        {
+            trace[b][i] = trace_sample(b * ADC_SAMPLER_BLOCK_SIZE + i);
+            sum += trace[b][i];
+            host_adc_push(trace[b][i]);
+        }
+        CHECK_EQ(callbacks, b + 1);
+        if (!consumer_runs[b])
+            continue;
+
+        // O consumidor lê o bloco mais recente, que continua intacto enquanto o DMA enche o outro
+        uint32_t seq = latest_seq;
+        CHECK_EQ(seq, b);
+        uint32_t lost = adc_sampler_blocks_lost(&expected_seq, seq);
+        CHECK_EQ(lost, expected_lost[b]);
+        total_lost += lost;
+        reads++;
+        CHECK(!memcmp(adc_sampler_block(seq), trace[b], sizeof(trace[b])));
+        CHECK_EQ(adc_sampler_block_average(seq), (sum + ADC_SAMPLER_BLOCK_SIZE / 2) / ADC_SAMPLER_BLOCK_SIZE);
+    }
+    CHECK(in_order);
+    CHECK_EQ(reads + total_lost, BLOCKS); // Todo bloco foi lido ou contado como perdido
+
+    // Metade de um bloco ainda não completa nada
+    for (uint32_t i = 0; i < ADC_SAMPLER_BLOCK_SIZE / 2; i++)
+        host_adc_push(0);
+    CHECK_EQ(callbacks, BLOCKS);
+}
+
+static void test_lost_wraparound(void)
+{
+    uint32_t expected = 0;
+
+    // A primeira leitura não conta perdas, mesmo começando depois do bloco 0
+    CHECK_EQ(adc_sampler_blocks_lost(&expected, 7), 0);
+    CHECK_EQ(adc_sampler_blocks_lost(&expected, 8), 0);
+    CHECK_EQ(adc_sampler_blocks_lost(&expected, 12), 3);
+
+    // O contador de blocos dá a volta
+    expected = 0xFFFFFFFEu;
+    CHECK_EQ(adc_sampler_blocks_lost(&expected, 1), 3);
+    CHECK_EQ(expected, 2);
+}
+
+int main(void)
+{
+    test_rate_limits();
+    test_replay();
+    test_lost_wraparound();
+    return TEST_RESULT;
+}
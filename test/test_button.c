@@ -0,0 +1,306 @@
+#include "test.h"
+#include "button/button.h"
+#include "hardware/gpio.h"
+
+// Debounce e gestos dos botões sobre traços de bordas com repique. A máquina de estados roda como na
+// placa: cada borda agenda a verificação para o fim do debounce, e cada verificação reagenda para o prazo
+// seguinte (button_fsm_deadline), como o alarme de button.c
+
+#define PIN BUTTON_A
+#define START_US 1000000u // Bordas a partir de 1 s: instante 0 não é usado pela máquina de estados
+#define MAX_EDGES 64
+#define MAX_EMITTED 8
+
+typedef struct {
+    uint64_t t_us;
+    bool pressed;
+} edge_t;
+
+typedef struct {
+    edge_t edges[MAX_EDGES];
+    int n;
+} trace_t;
+
+typedef struct {
+    button_event_t event;
+    uint64_t at_us; // Instante da verificação que gerou o evento
+} emitted_t;
+
+static emitted_t emitted[MAX_EMITTED];
+static int emitted_n;
+static uint64_t last_deadline; // Prazo agendado depois da última verificação, 0 = nenhum
+
+static void edge(trace_t *trace, uint64_t t_us, bool pressed)
+{
+    trace->edges[trace->n].t_us = t_us;
+    trace->edges[trace->n].pressed = pressed;
+    trace->n++;
+}
+
+// Surto de 'count' bordas alternadas, 'gap_us' entre elas, terminando em 'pressed'. Retorna a última borda
+static uint64_t bounce(trace_t *trace, uint64_t t_us, bool pressed, int count, uint64_t gap_us)
+{
+    for (int k = 0; k < count; k++)
+        edge(trace, t_us + k * gap_us, (count - 1 - k) % 2 == 0 ? pressed : !pressed);
+    return t_us + (count - 1) * gap_us;
+}
+
+static void check_poll(button_t *button, bool pressed, uint64_t now_us)
+{
+    button_event_t events[2];
+    uint8_t n = button_fsm_poll(button, pressed, now_us, events);
+    for (uint8_t e = 0; e < n && emitted_n < MAX_EMITTED; e++)
+    {
+        emitted[emitted_n].event = events[e];
+        emitted[emitted_n].at_us = now_us;
+        emitted_n++;
+    }
+}
+
+// Reproduz o traço até 'end_us' e guarda os eventos em 'emitted'
+static void run(const trace_t *trace, uint64_t end_us)
+{
+    button_t button;
+    bool level = false;
+    uint64_t alarm = 0;
+
+    button_fsm_init(&button, PIN);
+    emitted_n = 0;
+    for (int i = 0; i <= trace->n; i++)
+    {
+        uint64_t next = i < trace->n ? trace->edges[i].t_us : end_us;
+        while (alarm && alarm <= next)
+        {
+            uint64_t now = alarm;
+            check_poll(&button, level, now);
+            uint64_t deadline = button_fsm_deadline(&button);
+            alarm = deadline ? (deadline > now ? deadline : now + 1) : 0;
+        }
+        if (i < trace->n)
+        {
+            level = trace->edges[i].pressed;
+            button_fsm_edge(&button, trace->edges[i].t_us);
+            alarm = trace->edges[i].t_us + BUTTON_DEBOUNCE_US;
+        }
+    }
+    last_deadline = alarm;
+}
+
+static void check_event(int i, button_event_type_t type, uint64_t press_us)
+{
+    if (i >= emitted_n)
+    {
+        printf("%s:%d: evento %d não gerado\n", __FILE__, __LINE__, i);
+        test_failures++;
+        return;
+    }
+    CHECK_EQ(emitted[i].event.pin, PIN);
+    CHECK_EQ(emitted[i].event.type, type);
+    CHECK_EQ(emitted[i].event.time_ms, press_us / 1000);
+}
+
+static void test_short_bounces(void)
+{
+    trace_t trace = {.n = 0};
+
+    // Repique de 5 bordas a cada 1 ms no aperto e na soltura, bem dentro do debounce
+    uint64_t press = START_US;
+    bounce(&trace, press, true, 5, 1000);
+    uint64_t release = bounce(&trace, press + 100000, false, 5, 1000);
+    run(&trace, release + 1000000);
+
+    CHECK_EQ(emitted_n, 1);
+    check_event(0, BUTTON_EVENT_SHORT, press); // Com o instante da primeira borda do aperto
+    // Avisado só quando a janela do duplo termina, contada da primeira borda da soltura
+    CHECK_EQ(emitted[0].at_us, press + 100000 + BUTTON_DOUBLE_PRESS_MS * 1000);
+    CHECK_EQ(last_deadline, 0);
+}
+
+static void test_long_bounces(void)
+{
+    trace_t trace = {.n = 0};
+
+    // Surto mais longo que o debounce, mas com bordas mais próximas que ele: continua um só aperto
+    uint64_t press = START_US;
+    uint64_t settled = bounce(&trace, press, true, 31, BUTTON_DEBOUNCE_US / 2);
+    CHECK(settled - press > 10 * BUTTON_DEBOUNCE_US);
+    uint64_t release = bounce(&trace, settled + 100000, false, 31, BUTTON_DEBOUNCE_US / 2);
+    run(&trace, release + 1000000);
+
+    CHECK_EQ(emitted_n, 1);
+    check_event(0, BUTTON_EVENT_SHORT, press);
+
+    // Pulsos separados por mais que o debounce são toques de verdade: dois viram um duplo
+    trace.n = 0;
+    edge(&trace, press, true);
+    edge(&trace, press + BUTTON_DEBOUNCE_US + 5000, false);
+    edge(&trace, press + 2 * (BUTTON_DEBOUNCE_US + 5000), true);
+    edge(&trace, press + 3 * (BUTTON_DEBOUNCE_US + 5000), false);
+    run(&trace, press + 2000000);
+    CHECK_EQ(emitted_n, 1);
+    check_event(0, BUTTON_EVENT_DOUBLE, press);
+}
+
+static void test_double(void)
+{
+    trace_t trace = {.n = 0};
+    uint64_t first = START_US;
+    uint64_t second = first + 250000;
+
+    bounce(&trace, first, true, 3, 2000);
+    bounce(&trace, first + 80000, false, 3, 2000);
+    bounce(&trace, second, true, 3, 2000);
+    bounce(&trace, second + 80000, false, 3, 2000);
+    run(&trace, second + 2000000);
+
+    // Um só evento, com o instante do primeiro aperto, avisado na soltura do segundo
+    CHECK_EQ(emitted_n, 1);
+    check_event(0, BUTTON_EVENT_DOUBLE, first);
+    CHECK_EQ(emitted[0].at_us, second + 80000 + BUTTON_DEBOUNCE_US + 2 * 2000);
+
+    // Segundo toque depois da janela: dois toques simples
+    trace.n = 0;
+    edge(&trace, first, true);
+    edge(&trace, first + 80000, false);
+    edge(&trace, first + 80000 + BUTTON_DOUBLE_PRESS_MS * 1000 + 50000, true);
+    edge(&trace, first + 80000 + BUTTON_DOUBLE_PRESS_MS * 1000 + 130000, false);
+    run(&trace, first + 3000000);
+    CHECK_EQ(emitted_n, 2);
+    check_event(0, BUTTON_EVENT_SHORT, first);
+    check_event(1, BUTTON_EVENT_SHORT, first + 80000 + BUTTON_DOUBLE_PRESS_MS * 1000 + 50000);
+}
+
+static void test_long(void)
+{
+    trace_t trace = {.n = 0};
+    uint64_t press = START_US;
+
+    bounce(&trace, press, true, 4, 1500);
+    uint64_t release = bounce(&trace, press + 2000000, false, 4, 1500);
+    run(&trace, release + 1000000);
+
+    // Avisado com o botão ainda apertado, e a soltura depois não gera toque
+    CHECK_EQ(emitted_n, 1);
+    check_event(0, BUTTON_EVENT_LONG, press);
+    CHECK_EQ(emitted[0].at_us, press + BUTTON_LONG_PRESS_MS * 1000);
+    CHECK_EQ(last_deadline, 0);
+}
+
+static void test_long_after_pending_click(void)
+{
+    trace_t trace = {.n = 0};
+    uint64_t click = START_US;
+    uint64_t hold = click + 200000;
+
+    // Toque, e dentro da janela do duplo um aperto que vira pressão longa
+    bounce(&trace, click, true, 3, 1000);
+    bounce(&trace, click + 60000, false, 3, 1000);
+    bounce(&trace, hold, true, 3, 1000);
+    uint64_t release = bounce(&trace, hold + 1500000, false, 3, 1000);
+    run(&trace, release + 1000000);
+
+    // O toque anterior vale sozinho e vem antes, na mesma verificação
+    CHECK_EQ(emitted_n, 2);
+    check_event(0, BUTTON_EVENT_SHORT, click);
+    check_event(1, BUTTON_EVENT_LONG, hold);
+    CHECK_EQ(emitted[0].at_us, hold + BUTTON_LONG_PRESS_MS * 1000);
+    CHECK_EQ(emitted[1].at_us, emitted[0].at_us);
+}
+
+static void test_noise_deadline(void)
+{
+    button_t button;
+    button_event_t events[2];
+    uint64_t t = START_US;
+
+    // Solto: ruído que volta ao nível solto não gera evento nem deixa prazo
+    button_fsm_init(&button, PIN);
+    button_fsm_edge(&button, t);
+    button_fsm_edge(&button, t + 3000);
+    CHECK_EQ(button_fsm_deadline(&button), t + 3000 + BUTTON_DEBOUNCE_US);
+    CHECK_EQ(button_fsm_poll(&button, false, t + 3000 + BUTTON_DEBOUNCE_US, events), 0);
+    CHECK_EQ(button_fsm_deadline(&button), 0);
+    CHECK(!button.pressed);
+
+    // Apertado: ruído que volta ao nível apertado mantém o prazo da pressão longa do aperto original
+    t += 1000000;
+    button_fsm_edge(&button, t);
+    CHECK_EQ(button_fsm_poll(&button, true, t + BUTTON_DEBOUNCE_US, events), 0);
+    CHECK_EQ(button_fsm_deadline(&button), t + BUTTON_LONG_PRESS_MS * 1000);
+
+    uint64_t noise = t + 300000;
+    button_fsm_edge(&button, noise);
+    button_fsm_edge(&button, noise + 2000);
+    // Durante o debounce o prazo mais próximo é o fim dele
+    CHECK_EQ(button_fsm_deadline(&button), noise + 2000 + BUTTON_DEBOUNCE_US);
+    CHECK_EQ(button_fsm_poll(&button, true, noise + 2000 + BUTTON_DEBOUNCE_US, events), 0);
+    CHECK_EQ(button_fsm_deadline(&button), t + BUTTON_LONG_PRESS_MS * 1000);
+
+    CHECK_EQ(button_fsm_poll(&button, true, t + BUTTON_LONG_PRESS_MS * 1000, events), 1);
+    CHECK_EQ(events[0].type, BUTTON_EVENT_LONG);
+    CHECK_EQ(events[0].time_ms, t / 1000);
+
+    // Ruído perto do fim da janela do duplo: o prazo volta a ser o da janela, que não é estendida
+    t += 2000000;
+    button_fsm_init(&button, PIN);
+    button_fsm_edge(&button, t);
+    button_fsm_poll(&button, true, t + BUTTON_DEBOUNCE_US, events);
+    button_fsm_edge(&button, t + 50000);
+    button_fsm_poll(&button, false, t + 50000 + BUTTON_DEBOUNCE_US, events);
+    uint64_t window_end = t + 50000 + BUTTON_DOUBLE_PRESS_MS * 1000;
+    CHECK_EQ(button_fsm_deadline(&button), window_end);
+    button_fsm_edge(&button, window_end - 10000);
+    CHECK_EQ(button_fsm_deadline(&button), window_end); // A janela vence antes do debounce do ruído
+    CHECK_EQ(button_fsm_poll(&button, false, window_end, events), 1);
+    CHECK_EQ(events[0].type, BUTTON_EVENT_SHORT);
+    CHECK_EQ(button_fsm_deadline(&button), window_end - 10000 + BUTTON_DEBOUNCE_US);
+    CHECK_EQ(button_fsm_poll(&button, false, window_end - 10000 + BUTTON_DEBOUNCE_US, events), 0);
+    CHECK_EQ(button_fsm_deadline(&button), 0);
+}
+
+// O caminho da placa: interrupção do GPIO, alarme e fila
+static void test_interrupt_path(void)
+{
+    static const uint8_t pins[] = {PIN};
+    QueueHandle_t queue = xQueueCreate(4, sizeof(button_event_t));
+    button_event_t event;
+
+    CHECK(button_events_init(pins, 1, queue));
+    CHECK(gpio_get(PIN)); // Pull-up: solto em nível alto
+
+    host_time_us = START_US;
+    host_gpio_level[PIN] = false;
+    host_gpio_irq_events[PIN] = GPIO_IRQ_EDGE_FALL;
+    host_gpio_irq();
+    CHECK_EQ(host_gpio_irq_events[PIN], 0); // Reconhecida pelo tratador
+
+    host_time_us += BUTTON_DEBOUNCE_US;
+    CHECK(host_alarm_callback(1, host_alarm_user_data) > 0); // Reagenda para o prazo da pressão longa
+
+    host_time_us = START_US + 100000;
+    host_gpio_level[PIN] = true;
+    host_gpio_irq_events[PIN] = GPIO_IRQ_EDGE_RISE;
+    host_gpio_irq();
+    host_time_us += BUTTON_DEBOUNCE_US;
+    int64_t next = host_alarm_callback(1, host_alarm_user_data);
+    CHECK_EQ(next, BUTTON_DOUBLE_PRESS_MS * 1000 - BUTTON_DEBOUNCE_US);
+    CHECK(!xQueueReceive(queue, &event, 0));
+
+    host_time_us += next;
+    CHECK_EQ(host_alarm_callback(1, host_alarm_user_data), 0); // Nada mais a fazer: o alarme para
+    CHECK(xQueueReceive(queue, &event, 0));
+    CHECK_EQ(event.type, BUTTON_EVENT_SHORT);
+    CHECK_EQ(event.time_ms, START_US / 1000);
+}
+
+int main(void)
+{
+    test_short_bounces();
+    test_long_bounces();
+    test_double();
+    test_long();
+    test_long_after_pending_click();
+    test_noise_deadline();
+    test_interrupt_path();
+    return TEST_RESULT;
+}
@@ -0,0 +1,138 @@
+#include "test.h"
+#include "buzzer/buzzer.h"
+#include "hardware/pwm.h"
+#include "hardware/clocks.h"
+
+// Divisor e wrap calculados por play_tone e o sequenciador de padrões, sobre o PWM e os alarmes emulados
+
+#define PIN BUZZER_A_PIN
+
+static host_pwm_slice_t *slice(void)
+{
+    return &host_pwm[pwm_gpio_to_slice_num(PIN)];
+}
+
+// Frequência que o PWM gera com o divisor e o wrap programados, em centésimos de Hz
+static uint64_t generated_centihz(void)
+{
+    uint32_t div16 = slice()->div_int * 16 + slice()->div_frac;
+    return (uint64_t)host_clk_sys_hz * 16 * 100 / ((uint64_t)div16 * (slice()->wrap + 1));
+}
+
+static void test_tone(void)
+{
+    const uint32_t clocks[] = {125000000, 133000000, 48000000};
+
+    for (unsigned c = 0; c < sizeof(clocks) / sizeof(clocks[0]); c++)
+    {
+        host_clk_sys_hz = clocks[c];
+        for (uint frequency = 20; frequency <= 20000; frequency += frequency / 16 + 1)
+        {
+            play_tone(PIN, frequency);
+            uint32_t div16 = slice()->div_int * 16 + slice()->div_frac;
+            CHECK(div16 >= 16);
+            CHECK_EQ(slice()->level, slice()->wrap / 2);
+
+            // O menor divisor que cabe: com um passo a menos o wrap passaria de 16 bits
+            if (div16 > 16)
+                CHECK((uint64_t)host_clk_sys_hz * 16 / ((div16 - 1) * frequency) > 65536);
+
+            // Erro abaixo de 0,1% em toda a faixa audível
+            uint64_t expected = (uint64_t)frequency * 100;
+            uint64_t actual = generated_centihz();
+            uint64_t error = actual > expected ? actual - expected : expected - actual;
+            CHECK(error * 1000 <= expected);
+        }
+    }
+    host_clk_sys_hz = 125000000;
+
+    // Abaixo do alcance do divisor a nota sai mais aguda, mas sem estourar o contador
+    play_tone(PIN, 1);
+    CHECK_EQ(slice()->div_int, 255);
+    CHECK_EQ(slice()->div_frac, 15);
+    CHECK_EQ(slice()->wrap, 65535);
+
+    play_tone(PIN, 0);
+    CHECK_EQ(slice()->level, 0);
+}
+
+// Dispara o alarme agendado. Retorna a duração do próximo passo em ms, 0 se o alarme parou
+static uint32_t fire(void)
+{
+    int64_t next = host_alarm_callback(1, host_alarm_user_data);
+    CHECK(next <= 0);
+    return (uint32_t)(-next / 1000);
+}
+
+static void test_sequencer(void)
+{
+    static buzzer_t buzzer;
+    const buzzer_pattern_t beeps = {.frequency_hz = 900, .on_ms = 150, .off_ms = 50, .repeat = 2};
+    const buzzer_pattern_t tone = {.frequency_hz = 300, .on_ms = 250, .off_ms = 0, .repeat = 0};
+    const buzzer_pattern_t pause = {.frequency_hz = 0, .on_ms = 100, .off_ms = 0, .repeat = 1};
+
+    buzzer_init(&buzzer, PIN);
+    CHECK_EQ(slice()->level, 0);
+
+    uint32_t alarms = host_alarm_count;
+    CHECK(buzzer_play(&buzzer, &beeps));
+    CHECK(buzzer_play(&buzzer, &pause));
+    CHECK(buzzer_play(&buzzer, &tone));
+    CHECK_EQ(host_alarm_count, alarms + 1); // Um só alarme para a fila toda
+
+    // Dois bipes com silêncio entre eles
+    CHECK_EQ(fire(), 150);
+    CHECK(slice()->level > 0);
+    CHECK_EQ(fire(), 50);
+    CHECK_EQ(slice()->level, 0);
+    CHECK_EQ(fire(), 150);
+    CHECK(slice()->level > 0);
+    CHECK_EQ(fire(), 50);
+    CHECK_EQ(slice()->level, 0);
+
+    // Pausa: o tempo passa com o PWM desligado
+    CHECK_EQ(fire(), 100);
+    CHECK_EQ(slice()->level, 0);
+
+    // Tom sem silêncio depois, 'repeat' 0 toca uma vez
+    CHECK_EQ(fire(), 250);
+    CHECK(slice()->level > 0);
+    CHECK_EQ(fire(), 0);
+    CHECK_EQ(slice()->level, 0);
+    CHECK(!buzzer.active);
+
+    // Com o alarme parado, o próximo padrão agenda outro
+    CHECK(buzzer_play(&buzzer, &tone));
+    CHECK_EQ(host_alarm_count, alarms + 2);
+    CHECK_EQ(fire(), 250);
+    CHECK_EQ(fire(), 0);
+}
+
+static void test_queue_full(void)
+{
+    static buzzer_t buzzer;
+    const buzzer_pattern_t tone = {.frequency_hz = 440, .on_ms = 10, .off_ms = 0, .repeat = 1};
+
+    buzzer_init(&buzzer, PIN);
+    for (int i = 0; i < BUZZER_QUEUE_LENGTH; i++)
+        CHECK(buzzer_play(&buzzer, &tone));
+    CHECK(!buzzer_play(&buzzer, &tone));
+    CHECK_EQ(buzzer.dropped, 1);
+
+    // Tocar um libera uma posição
+    CHECK_EQ(fire(), 10);
+    CHECK(buzzer_play(&buzzer, &tone));
+
+    int steps = 0;
+    while (fire() && steps < 100)
+        steps++;
+    CHECK_EQ(steps, BUZZER_QUEUE_LENGTH); // Os que estavam na fila e o enfileirado depois
+}
+
+int main(void)
+{
+    test_tone();
+    test_sequencer();
+    test_queue_full();
+    return TEST_RESULT;
+}
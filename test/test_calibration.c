@@ -0,0 +1,162 @@
+#include "test.h"
+#include "calibration/calibration.h"
+
+#include <string.h>
+
+// Validação dos pontos, curva linear e monotônica nos dois sentidos, extremos e serialização
+
+#define Q8(percent) ((percent) << CALIBRATION_Q)
+
+static bool near(int32_t value, int32_t expected, int32_t tolerance)
+{
+    return value >= expected - tolerance && value <= expected + tolerance;
+}
+
+static void test_add_point(void)
+{
+    calibration_point_t points[CALIBRATION_MAX_POINTS];
+    uint8_t n = 0;
+
+    CHECK(calibration_add_point(points, &n, 100, 0));
+    CHECK(calibration_add_point(points, &n, 900, 100));
+    // Mesma porcentagem: substitui a leitura
+    CHECK(calibration_add_point(points, &n, 120, 0));
+    CHECK_EQ(n, 2);
+    CHECK_EQ(points[0].raw, 120);
+
+    CHECK(calibration_add_point(points, &n, 300, 25));
+    CHECK(calibration_add_point(points, &n, 500, 50));
+    CHECK(calibration_add_point(points, &n, 700, 75));
+    CHECK(!calibration_add_point(points, &n, 800, 90));
+    CHECK_EQ(n, CALIBRATION_MAX_POINTS);
+}
+
+static void test_invalid(void)
+{
+    calibration_t cal;
+    cal.num_points = 0;
+
+    const calibration_point_t one[] = {{100, 0}};
+    const calibration_point_t same_raw[] = {{100, 0}, {100, 50}, {900, 100}};
+    const calibration_point_t narrow[] = {{100, 0}, {100 + CALIBRATION_MIN_SPAN - 1, 100}};
+    const calibration_point_t flat[] = {{100, 50}, {900, 50}};
+    const calibration_point_t not_monotonic[] = {{100, 0}, {500, 60}, {700, 40}, {900, 100}};
+    const calibration_point_t over[] = {{100, 0}, {900, 101}};
+
+    CHECK(!calibration_build(&cal, one, 1));
+    CHECK(!calibration_build(&cal, same_raw, 3));
+    CHECK(!calibration_build(&cal, narrow, 2));
+    CHECK(!calibration_build(&cal, flat, 2));
+    CHECK(!calibration_build(&cal, not_monotonic, 4));
+    CHECK(!calibration_build(&cal, over, 2));
+    CHECK_EQ(cal.num_points, 0); // Uma calibração recusada não altera a atual
+}
+
+static void test_linear(void)
+{
+    calibration_t cal;
+    // Fora de ordem de propósito: a construção ordena pela leitura
+    const calibration_point_t points[] = {{3000, 100}, {1000, 0}};
+
+    CHECK(calibration_build(&cal, points, 2));
+    CHECK_EQ(cal.points[0].raw, 1000);
+    CHECK_EQ(calibration_apply(&cal, 1000), 0);
+    CHECK_EQ(calibration_apply(&cal, 3000), Q8(100));
+    // A escala da tabela é arredondada para baixo: a leitura fica até span / 65536 intervalos atrás
+    CHECK(near(calibration_apply(&cal, 2000), Q8(50), Q8(1) / 8));
+    CHECK(near(calibration_apply(&cal, 1500), Q8(25), Q8(1) / 8));
+
+    // Fora da faixa calibrada fica no extremo
+    CHECK_EQ(calibration_apply(&cal, 0), 0);
+    CHECK_EQ(calibration_apply(&cal, 65535), Q8(100));
+}
+
+static void test_decreasing(void)
+{
+    calibration_t cal;
+    // Ultrassônico: o eco encurta quando o nível sobe
+    const calibration_point_t points[] = {{2000, 0}, {1200, 40}, {400, 100}};
+
+    CHECK(calibration_build(&cal, points, 3));
+    CHECK_EQ(calibration_apply(&cal, 400), Q8(100));
+    CHECK_EQ(calibration_apply(&cal, 2000), 0);
+    CHECK(near(calibration_apply(&cal, 1200), Q8(40), Q8(1) / 2));
+
+    int32_t previous = Q8(100);
+    for (int32_t raw = 400; raw <= 2000; raw++)
+    {
+        int32_t value = calibration_apply(&cal, raw);
+        CHECK(value <= previous);
+        previous = value;
+    }
+}
+
+static void test_pchip(void)
+{
+    calibration_t cal;
+    // Reservatório mais largo em cima: a porcentagem cresce cada vez mais devagar com a leitura
+    const calibration_point_t points[] = {{0, 0}, {500, 40}, {1000, 65}, {2000, 85}, {4095, 100}};
+
+    CHECK(calibration_build(&cal, points, 5));
+
+    // Passa (dentro do erro da tabela) pelos pontos, nunca decresce e não sai de 0..100%
+    for (uint8_t i = 0; i < 5; i++)
+        CHECK(near(calibration_apply(&cal, points[i].raw), Q8(points[i].percent), Q8(1)));
+    int32_t previous = 0;
+    for (int32_t raw = 0; raw <= 4095; raw++)
+    {
+        int32_t value = calibration_apply(&cal, raw);
+        CHECK(value >= previous);
+        CHECK(value <= Q8(100));
+        previous = value;
+    }
+
+    // Patamar entre dois pontos de mesma inclinação zero não oscila
+    const calibration_point_t steps[] = {{0, 0}, {1000, 50}, {1010, 51}, {3000, 100}};
+    CHECK(calibration_build(&cal, steps, 4));
+    previous = 0;
+    for (int32_t raw = 0; raw <= 3000; raw++)
+    {
+        int32_t value = calibration_apply(&cal, raw);
+        CHECK(value >= previous);
+        previous = value;
+    }
+}
+
+static void test_pack(void)
+{
+    calibration_t cal;
+    calibration_point_t unpacked[CALIBRATION_MAX_POINTS];
+    uint8_t buf[CALIBRATION_PACKED_SIZE];
+    const calibration_point_t points[] = {{4000, 0}, {300, 100}, {2100, 50}};
+
+    CHECK(calibration_build(&cal, points, 3));
+    memset(buf, 0xAA, sizeof(buf));
+    calibration_pack(&cal, buf);
+    CHECK_EQ(buf[0], 3);
+    CHECK_EQ(buf[CALIBRATION_PACKED_SIZE - 1], 0); // Espaço não usado zerado
+
+    CHECK_EQ(calibration_unpack(buf, unpacked), 3);
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        CHECK_EQ(unpacked[i].raw, cal.points[i].raw);
+        CHECK_EQ(unpacked[i].percent, cal.points[i].percent);
+    }
+
+    // Flash apagada ou conteúdo inválido
+    memset(buf, 0xFF, sizeof(buf));
+    CHECK_EQ(calibration_unpack(buf, unpacked), 0);
+    buf[0] = 1;
+    CHECK_EQ(calibration_unpack(buf, unpacked), 0);
+}
+
+int main(void)
+{
+    test_add_point();
+    test_invalid();
+    test_linear();
+    test_decreasing();
+    test_pchip();
+    test_pack();
+    return TEST_RESULT;
+}
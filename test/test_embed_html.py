@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+# Confere o html_data.h gerado por tools/embed_html.py: as duas representações da página batem entre si,
+# o gzip é menor que a página, o ETag acompanha o conteúdo e a saída é a mesma a cada execução.
+#
+# Uso: test_embed_html.py <embed_html.py> <index.html>
+
+import ast
+import gzip
+import hashlib
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+failures = 0
+
+
+def check(cond, message):
+    global failures
+    if not cond:
+        print('falhou: %s' % message)
+        failures += 1
+
+
+def generate(tool, source, output):
+    result = subprocess.run([sys.executable, tool, source, output], capture_output=True, text=True)
+    check(result.returncode == 0, 'embed_html.py terminou com %d: %s' % (result.returncode, result.stderr))
+    print(result.stdout.strip())
+    with open(output, 'rb') as f:
+        return f.read()
+
+
+def parse(header):
+    # Lê de volta o que o compilador veria: a string, o vetor de bytes e os ETags
+    text = header.decode('utf-8')
+    string = re.search(r'html_data\[\] =\n(.*?);\n', text, re.S).group(1)
+    plain = ''.join(ast.literal_eval(literal) for literal in re.findall(r'^".*"$', string, re.M))
+    array = re.search(r'html_data_gz\[\] = \{\n(.*?)\n\};', text, re.S).group(1)
+    compressed = bytes(int(b, 16) for b in re.findall(r'0x([0-9a-f]{2})', array))
+    etags = dict(re.findall(r'#define (HTML_DATA\w*) "((?:[^"\\]|\\.)*)"', text))
+    return plain.encode('utf-8'), compressed, etags
+
+
+def main():
+    tool, source = sys.argv[1], sys.argv[2]
+    with open(source, 'rb') as f:
+        original = f.read()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        first = generate(tool, source, os.path.join(tmp, 'first.h'))
+        second = generate(tool, source, os.path.join(tmp, 'second.h'))
+        check(first == second, 'duas execuções geraram cabeçalhos diferentes')
+
+        plain, compressed, etags = parse(first)
+        check(gzip.decompress(compressed) == plain, 'o gzip não descomprime para a página sem gzip')
+        check(len(plain) < len(original), 'página minificada (%d) não é menor que a original (%d)' %
+              (len(plain), len(original)))
+        check(len(compressed) < len(plain) / 2, 'gzip (%d) não chega à metade da página (%d)' %
+              (len(compressed), len(plain)))
+        etag = hashlib.sha1(plain).hexdigest()[:16]
+        check(etags.get('HTML_DATA_ETAG_ID') == etag, 'ETag não é o hash da página')
+        check(etags.get('HTML_DATA_ETAG') == '\\"%s\\"' % etag, 'HTML_DATA_ETAG: %s' % etags.get('HTML_DATA_ETAG'))
+        check(etags.get('HTML_DATA_GZ_ETAG') == '\\"%s-gz\\"' % etag,
+              'HTML_DATA_GZ_ETAG: %s' % etags.get('HTML_DATA_GZ_ETAG'))
+        # Comentários e espaços somem do JavaScript, as strings ficam como estão
+        check(b"console.error('Erro:',e)" in plain, 'chamada do script alterada')
+        check(b"'Atualizado: '" in plain, 'string do script alterada')
+
+        # Uma mudança no conteúdo muda os ETags; uma mudança só em comentário não
+        changed = os.path.join(tmp, 'changed.html')
+        with open(changed, 'wb') as f:
+            f.write(original.replace(b'</body>', b'<p>x</p></body>'))
+        _, _, changed_etags = parse(generate(tool, changed, os.path.join(tmp, 'changed.h')))
+        for name in ('HTML_DATA_ETAG', 'HTML_DATA_GZ_ETAG', 'HTML_DATA_ETAG_ID'):
+            check(changed_etags.get(name) != etags.get(name), '%s não mudou com o conteúdo' % name)
+        comment = os.path.join(tmp, 'comment.html')
+        with open(comment, 'wb') as f:
+            f.write(original.replace(b'</body>', '<!-- comentário -->\n</body>'.encode('utf-8')))
+        _, _, comment_etags = parse(generate(tool, comment, os.path.join(tmp, 'comment.h')))
+        check(comment_etags == etags, 'um comentário HTML mudou o ETag')
+
+    return 1 if failures else 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -0,0 +1,386 @@
+#include "test.h"
+#include "http_parser/http_parser.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Requisições inteiras e em pedaços de qualquer tamanho, pipelining e as respostas de erro,
+// entradas aleatórias em cortes aleatórios e a vazão do parser
+
+// Entrega 'text' em pedaços de 'step' bytes. Retorna o estado final e, em 'consumed', os bytes aceitos
+static http_parser_status_t feed(http_parser_t *parser, const char *text, size_t step, size_t *consumed)
+{
+    http_parser_status_t status = HTTP_PARSER_INCOMPLETE;
+    size_t len = strlen(text), pos = 0;
+
+    http_parser_init(parser);
+    while (pos < len && status == HTTP_PARSER_INCOMPLETE)
+    {
+        size_t chunk = len - pos < step ? len - pos : step;
+        size_t used = http_parser_feed(parser, text + pos, chunk, &status);
+        pos += used;
+        if (used < chunk)
+            break;
+    }
+    if (consumed)
+        *consumed = pos;
+    return status;
+}
+
+static const char get_request[] =
+    "GET /historico?de=10&ate=20&pontos=300 HTTP/1.1\r\n"
+    "Host: 192.168.0.10\r\n"
+    "accept-encoding: deflate, GZIP\r\n"
+    "Connection:   keep-alive  \r\n"
+    "If-None-Match: \"abc\"\r\n"
+    "\r\n";
+
+static void test_get_any_split(void)
+{
+    // O resultado não depende de como os bytes chegam
+    for (size_t step = 1; step <= sizeof(get_request); step++)
+    {
+        http_parser_t parser;
+        size_t consumed;
+        CHECK_EQ(feed(&parser, get_request, step, &consumed), HTTP_PARSER_DONE);
+        CHECK_EQ(consumed, strlen(get_request));
+        CHECK_EQ(parser.method, HTTP_METHOD_GET);
+        CHECK(strcmp(parser.path, "/historico") == 0);
+        CHECK(strcmp(parser.query, "de=10&ate=20&pontos=300") == 0);
+        CHECK(parser.http11);
+        CHECK(parser.accept_gzip);
+        CHECK(parser.connection_keep_alive);
+        CHECK(!parser.connection_close);
+        CHECK(strcmp(parser.if_none_match, "\"abc\"") == 0);
+        CHECK_EQ(parser.body_len, 0);
+    }
+}
+
+static void test_query(void)
+{
+    http_parser_t parser;
+    size_t len;
+    const char *value;
+
+    CHECK_EQ(feed(&parser, get_request, sizeof(get_request), NULL), HTTP_PARSER_DONE);
+    value = http_parser_query(&parser, "ate", &len);
+    CHECK(value && len == 2 && memcmp(value, "20", 2) == 0);
+    value = http_parser_query(&parser, "pontos", &len);
+    CHECK(value && len == 3 && memcmp(value, "300", 3) == 0);
+    // Prefixo de outro nome não conta
+    CHECK(http_parser_query(&parser, "de", &len) && len == 2);
+    CHECK(http_parser_query(&parser, "d", &len) == NULL);
+    CHECK(http_parser_query(&parser, "formato", &len) == NULL);
+}
+
+static void test_post_body(void)
+{
+    const char request[] =
+        "POST /limites HTTP/1.0\n"
+        "Content-Length: 11\n"
+        "\n"
+        "min=20&max=80";
+    for (size_t step = 1; step <= sizeof(request); step++)
+    {
+        http_parser_t parser;
+        size_t consumed;
+        CHECK_EQ(feed(&parser, request, step, &consumed), HTTP_PARSER_DONE);
+        CHECK_EQ(parser.method, HTTP_METHOD_POST);
+        CHECK(!parser.http11);
+        CHECK_EQ(parser.body_len, 11);
+        CHECK(strcmp(parser.body, "min=20&max=") == 0);
+        // O que passa do Content-Length fica para a próxima requisição
+        CHECK_EQ(consumed, strlen(request) - 2);
+    }
+}
+
+static void test_pipelining(void)
+{
+    const char requests[] = "HEAD / HTTP/1.1\r\n\r\nGET /estado HTTP/1.1\r\nConnection: close\r\n\r\n";
+    http_parser_t parser;
+    http_parser_status_t status;
+
+    http_parser_init(&parser);
+    size_t used = http_parser_feed(&parser, requests, strlen(requests), &status);
+    CHECK_EQ(status, HTTP_PARSER_DONE);
+    CHECK_EQ(parser.method, HTTP_METHOD_HEAD);
+    CHECK_EQ(used, strlen("HEAD / HTTP/1.1\r\n\r\n"));
+
+    http_parser_init(&parser);
+    size_t rest = http_parser_feed(&parser, requests + used, strlen(requests) - used, &status);
+    CHECK_EQ(status, HTTP_PARSER_DONE);
+    CHECK_EQ(used + rest, strlen(requests));
+    CHECK_EQ(parser.method, HTTP_METHOD_GET);
+    CHECK(strcmp(parser.path, "/estado") == 0);
+    CHECK(parser.connection_close);
+}
+
+static void test_errors(void)
+{
+    http_parser_t parser;
+    char request[HTTP_PARSER_MAX_HEADER_BYTES + 64];
+
+    CHECK_EQ(feed(&parser, "GET / HTTP/2.0\r\n\r\n", 64, NULL), HTTP_PARSER_ERROR);
+    CHECK_EQ(parser.error_status, 400);
+    CHECK_EQ(feed(&parser, " / HTTP/1.1\r\n\r\n", 64, NULL), HTTP_PARSER_ERROR);
+    CHECK_EQ(parser.error_status, 400);
+    CHECK_EQ(feed(&parser, "GET / HTTP/1.1\r\nContent-Length: 12a\r\n\r\n", 64, NULL), HTTP_PARSER_ERROR);
+    CHECK_EQ(parser.error_status, 400);
+    CHECK_EQ(feed(&parser, "POST / HTTP/1.1\r\nContent-Length: 129\r\n\r\n", 64, NULL), HTTP_PARSER_ERROR);
+    CHECK_EQ(parser.error_status, 413);
+
+    // Caminho no limite é aceito, um byte a mais não
+    memset(request, 0, sizeof(request));
+    strcpy(request, "GET /");
+    memset(request + 5, 'a', HTTP_PARSER_MAX_PATH - 1);
+    strcat(request, " HTTP/1.1\r\n\r\n");
+    CHECK_EQ(feed(&parser, request, 64, NULL), HTTP_PARSER_DONE);
+    CHECK_EQ(parser.path_len, HTTP_PARSER_MAX_PATH);
+    memset(request, 0, sizeof(request));
+    strcpy(request, "GET /");
+    memset(request + 5, 'a', HTTP_PARSER_MAX_PATH);
+    strcat(request, " HTTP/1.1\r\n\r\n");
+    CHECK_EQ(feed(&parser, request, 64, NULL), HTTP_PARSER_ERROR);
+    CHECK_EQ(parser.error_status, 414);
+
+    // Cabeçalhos grandes demais
+    memset(request, 0, sizeof(request));
+    strcpy(request, "GET / HTTP/1.1\r\nCookie: ");
+    memset(request + strlen(request), 'x', HTTP_PARSER_MAX_HEADER_BYTES);
+    strcat(request, "\r\n\r\n");
+    CHECK_EQ(feed(&parser, request, 64, NULL), HTTP_PARSER_ERROR);
+    CHECK_EQ(parser.error_status, 431);
+}
+
+static void test_unrecognized_headers(void)
+{
+    http_parser_t parser;
+
+    // Nome longo que começa como um reconhecido, e valor reconhecido longo demais (truncado)
+    CHECK_EQ(feed(&parser,
+                  "GET / HTTP/1.1\r\n"
+                  "Connection-And-Something-Else: close\r\n"
+                  "If-None-Match: \"0123456789012345678901234567890123456789012345678901234567890\"\r\n"
+                  "\r\n",
+                  64, NULL),
+             HTTP_PARSER_DONE);
+    CHECK(!parser.connection_close);
+    CHECK_EQ(strlen(parser.if_none_match), HTTP_PARSER_MAX_VALUE);
+
+    CHECK_EQ(feed(&parser, "PUT / HTTP/1.1\r\n\r\n", 64, NULL), HTTP_PARSER_DONE);
+    CHECK_EQ(parser.method, HTTP_METHOD_UNKNOWN);
+}
+
+static uint32_t lcg = 1;
+
+static uint32_t next_random(void)
+{
+    lcg = lcg * 1103515245u + 12345u;
+    return lcg >> 16;
+}
+
+// Requisições válidas, concatenadas e depois alteradas pelo fuzz, e pedaços inseridos nelas
+static const char *const requests[] = {
+    "GET / HTTP/1.1\r\nHost: x\r\nAccept-Encoding: gzip\r\n\r\n",
+    "HEAD /estado HTTP/1.0\n\n",
+    "GET /historico?de=1&ate=2 HTTP/1.1\r\nConnection: keep-alive\r\nIf-None-Match: \"abc\"\r\n\r\n",
+    "POST /limites HTTP/1.1\r\nContent-Length: 13\r\n\r\nmin=20&max=80",
+    "POST /bomba/on HTTP/1.0\r\nConnection: close\r\nContent-Length: 0\r\n\r\n",
+};
+static const char *const fragments[] = {
+    " ", "/", "?", "&", "=", ":", "\r\n", "\n", "\r", "\t", " HTTP/2.0", "Connection: close\r\n",
+    "Content-Length: ", "128", "129", "99999999999", "-1", "\r\n\r\n", "\xff",
+};
+
+#define COUNT(array) (sizeof(array) / sizeof(array[0]))
+
+// Parser cercado de bytes conhecidos: uma escrita fora da estrutura os altera
+typedef struct {
+    uint8_t before[64];
+    http_parser_t parser;
+    uint8_t after[64];
+} guarded_parser_t;
+
+static bool guards_intact(const guarded_parser_t *g)
+{
+    for (size_t i = 0; i < sizeof(g->before); i++)
+    {
+        if (g->before[i] != 0xA5 || g->after[i] != 0xA5)
+            return false;
+    }
+    return true;
+}
+
+// Invariantes que valem depois de qualquer chamada: campos dentro dos buffers e sempre terminados
+static void check_fields(const http_parser_t *parser)
+{
+    CHECK(parser->path_len <= HTTP_PARSER_MAX_PATH);
+    CHECK(parser->path_len <= HTTP_PARSER_MAX_PATH && parser->path[parser->path_len] == '\0');
+    CHECK(parser->query_len <= HTTP_PARSER_MAX_QUERY);
+    CHECK(parser->query_len <= HTTP_PARSER_MAX_QUERY && parser->query[parser->query_len] == '\0');
+    CHECK(parser->body_len <= HTTP_PARSER_MAX_BODY);
+    CHECK(parser->body_len <= HTTP_PARSER_MAX_BODY && parser->body[parser->body_len] == '\0');
+    CHECK(parser->token_len <= HTTP_PARSER_MAX_VALUE);
+    CHECK(memchr(parser->if_none_match, '\0', sizeof(parser->if_none_match)) != NULL);
+    CHECK(parser->header_bytes <= HTTP_PARSER_MAX_HEADER_BYTES + 1);
+}
+
+// Entrega 'data' em cortes aleatórios, cada um copiado num bloco do heap do tamanho exato (para que
+// uma leitura além do corte caia fora do bloco). Reinicia o parser a cada requisição terminada, como o
+// servidor faz no pipelining. Retorna quantas requisições terminaram e o estado da última
+static int fuzz_feed(guarded_parser_t *g, const char *data, size_t len, bool split, http_parser_status_t *last)
+{
+    size_t pos = 0;
+    int requests = 0;
+    http_parser_status_t status = HTTP_PARSER_INCOMPLETE;
+
+    http_parser_init(&g->parser);
+    while (pos < len)
+    {
+        size_t chunk = split ? 1 + next_random() % 64 : len - pos;
+        if (chunk > len - pos)
+            chunk = len - pos;
+        char *copy = malloc(chunk);
+        memcpy(copy, data + pos, chunk);
+        size_t used = http_parser_feed(&g->parser, copy, chunk, &status);
+        free(copy);
+
+        CHECK(used <= chunk);
+        CHECK(status == HTTP_PARSER_INCOMPLETE || status == HTTP_PARSER_DONE || status == HTTP_PARSER_ERROR);
+        check_fields(&g->parser);
+        if (status == HTTP_PARSER_INCOMPLETE)
+            CHECK_EQ(used, chunk); // Só para antes do fim do pedaço se a requisição terminou
+        pos += used;
+        if (status == HTTP_PARSER_ERROR)
+        {
+            CHECK(g->parser.error_status == 400 || g->parser.error_status == 413 ||
+                  g->parser.error_status == 414 || g->parser.error_status == 431);
+            break; // O servidor fecha a conexão
+        }
+        if (status == HTTP_PARSER_DONE)
+        {
+            requests++;
+            http_parser_init(&g->parser);
+        }
+    }
+    *last = status;
+    return requests;
+}
+
+static void test_fuzz(void)
+{
+    static char input[4096];
+    static guarded_parser_t whole, pieces;
+    int done = 0, errors = 0;
+
+    memset(&whole, 0xA5, sizeof(whole));
+    memset(&pieces, 0xA5, sizeof(pieces));
+    lcg = 12345;
+    for (int round = 0; round < 20000; round++)
+    {
+        size_t len = 0, target = 1 + next_random() % (round % 10 == 0 ? sizeof(input) : 512);
+        if (next_random() % 4 == 0)
+        {
+            // Um quarto das entradas é só ruído
+            while (len < target)
+                input[len++] = (char)next_random();
+        }
+        else
+        {
+            while (len < target)
+            {
+                const char *r = requests[next_random() % COUNT(requests)];
+                size_t n = strlen(r) < target - len ? strlen(r) : target - len;
+                memcpy(input + len, r, n);
+                len += n;
+            }
+            // Algumas alterações: um byte trocado, um pedaço inserido ou um trecho removido
+            for (uint32_t m = next_random() % 4; m > 0 && len > 0; m--)
+            {
+                size_t at = next_random() % len;
+                uint32_t kind = next_random() % 3;
+                if (kind == 0)
+                    input[at] = (char)next_random();
+                else if (kind == 1)
+                {
+                    const char *f = fragments[next_random() % COUNT(fragments)];
+                    size_t n = strlen(f);
+                    if (len + n <= sizeof(input))
+                    {
+                        memmove(input + at + n, input + at, len - at);
+                        memcpy(input + at, f, n);
+                        len += n;
+                    }
+                }
+                else
+                {
+                    size_t n = 1 + next_random() % 8;
+                    if (n > len - at)
+                        n = len - at;
+                    memmove(input + at, input + at + n, len - at - n);
+                    len -= n;
+                }
+            }
+        }
+        if (len == 0)
+            continue;
+
+        // O resultado não depende dos cortes
+        http_parser_status_t status_whole, status_pieces;
+        int requests = fuzz_feed(&whole, input, len, false, &status_whole);
+        CHECK_EQ(fuzz_feed(&pieces, input, len, true, &status_pieces), requests);
+        CHECK_EQ(status_pieces, status_whole);
+        CHECK_EQ(pieces.parser.method, whole.parser.method);
+        CHECK(strcmp(pieces.parser.path, whole.parser.path) == 0);
+        CHECK_EQ(pieces.parser.body_len, whole.parser.body_len);
+        CHECK_EQ(pieces.parser.error_status, whole.parser.error_status);
+        CHECK(guards_intact(&whole) && guards_intact(&pieces));
+        done += requests;
+        errors += status_whole == HTTP_PARSER_ERROR;
+    }
+    // O fuzz exercitou os dois finais
+    CHECK(done > 100);
+    CHECK(errors > 100);
+    printf("fuzz: %d requisições completas, %d erros\n", done, errors);
+}
+
+// Vazão com a requisição típica do painel, em pedaços do tamanho de um segmento TCP e byte a byte
+static void test_benchmark(void)
+{
+    const int rounds = 200000;
+    const size_t steps[] = {1460, 1};
+    size_t len = strlen(get_request);
+
+    for (size_t s = 0; s < sizeof(steps) / sizeof(steps[0]); s++)
+    {
+        int ok = 0;
+        int n = steps[s] == 1 ? rounds / 10 : rounds;
+        clock_t start = clock();
+        for (int r = 0; r < n; r++)
+        {
+            http_parser_t parser;
+            size_t consumed;
+            ok += feed(&parser, get_request, steps[s], &consumed) == HTTP_PARSER_DONE && consumed == len;
+        }
+        double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+        if (seconds <= 0)
+            seconds = 1e-6;
+        CHECK_EQ(ok, n);
+        printf("parser, pedaços de %u bytes: %.2f M requisições/s, %.1f MB/s\n", (unsigned)steps[s],
+               n / seconds / 1e6, (double)n * len / seconds / 1e6);
+    }
+}
+
+int main(void)
+{
+    test_get_any_split();
+    test_query();
+    test_post_body();
+    test_pipelining();
+    test_errors();
+    test_unrecognized_headers();
+    test_fuzz();
+    test_benchmark();
+    return TEST_RESULT;
+}
@@ -0,0 +1,865 @@
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "test.h"
+#include "http_server/http_server.h"
+
+// Servidor HTTP sobre o lwIP emulado (host/lwip.c): o teste faz o papel dos clientes, abrindo conexões,
+// enviando requisições e confirmando os bytes no ritmo que quiser
+
+#define PAGE_SIZE 10000
+#define HISTORY_RECORDS 500
+
+static char page[PAGE_SIZE];
+static char page_header[HTTP_HEADER_SIZE];
+static int page_header_len;
+static timeseries_t history;
+
+// Rotas de teste: a página estática (referenciada, sem cópia), uma resposta pequena, o histórico gerado
+// aos pedaços e o canal de eventos
+static void handler(struct http_state *hs, const http_parser_t *req)
+{
+    if (strcmp(req->path, "/") == 0)
+    {
+        hs->header = page_header;
+        hs->header_len = page_header_len;
+        hs->body = page;
+        hs->body_len = PAGE_SIZE;
+    }
+    else if (strcmp(req->path, "/pequena") == 0)
+    {
+        http_reply_small(hs, "200 OK", "text/plain", "ok", 2);
+    }
+    else if (strcmp(req->path, "/historico") == 0)
+    {
+        timeseries_range_t range;
+        timeseries_query(&history, 0, UINT32_MAX, 0, &range);
+        http_reply_history(hs, &history, TIMESERIES_FORMAT_JSON, &range);
+    }
+    else if (strcmp(req->path, "/eventos") == 0)
+    {
+        http_reply_events(hs);
+    }
+    else
+    {
+        http_reply_small(hs, "404 Not Found", "text/plain", "Nao encontrado", 14);
+    }
+}
+
+static void setup(void)
+{
+    for (int i = 0; i < PAGE_SIZE; i++)
+        page[i] = 'a' + i % 26;
+    // O cabeçalho da página é de uma conexão persistente, como o firmware monta para keep_alive = 1
+    page_header_len = http_build_header(page_header, "200 OK", NULL, "\"etag\"", PAGE_SIZE, true);
+    timeseries_init(&history, 100);
+    for (int i = 0; i < HISTORY_RECORDS; i++)
+        timeseries_insert(&history, i % 100, i % 7 ? 0 : TIMESERIES_FLAG_PUMP, 20, 80, i * 100);
+    host_tcp_reset();
+    CHECK(http_server_start(80, handler));
+    CHECK(host_tcp_listener != NULL);
+}
+
+static struct tcp_pcb *connect_client(void)
+{
+    struct tcp_pcb *pcb = host_tcp_connect();
+    CHECK(pcb && !pcb->aborted);
+    CHECK(pcb->poll_interval == HTTP_POLL_INTERVAL);
+    return pcb;
+}
+
+static void send_text(struct tcp_pcb *pcb, const char *text)
+{
+    host_tcp_send(pcb, text, strlen(text), 1460);
+}
+
+static bool is_open(const struct tcp_pcb *pcb)
+{
+    return !pcb->closed && !pcb->aborted;
+}
+
+// O cliente fecha: o servidor fecha o seu lado e devolve o slot
+static void disconnect(struct tcp_pcb *pcb)
+{
+    if (is_open(pcb))
+    {
+        host_tcp_remote_close(pcb);
+        CHECK(pcb->closed);
+    }
+}
+
+// A página sai aos pedaços do tamanho do buffer de envio, cada um escrito quando o cliente confirma o anterior
+static void test_pacing(void)
+{
+    struct tcp_pcb *pcb = connect_client();
+    u32_t len;
+    u32_t total = page_header_len + PAGE_SIZE;
+
+    send_text(pcb, "GET / HTTP/1.1\r\n\r\n");
+    // O primeiro envio enche o buffer e para
+    CHECK_EQ(pcb->unacked, host_tcp_snd_buf);
+    CHECK_EQ(pcb->snd_buf, 0);
+    CHECK_EQ(pcb->out_total, host_tcp_snd_buf);
+    CHECK_EQ(pcb->recved, strlen("GET / HTTP/1.1\r\n\r\n"));
+
+    // Cada confirmação libera espaço, que o servidor preenche na hora
+    u32_t sent = pcb->out_total;
+    while (pcb->unacked)
+    {
+        u32_t before = pcb->out_total;
+        host_tcp_ack(pcb, 1000 < pcb->unacked ? 1000 : pcb->unacked);
+        u32_t written = pcb->out_total - before;
+        CHECK(written <= 1000);
+        CHECK(pcb->out_total == total || written == 1000); // Escreve tudo o que coube, até o fim da resposta
+        sent = pcb->out_total;
+    }
+    CHECK_EQ(sent, total);
+    const char *out = host_tcp_take(pcb, &len);
+    CHECK_EQ(len, total);
+    CHECK(strncmp(out, page_header, page_header_len) == 0);
+    CHECK(memcmp(out + page_header_len, page, PAGE_SIZE) == 0);
+    CHECK(pcb->outputs > 0);
+    // A página foi referenciada sem cópia e ficou intacta até ser confirmada
+    CHECK_EQ(host_tcp_ref_changed, 0);
+    CHECK(is_open(pcb)); // HTTP/1.1: a conexão continua
+
+    // A resposta pequena é copiada e vai de uma vez
+    u32_t writes = pcb->writes;
+    send_text(pcb, "GET /pequena HTTP/1.1\r\nConnection: close\r\n\r\n");
+    CHECK_EQ(pcb->writes, writes + 1);
+    out = host_tcp_take(pcb, &len);
+    CHECK(strncmp(out, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    CHECK(strstr(out, "Connection: close\r\n") != NULL);
+    CHECK(len > 2 && memcmp(out + len - 6, "\r\n\r\nok", 6) == 0);
+    CHECK(is_open(pcb)); // Fecha só depois da confirmação
+    host_tcp_ack_all(pcb);
+    CHECK(pcb->closed);
+    CHECK_EQ(http_server_stats.active_connections, 0);
+}
+
+// Oito conexões ocupadas enchem a tabela: a nona é recusada sem alocar nada, e o slot liberado é reaproveitado
+static void test_slot_limit(void)
+{
+    struct tcp_pcb *pcbs[HTTP_MAX_CONNECTIONS];
+    uint32_t accepted = http_server_stats.connections_accepted;
+
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        pcbs[i] = connect_client();
+        send_text(pcbs[i], "GET / HTTP/1.1\r\n\r\n"); // Respostas em andamento: nenhuma pode ser despejada
+        CHECK(pcbs[i]->unacked > 0);
+    }
+    CHECK_EQ(http_server_stats.active_connections, HTTP_MAX_CONNECTIONS);
+    CHECK_EQ(http_server_stats.connections_peak, HTTP_MAX_CONNECTIONS);
+
+    struct tcp_pcb *refused = host_tcp_connect();
+    CHECK(refused->aborted);
+    CHECK(refused->recv == NULL);
+    CHECK_EQ(http_server_stats.active_connections, HTTP_MAX_CONNECTIONS);
+    CHECK_EQ(http_server_stats.connections_accepted, accepted + HTTP_MAX_CONNECTIONS);
+
+    // Uma resposta termina e o cliente fecha: o slot volta para a próxima conexão
+    host_tcp_ack_all(pcbs[3]);
+    disconnect(pcbs[3]);
+    CHECK_EQ(http_server_stats.active_connections, HTTP_MAX_CONNECTIONS - 1);
+    pcbs[3] = connect_client();
+    send_text(pcbs[3], "GET /pequena HTTP/1.1\r\n\r\n");
+    CHECK(strstr(host_tcp_take(pcbs[3], NULL), "\r\n\r\nok") != NULL);
+
+    // As outras respostas continuam intactas
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        host_tcp_ack_all(pcbs[i]);
+        if (i != 3)
+        {
+            u32_t len;
+            const char *out = host_tcp_take(pcbs[i], &len);
+            CHECK_EQ(len, page_header_len + PAGE_SIZE);
+            CHECK(memcmp(out + page_header_len, page, PAGE_SIZE) == 0);
+        }
+        disconnect(pcbs[i]);
+    }
+    CHECK_EQ(http_server_stats.active_connections, 0);
+
+    // Abrir e fechar muitas vezes não esgota os slots nem deixa pbufs para trás
+    for (int i = 0; i < 1000; i++)
+    {
+        struct tcp_pcb *pcb = connect_client();
+        send_text(pcb, i % 2 ? "GET /pequena HTTP/1.0\r\n\r\n" : "GET / HTTP/1.1\r\nConnection: close\r\n\r\n");
+        host_tcp_ack_all(pcb);
+        CHECK(pcb->closed);
+    }
+    CHECK_EQ(http_server_stats.active_connections, 0);
+    CHECK_EQ(host_pbuf_live, 0);
+    CHECK_EQ(host_tcp_ref_changed, 0);
+}
+
+// O tcp_write falha (ERR_MEM) sem nada em voo: nenhuma confirmação virá, então o poll retoma a resposta.
+// Se o lwIP nunca aceitar os bytes, a conexão é encerrada depois de HTTP_SEND_RETRIES polls e o slot volta
+static void test_send_retry(void)
+{
+    struct tcp_pcb *pcb = connect_client();
+    u32_t len;
+
+    pcb->fail_writes = 3;
+    send_text(pcb, "GET / HTTP/1.1\r\n\r\n");
+    CHECK_EQ(pcb->unacked, 0);
+    CHECK_EQ(pcb->out_total, 0);
+    for (int i = 0; i < 2; i++)
+    {
+        host_tcp_poll(pcb);
+        CHECK(is_open(pcb));
+        CHECK_EQ(pcb->out_total, 0);
+    }
+    host_tcp_poll(pcb); // A terceira falha foi a última: a resposta volta a andar pelas confirmações
+    CHECK_EQ(pcb->unacked, host_tcp_snd_buf);
+    host_tcp_ack_all(pcb);
+    const char *out = host_tcp_take(pcb, &len);
+    CHECK_EQ(len, page_header_len + PAGE_SIZE);
+    CHECK(memcmp(out + page_header_len, page, PAGE_SIZE) == 0);
+
+    // Uma resposta pequena também é retomada, e a próxima requisição segue normalmente
+    pcb->fail_writes = 1;
+    send_text(pcb, "GET /pequena HTTP/1.1\r\n\r\n");
+    CHECK_EQ(pcb->unacked, 0);
+    host_tcp_poll(pcb);
+    host_tcp_ack_all(pcb);
+    CHECK(strstr(host_tcp_take(pcb, NULL), "\r\n\r\nok") != NULL);
+    send_text(pcb, "GET /pequena HTTP/1.1\r\n\r\n");
+    CHECK(strstr(host_tcp_take(pcb, NULL), "\r\n\r\nok") != NULL);
+    host_tcp_ack_all(pcb);
+
+    // Falha permanente: desiste depois de HTTP_SEND_RETRIES polls seguidos sem progresso
+    pcb->fail_writes = 1000;
+    send_text(pcb, "GET / HTTP/1.1\r\n\r\n");
+    for (int i = 0; i < HTTP_SEND_RETRIES - 1; i++)
+    {
+        host_tcp_poll(pcb);
+        CHECK(is_open(pcb));
+    }
+    host_tcp_poll(pcb);
+    CHECK(pcb->closed);
+    CHECK_EQ(http_server_stats.active_connections, 0);
+    CHECK_EQ(host_pbuf_live, 0);
+}
+
+// Corpo que o histórico inteiro deve produzir
+static const char *history_body(u32_t *len)
+{
+    static char body[HOST_TCP_OUT_SIZE];
+    timeseries_range_t range;
+    timeseries_reader_t reader;
+    timeseries_query(&history, 0, UINT32_MAX, 0, &range);
+    timeseries_reader_init(&reader, &history, TIMESERIES_FORMAT_JSON, &range);
+    int n = timeseries_read(&reader, (uint8_t *)body, sizeof(body));
+    CHECK(n > 0 && timeseries_read(&reader, (uint8_t *)body, sizeof(body)) == 0);
+    *len = n;
+    return body;
+}
+
+// Confere uma resposta do histórico completa: cabeçalho com o Content-Length certo e o corpo gerado
+static void check_history(const char *out, u32_t len)
+{
+    u32_t body_len;
+    const char *body = history_body(&body_len);
+    const char *end = strstr(out, "\r\n\r\n");
+    char content_length[48];
+    snprintf(content_length, sizeof(content_length), "Content-Length: %lu\r\n", (unsigned long)body_len);
+    CHECK(strncmp(out, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    CHECK(end && strstr(out, content_length) && strstr(out, content_length) < end);
+    CHECK(end && len == (u32_t)(end + 4 - out) + body_len && memcmp(end + 4, body, body_len) == 0);
+}
+
+// O histórico é gerado aos pedaços: o cabeçalho em 'small' precisa entrar inteiro no buffer de envio.
+// Se não couber, ou o primeiro tcp_write falhar, nada fica em voo e o poll retoma a resposta
+static void test_stream_retry(void)
+{
+    struct tcp_pcb *pcb = connect_client();
+    u32_t len;
+
+    // Sem pressão: a resposta anda pelas confirmações
+    send_text(pcb, "GET /historico HTTP/1.1\r\n\r\n");
+    CHECK(pcb->unacked > 0);
+    host_tcp_ack_all(pcb);
+    const char *out = host_tcp_take(pcb, &len);
+    check_history(out, len);
+    CHECK(is_open(pcb));
+
+    // Buffer de envio menor que o cabeçalho (ocupado por outras conexões): nada sai até ele liberar
+    pcb->snd_buf = 40;
+    send_text(pcb, "GET /historico HTTP/1.1\r\n\r\n");
+    CHECK_EQ(pcb->unacked, 0);
+    host_tcp_poll(pcb);
+    CHECK(is_open(pcb));
+    CHECK_EQ(pcb->unacked, 0);
+    pcb->snd_buf = host_tcp_snd_buf;
+    host_tcp_poll(pcb);
+    CHECK(pcb->unacked > 0);
+    host_tcp_ack_all(pcb);
+    out = host_tcp_take(pcb, &len);
+    check_history(out, len);
+
+    // O tcp_write do cabeçalho falha uma ou duas vezes seguidas
+    for (int fail = 1; fail <= 2; fail++)
+    {
+        pcb->fail_writes = fail;
+        send_text(pcb, "GET /historico HTTP/1.1\r\n\r\n");
+        for (int i = 0; i < fail; i++)
+            host_tcp_poll(pcb);
+        host_tcp_ack_all(pcb);
+        out = host_tcp_take(pcb, &len);
+        check_history(out, len);
+        CHECK(is_open(pcb));
+    }
+
+    // Nunca cabe: encerrada depois de HTTP_SEND_RETRIES polls, sem reter o slot
+    pcb->snd_buf = 40;
+    send_text(pcb, "GET /historico HTTP/1.1\r\n\r\n");
+    for (int i = 0; i < HTTP_SEND_RETRIES; i++)
+        host_tcp_poll(pcb);
+    CHECK(pcb->closed);
+    CHECK_EQ(http_server_stats.active_connections, 0);
+    CHECK_EQ(host_pbuf_live, 0);
+}
+
+// Avança o relógio emulado
+static void advance_ms(uint32_t ms)
+{
+    host_time_us += (uint64_t)ms * 1000;
+}
+
+// Responde tudo o que a conexão tiver pendente e devolve a saída acumulada
+static const char *drain(struct tcp_pcb *pcb, u32_t *len)
+{
+    host_tcp_ack_all(pcb);
+    return host_tcp_take(pcb, len);
+}
+
+// Várias requisições no mesmo segmento, ou uma requisição dividida entre segmentos: cada uma é
+// respondida inteira, na ordem de chegada, e a próxima só começa depois da confirmação da anterior
+static void test_pipelining(void)
+{
+    const char *requests = "GET /pequena HTTP/1.1\r\n\r\n"
+                           "GET /nada HTTP/1.1\r\nHost: x\r\n\r\n"
+                           "GET / HTTP/1.1\r\n\r\n"
+                           "HEAD / HTTP/1.1\r\n\r\n"
+                           "GET /pequena HTTP/1.1\r\n\r\n";
+    static char expected[HOST_TCP_OUT_SIZE + 1];
+    u32_t expected_len;
+    u32_t requests_before = http_server_stats.requests;
+
+    // Tudo em um segmento: só a primeira resposta sai, as outras esperam a confirmação dela
+    struct tcp_pcb *pcb = connect_client();
+    send_text(pcb, requests);
+    u32_t first, rest;
+    const char *out = host_tcp_take(pcb, &first);
+    memcpy(expected, out, first);
+    CHECK(first > 0 && pcb->unacked == first);
+    CHECK(pcb->recved < strlen(requests)); // A janela só abre para o que já foi atendido
+    out = drain(pcb, &rest);
+    memcpy(expected + first, out, rest + 1);
+    expected_len = first + rest;
+    CHECK_EQ(pcb->recved, strlen(requests));
+    CHECK_EQ(http_server_stats.requests, requests_before + 5);
+
+    // As respostas, na ordem: pequena, 404, página, cabeçalhos da página sem corpo, pequena
+    const char *p = expected;
+    CHECK(strncmp(p, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    p = strstr(p, "\r\n\r\nok");
+    CHECK(p && strncmp(p + 6, "HTTP/1.1 404 Not Found\r\n", 24) == 0);
+    p = strstr(p + 6, "Nao encontrado");
+    CHECK(p && strncmp(p + 14, page_header, page_header_len) == 0);
+    p += 14 + page_header_len;
+    CHECK(memcmp(p, page, PAGE_SIZE) == 0);
+    p += PAGE_SIZE;
+    CHECK(strncmp(p, page_header, page_header_len) == 0); // HEAD: Content-Length do GET, sem o corpo
+    p += page_header_len;
+    CHECK(strncmp(p, "HTTP/1.1 200 OK\r\n", 17) == 0);
+    CHECK(strcmp(expected + expected_len - 6, "\r\n\r\nok") == 0);
+    CHECK(is_open(pcb));
+    disconnect(pcb);
+
+    // Divididas em segmentos de vários tamanhos, inclusive um byte por vez: a mesma saída
+    const size_t splits[] = {1, 2, 7, 19, 64};
+    for (size_t i = 0; i < sizeof(splits) / sizeof(splits[0]); i++)
+    {
+        pcb = connect_client();
+        host_tcp_send(pcb, requests, strlen(requests), splits[i]);
+        u32_t len;
+        out = drain(pcb, &len);
+        CHECK_EQ(len, expected_len);
+        CHECK(memcmp(out, expected, len) == 0);
+        disconnect(pcb);
+    }
+
+    // Uma requisição chega em dois segmentos separados por respostas em andamento
+    pcb = connect_client();
+    send_text(pcb, "GET / HTTP/1.1\r\n\r\nGET /peq");
+    host_tcp_ack(pcb, 100);
+    send_text(pcb, "uena HTTP/1.1\r\n\r\n");
+    u32_t len;
+    out = drain(pcb, &len);
+    CHECK_EQ(len, page_header_len + PAGE_SIZE + first);
+    CHECK(strcmp(out + len - 6, "\r\n\r\nok") == 0);
+    disconnect(pcb);
+    CHECK_EQ(http_server_stats.active_connections, 0);
+    CHECK_EQ(host_pbuf_live, 0);
+}
+
+// pbufs vazios no meio da cadeia (o lwIP pode entregá-los) são descartados, sem travar as requisições seguintes
+static void test_empty_pbufs(void)
+{
+    const char *parts[] = {"", "GET /peq", "", "", "uena HTTP/1.1\r\n\r\n", "", "GET /pequena HTTP/1.1\r\n\r\n", ""};
+    struct tcp_pcb *pcb = connect_client();
+    struct pbuf *head = NULL;
+    for (size_t i = 0; i < sizeof(parts) / sizeof(parts[0]); i++)
+    {
+        struct pbuf *p = host_pbuf(parts[i], strlen(parts[i]));
+        if (head)
+            pbuf_cat(head, p);
+        else
+            head = p;
+    }
+    uint32_t requests = http_server_stats.requests;
+    host_tcp_recv(pcb, head);
+    u32_t len;
+    const char *out = drain(pcb, &len);
+    CHECK_EQ(http_server_stats.requests, requests + 2);
+    const char *second = strstr(out, "\r\n\r\nok");
+    CHECK(second && strstr(second + 6, "\r\n\r\nok") == out + len - 6);
+    CHECK_EQ(host_pbuf_live, 0);
+
+    // Um pbuf vazio sozinho não gera resposta nem fica retido
+    host_tcp_recv(pcb, host_pbuf(NULL, 0));
+    CHECK_EQ(pcb->out_len, 0);
+    CHECK_EQ(host_pbuf_live, 0);
+    send_text(pcb, "GET /pequena HTTP/1.1\r\n\r\n");
+    CHECK(strstr(drain(pcb, NULL), "\r\n\r\nok") != NULL);
+    disconnect(pcb);
+}
+
+// HTTP/1.1 mantém a conexão por padrão, HTTP/1.0 só se o cliente pedir. A resposta sempre diz o que vai acontecer
+static void test_connection_defaults(void)
+{
+    static const struct {
+        const char *request;
+        bool keep_alive;
+    } cases[] = {
+        {"GET /pequena HTTP/1.1\r\n\r\n", true},
+        {"GET /pequena HTTP/1.1\r\nConnection: close\r\n\r\n", false},
+        {"GET /pequena HTTP/1.0\r\n\r\n", false},
+        {"GET /pequena HTTP/1.0\r\nConnection: keep-alive\r\n\r\n", true},
+        {"GET /nada HTTP/1.0\r\nConnection: keep-alive\r\n\r\n", true},
+        {"GARBAGE\r\n\r\n", false}, // Requisição inválida: não dá para saber onde começa a próxima
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        struct tcp_pcb *pcb = connect_client();
+        send_text(pcb, cases[i].request);
+        const char *out = host_tcp_take(pcb, NULL);
+        CHECK(strstr(out, cases[i].keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n") != NULL);
+        CHECK(is_open(pcb)); // Só fecha depois da confirmação
+        host_tcp_ack_all(pcb);
+        CHECK_EQ(is_open(pcb), cases[i].keep_alive);
+        if (cases[i].keep_alive)
+        {
+            // A conexão serve a próxima requisição
+            send_text(pcb, "GET /pequena HTTP/1.1\r\nConnection: close\r\n\r\n");
+            CHECK(strstr(host_tcp_take(pcb, NULL), "\r\n\r\nok") != NULL);
+            host_tcp_ack_all(pcb);
+            CHECK(pcb->closed);
+        }
+    }
+
+    // O que vier depois de uma requisição com Connection: close é ignorado
+    struct tcp_pcb *pcb = connect_client();
+    uint32_t requests = http_server_stats.requests;
+    send_text(pcb, "GET /pequena HTTP/1.1\r\nConnection: close\r\n\r\nGET /pequena HTTP/1.1\r\n\r\n");
+    host_tcp_ack_all(pcb);
+    CHECK(pcb->closed);
+    CHECK_EQ(http_server_stats.requests, requests + 1);
+    CHECK_EQ(http_server_stats.active_connections, 0);
+    CHECK_EQ(host_pbuf_live, 0);
+}
+
+// Conexão persistente sem requisições por HTTP_IDLE_TIMEOUT_MS é encerrada no poll. Uma resposta em
+// andamento, lenta que seja, e um canal de eventos não contam como ociosos
+static void test_idle_timeout(void)
+{
+    struct tcp_pcb *idle = connect_client();    // Nunca envia nada
+    struct tcp_pcb *served = connect_client();  // Uma requisição atendida
+    struct tcp_pcb *partial = connect_client(); // Metade de uma requisição
+    struct tcp_pcb *slow = connect_client();    // Não confirma a resposta
+    struct tcp_pcb *events = connect_client();
+
+    advance_ms(1000);
+    send_text(served, "GET /pequena HTTP/1.1\r\n\r\n");
+    host_tcp_ack_all(served);
+    send_text(partial, "GET /pequena HTTP/1.1\r\nHo");
+    send_text(slow, "GET / HTTP/1.1\r\n\r\n");
+    send_text(events, "GET /eventos HTTP/1.1\r\n\r\n");
+    host_tcp_ack_all(events);
+
+    // 'idle' completa o tempo limite; as outras tiveram atividade 1 s depois
+    advance_ms(HTTP_IDLE_TIMEOUT_MS - 1000 - 1);
+    host_tcp_poll(idle);
+    CHECK(is_open(idle));
+    advance_ms(1);
+    host_tcp_poll(idle);
+    CHECK(idle->closed);
+
+    advance_ms(999);
+    host_tcp_poll(served);
+    host_tcp_poll(partial);
+    CHECK(is_open(served) && is_open(partial));
+    advance_ms(1);
+    host_tcp_poll(served);
+    host_tcp_poll(partial);
+    CHECK(served->closed && partial->closed);
+
+    // Muito depois, quem está no meio de uma resposta ou recebendo eventos continua aberto. A resposta
+    // sem nenhuma confirmação só é abandonada depois de HTTP_SEND_RETRIES polls (test_send_retry)
+    for (int i = 0; i < HTTP_SEND_RETRIES - 1; i++)
+    {
+        advance_ms(HTTP_IDLE_TIMEOUT_MS);
+        host_tcp_poll(slow);
+        host_tcp_poll(events);
+    }
+    CHECK(is_open(slow) && is_open(events));
+
+    // Terminada a resposta, o tempo limite conta a partir dela
+    host_tcp_ack_all(slow);
+    advance_ms(HTTP_IDLE_TIMEOUT_MS - 1);
+    host_tcp_poll(slow);
+    CHECK(is_open(slow));
+    advance_ms(1);
+    host_tcp_poll(slow);
+    CHECK(slow->closed);
+
+    disconnect(events);
+    CHECK_EQ(http_server_stats.active_connections, 0);
+    CHECK_EQ(http_server_stats.sse_clients, 0);
+    CHECK_EQ(host_pbuf_live, 0);
+}
+
+// Tabela cheia: uma conexão nova despeja a persistente ociosa há mais tempo, nunca uma com resposta
+// em andamento ou um canal de eventos. Sem ociosas, a nova é recusada
+static void test_eviction(void)
+{
+    struct tcp_pcb *idle[4];
+    const int activity_order[4] = {2, 0, 3, 1}; // Ordem da última atividade, diferente da dos slots
+    uint32_t evictions = http_server_stats.evictions;
+
+    for (int i = 0; i < 4; i++)
+        idle[i] = connect_client();
+    struct tcp_pcb *busy[2] = {connect_client(), connect_client()};
+    struct tcp_pcb *events[2] = {connect_client(), connect_client()};
+    for (int i = 0; i < 2; i++)
+    {
+        send_text(busy[i], "GET / HTTP/1.1\r\n\r\n");
+        send_text(events[i], "GET /eventos HTTP/1.1\r\n\r\n");
+        host_tcp_ack_all(events[i]);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        advance_ms(100);
+        send_text(idle[activity_order[i]], "GET /pequena HTTP/1.1\r\n\r\n");
+        host_tcp_ack_all(idle[activity_order[i]]);
+    }
+    advance_ms(100);
+    CHECK_EQ(http_server_stats.active_connections, HTTP_MAX_CONNECTIONS);
+
+    // Cada conexão nova tira a ociosa mais antiga e fica ocupada com uma resposta
+    struct tcp_pcb *fresh[4];
+    for (int i = 0; i < 4; i++)
+    {
+        fresh[i] = connect_client();
+        CHECK_EQ(http_server_stats.evictions, evictions + i + 1);
+        for (int j = 0; j < 4; j++)
+            CHECK_EQ(is_open(idle[activity_order[j]]), j > i);
+        send_text(fresh[i], "GET / HTTP/1.1\r\n\r\n");
+    }
+
+    // Só restam respostas em andamento e eventos: a próxima é recusada
+    struct tcp_pcb *refused = host_tcp_connect();
+    CHECK(refused->aborted);
+    CHECK_EQ(http_server_stats.evictions, evictions + 4);
+    CHECK_EQ(http_server_stats.active_connections, HTTP_MAX_CONNECTIONS);
+
+    // As respostas interrompidas pela disputa continuam intactas
+    for (int i = 0; i < 2; i++)
+    {
+        CHECK(is_open(busy[i]) && is_open(events[i]));
+        u32_t len;
+        const char *out = drain(busy[i], &len);
+        CHECK_EQ(len, page_header_len + PAGE_SIZE);
+        CHECK(memcmp(out + page_header_len, page, PAGE_SIZE) == 0);
+        disconnect(busy[i]);
+        disconnect(events[i]);
+    }
+    for (int i = 0; i < 4; i++)
+    {
+        host_tcp_ack_all(fresh[i]);
+        disconnect(fresh[i]);
+    }
+    CHECK_EQ(http_server_stats.active_connections, 0);
+    CHECK_EQ(http_server_stats.sse_clients, 0);
+    CHECK_EQ(host_pbuf_live, 0);
+}
+
+// Abre um canal de eventos e descarta o cabeçalho
+static struct tcp_pcb *open_events(void)
+{
+    struct tcp_pcb *pcb = connect_client();
+    send_text(pcb, "GET /eventos HTTP/1.1\r\n\r\n");
+    const char *out = drain(pcb, NULL);
+    CHECK(strstr(out, "Content-Type: text/event-stream\r\n") != NULL);
+    return pcb;
+}
+
+// Envia o estado a todos os canais e confere o que este recebeu ("" para nada)
+static void check_push(struct tcp_pcb *pcb, const http_sse_state_t *state, const char *expected)
+{
+    http_sse_push(state, (uint32_t)(host_time_us / 1000));
+    const char *out = drain(pcb, NULL);
+    if (strcmp(out, expected) != 0)
+    {
+        printf("evento: '%s', esperado '%s'\n", out, expected);
+        CHECK(false);
+    }
+}
+
+// O primeiro evento leva o estado completo, os seguintes só os campos que mudaram. Sem mudanças,
+// um comentário a cada HTTP_SSE_KEEPALIVE_MS
+static void test_sse_delta(void)
+{
+    uint32_t events = http_server_stats.sse_events;
+    http_sse_state_t state = {50, 0, 20, 80};
+    struct tcp_pcb *a = open_events();
+    CHECK_EQ(http_server_stats.sse_clients, 1);
+
+    check_push(a, &state, "data: {\"nivel_agua\":50,\"bomba_agua\":0,\"limite_minimo\":20,\"limite_maximo\":80}\n\n");
+    check_push(a, &state, "");
+    state.nivel = 51;
+    check_push(a, &state, "data: {\"nivel_agua\":51}\n\n");
+    state.bomba = 1;
+    state.max = 90;
+    check_push(a, &state, "data: {\"bomba_agua\":1,\"limite_maximo\":90}\n\n");
+
+    // Um cliente que chega depois recebe tudo, sem mudar o que o primeiro já tem
+    struct tcp_pcb *b = open_events();
+    check_push(b, &state, "data: {\"nivel_agua\":51,\"bomba_agua\":1,\"limite_minimo\":20,\"limite_maximo\":90}\n\n");
+    CHECK_EQ(a->out_len, 0);
+    state.min = 25;
+    http_sse_push(&state, (uint32_t)(host_time_us / 1000));
+    CHECK(strcmp(drain(a, NULL), "data: {\"limite_minimo\":25}\n\n") == 0);
+    CHECK(strcmp(drain(b, NULL), "data: {\"limite_minimo\":25}\n\n") == 0);
+
+    // Keep-alive só depois de HTTP_SSE_KEEPALIVE_MS sem eventos
+    advance_ms(HTTP_SSE_KEEPALIVE_MS - 1);
+    check_push(a, &state, "");
+    advance_ms(1);
+    check_push(a, &state, ": keep-alive\n\n");
+    check_push(a, &state, "");
+    CHECK_EQ(http_server_stats.sse_events, events + 8); // Seis deltas e o keep-alive dos dois canais
+
+    // O cliente não envia nada depois da requisição; se enviar, é descartado sem resposta
+    send_text(a, "GET /pequena HTTP/1.1\r\n\r\n");
+    CHECK_EQ(a->out_len, 0);
+    CHECK_EQ(host_pbuf_live, 0);
+
+    disconnect(a);
+    disconnect(b);
+    CHECK_EQ(http_server_stats.sse_clients, 0);
+}
+
+// Um evento que não cabe no buffer de envio não é perdido: o estado enviado fica onde estava e
+// as mudanças se juntam no próximo delta que couber
+static void test_sse_backpressure(void)
+{
+    http_sse_state_t state = {10, 0, 20, 80};
+    struct tcp_pcb *pcb = open_events();
+    check_push(pcb, &state, "data: {\"nivel_agua\":10,\"bomba_agua\":0,\"limite_minimo\":20,\"limite_maximo\":80}\n\n");
+
+    pcb->snd_buf = 10;
+    state.nivel = 11;
+    check_push(pcb, &state, "");
+    state.nivel = 12;
+    state.bomba = 1;
+    check_push(pcb, &state, "");
+    pcb->snd_buf = host_tcp_snd_buf;
+    check_push(pcb, &state, "data: {\"nivel_agua\":12,\"bomba_agua\":1}\n\n");
+
+    // Uma falha do tcp_write também não avança o estado
+    pcb->fail_writes = 1;
+    state.max = 85;
+    check_push(pcb, &state, "");
+    state.bomba = 0;
+    check_push(pcb, &state, "data: {\"bomba_agua\":0,\"limite_maximo\":85}\n\n");
+
+    // Uma mudança desfeita antes de caber não gera evento
+    pcb->snd_buf = 10;
+    state.nivel = 13;
+    check_push(pcb, &state, "");
+    state.nivel = 12;
+    pcb->snd_buf = host_tcp_snd_buf;
+    check_push(pcb, &state, "");
+    disconnect(pcb);
+
+    // Sem o cabeçalho do canal no lwIP, nenhum evento: ele é reenviado pelo poll e o primeiro evento vem completo
+    pcb = connect_client();
+    pcb->fail_writes = 1;
+    send_text(pcb, "GET /eventos HTTP/1.1\r\n\r\n");
+    CHECK_EQ(pcb->out_total, 0);
+    http_sse_push(&state, (uint32_t)(host_time_us / 1000));
+    CHECK_EQ(pcb->out_total, 0);
+    host_tcp_poll(pcb);
+    CHECK(strstr(drain(pcb, NULL), "Content-Type: text/event-stream\r\n") != NULL);
+    check_push(pcb, &state, "data: {\"nivel_agua\":12,\"bomba_agua\":0,\"limite_minimo\":20,\"limite_maximo\":85}\n\n");
+    disconnect(pcb);
+    CHECK_EQ(http_server_stats.sse_clients, 0);
+    CHECK_EQ(http_server_stats.active_connections, 0);
+}
+
+// No máximo HTTP_MAX_SSE_CLIENTS canais: o seguinte recebe 503 e a conexão continua servindo
+// requisições. HEAD recebe o cabeçalho sem ocupar um canal
+static void test_sse_limit(void)
+{
+    struct tcp_pcb *channels[HTTP_MAX_SSE_CLIENTS];
+    for (int i = 0; i < HTTP_MAX_SSE_CLIENTS; i++)
+        channels[i] = open_events();
+    CHECK_EQ(http_server_stats.sse_clients, HTTP_MAX_SSE_CLIENTS);
+
+    struct tcp_pcb *pcb = connect_client();
+    send_text(pcb, "GET /eventos HTTP/1.1\r\n\r\n");
+    const char *out = drain(pcb, NULL);
+    CHECK(strncmp(out, "HTTP/1.1 503 Service Unavailable\r\n", 34) == 0);
+    CHECK(strstr(out, "\r\n\r\nMuitos clientes") != NULL);
+    CHECK_EQ(http_server_stats.sse_clients, HTTP_MAX_SSE_CLIENTS);
+    send_text(pcb, "GET /pequena HTTP/1.1\r\n\r\n");
+    CHECK(strstr(drain(pcb, NULL), "\r\n\r\nok") != NULL);
+
+    // Fechado um canal, o próximo pedido abre outro
+    disconnect(channels[0]);
+    CHECK_EQ(http_server_stats.sse_clients, HTTP_MAX_SSE_CLIENTS - 1);
+    send_text(pcb, "HEAD /eventos HTTP/1.1\r\n\r\n");
+    out = drain(pcb, NULL);
+    CHECK(strstr(out, "Content-Type: text/event-stream\r\n") != NULL);
+    CHECK_EQ(http_server_stats.sse_clients, HTTP_MAX_SSE_CLIENTS - 1);
+    send_text(pcb, "GET /eventos HTTP/1.1\r\n\r\n");
+    CHECK(strstr(drain(pcb, NULL), "Content-Type: text/event-stream\r\n") != NULL);
+    CHECK_EQ(http_server_stats.sse_clients, HTTP_MAX_SSE_CLIENTS);
+    channels[0] = pcb;
+
+    // Um canal derrubado pelo lwIP também devolve a vaga
+    host_tcp_error(channels[1], ERR_ABRT);
+    CHECK_EQ(http_server_stats.sse_clients, HTTP_MAX_SSE_CLIENTS - 1);
+    for (int i = 0; i < HTTP_MAX_SSE_CLIENTS; i++)
+    {
+        if (i != 1)
+            disconnect(channels[i]);
+    }
+    CHECK_EQ(http_server_stats.sse_clients, 0);
+    CHECK_EQ(http_server_stats.active_connections, 0);
+}
+
+// Requisições pequenas em uma conexão persistente contra uma conexão nova por requisição
+static void test_keep_alive_benchmark(void)
+{
+    const int count = 100000;
+    uint32_t requests = http_server_stats.requests;
+
+    struct tcp_pcb *pcb = connect_client();
+    clock_t start = clock();
+    for (int i = 0; i < count; i++)
+    {
+        send_text(pcb, "GET /pequena HTTP/1.1\r\n\r\n");
+        host_tcp_ack_all(pcb);
+        host_tcp_take(pcb, NULL);
+    }
+    double persistent = (double)(clock() - start) / CLOCKS_PER_SEC;
+    disconnect(pcb);
+
+    start = clock();
+    for (int i = 0; i < count; i++)
+    {
+        pcb = connect_client();
+        send_text(pcb, "GET /pequena HTTP/1.0\r\n\r\n");
+        host_tcp_ack_all(pcb);
+        host_tcp_take(pcb, NULL);
+    }
+    double fresh = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    CHECK_EQ(http_server_stats.requests, requests + 2 * count);
+    CHECK_EQ(http_server_stats.active_connections, 0);
+    CHECK_EQ(host_pbuf_live, 0);
+    printf("keep-alive: %.0f requisições/s persistentes, %.0f com uma conexão por requisição\n",
+           count / (persistent > 0 ? persistent : 1e-6), count / (fresh > 0 ? fresh : 1e-6));
+}
+
+// Carga: oito clientes persistentes pedindo a página e respostas pequenas, duas requisições por segmento.
+// Mostra as requisições por segundo e o pico de memória retida em pbufs à espera de atendimento
+// (o servidor em si não usa o heap: só a tabela estática de slots)
+static void test_load(void)
+{
+    const int rounds = 4000;
+    struct tcp_pcb *pcbs[HTTP_MAX_CONNECTIONS];
+    uint32_t requests = http_server_stats.requests;
+    uint64_t bytes = 0;
+
+    host_pbuf_peak_bytes = 0;
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+        pcbs[i] = connect_client();
+
+    clock_t start = clock();
+    for (int r = 0; r < rounds; r++)
+    {
+        for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+        {
+            send_text(pcbs[i], (r + i) % 4 ? "GET /pequena HTTP/1.1\r\n\r\nGET /pequena HTTP/1.1\r\n\r\n"
+                                           : "GET / HTTP/1.1\r\n\r\nGET /pequena HTTP/1.1\r\n\r\n");
+        }
+        for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+        {
+            bytes += host_tcp_ack_all(pcbs[i]);
+            host_tcp_take(pcbs[i], NULL);
+        }
+    }
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+    if (seconds <= 0)
+        seconds = 1e-6;
+
+    uint32_t served = http_server_stats.requests - requests;
+    CHECK_EQ(served, rounds * HTTP_MAX_CONNECTIONS * 2);
+    for (int i = 0; i < HTTP_MAX_CONNECTIONS; i++)
+    {
+        CHECK(is_open(pcbs[i]));
+        disconnect(pcbs[i]);
+    }
+    CHECK_EQ(host_pbuf_live, 0);
+    CHECK_EQ(host_tcp_ref_changed, 0);
+    printf("carga: %.0f requisições/s, %.1f MB/s, pico de %u bytes em pbufs pendentes, slots %u bytes\n",
+           served / seconds, bytes / seconds / 1e6, (unsigned)host_pbuf_peak_bytes,
+           (unsigned)(HTTP_MAX_CONNECTIONS * sizeof(struct http_state)));
+}
+
+int main(void)
+{
+    setup();
+    test_pacing();
+    test_slot_limit();
+    test_send_retry();
+    test_stream_retry();
+    test_pipelining();
+    test_empty_pbufs();
+    test_connection_defaults();
+    test_idle_timeout();
+    test_eviction();
+    test_sse_delta();
+    test_sse_backpressure();
+    test_sse_limit();
+    test_keep_alive_benchmark();
+    test_load();
+    return TEST_RESULT;
+}
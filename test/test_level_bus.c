@@ -0,0 +1,276 @@
+#include "test.h"
+#include "level_bus/level_bus.h"
+
+// Entrega, contagem de perdidas e latência medida pelo assinante, com o relógio do host controlado pelo teste,
+// e um produtor em taxa fixa disputado por assinantes mais lentos que ele
+
+static void test_receive_latest(void)
+{
+    level_bus_t bus;
+    level_bus_sub_t sub;
+    level_sample_t sample;
+    uint32_t skipped = 99;
+
+    level_bus_init(&bus);
+    CHECK(level_bus_subscribe(&bus, &sub));
+
+    // Nada publicado: a espera vence o tempo limite
+    CHECK(!level_bus_receive(&sub, &sample, &skipped, 0));
+
+    level_bus_publish(&bus, 42);
+    CHECK(level_bus_receive(&sub, &sample, &skipped, 0));
+    CHECK_EQ(sample.value, 42);
+    CHECK_EQ(sample.seq, 1);
+    CHECK_EQ(skipped, 0);
+
+    // A mesma amostra não é entregue duas vezes
+    CHECK(!level_bus_receive(&sub, &sample, NULL, 0));
+}
+
+static void test_skipped(void)
+{
+    level_bus_t bus;
+    level_bus_sub_t sub;
+    level_sample_t sample;
+    uint32_t skipped;
+
+    level_bus_init(&bus);
+    CHECK(level_bus_subscribe(&bus, &sub));
+
+    // Três publicações sem leitura: só a última é entregue, as outras contam como perdidas
+    level_bus_publish(&bus, 10);
+    level_bus_publish(&bus, 20);
+    level_bus_publish(&bus, 30);
+    CHECK(level_bus_receive(&sub, &sample, &skipped, 0));
+    CHECK_EQ(sample.value, 30);
+    CHECK_EQ(skipped, 2);
+    CHECK_EQ(sub.received, 1);
+    CHECK_EQ(sub.skipped, 2);
+
+    // Notificações pendentes sem dado novo não geram entrega
+    CHECK(!level_bus_receive(&sub, &sample, &skipped, 0));
+}
+
+static void test_subscribe_after_publish(void)
+{
+    level_bus_t bus;
+    level_bus_sub_t sub;
+    level_sample_t sample;
+
+    level_bus_init(&bus);
+    level_bus_publish(&bus, 5);
+    CHECK(level_bus_subscribe(&bus, &sub));
+
+    // Quem assina depois só recebe o que for publicado a partir daí
+    CHECK(!level_bus_receive(&sub, &sample, NULL, 0));
+    level_bus_publish(&bus, 6);
+    CHECK(level_bus_receive(&sub, &sample, NULL, 0));
+    CHECK_EQ(sample.value, 6);
+    CHECK_EQ(sub.skipped, 0);
+}
+
+static void test_subscriber_limit(void)
+{
+    level_bus_t bus;
+    level_bus_sub_t subs[LEVEL_BUS_MAX_SUBSCRIBERS + 1];
+
+    level_bus_init(&bus);
+    for (int i = 0; i < LEVEL_BUS_MAX_SUBSCRIBERS; i++)
+    {
+        CHECK(level_bus_subscribe(&bus, &subs[i]));
+    }
+    CHECK(!level_bus_subscribe(&bus, &subs[LEVEL_BUS_MAX_SUBSCRIBERS]));
+}
+
+static void test_latency(void)
+{
+    level_bus_t bus;
+    level_bus_sub_t sub;
+    level_sample_t sample;
+
+    level_bus_init(&bus);
+    CHECK(level_bus_subscribe(&bus, &sub));
+
+    host_time_us = 1000;
+    level_bus_publish(&bus, 1);
+    host_time_us = 1300;
+    CHECK(level_bus_receive(&sub, &sample, NULL, 0));
+    CHECK_EQ(sample.timestamp_us, 1000);
+
+    host_time_us = 2000;
+    level_bus_publish(&bus, 2);
+    host_time_us = 2100;
+    CHECK(level_bus_receive(&sub, &sample, NULL, 0));
+
+    CHECK_EQ(sub.received, 2);
+    CHECK_EQ(sub.latency_max_us, 300);
+    CHECK_EQ(sub.latency_total_us, 400);
+}
+
+static void test_independent_subscribers(void)
+{
+    // Duas tasks assinantes, cada uma com suas notificações e sua contagem
+    host_task_t fast_task = {0}, slow_task = {0};
+    host_task_t *previous = host_current_task;
+    level_bus_t bus;
+    level_bus_sub_t fast, slow;
+    level_sample_t sample;
+
+    level_bus_init(&bus);
+    host_current_task = &fast_task;
+    CHECK(level_bus_subscribe(&bus, &fast));
+    host_current_task = &slow_task;
+    CHECK(level_bus_subscribe(&bus, &slow));
+
+    for (int i = 1; i <= 5; i++)
+    {
+        level_bus_publish(&bus, i);
+        host_current_task = &fast_task;
+        CHECK(level_bus_receive(&fast, &sample, NULL, 0));
+        CHECK_EQ(sample.value, i);
+    }
+    host_current_task = &slow_task;
+    CHECK(level_bus_receive(&slow, &sample, NULL, 0));
+    CHECK_EQ(sample.value, 5);
+
+    CHECK_EQ(fast.received, 5);
+    CHECK_EQ(fast.skipped, 0);
+    CHECK_EQ(slow.received, 1);
+    CHECK_EQ(slow.skipped, 4);
+
+    host_current_task = previous;
+}
+
+// Simulação por eventos no relógio do host: o produtor publica a cada PERIOD_US, como a fusão dos sensores,
+// e cada assinante fica ocupado um tempo depois de cada entrega (o display enviando um quadro pelo I2C, o
+// servidor HTTP respondendo). Bloqueado na espera, o assinante acorda WAKE_MAX_US no máximo após a publicação
+#define PERIOD_US 100000
+#define WAKE_MAX_US 200
+#define RUN_US 60000000ull
+#define NEVER UINT64_MAX
+
+typedef struct {
+    const char *name;
+    uint32_t work_us;      // Ocupado depois de cada entrega
+    uint32_t slow_every;   // A cada 'slow_every' entregas (0 = nunca) fica ocupado 'slow_us'
+    uint32_t slow_us;
+    host_task_t task;
+    level_bus_sub_t sub;
+    uint64_t wake_us;      // Quando volta a chamar level_bus_receive, NEVER enquanto bloqueado
+    uint32_t last_seq;
+    uint32_t skipped;      // Soma do 'skipped' de cada entrega
+    uint64_t latency_total_us;
+    bool in_order;
+} sim_sub_t;
+
+static void sim_receive(sim_sub_t *s, uint64_t now)
+{
+    level_sample_t sample;
+    uint32_t skipped;
+
+    host_time_us = now;
+    host_current_task = &s->task;
+    if (!level_bus_receive(&s->sub, &sample, &skipped, 0))
+    {
+        s->wake_us = NEVER; // Nada novo: espera a próxima publicação
+        return;
+    }
+    if (sample.seq <= s->last_seq || sample.seq - s->last_seq - 1 != skipped)
+        s->in_order = false;
+    s->last_seq = sample.seq;
+    s->skipped += skipped;
+    s->latency_total_us += now - sample.timestamp_us;
+    bool slow = s->slow_every && s->sub.received % s->slow_every == 0;
+    s->wake_us = now + (slow ? s->slow_us : s->work_us);
+}
+
+static void test_contended_latency(void)
+{
+    sim_sub_t subs[] = {
+        {.name = "rápido", .work_us = 2000},                                       // Bem abaixo do período
+        {.name = "display", .work_us = 30000, .slow_every = 5, .slow_us = 250000},  // Quadro longo a cada cinco
+        {.name = "servidor", .work_us = 150000},                                   // Mais lento que o produtor
+        {.name = "travado", .work_us = 5000, .slow_every = 50, .slow_us = 2000000}, // Preso por 2 s às vezes
+    };
+    const int n = sizeof(subs) / sizeof(subs[0]);
+    host_task_t *previous = host_current_task;
+    level_bus_t bus;
+    uint32_t lcg = 1, published = 0;
+
+    level_bus_init(&bus);
+    for (int i = 0; i < n; i++)
+    {
+        host_current_task = &subs[i].task;
+        CHECK(level_bus_subscribe(&bus, &subs[i].sub));
+        subs[i].wake_us = 0;
+        subs[i].in_order = true;
+    }
+
+    uint64_t next_publish = PERIOD_US;
+    while (next_publish <= RUN_US)
+    {
+        int first = -1;
+        for (int i = 0; i < n; i++)
+        {
+            if (subs[i].wake_us < next_publish && (first < 0 || subs[i].wake_us < subs[first].wake_us))
+                first = i;
+        }
+        if (first >= 0)
+        {
+            sim_receive(&subs[first], subs[first].wake_us);
+            continue;
+        }
+
+        // O produtor nunca espera pelos assinantes
+        host_time_us = next_publish;
+        level_bus_publish(&bus, (int)(published++ % 101));
+        CHECK_EQ(host_time_us, next_publish);
+        for (int i = 0; i < n; i++)
+        {
+            if (subs[i].wake_us == NEVER)
+            {
+                lcg = lcg * 1103515245u + 12345u;
+                subs[i].wake_us = next_publish + (lcg >> 16) % (WAKE_MAX_US + 1);
+            }
+        }
+        next_publish += PERIOD_US;
+    }
+
+    for (int i = 0; i < n; i++)
+    {
+        const level_bus_sub_t *sub = &subs[i].sub;
+        CHECK(subs[i].in_order);
+        // Cada publicação foi entregue, contada como perdida ou ainda espera quem está ocupado, uma vez só
+        CHECK_EQ(bus.seq, published);
+        CHECK_EQ(sub->received + sub->skipped + (bus.seq - sub->last_seq), published);
+        CHECK_EQ(sub->skipped, subs[i].skipped);
+        CHECK_EQ(sub->latency_total_us, subs[i].latency_total_us);
+        // Nunca recebe uma amostra mais velha que um período mais o tempo para acordar
+        CHECK(sub->latency_max_us <= PERIOD_US + WAKE_MAX_US);
+        printf("%-8s %4u entregues, %4u perdidas, latência média %6u us, máxima %6u us\n", subs[i].name,
+               (unsigned)sub->received, (unsigned)sub->skipped, (unsigned)(sub->latency_total_us / sub->received),
+               (unsigned)sub->latency_max_us);
+    }
+
+    // O assinante rápido acorda a cada publicação e recebe todas, só com o atraso de acordar
+    CHECK_EQ(subs[0].sub.skipped, 0);
+    CHECK(subs[0].sub.latency_max_us <= WAKE_MAX_US);
+    // Os lentos perdem amostras em vez de atrasar o produtor ou os outros
+    CHECK(subs[1].sub.skipped > 0);
+    CHECK(subs[2].sub.skipped >= published / 4);
+    CHECK(subs[3].sub.skipped >= 19 * (subs[3].sub.received / 50 - 1)); // Cada parada de 2 s perde 19 ou 20
+
+    host_current_task = previous;
+}
+
+int main(void)
+{
+    test_receive_latest();
+    test_skipped();
+    test_subscribe_after_publish();
+    test_subscriber_limit();
+    test_latency();
+    test_independent_subscribers();
+    test_contended_latency();
+    return TEST_RESULT;
+}
@@ -0,0 +1,131 @@
+#include "test.h"
+#include "level_filter/level_filter.h"
+
+#include <stdlib.h>
+
+// Cada estágio do filtro isolado pela configuração, e a mediana incremental conferida contra uma ordenação completa
+
+static void test_passthrough(void)
+{
+    level_filter_config_t config = {.median_window = 1, .ema_alpha_q15 = 32768, .max_step = 0, .max_rejects = 0};
+    level_filter_t filter;
+    level_filter_init(&filter, &config);
+
+    const int32_t samples[] = {10, 90, -5, 0, 32767, -32767};
+    for (unsigned i = 0; i < sizeof(samples) / sizeof(samples[0]); i++)
+    {
+        CHECK_EQ(level_filter_update(&filter, samples[i]), samples[i]);
+    }
+}
+
+static void test_window_clamped(void)
+{
+    level_filter_config_t config = {.median_window = 200, .ema_alpha_q15 = 32768};
+    level_filter_t filter;
+    level_filter_init(&filter, &config);
+    CHECK_EQ(filter.config.median_window, LEVEL_FILTER_MAX_WINDOW);
+
+    config.median_window = 0;
+    level_filter_init(&filter, &config);
+    CHECK_EQ(filter.config.median_window, 1);
+}
+
+static int compare_int32(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void test_median_matches_sort(void)
+{
+    for (uint8_t n = 1; n <= LEVEL_FILTER_MAX_WINDOW; n += 2)
+    {
+        level_filter_config_t config = {.median_window = n, .ema_alpha_q15 = 32768};
+        level_filter_t filter;
+        int32_t window[LEVEL_FILTER_MAX_WINDOW], sorted[LEVEL_FILTER_MAX_WINDOW];
+
+        level_filter_init(&filter, &config);
+        srand(n);
+        int32_t first = rand() % 101;
+        level_filter_update(&filter, first);
+        for (uint8_t i = 0; i < n; i++)
+            window[i] = first;
+
+        // Valores repetidos de propósito: a faixa é pequena perto do número de amostras
+        for (int k = 0; k < 2000; k++)
+        {
+            int32_t sample = rand() % 101;
+            window[k % n] = sample;
+            for (uint8_t i = 0; i < n; i++)
+                sorted[i] = window[i];
+            qsort(sorted, n, sizeof(sorted[0]), compare_int32);
+            CHECK_EQ(level_filter_update(&filter, sample), sorted[n / 2]);
+        }
+    }
+}
+
+static void test_median_removes_spike(void)
+{
+    level_filter_config_t config = {.median_window = 3, .ema_alpha_q15 = 32768};
+    level_filter_t filter;
+    level_filter_init(&filter, &config);
+
+    CHECK_EQ(level_filter_update(&filter, 50), 50);
+    CHECK_EQ(level_filter_update(&filter, 99), 50);
+    CHECK_EQ(level_filter_update(&filter, 51), 51);
+}
+
+static void test_reject_and_accept(void)
+{
+    level_filter_config_t config = {.median_window = 1, .ema_alpha_q15 = 32768, .max_step = 10, .max_rejects = 2};
+    level_filter_t filter;
+    level_filter_init(&filter, &config);
+
+    CHECK_EQ(level_filter_update(&filter, 50), 50);
+    // Salto isolado: ignorado
+    CHECK_EQ(level_filter_update(&filter, 90), 50);
+    CHECK_EQ(level_filter_update(&filter, 55), 55);
+    CHECK_EQ(filter.rejected_total, 1);
+
+    // O salto se repete além de max_rejects: vira o novo patamar
+    CHECK_EQ(level_filter_update(&filter, 90), 55);
+    CHECK_EQ(level_filter_update(&filter, 90), 55);
+    CHECK_EQ(level_filter_update(&filter, 90), 90);
+    CHECK_EQ(level_filter_update(&filter, 91), 91);
+    CHECK_EQ(filter.rejected_total, 4);
+}
+
+static void test_ema(void)
+{
+    // alpha = 1/2: cada amostra leva a saída até a metade do caminho
+    level_filter_config_t config = {.median_window = 1, .ema_alpha_q15 = 16384};
+    level_filter_t filter;
+    level_filter_init(&filter, &config);
+
+    CHECK_EQ(level_filter_update(&filter, 0), 0);
+    CHECK_EQ(level_filter_update(&filter, 100), 50);
+    CHECK_EQ(level_filter_update(&filter, 100), 75);
+
+    // Com entrada constante a saída para a menos de 0.5 / alpha unidades dela (arredondamento em ponto fixo)
+    for (int i = 0; i < 20; i++)
+        level_filter_update(&filter, 100);
+    CHECK(filter.output >= 99 && filter.output <= 100);
+    for (int i = 0; i < 20; i++)
+        level_filter_update(&filter, 0);
+    CHECK(filter.output >= 0 && filter.output <= 1);
+
+    // Mesma escala com as amostras em Q8
+    level_filter_reset(&filter, 0);
+    CHECK_EQ(level_filter_update(&filter, 100 * LEVEL_FILTER_ONE), 50 * LEVEL_FILTER_ONE);
+}
+
+int main(void)
+{
+    test_passthrough();
+    test_window_clamped();
+    test_median_matches_sort();
+    test_median_removes_spike();
+    test_reject_and_accept();
+    test_ema();
+    return TEST_RESULT;
+}
@@ -0,0 +1,144 @@
+#include "test.h"
+#include "level_fusion/level_fusion.h"
+
+// Combinação ponderada e exclusão de sensores parados, ruidosos ou divergentes
+
+#define Q8(percent) ((percent) * 256)
+
+// Mesmos valores da configuração do firmware
+static const level_fusion_config_t config = {
+    .stale_timeout_us = 1000000,
+    .min_variance = Q8(1) / 2 * (Q8(1) / 2),
+    .max_variance = Q8(15) * Q8(15),
+    .max_disagreement = Q8(15),
+    .drift_timeout_us = 5000000,
+    .primary = LEVEL_FUSION_POTENTIOMETER,
+};
+
+static void test_no_data(void)
+{
+    level_fusion_t fusion;
+    int32_t value = -1;
+
+    level_fusion_init(&fusion, &config);
+    CHECK(!level_fusion_compute(&fusion, 0, &value));
+    CHECK_EQ(value, 0);
+    CHECK_EQ(fusion.active_mask, 0);
+}
+
+static void test_single_sensor(void)
+{
+    level_fusion_t fusion;
+    int32_t value;
+
+    level_fusion_init(&fusion, &config);
+    level_fusion_update(&fusion, LEVEL_FUSION_ULTRASONIC, Q8(40), 100);
+    CHECK(level_fusion_compute(&fusion, 200, &value));
+    CHECK_EQ(value, Q8(40));
+    CHECK_EQ(fusion.active_mask, 1 << LEVEL_FUSION_ULTRASONIC);
+}
+
+static void test_weighted_average(void)
+{
+    level_fusion_t fusion;
+    int32_t value;
+
+    level_fusion_init(&fusion, &config);
+    // Variâncias iguais: média simples
+    level_fusion_update(&fusion, LEVEL_FUSION_POTENTIOMETER, Q8(50), 0);
+    level_fusion_update(&fusion, LEVEL_FUSION_ULTRASONIC, Q8(60), 0);
+    CHECK(level_fusion_compute(&fusion, 0, &value));
+    CHECK_EQ(value, Q8(55));
+
+    // Variâncias diferentes: o resultado fica mais perto do sensor mais estável
+    fusion.sensors[LEVEL_FUSION_POTENTIOMETER].variance = config.min_variance;
+    fusion.sensors[LEVEL_FUSION_ULTRASONIC].variance = 3 * config.min_variance;
+    CHECK(level_fusion_compute(&fusion, 0, &value));
+    CHECK_EQ(value, (Q8(50) * 3 + Q8(60)) / 4);
+}
+
+static void test_variance_tracks_noise(void)
+{
+    level_fusion_t fusion;
+    level_fusion_init(&fusion, &config);
+
+    // Leituras constantes não sobem a variância acima do piso
+    for (int i = 0; i < 50; i++)
+        level_fusion_update(&fusion, LEVEL_FUSION_POTENTIOMETER, Q8(50), i);
+    CHECK(fusion.sensors[LEVEL_FUSION_POTENTIOMETER].variance <= config.min_variance);
+
+    // Oscilação de +-20% leva o sensor acima de max_variance
+    for (int i = 0; i < 50; i++)
+        level_fusion_update(&fusion, LEVEL_FUSION_ULTRASONIC, i & 1 ? Q8(70) : Q8(30), i);
+    CHECK(fusion.sensors[LEVEL_FUSION_ULTRASONIC].variance > config.max_variance);
+
+    int32_t value;
+    CHECK(level_fusion_compute(&fusion, 50, &value));
+    CHECK(fusion.sensors[LEVEL_FUSION_ULTRASONIC].faults & LEVEL_FUSION_FAULT_NOISY);
+    CHECK_EQ(fusion.active_mask, 1 << LEVEL_FUSION_POTENTIOMETER);
+    CHECK_EQ(value, Q8(50));
+}
+
+static void test_stale(void)
+{
+    level_fusion_t fusion;
+    int32_t value;
+
+    level_fusion_init(&fusion, &config);
+    level_fusion_update(&fusion, LEVEL_FUSION_POTENTIOMETER, Q8(20), 0);
+    level_fusion_update(&fusion, LEVEL_FUSION_ULTRASONIC, Q8(30), 0);
+
+    // A boia continua lendo, o ultrassônico para
+    level_fusion_update(&fusion, LEVEL_FUSION_POTENTIOMETER, Q8(20), 1500000);
+    CHECK(level_fusion_compute(&fusion, 1500000, &value));
+    CHECK(fusion.sensors[LEVEL_FUSION_ULTRASONIC].faults & LEVEL_FUSION_FAULT_STALE);
+    CHECK_EQ(value, Q8(20));
+
+    // Os dois parados: mantém o último valor e avisa
+    CHECK(!level_fusion_compute(&fusion, 3000000, &value));
+    CHECK_EQ(value, Q8(20));
+
+    // Leitura nova tira a falha
+    level_fusion_update(&fusion, LEVEL_FUSION_ULTRASONIC, Q8(30), 3000000);
+    CHECK(level_fusion_compute(&fusion, 3000000, &value));
+    CHECK_EQ(value, Q8(30));
+}
+
+static void test_drift(void)
+{
+    level_fusion_t fusion;
+    int32_t value;
+    uint64_t now = 0;
+
+    level_fusion_init(&fusion, &config);
+    // 40% de diferença com variâncias iguais: a boia (primária) é mantida após drift_timeout_us
+    for (; now <= 6000000; now += 100000)
+    {
+        level_fusion_update(&fusion, LEVEL_FUSION_POTENTIOMETER, Q8(20), now);
+        level_fusion_update(&fusion, LEVEL_FUSION_ULTRASONIC, Q8(60), now);
+        level_fusion_compute(&fusion, now, &value);
+        if (now <= config.drift_timeout_us)
+            CHECK_EQ(fusion.active_mask, 3);
+    }
+    CHECK(fusion.sensors[LEVEL_FUSION_ULTRASONIC].faults & LEVEL_FUSION_FAULT_DRIFT);
+    CHECK(!(fusion.sensors[LEVEL_FUSION_POTENTIOMETER].faults & LEVEL_FUSION_FAULT_DRIFT));
+    CHECK_EQ(value, Q8(20));
+
+    // Voltando a concordar, o sensor excluído retorna
+    level_fusion_update(&fusion, LEVEL_FUSION_POTENTIOMETER, Q8(20), now);
+    level_fusion_update(&fusion, LEVEL_FUSION_ULTRASONIC, Q8(22), now);
+    CHECK(level_fusion_compute(&fusion, now, &value));
+    CHECK_EQ(fusion.active_mask, 3);
+    CHECK_EQ(fusion.disagree_since_us, 0);
+}
+
+int main(void)
+{
+    test_no_data();
+    test_single_sensor();
+    test_weighted_average();
+    test_variance_tracks_noise();
+    test_stale();
+    test_drift();
+    return TEST_RESULT;
+}
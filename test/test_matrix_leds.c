@@ -0,0 +1,137 @@
+#include <string.h>
+#include "test.h"
+#include "matrix_leds/matrix_leds.h"
+#include "matrix_render/matrix_render.h"
+#include "hardware/dma.h"
+
+// Ordem do fio da matriz da placa: o obter_index atual como mapa do renderizador, comparado com a ordem
+// em que o antigo desenha_frame empurrava os pixels, e o quadro chegando à FIFO da state machine
+
+#define Q8(percent) ((percent) << 8)
+
+static void test_wire_map(void)
+{
+    bool seen[NUM_PIXELS] = {false};
+    CHECK_EQ(NUM_PIXELS, MATRIX_RENDER_PIXELS);
+
+    for (uint8_t i = 0; i < NUM_PIXELS; i++)
+    {
+        uint8_t pixel = obter_index(i);
+        CHECK(pixel < NUM_PIXELS);
+        if (pixel < NUM_PIXELS)
+        {
+            CHECK(!seen[pixel]); // Cada LED aparece uma vez só
+            seen[pixel] = true;
+        }
+        // Cinco LEDs por linha, de baixo para cima
+        CHECK_EQ(pixel / MATRIX_RENDER_WIDTH, MATRIX_RENDER_ROWS - 1 - i / MATRIX_RENDER_WIDTH);
+        if (i == 0)
+            continue;
+
+        // Zigue-zague: LEDs vizinhos no fio são vizinhos na matriz
+        int previous = obter_index(i - 1);
+        int rows = pixel / MATRIX_RENDER_WIDTH - previous / MATRIX_RENDER_WIDTH;
+        int columns = pixel % MATRIX_RENDER_WIDTH - previous % MATRIX_RENDER_WIDTH;
+        CHECK_EQ((rows < 0 ? -rows : rows) + (columns < 0 ? -columns : columns), 1);
+    }
+    // O fio começa no canto de baixo à direita e termina no de cima à esquerda
+    CHECK_EQ(obter_index(0), NUM_PIXELS - 1);
+    CHECK_EQ(obter_index(NUM_PIXELS - 1), 0);
+}
+
+static uint8_t identity(uint8_t i)
+{
+    return i;
+}
+
+// O quadro em ordem de fio é o que desenha_frame enviava: na posição i do fio, matriz[obter_index(i)]
+static void test_render_matches_old_push_order(void)
+{
+    static const int32_t levels[] = {Q8(0), Q8(13), Q8(50), Q8(87), Q8(100)};
+    static const uint8_t flags[] = {0, MATRIX_RENDER_FLAG_PUMP, MATRIX_RENDER_FLAG_ALARM,
+                                    MATRIX_RENDER_FLAG_PUMP | MATRIX_RENDER_FLAG_ALARM};
+    matrix_render_t logical, wired;
+    uint32_t matriz[NUM_PIXELS], fio[NUM_PIXELS];
+
+    for (unsigned f = 0; f < sizeof(flags) / sizeof(flags[0]); f++)
+    {
+        matrix_render_init(&logical, 64, identity);
+        matrix_render_init(&wired, 64, obter_index);
+        for (unsigned l = 0; l < sizeof(levels) / sizeof(levels[0]); l++)
+        {
+            // Os dois renderizadores andam juntos, com as animações na mesma fase
+            for (int frame = 0; frame < 40; frame++)
+            {
+                matrix_render_frame(&logical, levels[l], flags[f], matriz);
+                matrix_render_frame(&wired, levels[l], flags[f], fio);
+                for (uint8_t i = 0; i < NUM_PIXELS; i++)
+                    CHECK_EQ(fio[i], matriz[obter_index(i)]);
+            }
+        }
+    }
+}
+
+// Canal de DMA que alimenta a state machine 'sm' do pio0
+static int matrix_dma(uint sm)
+{
+    for (int c = 0; c < HOST_DMA_CHANNELS; c++)
+    {
+        if (host_dma[c].claimed && host_dma[c].write_addr == &pio0->txf[sm])
+            return c;
+    }
+    return -1;
+}
+
+static void test_frame_reaches_fifo(void)
+{
+    init_led_matrix();
+    int sm = -1;
+    for (uint s = 0; s < NUM_PIO_STATE_MACHINES; s++)
+    {
+        if (host_pio_sm[0][s].claimed)
+            sm = (int)s;
+    }
+    CHECK(sm >= 0);
+    if (sm < 0)
+        return;
+    int dma = matrix_dma(sm);
+    CHECK(dma >= 0);
+    if (dma < 0)
+        return;
+    CHECK(host_pio_sm[0][sm].enabled);
+
+    // A inicialização apaga a matriz
+    host_dma_complete(dma);
+    CHECK_EQ(host_pio_sm[0][sm].fifo_len, NUM_PIXELS);
+    for (int i = 0; i < NUM_PIXELS; i++)
+        CHECK_EQ(host_pio_sm[0][sm].fifo[i], 0);
+
+    // Um quadro desenhado com obter_index chega à FIFO na ordem do fio, uma palavra por LED
+    matrix_render_t render;
+    uint32_t fio[NUM_PIXELS];
+    matrix_render_init(&render, 64, obter_index);
+    for (int frame = 0; frame < 40; frame++)
+        matrix_render_frame(&render, Q8(60), MATRIX_RENDER_FLAG_PUMP, fio);
+    host_pio_fifo_clear(pio0, sm);
+    CHECK(envia_frame(fio));
+    host_dma_complete(dma);
+    CHECK_EQ(host_pio_sm[0][sm].fifo_len, NUM_PIXELS);
+    CHECK(!memcmp(host_pio_sm[0][sm].fifo, fio, sizeof(fio)));
+
+    // O mesmo quadro não é reenviado; apagar a matriz é enviar zeros
+    host_pio_fifo_clear(pio0, sm);
+    CHECK(!envia_frame(fio));
+    apaga_matriz();
+    host_dma_complete(dma);
+    CHECK_EQ(host_pio_sm[0][sm].fifo_len, NUM_PIXELS);
+    for (int i = 0; i < NUM_PIXELS; i++)
+        CHECK_EQ(host_pio_sm[0][sm].fifo[i], 0);
+}
+
+int main(void)
+{
+    test_wire_map();
+    test_render_matches_old_push_order();
+    test_frame_reaches_fifo();
+    return TEST_RESULT;
+}
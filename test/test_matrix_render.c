@@ -0,0 +1,187 @@
+#include "test.h"
+#include "matrix_render/matrix_render.h"
+
+// Preenchimento por linha, fração da superfície, aproximação do nível exibido, animações e ordem do fio
+
+#define Q8(percent) ((percent) << 8)
+
+static uint8_t identity(uint8_t i)
+{
+    return i;
+}
+
+// Fio em zigue-zague começando embaixo à direita, como na matriz da placa (test_matrix_leds confere
+// o obter_index de verdade)
+static uint8_t serpentine(uint8_t i)
+{
+    uint8_t row = MATRIX_RENDER_ROWS - 1 - i / MATRIX_RENDER_WIDTH;
+    uint8_t column = i % MATRIX_RENDER_WIDTH;
+    if (i / MATRIX_RENDER_WIDTH % 2 == 0)
+        column = MATRIX_RENDER_WIDTH - 1 - column;
+    return row * MATRIX_RENDER_WIDTH + column;
+}
+
+static uint32_t green(uint32_t word) { return word >> 24; }
+static uint32_t red(uint32_t word) { return (word >> 16) & 0xFF; }
+static uint32_t blue(uint32_t word) { return (word >> 8) & 0xFF; }
+
+// Desenha quadros até o nível exibido chegar ao medido. Retorna quantos foram necessários
+static int settle(matrix_render_t *render, int32_t level_q8, uint8_t flags, uint32_t *fio)
+{
+    int frames = 0;
+    do
+    {
+        matrix_render_frame(render, level_q8, flags, fio);
+        frames++;
+    } while (render->shown_q8 != level_q8 && frames < 1000);
+    return frames;
+}
+
+static void test_gamma(void)
+{
+    matrix_render_t render;
+    matrix_render_init(&render, 255, identity);
+    CHECK_EQ(render.gamma[0], 0);
+    CHECK_EQ(render.gamma[255], 255);
+    for (int i = 1; i < 256; i++)
+        CHECK(render.gamma[i] >= render.gamma[i - 1]);
+}
+
+static void test_fill(void)
+{
+    matrix_render_t render;
+    uint32_t fio[MATRIX_RENDER_PIXELS];
+
+    matrix_render_init(&render, 255, identity);
+    matrix_render_frame(&render, 0, 0, fio);
+    for (int i = 0; i < MATRIX_RENDER_PIXELS; i++)
+        CHECK_EQ(fio[i], 0);
+
+    // 50%: duas linhas e meia de baixo acesas, as duas de cima apagadas
+    settle(&render, Q8(50), 0, fio);
+    for (int i = 0; i < MATRIX_RENDER_PIXELS; i++)
+    {
+        int row_from_top = i / MATRIX_RENDER_WIDTH;
+        CHECK_EQ(fio[i] & 0xFF, 0); // Os 8 bits baixos não vão para o PIO
+        if (row_from_top < 2)
+            CHECK_EQ(fio[i], 0);
+        else
+            CHECK(blue(fio[i]) > 0);
+    }
+    // A superfície pela metade fica mais fraca que a linha cheia de mesma cor
+    matrix_render_t full;
+    uint32_t fio_full[MATRIX_RENDER_PIXELS];
+    matrix_render_init(&full, 255, identity);
+    settle(&full, Q8(60), 0, fio_full);
+    CHECK(blue(fio[2 * MATRIX_RENDER_WIDTH]) < blue(fio_full[2 * MATRIX_RENDER_WIDTH]));
+
+    // Fora da faixa fica nos extremos
+    settle(&render, Q8(300), 0, fio);
+    for (int i = 0; i < MATRIX_RENDER_PIXELS; i++)
+        CHECK(blue(fio[i]) > 0);
+    settle(&render, -Q8(50), 0, fio);
+    for (int i = 0; i < MATRIX_RENDER_PIXELS; i++)
+        CHECK_EQ(fio[i], 0);
+}
+
+static void test_surface_fraction(void)
+{
+    // Dentro da linha da superfície o brilho só cresce com o nível
+    uint32_t previous = 0;
+    for (int32_t level = Q8(40) + 1; level <= Q8(60); level += 64)
+    {
+        matrix_render_t render;
+        uint32_t fio[MATRIX_RENDER_PIXELS];
+        matrix_render_init(&render, 255, identity);
+        settle(&render, level, 0, fio);
+        uint32_t value = blue(fio[2 * MATRIX_RENDER_WIDTH]);
+        CHECK(value >= previous);
+        previous = value;
+    }
+}
+
+static void test_easing(void)
+{
+    matrix_render_t render;
+    uint32_t fio[MATRIX_RENDER_PIXELS];
+
+    matrix_render_init(&render, 255, identity);
+    matrix_render_frame(&render, Q8(80), 0, fio);
+    CHECK_EQ(render.shown_q8, Q8(80) >> MATRIX_RENDER_EASE_SHIFT);
+
+    // A menos de 2% do alvo em um segundo, e exatamente nele pouco depois, subindo e descendo
+    for (int f = 1; f < MATRIX_RENDER_FPS; f++)
+        matrix_render_frame(&render, Q8(80), 0, fio);
+    CHECK(Q8(80) - render.shown_q8 < Q8(2));
+    CHECK(settle(&render, Q8(80), 0, fio) < 2 * MATRIX_RENDER_FPS);
+    CHECK_EQ(render.shown_q8, Q8(80));
+
+    for (int f = 0; f < MATRIX_RENDER_FPS; f++)
+        matrix_render_frame(&render, Q8(10), 0, fio);
+    CHECK(render.shown_q8 - Q8(10) < Q8(2));
+    CHECK(settle(&render, Q8(10), 0, fio) < 2 * MATRIX_RENDER_FPS);
+    CHECK_EQ(render.shown_q8, Q8(10));
+}
+
+static void test_animations(void)
+{
+    matrix_render_t render;
+    uint32_t fio[MATRIX_RENDER_PIXELS];
+    uint32_t seen_min = 255, seen_max = 0;
+
+    // Alarme: a parte vazia pulsa em vermelho, sem verde nem azul
+    matrix_render_init(&render, 255, identity);
+    settle(&render, Q8(20), MATRIX_RENDER_FLAG_ALARM, fio);
+    for (int f = 0; f < MATRIX_RENDER_FPS; f++)
+    {
+        matrix_render_frame(&render, Q8(20), MATRIX_RENDER_FLAG_ALARM, fio);
+        CHECK_EQ(green(fio[0]), 0);
+        CHECK_EQ(blue(fio[0]), 0);
+        if (red(fio[0]) < seen_min)
+            seen_min = red(fio[0]);
+        if (red(fio[0]) > seen_max)
+            seen_max = red(fio[0]);
+    }
+    CHECK(seen_max > seen_min);
+
+    // Bomba: a superfície varia de coluna a coluna, as linhas cheias abaixo não
+    matrix_render_init(&render, 255, identity);
+    settle(&render, Q8(60), MATRIX_RENDER_FLAG_PUMP, fio);
+    bool wave = false;
+    for (int c = 1; c < MATRIX_RENDER_WIDTH; c++)
+    {
+        wave |= fio[2 * MATRIX_RENDER_WIDTH + c] != fio[2 * MATRIX_RENDER_WIDTH];
+        CHECK_EQ(fio[4 * MATRIX_RENDER_WIDTH + c], fio[4 * MATRIX_RENDER_WIDTH]);
+    }
+    CHECK(wave);
+}
+
+static void test_brightness_and_wire(void)
+{
+    matrix_render_t dim, ordered, wired;
+    uint32_t fio_dim[MATRIX_RENDER_PIXELS], fio_ordered[MATRIX_RENDER_PIXELS], fio_wired[MATRIX_RENDER_PIXELS];
+
+    matrix_render_init(&dim, 0, identity);
+    settle(&dim, Q8(100), 0, fio_dim);
+    for (int i = 0; i < MATRIX_RENDER_PIXELS; i++)
+        CHECK_EQ(fio_dim[i], 0);
+
+    // Cada posição do fio recebe a cor do pixel ligado a ela
+    matrix_render_init(&ordered, 255, identity);
+    matrix_render_init(&wired, 255, serpentine);
+    settle(&ordered, Q8(50), 0, fio_ordered);
+    settle(&wired, Q8(50), 0, fio_wired);
+    for (uint8_t i = 0; i < MATRIX_RENDER_PIXELS; i++)
+        CHECK_EQ(fio_wired[i], fio_ordered[serpentine(i)]);
+}
+
+int main(void)
+{
+    test_gamma();
+    test_fill();
+    test_surface_fraction();
+    test_easing();
+    test_animations();
+    test_brightness_and_wire();
+    return TEST_RESULT;
+}
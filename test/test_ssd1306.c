@@ -0,0 +1,400 @@
+#include <string.h>
+#include <time.h>
+#include "test.h"
+#include "ssd1306/ssd1306.h"
+#include "hardware/dma.h"
+#include "ssd1306/font.h"
+
+// Envio do display sobre o I2C e o DMA emulados: o que chega ao fio, em que ordem, de quem é o
+// buffer de envio durante a transferência, a recuperação de um NACK e as janelas do envio parcial.
+// As primitivas de desenho por byte são comparadas com as antigas, pixel a pixel
+
+#define ADDRESS 0x3C
+#define FULL_FRAME_WORDS (8 + WIDTH * HEIGHT / 8) // Comandos de janela, byte de controle e a GDDRAM
+
+static ssd1306_t ssd;
+static uint32_t flushes;
+
+static void flush_done(void *ctx)
+{
+    (*(uint32_t *)ctx)++;
+}
+
+static void setup(void)
+{
+    static bool initialized = false;
+    if (!initialized)
+    {
+        ssd1306_init(&ssd, WIDTH, HEIGHT, false, ADDRESS, i2c0);
+        i2c_get_hw(i2c0)->tar = ADDRESS;
+        ssd1306_dma_init(&ssd, flush_done, &flushes);
+        initialized = true;
+    }
+    ssd1306_wait_idle(&ssd);
+    ssd1306_invalidate(&ssd);
+    host_wire_len = 0;
+    flushes = 0;
+}
+
+static host_dma_channel_t *channel(void)
+{
+    return &host_dma[ssd.dma_chan];
+}
+
+// Confere no fio uma janela completa a partir de 'at': comandos, byte de controle e 'data_len' bytes
+static void check_window(size_t at, uint8_t c0, uint8_t c1, uint8_t p0, uint8_t p1, size_t data_len)
+{
+    const uint16_t *w = &host_wire[at];
+    CHECK_EQ(w[0], 0x00);
+    CHECK_EQ(w[1], SET_COL_ADDR);
+    CHECK_EQ(w[2], c0);
+    CHECK_EQ(w[3], c1);
+    CHECK_EQ(w[4], SET_PAGE_ADDR);
+    CHECK_EQ(w[5], p0);
+    CHECK_EQ(w[6], p1 | I2C_IC_DATA_CMD_STOP_BITS);
+    CHECK_EQ(w[7], 0x40);
+    for (size_t i = 0; i + 1 < data_len; i++)
+        CHECK(!(w[8 + i] & I2C_IC_DATA_CMD_STOP_BITS));
+    CHECK(w[8 + data_len - 1] & I2C_IC_DATA_CMD_STOP_BITS); // STOP só no último byte
+}
+
+static void test_buffer_ownership(void)
+{
+    setup();
+
+    ssd1306_fill(&ssd, true);
+    CHECK(ssd1306_send_data_async(&ssd));
+    CHECK(ssd1306_is_busy(&ssd));
+    CHECK_EQ(channel()->count, FULL_FRAME_WORDS);
+    CHECK_EQ(host_wire_len, 0);
+    CHECK_EQ(flushes, 0);
+
+    // Redesenhar durante o envio não muda o que vai para o fio: o quadro já está no tx_words
+    ssd1306_fill(&ssd, false);
+    host_dma_complete(ssd.dma_chan);
+    CHECK_EQ(flushes, 1);
+    CHECK_EQ(host_wire_len, FULL_FRAME_WORDS);
+    check_window(0, 0, WIDTH - 1, 0, HEIGHT / 8 - 1, WIDTH * HEIGHT / 8);
+    for (size_t i = 8; i < FULL_FRAME_WORDS; i++)
+        CHECK_EQ(host_wire[i] & 0xFF, 0xFF);
+    CHECK(!ssd1306_is_busy(&ssd));
+}
+
+static void test_ordering(void)
+{
+    setup();
+
+    ssd1306_fill(&ssd, false);
+    ssd1306_send_data(&ssd);
+    host_wire_len = 0;
+    uint32_t transfers = channel()->transfers;
+
+    // Primeiro envio ainda no barramento quando o segundo é pedido
+    ssd1306_pixel(&ssd, 10, 3, true);
+    CHECK(ssd1306_send_data_async(&ssd));
+    ssd1306_pixel(&ssd, 100, 60, true);
+    CHECK(ssd1306_send_data_async(&ssd));
+    CHECK_EQ(channel()->transfers, transfers + 2);
+
+    // O segundo só foi empacotado depois de o primeiro sair inteiro
+    CHECK_EQ(host_wire_len, 9);
+    check_window(0, 10, 10, 0, 0, 1);
+    CHECK_EQ(host_wire[8] & 0xFF, 1 << 3);
+
+    // E leva só o que mudou depois do primeiro
+    host_dma_complete(ssd.dma_chan);
+    CHECK_EQ(host_wire_len, 18);
+    check_window(9, 100, 100, 7, 7, 1);
+    CHECK_EQ(host_wire[17] & 0xFF, 1 << 4);
+    CHECK_EQ(flushes, 3);
+
+    // Nada mudou: nada é enviado e o callback não é chamado
+    CHECK(!ssd1306_send_data_async(&ssd));
+    CHECK_EQ(channel()->transfers, transfers + 2);
+    CHECK_EQ(flushes, 3);
+}
+
+static void test_abort_resends_full_frame(void)
+{
+    setup();
+
+    ssd1306_fill(&ssd, false);
+    ssd1306_send_data(&ssd);
+    host_wire_len = 0;
+    uint32_t clears = host_i2c_abort_clears;
+
+    // O display não responde durante o envio: o I2C descarta o quadro e fica em abort
+    ssd1306_pixel(&ssd, 5, 5, true);
+    CHECK(ssd1306_send_data_async(&ssd));
+    i2c_get_hw(i2c0)->raw_intr_stat |= I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS;
+    host_dma_complete(ssd.dma_chan);
+    CHECK_EQ(host_wire_len, 0);
+
+    // O envio seguinte, só pelo caminho assíncrono, limpa o abort e reenvia o quadro inteiro
+    ssd1306_pixel(&ssd, 6, 5, true);
+    CHECK(ssd1306_send_data_async(&ssd));
+    CHECK_EQ(host_i2c_abort_clears, clears + 1);
+    CHECK(!(i2c_get_hw(i2c0)->raw_intr_stat & I2C_IC_RAW_INTR_STAT_TX_ABRT_BITS));
+    CHECK_EQ(channel()->count, FULL_FRAME_WORDS);
+    host_dma_complete(ssd.dma_chan);
+    CHECK_EQ(host_wire_len, FULL_FRAME_WORDS);
+    CHECK_EQ(host_wire[8 + 5 * 8] & 0xFF, 1 << 5);
+    CHECK_EQ(host_wire[8 + 6 * 8] & 0xFF, 1 << 5);
+
+    // Com o display de volta, os envios voltam a ser só das alterações
+    ssd1306_pixel(&ssd, 7, 5, true);
+    CHECK(ssd1306_send_data_async(&ssd));
+    CHECK_EQ(channel()->count, 9);
+    CHECK_EQ(host_i2c_abort_clears, clears + 1);
+}
+
+static void test_dirty_windows(void)
+{
+    setup();
+    ssd1306_fill(&ssd, false);
+    ssd1306_send_data(&ssd);
+    CHECK_EQ(ssd.last_flush_bytes, FULL_FRAME_WORDS + 2); // Mais o byte de endereço de cada transação
+    host_wire_len = 0;
+
+    // Colunas alteradas a até SSD1306_WINDOW_MERGE_GAP colunas limpas uma da outra vão na mesma janela
+    ssd1306_pixel(&ssd, 20, 0, true);
+    ssd1306_pixel(&ssd, 20 + SSD1306_WINDOW_MERGE_GAP + 1, 0, true);
+    ssd1306_send_data(&ssd);
+    CHECK_EQ(ssd.last_flush_bytes, 8 + SSD1306_WINDOW_MERGE_GAP + 2 + 2);
+    host_wire_len = 0;
+
+    // Uma coluna limpa a mais separa as janelas
+    ssd1306_pixel(&ssd, 40, 0, true);
+    ssd1306_pixel(&ssd, 40 + SSD1306_WINDOW_MERGE_GAP + 2, 0, true);
+    ssd1306_send_data(&ssd);
+    CHECK_EQ(host_wire_len, 18);
+    check_window(0, 40, 40, 0, 0, 1);
+    check_window(9, 40 + SSD1306_WINDOW_MERGE_GAP + 2, 40 + SSD1306_WINDOW_MERGE_GAP + 2, 0, 0, 1);
+    CHECK_EQ(ssd.last_flush_bytes, 2 * (9 + 2));
+    host_wire_len = 0;
+
+    // A janela cobre da primeira à última página alterada, com as do meio inalteradas
+    ssd1306_pixel(&ssd, 90, 2 * 8, true);
+    ssd1306_pixel(&ssd, 90, 5 * 8 + 7, true);
+    ssd1306_send_data(&ssd);
+    CHECK_EQ(host_wire_len, 8 + 4);
+    check_window(0, 90, 90, 2, 5, 4);
+    CHECK_EQ(host_wire[8] & 0xFF, 0x01);
+    CHECK_EQ(host_wire[9] & 0xFF, 0x00);
+    CHECK_EQ(host_wire[10] & 0xFF, 0x00);
+    CHECK_EQ(host_wire[11] & 0xFF, 0x80);
+    host_wire_len = 0;
+
+    // Apagar e redesenhar o mesmo pixel antes do envio não gera tráfego
+    ssd1306_pixel(&ssd, 90, 2 * 8, false);
+    ssd1306_pixel(&ssd, 90, 2 * 8, true);
+    CHECK(!ssd1306_send_data_async(&ssd));
+    CHECK_EQ(ssd.last_flush_bytes, 0);
+}
+
+// Mesmo layout do painel desenhado por vDisplayTask
+static void draw_dashboard(int level)
+{
+    char str[8];
+    ssd1306_fill(&ssd, false);
+    ssd1306_rect(&ssd, 3, 3, 122, 60, true, false);
+    ssd1306_draw_string(&ssd, "Min: ", 10, 10);
+    ssd1306_draw_string(&ssd, "20%", 58, 10);
+    ssd1306_draw_string(&ssd, "Max: ", 10, 20);
+    ssd1306_draw_string(&ssd, "50%", 58, 20);
+    ssd1306_draw_string(&ssd, "Nivel: ", 10, 30);
+    snprintf(str, sizeof(str), "%d%%", level);
+    ssd1306_draw_string(&ssd, str, 58, 30);
+    ssd1306_draw_string(&ssd, ">", 48, 10);
+    ssd1306_draw_string(&ssd, "Bomba:OFF", 10, 40);
+    ssd1306_draw_string(&ssd, "Wi-Fi:ON", 10, 50);
+}
+
+static void test_dashboard_refresh(void)
+{
+    setup();
+    draw_dashboard(42);
+    ssd1306_send_data(&ssd);
+    size_t full = ssd.last_flush_bytes;
+    CHECK_EQ(full, FULL_FRAME_WORDS + 2);
+    host_wire_len = 0;
+
+    // Só o dígito das unidades do nível muda: uma janela nas colunas dele, páginas 3 e 4 (y = 30)
+    draw_dashboard(43);
+    ssd1306_send_data(&ssd);
+    CHECK_EQ(host_wire[4], SET_PAGE_ADDR);
+    CHECK(host_wire[2] >= 66 && host_wire[3] <= 73);
+    CHECK_EQ(host_wire[5], 3);
+    CHECK_EQ(host_wire[6] & 0xFF, 4);
+    CHECK_EQ(ssd.last_flush_bytes, host_wire_len + 2);
+    CHECK(ssd.last_flush_bytes <= 8 + 8 * 2 + 2);
+    CHECK(ssd.last_flush_bytes * 40 < full); // Economia de mais de 97% por atualização
+    host_wire_len = 0;
+
+    // Redesenhar o mesmo valor não envia nada
+    draw_dashboard(43);
+    CHECK(!ssd1306_send_data_async(&ssd));
+}
+
+// Primitivas de referência, pixel a pixel como eram antes das versões por byte, com corte nas bordas
+static void ref_pixel(ssd1306_t *d, int x, int y, bool value)
+{
+    if (x >= 0 && x < d->width && y >= 0 && y < d->height)
+        ssd1306_pixel(d, x, y, value);
+}
+
+static void ref_hline(ssd1306_t *d, int x0, int x1, int y, bool value)
+{
+    for (int x = x0; x <= x1; ++x)
+        ref_pixel(d, x, y, value);
+}
+
+static void ref_vline(ssd1306_t *d, int x, int y0, int y1, bool value)
+{
+    for (int y = y0; y <= y1; ++y)
+        ref_pixel(d, x, y, value);
+}
+
+static void ref_rect(ssd1306_t *d, int top, int left, int width, int height, bool value, bool fill)
+{
+    ref_hline(d, left, left + width - 1, top, value);
+    ref_hline(d, left, left + width - 1, top + height - 1, value);
+    ref_vline(d, left, top, top + height - 1, value);
+    ref_vline(d, left + width - 1, top, top + height - 1, value);
+    if (fill)
+    {
+        for (int x = left + 1; x < left + width - 1; ++x)
+            ref_vline(d, x, top + 1, top + height - 2, value);
+    }
+}
+
+static void ref_draw_char(ssd1306_t *d, char c, int x, int y)
+{
+    int index = (c >= ' ' && c <= '~') ? (c - ' ') * 8 : 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        for (int j = 0; j < 8; ++j)
+            ref_pixel(d, x + i, y + j, font[index + i] & (1 << j));
+    }
+}
+
+static uint32_t lcg_state = 12345;
+
+static uint32_t lcg(uint32_t range)
+{
+    lcg_state = lcg_state * 1103515245u + 12345u;
+    return (lcg_state >> 16) % range;
+}
+
+// Mesmo fundo aleatório nos dois quadros, para conferir tanto acender quanto apagar pixels
+static void random_background(ssd1306_t *a, ssd1306_t *b)
+{
+    for (size_t i = 1; i < a->bufsize; i++)
+        a->ram_buffer[i] = (uint8_t)lcg(256);
+    memcpy(b->ram_buffer, a->ram_buffer, a->bufsize);
+}
+
+static void test_primitives_match_per_pixel(void)
+{
+    static ssd1306_t fast, ref;
+    ssd1306_init(&fast, WIDTH, HEIGHT, false, ADDRESS, i2c0);
+    ssd1306_init(&ref, WIDTH, HEIGHT, false, ADDRESS, i2c0);
+
+    for (int round = 0; round < 2000; round++)
+    {
+        random_background(&fast, &ref);
+        bool value = lcg(2);
+
+        // Retângulos dentro da tela, de 1x1 até a tela inteira
+        uint8_t left = lcg(WIDTH), top = lcg(HEIGHT);
+        uint8_t width = 1 + lcg(WIDTH - left), height = 1 + lcg(HEIGHT - top);
+        bool fill = lcg(2);
+        ssd1306_rect(&fast, top, left, width, height, value, fill);
+        ref_rect(&ref, top, left, width, height, value, fill);
+
+        // Linhas que podem passar da borda
+        uint8_t x0 = lcg(WIDTH + 8), x1 = x0 + lcg(WIDTH), y = lcg(HEIGHT + 8);
+        ssd1306_hline(&fast, x0, x1, y, value);
+        ref_hline(&ref, x0, x1, y, value);
+        uint8_t x = lcg(WIDTH + 8), y0 = lcg(HEIGHT + 8), y1 = y0 + lcg(HEIGHT);
+        ssd1306_vline(&fast, x, y0, y1, value);
+        ref_vline(&ref, x, y0, y1, value);
+
+        // Caracteres em qualquer alinhamento de página, inclusive cortados na borda direita e inferior
+        char c = (char)lcg(128);
+        x = lcg(WIDTH + 4);
+        y = lcg(HEIGHT + 4);
+        ssd1306_draw_char(&fast, c, x, y);
+        ref_draw_char(&ref, c, x, y);
+
+        if (memcmp(fast.ram_buffer, ref.ram_buffer, fast.bufsize))
+        {
+            printf("rodada %d: quadro difere da referência pixel a pixel\n", round);
+            test_failures++;
+            break;
+        }
+    }
+}
+
+// Painel de vDisplayTask desenhado com as primitivas de 'rect', 'vline' e 'draw_char' escolhidas
+static void bench_dashboard(ssd1306_t *d, bool per_pixel)
+{
+    static const char *lines[] = {"Min: 20%", "Max: 50%", "Nivel: 43%", "Bomba:OFF", "Wi-Fi:ON"};
+    ssd1306_fill(d, false);
+    if (per_pixel)
+        ref_rect(d, 3, 3, 122, 60, true, false);
+    else
+        ssd1306_rect(d, 3, 3, 122, 60, true, false);
+    for (int l = 0; l < 5; l++)
+    {
+        for (int i = 0; lines[l][i]; i++)
+        {
+            if (per_pixel)
+                ref_draw_char(d, lines[l][i], 10 + 8 * i, 10 + 10 * l);
+            else
+                ssd1306_draw_char(d, lines[l][i], 10 + 8 * i, 10 + 10 * l);
+        }
+    }
+    for (int x = 90; x < 122; x++)
+    {
+        if (per_pixel)
+            ref_vline(d, x, 20 + x % 30, 58, true);
+        else
+            ssd1306_vline(d, x, 20 + x % 30, 58, true);
+    }
+}
+
+static double bench_seconds(ssd1306_t *d, bool per_pixel, int frames)
+{
+    clock_t start = clock();
+    for (int i = 0; i < frames; i++)
+        bench_dashboard(d, per_pixel);
+    return (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void test_primitives_benchmark(void)
+{
+    static ssd1306_t fast, ref;
+    const int frames = 2000;
+    ssd1306_init(&fast, WIDTH, HEIGHT, false, ADDRESS, i2c0);
+    ssd1306_init(&ref, WIDTH, HEIGHT, false, ADDRESS, i2c0);
+
+    double per_pixel = bench_seconds(&ref, true, frames);
+    double per_byte = bench_seconds(&fast, false, frames);
+    CHECK(!memcmp(fast.ram_buffer, ref.ram_buffer, fast.bufsize));
+    printf("painel: %.1f us por quadro pixel a pixel, %.1f us por byte (%.1fx)\n",
+           per_pixel * 1e6 / frames, per_byte * 1e6 / frames, per_byte > 0 ? per_pixel / per_byte : 0.0);
+    CHECK(per_byte < per_pixel);
+}
+
+int main(void)
+{
+    test_buffer_ownership();
+    test_ordering();
+    test_abort_resends_full_frame();
+    test_dirty_windows();
+    test_dashboard_refresh();
+    test_primitives_match_per_pixel();
+    test_primitives_benchmark();
+    return TEST_RESULT;
+}
@@ -0,0 +1,358 @@
+#include "test.h"
+#include "timeseries/timeseries.h"
+
+#include <string.h>
+#include <time.h>
+
+// Agregação entre níveis, escolha do nível nas consultas, os dois formatos de saída,
+// a detecção de registros sobrescritos durante uma leitura e o tamanho e a vazão da codificação
+
+#define PERIOD_MS 100
+
+static timeseries_t ts;
+
+static uint32_t get_u32(const uint8_t *buf)
+{
+    return buf[0] | buf[1] << 8 | buf[2] << 16 | (uint32_t)buf[3] << 24;
+}
+
+// Lê toda a saída em pedaços de 'step' bytes. Retorna o total, ou -1 se a leitura falhou
+static int read_all(timeseries_reader_t *reader, uint8_t *buf, size_t size, size_t step)
+{
+    size_t total = 0;
+    for (;;)
+    {
+        size_t want = size - total < step ? size - total : step;
+        int n = timeseries_read(reader, buf + total, want);
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            return total;
+        total += n;
+    }
+}
+
+static void fill(uint32_t count, uint32_t origin_ms)
+{
+    timeseries_init(&ts, PERIOD_MS);
+    for (uint32_t i = 0; i < count; i++)
+        timeseries_insert(&ts, i % 100, 0, 20, 80, origin_ms + i * PERIOD_MS);
+}
+
+static void test_aggregation(void)
+{
+    timeseries_record_t record;
+
+    timeseries_init(&ts, PERIOD_MS);
+    for (uint32_t i = 0; i < TIMESERIES_TIER1_RATIO; i++)
+        timeseries_insert(&ts, 10 + i, i == 3 ? TIMESERIES_FLAG_PUMP : 0, 20, 80 + i, 5000 + i * PERIOD_MS);
+
+    CHECK_EQ(ts.origin_ms, 5000);
+    CHECK_EQ(ts.tiers[0].count, TIMESERIES_TIER1_RATIO);
+    CHECK_EQ(ts.tiers[1].count, 1);
+    CHECK_EQ(ts.tiers[2].count, 0);
+
+    CHECK(timeseries_get(&ts, 0, 3, &record));
+    CHECK_EQ(record.level, 13);
+    CHECK_EQ(record.level_min, 13);
+    CHECK_EQ(record.flags, TIMESERIES_FLAG_PUMP);
+    CHECK(!timeseries_get(&ts, 0, TIMESERIES_TIER1_RATIO, &record));
+
+    // Média arredondada de 10..19, extremos, bomba ligada em algum momento e limites do último registro
+    CHECK(timeseries_get(&ts, 1, 0, &record));
+    CHECK_EQ(record.level, 15);
+    CHECK_EQ(record.level_min, 10);
+    CHECK_EQ(record.level_max, 19);
+    CHECK_EQ(record.flags, TIMESERIES_FLAG_PUMP);
+    CHECK_EQ(record.limit_max, 80 + TIMESERIES_TIER1_RATIO - 1);
+
+    CHECK_EQ(timeseries_record_ms(&ts, 1, 2), 5000 + 2 * PERIOD_MS * TIMESERIES_TIER1_RATIO);
+
+    // Um agregado do nível 2 a cada TIER1_RATIO * TIER2_RATIO leituras
+    fill(TIMESERIES_TIER1_RATIO * TIMESERIES_TIER2_RATIO * 2, 0);
+    CHECK_EQ(ts.tiers[1].count, TIMESERIES_TIER2_RATIO * 2);
+    CHECK_EQ(ts.tiers[2].count, 2);
+}
+
+static void test_wraparound(void)
+{
+    timeseries_record_t record;
+
+    fill(TIMESERIES_TIER0_CAPACITY * 3 + 7, 0);
+    uint32_t count = ts.tiers[0].count;
+    // O registro mais antigo do buffer é o próximo a ser sobrescrito e já não é entregue
+    CHECK(!timeseries_get(&ts, 0, count - TIMESERIES_TIER0_CAPACITY, &record));
+    CHECK(timeseries_get(&ts, 0, count - TIMESERIES_TIER0_CAPACITY + 1, &record));
+    CHECK_EQ(record.level, (count - TIMESERIES_TIER0_CAPACITY + 1) % 100);
+    CHECK(timeseries_get(&ts, 0, count - 1, &record));
+    CHECK_EQ(record.level, (count - 1) % 100);
+}
+
+static void test_query(void)
+{
+    timeseries_range_t range;
+
+    // 70 s de leituras: o nível 0 guarda só os últimos 60 s
+    fill(700, 0);
+
+    timeseries_query(&ts, 20000, 70000, 0, &range);
+    CHECK_EQ(range.tier, 0);
+    CHECK_EQ(range.first, 200);
+    CHECK_EQ(range.end, 700);
+
+    // Pontos demais para o limite: passa para os agregados de 1 s
+    timeseries_query(&ts, 20000, 70000, 100, &range);
+    CHECK_EQ(range.tier, 1);
+    CHECK_EQ(range.first, 20);
+    CHECK_EQ(range.end, 70);
+
+    // Início fora do nível 0
+    timeseries_query(&ts, 0, 70000, 0, &range);
+    CHECK_EQ(range.tier, 1);
+    CHECK_EQ(range.first, 0);
+
+    // Intervalo no futuro ou invertido: vazio
+    timeseries_query(&ts, 90000, 95000, 0, &range);
+    CHECK_EQ(range.end - range.first, 0);
+    timeseries_query(&ts, 50000, 40000, 0, &range);
+    CHECK_EQ(range.end - range.first, 0);
+}
+
+static void test_json(void)
+{
+    timeseries_range_t range;
+    timeseries_reader_t reader;
+    char buf[256];
+
+    timeseries_init(&ts, PERIOD_MS);
+    timeseries_insert(&ts, 10, 0, 20, 80, 1000);
+    timeseries_insert(&ts, 12, TIMESERIES_FLAG_PUMP, 20, 80, 1100);
+    timeseries_insert(&ts, 11, TIMESERIES_FLAG_PUMP, 20, 80, 1200);
+
+    timeseries_query(&ts, 0, 2000, 0, &range);
+    timeseries_reader_init(&reader, &ts, TIMESERIES_FORMAT_JSON, &range);
+    uint32_t size = timeseries_reader_size(&reader);
+    int n = read_all(&reader, (uint8_t *)buf, sizeof(buf) - 1, sizeof(buf));
+    CHECK_EQ(n, size);
+    buf[n > 0 ? n : 0] = '\0';
+
+    const char *expected = "{\"periodo_ms\":100,\"inicio_ms\":1000,\"n\":3,\"nivel\":[10,2,-1],"
+                           "\"bomba\":[0,0,1,1],\"sem_leitura\":[0,0],\"min\":[0,20],\"max\":[0,80]}";
+    CHECK(strcmp(buf, expected) == 0);
+    if (strcmp(buf, expected) != 0)
+        printf("saída: %s\n", buf);
+}
+
+static void test_binary(void)
+{
+    timeseries_range_t range;
+    timeseries_reader_t reader;
+    uint8_t buf[TIMESERIES_BINARY_HEADER_SIZE + 4 * sizeof(timeseries_record_t)];
+
+    fill(4, 3000);
+    timeseries_query(&ts, 0, 10000, 0, &range);
+    timeseries_reader_init(&reader, &ts, TIMESERIES_FORMAT_BINARY, &range);
+    CHECK_EQ(timeseries_reader_size(&reader), sizeof(buf));
+    CHECK_EQ(read_all(&reader, buf, sizeof(buf), sizeof(buf)), sizeof(buf));
+
+    CHECK(buf[0] == 'N' && buf[1] == 'V');
+    CHECK_EQ(buf[2], TIMESERIES_BINARY_VERSION);
+    CHECK_EQ(buf[3], sizeof(timeseries_record_t));
+    CHECK_EQ(get_u32(buf + 4), PERIOD_MS);
+    CHECK_EQ(get_u32(buf + 8), 3000);
+    CHECK_EQ(get_u32(buf + 12), 4);
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        const uint8_t *record = buf + TIMESERIES_BINARY_HEADER_SIZE + i * sizeof(timeseries_record_t);
+        CHECK_EQ(record[0], i);
+        CHECK_EQ(record[4], 20);
+        CHECK_EQ(record[5], 80);
+    }
+}
+
+static void test_chunked(void)
+{
+    static uint8_t whole[16 * 1024], chunked[sizeof(whole)];
+    timeseries_range_t range;
+
+    fill(TIMESERIES_TIER1_RATIO * 200 + 3, 0);
+    timeseries_query(&ts, 0, UINT32_MAX, 0, &range);
+    CHECK_EQ(range.tier, 1);
+    CHECK_EQ(range.end - range.first, 200);
+
+    for (uint8_t format = TIMESERIES_FORMAT_BINARY; format <= TIMESERIES_FORMAT_JSON; format++)
+    {
+        timeseries_reader_t reader;
+        timeseries_reader_init(&reader, &ts, format, &range);
+        uint32_t size = timeseries_reader_size(&reader);
+        CHECK_EQ(read_all(&reader, whole, sizeof(whole), sizeof(whole)), size);
+
+        // Pedaços de qualquer tamanho produzem a mesma saída, e o tamanho restante é exato a cada passo
+        for (size_t step = 1; step <= 100; step += 3)
+        {
+            size_t total = 0;
+            int n;
+            timeseries_reader_init(&reader, &ts, format, &range);
+            do
+            {
+                CHECK_EQ(timeseries_reader_size(&reader), size - total);
+                n = timeseries_read(&reader, chunked + total, step);
+                total += n > 0 ? n : 0;
+            } while (n > 0 && total < size + 1);
+            CHECK_EQ(n, 0);
+            CHECK_EQ(total, size);
+            CHECK(memcmp(whole, chunked, size) == 0);
+        }
+    }
+}
+
+static void test_overwritten(void)
+{
+    timeseries_range_t range;
+    timeseries_reader_t reader;
+    uint8_t buf[64];
+
+    fill(700, 0);
+    timeseries_query(&ts, 20000, 70000, 0, &range);
+    CHECK_EQ(range.tier, 0);
+    timeseries_reader_init(&reader, &ts, TIMESERIES_FORMAT_BINARY, &range);
+    CHECK(timeseries_read(&reader, buf, sizeof(buf)) > 0);
+
+    // A folga ainda protege a leitura em andamento
+    for (uint32_t i = 0; i < TIMESERIES_READ_SLACK - 1; i++)
+        timeseries_insert(&ts, 0, 0, 20, 80, 70000 + i * PERIOD_MS);
+    CHECK(timeseries_read(&reader, buf, sizeof(buf)) > 0);
+
+    // Depois dela, o leitor percebe que perdeu registros em vez de entregar dados misturados
+    for (uint32_t i = 0; i < TIMESERIES_TIER0_CAPACITY; i++)
+        timeseries_insert(&ts, 0, 0, 20, 80, 80000 + i * PERIOD_MS);
+    CHECK_EQ(timeseries_read(&reader, buf, sizeof(buf)), -1);
+}
+
+// Nível em passeio aleatório de um ponto por leitura, a bomba ligando e desligando de vez em quando
+static void fill_random_walk(uint32_t count)
+{
+    uint32_t lcg = 12345;
+    int level = 50;
+    uint8_t flags = 0;
+    timeseries_init(&ts, PERIOD_MS);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        lcg = lcg * 1103515245u + 12345u;
+        level += (int)((lcg >> 16) % 3) - 1;
+        level = level < 0 ? 0 : level > 100 ? 100 : level;
+        if ((lcg >> 8) % 200 == 0)
+            flags ^= TIMESERIES_FLAG_PUMP;
+        timeseries_insert(&ts, (uint8_t)level, flags, 20, 80, i * PERIOD_MS);
+    }
+}
+
+static uint32_t encoded_size(timeseries_format_t format, const timeseries_range_t *range)
+{
+    static uint8_t out[64 * 1024];
+    timeseries_reader_t reader;
+    timeseries_reader_init(&reader, &ts, format, range);
+    uint32_t size = timeseries_reader_size(&reader);
+    CHECK_EQ(read_all(&reader, out, sizeof(out), 256), size);
+    return size;
+}
+
+static void test_encode_size(void)
+{
+    timeseries_range_t range;
+
+    // Último minuto de leituras: o binário é o cabeçalho e um registro de tamanho fixo por amostra
+    const uint32_t readings = TIMESERIES_TIER0_CAPACITY * 2;
+    const uint32_t minute = TIMESERIES_TIER0_CAPACITY - TIMESERIES_READ_SLACK;
+    fill_random_walk(readings);
+    timeseries_query(&ts, (readings - minute) * PERIOD_MS, readings * PERIOD_MS, 0, &range);
+    CHECK_EQ(range.tier, 0);
+    uint32_t n = range.end - range.first;
+    CHECK_EQ(n, minute);
+    uint32_t binary = encoded_size(TIMESERIES_FORMAT_BINARY, &range);
+    CHECK_EQ(binary, TIMESERIES_BINARY_HEADER_SIZE + n * sizeof(timeseries_record_t));
+
+    // JSON com diferenças: num passeio aleatório a coluna do nível gasta de 2 a 3 bytes por amostra
+    // ("0," "1," "-1,") e as mudanças raras da bomba e dos limites quase nada
+    uint32_t json = encoded_size(TIMESERIES_FORMAT_JSON, &range);
+    CHECK(json < binary / 2);
+    CHECK(json < 3 * n);
+    printf("nível 0, %u amostras: binário %.2f bytes por amostra, JSON %.2f\n", (unsigned)n,
+           (double)binary / n, (double)json / n);
+
+    // Nível parado: só "0," por amostra
+    timeseries_init(&ts, PERIOD_MS);
+    for (uint32_t i = 0; i < n; i++)
+        timeseries_insert(&ts, 42, 0, 20, 80, i * PERIOD_MS);
+    timeseries_query(&ts, 0, n * PERIOD_MS, 0, &range);
+    CHECK_EQ(range.end - range.first, n);
+    uint32_t flat = encoded_size(TIMESERIES_FORMAT_JSON, &range);
+    CHECK(flat <= 2 * n + 128);
+
+    // Agregados de 1 s: média, mínimo e máximo vão como diferenças, três colunas de até 3 bytes
+    fill_random_walk(TIMESERIES_TIER1_RATIO * 1000);
+    timeseries_query(&ts, 0, TIMESERIES_TIER1_RATIO * 1000 * PERIOD_MS, 0, &range);
+    CHECK_EQ(range.tier, 1);
+    n = range.end - range.first;
+    CHECK_EQ(n, 1000);
+    binary = encoded_size(TIMESERIES_FORMAT_BINARY, &range);
+    json = encoded_size(TIMESERIES_FORMAT_JSON, &range);
+    CHECK_EQ(binary, TIMESERIES_BINARY_HEADER_SIZE + n * sizeof(timeseries_record_t));
+    CHECK(json < 3 * 3 * n);
+    printf("nível 1, %u agregados: binário %.2f bytes por amostra, JSON %.2f\n", (unsigned)n,
+           (double)binary / n, (double)json / n);
+}
+
+// Vazão da codificação em pedaços do tamanho do buffer de uma conexão, como o envio pelo tcp_sent
+static void test_encode_throughput(void)
+{
+    static uint8_t chunk[256];
+    timeseries_range_t range;
+    const int rounds = 200;
+
+    const uint32_t readings = TIMESERIES_TIER1_RATIO * (TIMESERIES_TIER1_CAPACITY + 100);
+    fill_random_walk(readings);
+    // A última hora inteira, a maior resposta do nível 1
+    timeseries_query(&ts, readings * PERIOD_MS - 3600 * 1000, readings * PERIOD_MS, 0, &range);
+    CHECK_EQ(range.tier, 1);
+    uint32_t n = range.end - range.first;
+    CHECK_EQ(n, TIMESERIES_TIER1_CAPACITY - TIMESERIES_READ_SLACK);
+
+    for (uint8_t format = TIMESERIES_FORMAT_BINARY; format <= TIMESERIES_FORMAT_JSON; format++)
+    {
+        uint64_t bytes = 0;
+        clock_t start = clock();
+        for (int r = 0; r < rounds; r++)
+        {
+            timeseries_reader_t reader;
+            timeseries_reader_init(&reader, &ts, format, &range);
+            uint32_t size = timeseries_reader_size(&reader);
+            int got;
+            uint32_t total = 0;
+            while ((got = timeseries_read(&reader, chunk, sizeof(chunk))) > 0)
+                total += got;
+            CHECK_EQ(got, 0);
+            CHECK_EQ(total, size);
+            bytes += total;
+        }
+        double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+        if (seconds <= 0)
+            seconds = 1e-6;
+        printf("%s: %.1f MB/s, %.2f M amostras/s\n", format == TIMESERIES_FORMAT_BINARY ? "binário" : "JSON",
+               bytes / seconds / 1e6, (double)n * rounds / seconds / 1e6);
+    }
+}
+
+int main(void)
+{
+    test_aggregation();
+    test_wraparound();
+    test_query();
+    test_json();
+    test_binary();
+    test_chunked();
+    test_overwritten();
+    test_encode_size();
+    test_encode_throughput();
+    return TEST_RESULT;
+}
@@ -0,0 +1,160 @@
+#include "test.h"
+#include "ultrasonic/ultrasonic.h"
+#include "hardware/gpio.h"
+
+// Captura do eco por bordas marcadas no tempo: a máquina de estados sozinha, com sequências de bordas
+// simuladas, e o caminho da placa pela interrupção do GPIO emulado
+
+#define TRIG_PIN 17
+#define ECHO_PIN 16
+#define TIMEOUT_US 40000 // O mesmo limite de ultrasonic.c: eco mais longo é medição inválida
+
+// Duração do eco para uma distância, ida e volta a 343 m/s
+static uint64_t echo_us(float cm)
+{
+    return (uint64_t)(cm * 2.0f / 0.0343f + 0.5f);
+}
+
+static void test_echo_sweep(void)
+{
+    ultrasonic_echo_t echo;
+    uint64_t duration;
+    uint64_t t = 1000000;
+
+    ultrasonic_fsm_init(&echo);
+    for (float cm = 2.0f; cm <= 400.0f; cm += 0.5f)
+    {
+        ultrasonic_fsm_arm(&echo);
+        CHECK(!ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_RISE, t, &duration));
+        CHECK_EQ(echo.state, ULTRASONIC_WAIT_FALL);
+        duration = 12345;
+        CHECK(ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_FALL, t + echo_us(cm), &duration));
+        CHECK_EQ(duration, echo_us(cm));
+        CHECK_EQ(echo.state, ULTRASONIC_IDLE);
+
+        float measured = microseconds_to_cm(duration);
+        CHECK(measured > cm - 0.05f && measured < cm + 0.05f);
+        t += 60000;
+    }
+}
+
+static void test_timeout(void)
+{
+    ultrasonic_echo_t echo;
+    uint64_t duration = 1;
+    uint64_t t = 5000000;
+
+    // No limite ainda vale; um µs depois é inválida, mas a medição termina e o sensor fica livre
+    ultrasonic_fsm_init(&echo);
+    ultrasonic_fsm_arm(&echo);
+    ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_RISE, t, &duration);
+    CHECK(ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_FALL, t + TIMEOUT_US, &duration));
+    CHECK_EQ(duration, TIMEOUT_US);
+
+    ultrasonic_fsm_arm(&echo);
+    ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_RISE, t, &duration);
+    CHECK(ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_FALL, t + TIMEOUT_US + 1, &duration));
+    CHECK_EQ(duration, 0);
+    CHECK_EQ(echo.state, ULTRASONIC_IDLE);
+
+    // Sem eco nenhum: quem chamou desiste e cancela; o eco atrasado que chega depois é ignorado
+    ultrasonic_fsm_arm(&echo);
+    ultrasonic_fsm_cancel(&echo);
+    CHECK(!ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_RISE, t + 100000, &duration));
+    CHECK(!ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_FALL, t + 101000, &duration));
+    CHECK_EQ(echo.state, ULTRASONIC_IDLE);
+
+    // Cancelada com o eco em andamento: a descida dele também é ignorada
+    ultrasonic_fsm_arm(&echo);
+    ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_RISE, t + 200000, &duration);
+    ultrasonic_fsm_cancel(&echo);
+    CHECK(!ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_FALL, t + 300000, &duration));
+}
+
+static void test_odd_edges(void)
+{
+    ultrasonic_echo_t echo;
+    uint64_t duration = 1;
+    uint64_t t = 9000000;
+
+    // Bordas sem medição armada não fazem nada
+    ultrasonic_fsm_init(&echo);
+    CHECK(!ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, t, &duration));
+    CHECK_EQ(echo.state, ULTRASONIC_IDLE);
+
+    // Descida de um eco anterior antes da subida: continua esperando a subida
+    ultrasonic_fsm_arm(&echo);
+    CHECK(!ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_FALL, t, &duration));
+    CHECK_EQ(echo.state, ULTRASONIC_WAIT_RISE);
+
+    // Subida repetida durante o eco não reinicia a contagem
+    CHECK(!ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_RISE, t + 100, &duration));
+    CHECK(!ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_RISE, t + 500, &duration));
+    CHECK(ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_FALL, t + 1100, &duration));
+    CHECK_EQ(duration, 1000);
+
+    // As duas bordas na mesma interrupção: a duração não pode ser medida
+    ultrasonic_fsm_arm(&echo);
+    duration = 1;
+    CHECK(ultrasonic_fsm_edge(&echo, GPIO_IRQ_EDGE_RISE | GPIO_IRQ_EDGE_FALL, t + 5000, &duration));
+    CHECK_EQ(duration, 0);
+    CHECK_EQ(echo.state, ULTRASONIC_IDLE);
+}
+
+static uint64_t delivered_us;
+static uint32_t deliveries;
+
+static void echo_done(uint64_t pulse_duration_us, void *ctx)
+{
+    CHECK(ctx == &deliveries);
+    delivered_us = pulse_duration_us;
+    deliveries++;
+}
+
+static void echo_edge(bool level, uint32_t event)
+{
+    host_gpio_level[ECHO_PIN] = level;
+    host_gpio_irq_events[ECHO_PIN] |= event;
+    host_gpio_irq();
+}
+
+// O caminho da placa: gatilho, bordas pela interrupção do GPIO e o callback
+static void test_interrupt_path(void)
+{
+    ultrasonic_init_async(TRIG_PIN, ECHO_PIN, echo_done, &deliveries);
+    host_time_us = 20000000;
+
+    CHECK(ultrasonic_trigger());
+    CHECK(!host_gpio_level[TRIG_PIN]); // O pulso de gatilho já terminou
+    CHECK(!ultrasonic_trigger());      // Uma medição por vez
+
+    host_time_us += 300;
+    echo_edge(true, GPIO_IRQ_EDGE_RISE);
+    CHECK_EQ(host_gpio_irq_events[ECHO_PIN], 0); // Reconhecida pelo tratador
+    CHECK_EQ(deliveries, 0);
+    host_time_us += echo_us(50.0f);
+    echo_edge(false, GPIO_IRQ_EDGE_FALL);
+    CHECK_EQ(deliveries, 1);
+    CHECK_EQ(delivered_us, echo_us(50.0f));
+
+    // Interrupção de outro pino não mexe na medição
+    CHECK(ultrasonic_trigger());
+    host_gpio_irq();
+    CHECK_EQ(deliveries, 1);
+
+    // Eco ainda em nível alto: o gatilho é recusado até ele terminar
+    ultrasonic_cancel();
+    host_gpio_level[ECHO_PIN] = true;
+    CHECK(!ultrasonic_trigger());
+    host_gpio_level[ECHO_PIN] = false;
+    CHECK(ultrasonic_trigger());
+}
+
+int main(void)
+{
+    test_echo_sweep();
+    test_timeout();
+    test_odd_edges();
+    test_interrupt_path();
+    return TEST_RESULT;
+}
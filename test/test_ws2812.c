@@ -0,0 +1,442 @@
+#include <stdlib.h>
+#include <string.h>
+#include "test.h"
+#include "ws2812/ws2812.h"
+#include "hardware/dma.h"
+#include "hardware/clocks.h"
+#include "ws2812.pio.h"
+
+// Driver WS2812: o programa de lib/ws2812/ws2812.pio montado e executado ciclo a ciclo sobre as palavras
+// que o DMA põe na FIFO emulada (tempo de cada bit e bits na ordem GRB), reserva de state machines e
+// canais, descarte de quadros repetidos e a espera do reset entre quadros
+
+#define MAX_PROGRAM 32
+#define MAX_CYCLES 20000
+
+// Janelas do WS2812B: 150 ns para mais ou para menos em torno do nominal
+#define T1H_NS 800
+#define T1L_NS 450
+#define T0H_NS 400
+#define T0L_NS 850
+#define TOLERANCE_NS 150
+
+typedef struct {
+    uint16_t instructions[MAX_PROGRAM];
+    uint length;
+    uint wrap_target;
+    uint wrap;
+} program_t;
+
+// Montador só das instruções que o programa usa: out, jmp e set, com atraso opcional
+static int find_label(char labels[][32], uint count, const char *name)
+{
+    for (uint i = 0; i < count; i++)
+    {
+        if (!strcmp(labels[i], name))
+            return (int)i;
+    }
+    return -1;
+}
+
+static char *trim(char *s)
+{
+    while (*s == ' ' || *s == '\t')
+        s++;
+    char *end = s + strlen(s);
+    while (end > s && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r' || end[-1] == '\n'))
+        *--end = '\0';
+    return s;
+}
+
+static bool assemble(const char *path, program_t *program)
+{
+    char lines[64][128];
+    uint line_count = 0;
+    FILE *f = fopen(path, "r");
+    CHECK(f != NULL);
+    if (!f)
+        return false;
+    char buffer[256];
+    while (fgets(buffer, sizeof(buffer), f) && line_count < 64)
+    {
+        if (buffer[0] == '%')
+            break; // Começo da seção c-sdk
+        char *comment = strpbrk(buffer, ";");
+        if (comment)
+            *comment = '\0';
+        comment = strstr(buffer, "//");
+        if (comment)
+            *comment = '\0';
+        char *line = trim(buffer);
+        if (*line && strncmp(line, ".program", 8))
+            snprintf(lines[line_count++], sizeof(lines[0]), "%s", line);
+    }
+    fclose(f);
+
+    // Primeira passada: endereço de cada rótulo e das diretivas de wrap
+    char labels[MAX_PROGRAM][32];
+    uint label_pc[MAX_PROGRAM], label_count = 0, pc = 0;
+    for (uint i = 0; i < line_count; i++)
+    {
+        char *colon = strchr(lines[i], ':');
+        if (!strcmp(lines[i], ".wrap_target"))
+            program->wrap_target = pc;
+        else if (!strcmp(lines[i], ".wrap"))
+            program->wrap = pc - 1;
+        else if (colon && label_count < MAX_PROGRAM)
+        {
+            *colon = '\0';
+            snprintf(labels[label_count], sizeof(labels[0]), "%s", trim(lines[i]));
+            label_pc[label_count++] = pc;
+            lines[i][0] = '\0';
+        }
+        else
+            pc++;
+    }
+
+    // Segunda passada: codificação
+    program->length = 0;
+    for (uint i = 0; i < line_count; i++)
+    {
+        char op[16] = "", a[16] = "", b[16] = "";
+        uint delay = 0;
+        if (!lines[i][0] || lines[i][0] == '.')
+            continue;
+        char *bracket = strchr(lines[i], '[');
+        if (bracket)
+        {
+            delay = (uint)atoi(bracket + 1);
+            *bracket = '\0';
+        }
+        for (char *c = lines[i]; *c; c++)
+        {
+            if (*c == ',')
+                *c = ' ';
+        }
+        int fields = sscanf(lines[i], "%15s %15s %15s", op, a, b);
+        uint16_t word;
+        if (!strcmp(op, "out") && fields == 3 && !strcmp(a, "x"))
+            word = 0x6000 | (1 << 5) | (atoi(b) & 31);
+        else if (!strcmp(op, "set") && fields == 3 && !strcmp(a, "pins"))
+            word = 0xE000 | (atoi(b) & 31);
+        else if (!strcmp(op, "jmp") && (fields == 2 || (fields == 3 && !strcmp(a, "!x"))))
+        {
+            int label = find_label(labels, label_count, fields == 2 ? a : b);
+            CHECK(label >= 0);
+            word = (fields == 3 ? 1 << 5 : 0) | (label >= 0 ? label_pc[label] : 0);
+        }
+        else
+        {
+            printf("%s: instrução não suportada pelo teste: %s\n", path, lines[i]);
+            test_failures++;
+            return false;
+        }
+        CHECK(delay < 32);
+        CHECK(program->length < MAX_PROGRAM);
+        if (program->length < MAX_PROGRAM)
+            program->instructions[program->length++] = word | (uint16_t)(delay << 8);
+    }
+    return true;
+}
+
+// Executa o programa como a state machine: OUT com autopull de 'threshold' bits deslocando para a
+// esquerda, e para (como a state machine parada no autopull) quando a FIFO acaba.
+// Grava o nível do pino em cada ciclo e retorna quantos ciclos rodaram
+static uint run(const program_t *program, const uint32_t *fifo, size_t fifo_len, uint threshold, bool *pin)
+{
+    uint pc = program->wrap_target, cycles = 0, shifted = 32;
+    uint32_t osr = 0, x = 0;
+    size_t next = 0;
+    bool level = false;
+
+    while (cycles < MAX_CYCLES)
+    {
+        uint16_t word = program->instructions[pc];
+        uint delay = (word >> 8) & 31;
+        uint next_pc = pc == program->wrap ? program->wrap_target : pc + 1;
+        switch (word >> 13)
+        {
+        case 0: // jmp
+            if ((word >> 5 & 7) == 0 || ((word >> 5 & 7) == 1 && !x))
+                next_pc = word & 31;
+            break;
+        case 3: // out x
+        {
+            if (shifted >= threshold)
+            {
+                if (next == fifo_len)
+                    return cycles;
+                osr = fifo[next++];
+                shifted = 0;
+            }
+            uint count = word & 31;
+            x = osr >> (32 - count);
+            osr <<= count;
+            shifted += count;
+            break;
+        }
+        case 7: // set pins
+            level = word & 1;
+            break;
+        }
+        for (uint c = 0; c <= delay && cycles < MAX_CYCLES; c++)
+            pin[cycles++] = level;
+        pc = next_pc;
+    }
+    return cycles;
+}
+
+typedef struct {
+    uint high;   // Ciclos em nível alto
+    uint period; // Da subida deste bit até a do próximo (0 no último)
+    uint rise;   // Ciclo da subida
+} bit_t;
+
+// Separa os bits pelas subidas do pino
+static uint split_bits(const bool *pin, uint cycles, bit_t *bits, uint max_bits)
+{
+    uint count = 0;
+    for (uint c = 0; c < cycles; c++)
+    {
+        if (!pin[c] || (c > 0 && pin[c - 1]))
+            continue;
+        if (count)
+            bits[count - 1].period = c - bits[count - 1].rise;
+        if (count == max_bits)
+            break;
+        uint high = 0;
+        while (c + high < cycles && pin[c + high])
+            high++;
+        bits[count].high = high;
+        bits[count].period = 0;
+        bits[count].rise = c;
+        count++;
+    }
+    return count;
+}
+
+static program_t source;
+
+static void test_program_source(void)
+{
+    CHECK(assemble(WS2812_PIO_PATH, &source));
+
+    // O cabeçalho do host é o mesmo programa que o pioasm gera do arquivo
+    CHECK_EQ(source.length, ws2812_program.length);
+    CHECK_EQ(source.wrap_target, ws2812_wrap_target);
+    CHECK_EQ(source.wrap, ws2812_wrap);
+    for (uint i = 0; i < source.length && i < ws2812_program.length; i++)
+        CHECK_EQ(source.instructions[i], ws2812_program_instructions[i]);
+
+    // Cada bit leva WS2812_CYCLES_PER_BIT ciclos: 6 em alto para 1 e 3 para 0
+    static const uint32_t words[] = {0xAAAAAA00, 0xFF00F000, 0x0F0F0F00};
+    static bool pin[MAX_CYCLES];
+    static bit_t bits[128];
+    uint cycles = run(&source, words, 3, 24, pin);
+    uint count = split_bits(pin, cycles, bits, 128);
+    CHECK_EQ(count, 3 * 24);
+    for (uint i = 0; i < count; i++)
+    {
+        bool one = (words[i / 24] >> (31 - i % 24)) & 1;
+        CHECK_EQ(bits[i].high, one ? 6 : 3);
+        if (i + 1 < count)
+            CHECK_EQ(bits[i].period, WS2812_CYCLES_PER_BIT);
+    }
+}
+
+// Ciclos do PIO em ns com o divisor da state machine
+static uint cycles_ns(uint cycles, float clkdiv)
+{
+    return (uint)(cycles * clkdiv * 1e9f / clock_get_hz(clk_sys) + 0.5f);
+}
+
+static bool in_window(uint ns, uint nominal)
+{
+    return ns + TOLERANCE_NS >= nominal && ns <= nominal + TOLERANCE_NS;
+}
+
+static void complete(const ws2812_t *strip)
+{
+    host_dma_complete(strip->dma_chan);
+}
+
+static host_pio_sm_t *sm_of(const ws2812_t *strip)
+{
+    return &host_pio_sm[pio_get_index(strip->pio)][strip->sm];
+}
+
+// Confere o fluxo de bits que a state machine tira da FIFO: os pixels em GRB, o bit mais alto primeiro,
+// e o tempo de cada bit dentro das janelas do WS2812B
+static void check_bitstream(const ws2812_t *strip, const uint32_t *pixels, uint num_pixels)
+{
+    static bool pin[MAX_CYCLES];
+    static bit_t bits[MAX_CYCLES / WS2812_CYCLES_PER_BIT];
+    host_pio_sm_t *sm = sm_of(strip);
+    const pio_sm_config *config = &sm->config;
+
+    CHECK_EQ(sm->fifo_len, num_pixels);
+    CHECK(config->autopull);
+    CHECK(!config->out_shift_right);
+    uint cycles = run(&source, sm->fifo, sm->fifo_len, config->pull_threshold, pin);
+    uint count = split_bits(pin, cycles, bits, MAX_CYCLES / WS2812_CYCLES_PER_BIT);
+    CHECK_EQ(count, num_pixels * 24);
+    if (count != num_pixels * 24)
+        return;
+
+    for (uint p = 0; p < num_pixels; p++)
+    {
+        uint32_t grb = 0;
+        for (uint b = 0; b < 24; b++)
+        {
+            const bit_t *bit = &bits[p * 24 + b];
+            bool one = bit->high > WS2812_CYCLES_PER_BIT / 2 - 1;
+            grb = grb << 1 | one;
+            uint high_ns = cycles_ns(bit->high, config->clkdiv);
+            CHECK(in_window(high_ns, one ? T1H_NS : T0H_NS));
+            if (bit->period)
+            {
+                uint low_ns = cycles_ns(bit->period - bit->high, config->clkdiv);
+                CHECK(in_window(low_ns, one ? T1L_NS : T0L_NS));
+                CHECK_EQ(cycles_ns(bit->period, config->clkdiv), 1000000000 / WS2812_BIT_RATE_HZ);
+            }
+        }
+        CHECK_EQ(grb, pixels[p] >> 8);
+    }
+}
+
+#define STRIP_PIXELS 8
+
+static ws2812_t strip_a, strip_b;
+static uint32_t tx_a[STRIP_PIXELS], tx_b[STRIP_PIXELS];
+
+static void test_init(void)
+{
+    host_clk_sys_hz = 133000000; // O clock que o main configura
+    CHECK(ws2812_init(&strip_a, pio0, 7, tx_a, STRIP_PIXELS));
+    CHECK_EQ(host_pio_used[0], ws2812_program.length);
+    const host_pio_sm_t *sm = sm_of(&strip_a);
+    CHECK(sm->claimed && sm->enabled);
+    CHECK_EQ(sm->config.set_base, 7);
+    CHECK_EQ(sm->config.set_count, 1);
+    CHECK_EQ(sm->config.join, PIO_FIFO_JOIN_TX);
+    CHECK_EQ(sm->config.pull_threshold, 24);
+    CHECK(sm->config.clkdiv > 16.62f && sm->config.clkdiv < 16.63f);
+    CHECK(host_dma[strip_a.dma_chan].write_addr == &pio0->txf[strip_a.sm]);
+
+    // A inicialização apaga os LEDs
+    complete(&strip_a);
+    static const uint32_t off[STRIP_PIXELS] = {0};
+    check_bitstream(&strip_a, off, STRIP_PIXELS);
+
+    // Segunda fileira no mesmo bloco: o programa não é carregado de novo, state machine e canal próprios
+    CHECK(ws2812_init(&strip_b, pio0, 8, tx_b, STRIP_PIXELS));
+    CHECK_EQ(host_pio_used[0], ws2812_program.length);
+    CHECK(strip_b.sm != strip_a.sm);
+    CHECK(strip_b.dma_chan != strip_a.dma_chan);
+    CHECK_EQ(sm_of(&strip_b)->offset, sm_of(&strip_a)->offset);
+
+    // Com as quatro state machines ocupadas a quinta fileira é recusada
+    static ws2812_t more[3];
+    static uint32_t tx_more[3][STRIP_PIXELS];
+    CHECK(ws2812_init(&more[0], pio0, 9, tx_more[0], STRIP_PIXELS));
+    CHECK(ws2812_init(&more[1], pio0, 10, tx_more[1], STRIP_PIXELS));
+    CHECK(!ws2812_init(&more[2], pio0, 11, tx_more[2], STRIP_PIXELS));
+
+    // Sem canal de DMA livre a state machine reservada é devolvida
+    bool taken[HOST_DMA_CHANNELS];
+    for (int c = 0; c < HOST_DMA_CHANNELS; c++)
+    {
+        taken[c] = !host_dma[c].claimed;
+        host_dma[c].claimed = true;
+    }
+    CHECK(!ws2812_init(&more[2], pio1, 11, tx_more[2], STRIP_PIXELS));
+    for (uint s = 0; s < NUM_PIO_STATE_MACHINES; s++)
+        CHECK(!host_pio_sm[1][s].claimed);
+    for (int c = 0; c < HOST_DMA_CHANNELS; c++)
+    {
+        if (taken[c])
+            host_dma[c].claimed = false;
+    }
+}
+
+static void test_bitstream_at_any_clock(void)
+{
+    static const uint32_t frame[STRIP_PIXELS] = {0xFF000000, 0x00FF0000, 0x0000FF00, 0x80402000,
+                                                 0x01020300, 0xAA55AA00, 0xFFFFFF00, 0x12345600};
+
+    host_pio_fifo_clear(pio0, strip_a.sm);
+    CHECK(ws2812_show(&strip_a, frame));
+    complete(&strip_a);
+    check_bitstream(&strip_a, frame, STRIP_PIXELS);
+
+    // O divisor sai do clock do sistema na inicialização: a 125 MHz o tempo de cada bit é o mesmo
+    static ws2812_t strip;
+    static uint32_t tx[STRIP_PIXELS];
+    host_clk_sys_hz = 125000000;
+    CHECK(ws2812_init(&strip, pio1, 12, tx, STRIP_PIXELS));
+    CHECK(sm_of(&strip)->config.clkdiv == 15.625f);
+    complete(&strip);
+    host_pio_fifo_clear(pio1, strip.sm);
+    CHECK(ws2812_show(&strip, frame));
+    complete(&strip);
+    check_bitstream(&strip, frame, STRIP_PIXELS);
+    host_clk_sys_hz = 133000000;
+}
+
+static void test_show_skips_and_waits(void)
+{
+    const uint64_t frame_us = STRIP_PIXELS * WS2812_PIXEL_US + WS2812_RESET_US;
+    uint32_t first[STRIP_PIXELS], second[STRIP_PIXELS], copy[STRIP_PIXELS];
+    for (int i = 0; i < STRIP_PIXELS; i++)
+    {
+        first[i] = (uint32_t)(i + 1) << 24;
+        second[i] = (uint32_t)(i + 1) << 8;
+    }
+    memcpy(copy, first, sizeof(copy));
+
+    host_time_us = 1000000;
+    complete(&strip_b);
+    uint32_t transfers = host_dma[strip_b.dma_chan].transfers;
+    CHECK(ws2812_show(&strip_b, first));
+    CHECK_EQ(strip_b.ready_us, 1000000 + frame_us);
+    CHECK_EQ(host_time_us, 1000000); // O quadro anterior já tinha terminado: não espera
+    CHECK_EQ(host_dma[strip_b.dma_chan].transfers, transfers + 1);
+
+    // Mesmo conteúdo, mesmo em outro buffer: não reenvia nem espera
+    CHECK(!ws2812_show(&strip_b, copy));
+    CHECK(!ws2812_show(&strip_b, first));
+    CHECK_EQ(host_time_us, 1000000);
+    CHECK_EQ(host_dma[strip_b.dma_chan].transfers, transfers + 1);
+
+    // Quadro novo logo em seguida: o anterior sai inteiro da FIFO e o novo só começa depois do reset
+    host_pio_fifo_clear(pio0, strip_b.sm);
+    host_time_us += 100;
+    CHECK(ws2812_show(&strip_b, second));
+    CHECK_EQ(host_time_us, 1000000 + frame_us);
+    CHECK_EQ(strip_b.ready_us, 1000000 + 2 * frame_us);
+    CHECK_EQ(sm_of(&strip_b)->fifo_len, STRIP_PIXELS);
+    CHECK(!memcmp(sm_of(&strip_b)->fifo, first, sizeof(first)));
+    CHECK(!memcmp(strip_b.tx, second, sizeof(second)));
+
+    // Passado o prazo, o próximo quadro sai sem espera
+    host_time_us = strip_b.ready_us + 1;
+    uint64_t now = host_time_us;
+    CHECK(ws2812_show(&strip_b, first));
+    CHECK_EQ(host_time_us, now);
+    CHECK_EQ(strip_b.ready_us, now + frame_us);
+
+    // A outra fileira não espera por esta
+    now = host_time_us;
+    complete(&strip_a);
+    CHECK(ws2812_show(&strip_a, second));
+    CHECK_EQ(host_time_us, now);
+}
+
+int main(void)
+{
+    test_program_source();
+    test_init();
+    test_bitstream_at_any_clock();
+    test_show_skips_and_waits();
+    return TEST_RESULT;
+}
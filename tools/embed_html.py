@@ -0,0 +1,162 @@
+#!/usr/bin/env python3
+# Gera o header C com a página do painel a partir de public/index.html.
+# A página é minificada, comprimida com gzip e identificada por um ETag derivado do conteúdo,
+# para o servidor responder 304 quando o navegador já tiver a mesma versão.
+#
+# Uso: embed_html.py <entrada.html> <saida.h>
+
+import gzip
+import hashlib
+import re
+import sys
+
+
+# Caracteres que nunca se juntam a um vizinho formando outro token: espaços ao lado deles sobram
+CSS_DELIMITERS = '{};,>'
+JS_DELIMITERS = '{}()[];,:'
+JS_OPERATORS = '=<>!&|?+-*/%'
+
+
+def split_strings(code, quotes, comments):
+    # Separa o código em trechos (texto, é_literal). Literais de string vão inteiros, comentários somem.
+    # Não reconhece literais de regex: a página não usa
+    parts, text, i = [], [], 0
+    while i < len(code):
+        c = code[i]
+        if c in quotes:
+            j = i + 1
+            while j < len(code) and code[j] != c:
+                j += 2 if code[j] == '\\' else 1
+            parts.append((''.join(text), False))
+            parts.append((code[i:j + 1], True))
+            text, i = [], j + 1
+        elif comments and code.startswith('/*', i):
+            i = code.index('*/', i + 2) + 2
+            text.append(' ')
+        elif comments == 'js' and code.startswith('//', i):
+            i = code.find('\n', i)
+            i = len(code) if i < 0 else i
+        else:
+            text.append(c)
+            i += 1
+    parts.append((''.join(text), False))
+    return parts
+
+
+def squeeze(parts, removable):
+    # Junta os trechos trocando cada sequência de espaços pelo mínimo que 'removable' permite:
+    # nada, um espaço ou uma quebra de linha (que no JavaScript pode encerrar um comando)
+    out = []
+    for text, literal in parts:
+        if literal:
+            out.append(text)
+            continue
+        for m in re.finditer(r'\s+|[^\s]+', text):
+            run = m.group()
+            if not run.isspace():
+                out.append(run)
+                continue
+            prev = out[-1][-1] if out and out[-1] else ''
+            nxt = text[m.end()] if m.end() < len(text) else ''
+            keep = removable(prev, nxt, '\n' in run)
+            if keep:
+                out.append(keep)
+    return ''.join(out)
+
+
+def minify_css(css):
+    def removable(prev, nxt, newline):
+        if not prev or not nxt or prev in CSS_DELIMITERS or nxt in CSS_DELIMITERS:
+            return ''
+        return ' '
+    css = squeeze(split_strings(css, '\'"', 'css'), removable)
+    return css.replace(';}', '}')
+
+
+def minify_js(js):
+    def removable(prev, nxt, newline):
+        if not prev or not nxt:
+            return ''
+        if newline and prev not in ';{,(' and nxt not in '})]':
+            return '\n' # A quebra pode ser um ponto e vírgula implícito
+        if prev in JS_DELIMITERS or nxt in JS_DELIMITERS:
+            return ''
+        # Entre dois operadores o espaço separa tokens ("a - -b"), entre um operador e um nome não
+        if (prev in JS_OPERATORS) != (nxt in JS_OPERATORS):
+            return ''
+        return ' '
+    return squeeze(split_strings(js, '\'"`', 'js'), removable)
+
+
+def minify_markup(html):
+    # Espaços com quebra de linha entre tags (ou antes de um <style> ou <script>) somem,
+    # os demais viram um espaço só
+    html = re.sub(r'>\s*\n\s*(?=<|$)', '>', html)
+    html = re.sub(r'^\s*\n\s*<', '<', html)
+    return re.sub(r'\s+', ' ', html)
+
+
+def minify(html):
+    # Remove comentários e espaços do HTML, do CSS dos <style> e do JavaScript dos <script>
+    html = re.sub(r'<!--.*?-->', '', html, flags=re.S)
+    out, pos = [], 0
+    for m in re.finditer(r'(<(style|script)\b[^>]*>)(.*?)(</\2>)', html, flags=re.S | re.I):
+        out.append(minify_markup(html[pos:m.start()]))
+        code = minify_css(m.group(3)) if m.group(2).lower() == 'style' else minify_js(m.group(3))
+        out.append(m.group(1) + code + m.group(4))
+        pos = m.end()
+    out.append(minify_markup(html[pos:]))
+    return ''.join(out).strip()
+
+
+def c_string(data, width=96):
+    # Literais de até 'width' caracteres da página, um por linha, com escape do que o C exige
+    out = []
+    lines = data.split('\n')
+    for n, line in enumerate(lines):
+        pieces = [line[i:i + width] for i in range(0, len(line), width)] or ['']
+        if n < len(lines) - 1:
+            pieces[-1] += '\n'
+        for piece in pieces:
+            escaped = piece.replace('\\', '\\\\').replace('"', '\\"').replace('\n', '\\n')
+            out.append('"%s"' % escaped)
+    return '\n'.join(out)
+
+
+def c_bytes(data):
+    rows = []
+    for i in range(0, len(data), 16):
+        rows.append('    ' + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',')
+    return '\n'.join(rows)
+
+
+def main():
+    source, output = sys.argv[1], sys.argv[2]
+    with open(source, encoding='utf-8') as f:
+        original = f.read()
+
+    text = minify(original)
+    raw = text.encode('utf-8')
+    # mtime fixo para o arquivo gerado (e o ETag) só mudar quando a página mudar
+    compressed = gzip.compress(raw, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(raw).hexdigest()[:16]
+
+    with open(output, 'w', encoding='utf-8') as f:
+        f.write('// Gerado por tools/embed_html.py a partir de public/index.html, não editar\n')
+        f.write('#ifndef HTML_DATA_H\n#define HTML_DATA_H\n\n')
+        f.write('// Página minificada, para clientes que não aceitam gzip\n')
+        f.write('static const char html_data[] =\n%s;\n\n' % c_string(text))
+        f.write('// A mesma página comprimida com gzip\n')
+        f.write('static const unsigned char html_data_gz[] = {\n%s\n};\n\n' % c_bytes(compressed))
+        f.write('// ETag forte de cada representação\n')
+        f.write('#define HTML_DATA_ETAG "\\"%s\\""\n' % etag)
+        f.write('#define HTML_DATA_GZ_ETAG "\\"%s-gz\\""\n' % etag)
+        f.write('#define HTML_DATA_ETAG_ID "%s" // Parte comum, usada para validar o If-None-Match\n\n' % etag)
+        f.write('#endif // HTML_DATA_H\n')
+
+    print('index.html: %d bytes, minificado %d bytes, gzip %d bytes' %
+          (len(original.encode('utf-8')), len(raw), len(compressed)))
+
+
+if __name__ == '__main__':
+    main()